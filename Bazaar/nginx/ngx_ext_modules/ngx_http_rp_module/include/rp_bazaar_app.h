@@ -53,6 +53,11 @@ typedef const char  *(*rp_app_desc_func)(void);
 typedef int          (*rp_set_params_func)(rp_app_params_t *p, int len);
 typedef int          (*rp_get_params_func)(rp_app_params_t **p);
 typedef int          (*rp_get_signals_func)(float ***s, int *sig_num, int *sig_len);
+/* Optional: */
+typedef int          (*rp_get_wf_rows_func)(unsigned char *cha, unsigned char *chb,
+                                            int max_rows, int *cols,
+                                            unsigned int *seq);
+typedef int          (*rp_wait_signals_func)(int timeout_ms);
 
 /*WebSocket Server part*/
 typedef void		(*rp_ws_set_params_interval_func)(int);
@@ -64,6 +69,7 @@ typedef const char     *(*rp_ws_get_signals_func)(void);
 typedef int		(*rp_ws_set_params_func)(const char *_params);
 typedef int		(*rp_ws_set_signals_func)(const char *_signals);
 typedef void	(*rp_ws_gzip_func)(const char *_in, void* _data, size_t* _size);
+typedef const void     *(*rp_ws_get_signals_binary_func)(size_t* _size);
 
 typedef struct rp_bazaar_app_s {
     /* Initialization function - called when app. is loaded */
@@ -83,6 +89,11 @@ typedef struct rp_bazaar_app_s {
     rp_get_params_func       get_params_func;
     /* Retrieves last good signals from the application */
     rp_get_signals_func      get_signals_func;
+    /* Retrieves new waterfall lines (optional, NULL if not provided) */
+    rp_get_wf_rows_func      get_wf_rows_func;
+    /* Blocks until get_signals_func() has new signals, at most timeout_ms
+     * (optional, NULL if not provided - then the signals are polled) */
+    rp_wait_signals_func     wait_signals_func;
 
 	/*WebSocket Server part*/
 
@@ -98,6 +109,7 @@ typedef struct rp_bazaar_app_s {
 	rp_ws_set_params_interval_func ws_set_params_demo_func;
 	rp_ws_set_params_func verify_app_license_func;
 	rp_ws_gzip_func ws_gzip_func;
+	rp_ws_get_signals_binary_func ws_get_signals_binary_func;
 
     /* Dynamic library handle */
     void            *handle;
@@ -39,6 +39,7 @@ int rp_data_get_signals_list(ngx_http_request_t *r,
 int rp_data_get_params(ngx_http_request_t *r, cJSON **json_root);
 int rp_data_set_signals(ngx_http_request_t *r, cJSON **json_root);
 int rp_data_get_signals(ngx_http_request_t *r, cJSON **json_root);
+void rp_data_add_wf_rows(ngx_http_request_t *r, cJSON *data_root);
 /* Clear dirty flag in case of re-send */
 void rp_data_clear_signals_dirty();
 
@@ -36,6 +36,8 @@ const char *c_rp_set_params_str   = "rp_set_params";
 const char *c_rp_get_params_str   = "rp_get_params";
 const char *c_rp_set_signals_str  = "rp_set_signals";
 const char *c_rp_get_signals_str  = "rp_get_signals";
+const char *c_rp_get_wf_rows_str  = "rp_get_wf_rows";
+const char *c_rp_wait_signals_str = "rp_wait_signals";
 
 //start web socket function str
 
@@ -48,6 +50,7 @@ const char *c_ws_get_params_str   = "ws_get_params";
 const char *c_ws_set_signals_str  = "ws_set_signals";
 const char *c_ws_get_signals_str  = "ws_get_signals";
 const char* c_ws_gzip_str = "ws_gzip";
+const char* c_ws_get_signals_binary_str = "ws_get_signals_binary";
 // end web socket function str
 
 /** Get MAC address of a specific NIC via sysfs */
@@ -401,6 +404,11 @@ int rp_bazaar_app_load_module(const char *app_file, rp_bazaar_app_t *app)
     if(!app->get_signals_func)
         return -7;
 
+    /* Optional: only applications with a waterfall provide it */
+    app->get_wf_rows_func = dlsym(app->handle, c_rp_get_wf_rows_str);
+    /* Optional: applications which notify about new signals */
+    app->wait_signals_func = dlsym(app->handle, c_rp_wait_signals_str);
+
     // start web socket functionality
     app->ws_api_supported = 1;
     app->ws_set_params_interval_func = dlsym(app->handle, c_ws_set_params_interval_str);
@@ -466,6 +474,9 @@ int rp_bazaar_app_load_module(const char *app_file, rp_bazaar_app_t *app)
         fprintf(stderr, "Cannot resolve '%s' function.\n", c_ws_gzip_str);
     }
 
+    /* Optional: applications built with an older SDK have no binary signal frames */
+    app->ws_get_signals_binary_func = dlsym(app->handle, c_ws_get_signals_binary_str);
+
     // end web socket functionality
 
     app->file_name = (char *)malloc(strlen(app_file)+1);
@@ -27,6 +27,9 @@ static int     rp_signals_dirty = 0;
 
 #define TRACE(args...) fprintf(stderr, args)
 
+/* Max. number of waterfall lines sent in one response, older ones are skipped */
+#define RP_DATA_WF_MAX_ROWS 256
+
 
 /*----------------------------------------------------------------------------*/
 /* request private context, used to shared data between different callback functions
@@ -436,18 +439,29 @@ int rp_data_get_signals(ngx_http_request_t *r, cJSON **json_root)
         rp_module_ctx.app.get_signals_func((float ***)&rp_signals, &rp_sig_num, 
                                            &rp_sig_len);
 
-    while(ret_val == -1) {
-        ret_val =
-            rp_module_ctx.app.get_signals_func((float ***)&rp_signals, 
-                                               &rp_sig_num, &rp_sig_len);
-
-        if(ret_val == -2) 
-            break;
-        if(retries-- <= 0) {
-            /* Use old signals */
-            break;
-        } else {
-            usleep(1000);
+    if(rp_module_ctx.app.wait_signals_func) {
+        /* Sleep until the application publishes new signals instead of
+         * polling, on timeout the old signals are used */
+        if((ret_val == -1) &&
+           (rp_module_ctx.app.wait_signals_func(retries) > 0)) {
+            ret_val =
+                rp_module_ctx.app.get_signals_func((float ***)&rp_signals, 
+                                                   &rp_sig_num, &rp_sig_len);
+        }
+    } else {
+        while(ret_val == -1) {
+            ret_val =
+                rp_module_ctx.app.get_signals_func((float ***)&rp_signals, 
+                                                   &rp_sig_num, &rp_sig_len);
+
+            if(ret_val == -2) 
+                break;
+            if(retries-- <= 0) {
+                /* Use old signals */
+                break;
+            } else {
+                usleep(1000);
+            }
         }
     }
     ret_val = ret_val;
@@ -472,9 +486,71 @@ int rp_data_get_signals(ngx_http_request_t *r, cJSON **json_root)
                                                rp_sig_len, r->pool),
                           r->pool);
 
+    if(rp_module_ctx.app.get_wf_rows_func)
+        rp_data_add_wf_rows(r, data_root);
+
     return ret_val;
 }
 
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Adds the waterfall lines added since the last response
+ *
+ * The lines are colour map indexes, one byte per column, and are sent base64
+ * encoded in "wf": { "seq", "rows", "cols", "ch1", "ch2" } instead of
+ * rendering an image per frame on the device.
+ */
+void rp_data_add_wf_rows(ngx_http_request_t *r, cJSON *data_root)
+{
+    cJSON    *wf_root;
+    u_char   *cha, *chb;
+    ngx_str_t src, dst;
+    unsigned int seq = 0;
+    int       cols, rows;
+
+    if(rp_module_ctx.app.get_wf_rows_func(NULL, NULL, 0, &cols, &seq) < 0 ||
+       cols <= 0)
+        return;
+
+    cha = ngx_palloc(r->pool, 2 * RP_DATA_WF_MAX_ROWS * cols);
+    if(cha == NULL)
+        return;
+    chb = cha + RP_DATA_WF_MAX_ROWS * cols;
+
+    rows = rp_module_ctx.app.get_wf_rows_func(cha, chb, RP_DATA_WF_MAX_ROWS,
+                                              &cols, &seq);
+    if(rows < 0)
+        return;
+
+    cJSON_AddItemToObject(data_root, "wf",
+                          wf_root=cJSON_CreateObject(r->pool), r->pool);
+    cJSON_AddItemToObject(wf_root, "seq", cJSON_CreateNumber(seq, r->pool),
+                          r->pool);
+    cJSON_AddItemToObject(wf_root, "rows", cJSON_CreateNumber(rows, r->pool),
+                          r->pool);
+    cJSON_AddItemToObject(wf_root, "cols", cJSON_CreateNumber(cols, r->pool),
+                          r->pool);
+
+    /* Both channels share one output buffer, plus the terminating zero */
+    src.len = rows * cols;
+    dst.data = ngx_palloc(r->pool, 2 * (ngx_base64_encoded_length(src.len) + 1));
+    if(dst.data == NULL)
+        return;
+
+    src.data = cha;
+    ngx_encode_base64(&dst, &src);
+    dst.data[dst.len] = '\0';
+    cJSON_AddItemToObject(wf_root, "ch1",
+                          cJSON_CreateString((char *)dst.data, r->pool), r->pool);
+
+    src.data = chb;
+    dst.data += dst.len + 1;
+    ngx_encode_base64(&dst, &src);
+    dst.data[dst.len] = '\0';
+    cJSON_AddItemToObject(wf_root, "ch2",
+                          cJSON_CreateString((char *)dst.data, r->pool), r->pool);
+}
+
 /*----------------------------------------------------------------------------*/
 /**
  * @brief Clear Signal Dirty flag
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <libjson.h>
 
 class CBaseParameter  //base class for parameter and signal
@@ -27,4 +28,6 @@ public:
 	virtual bool IsNewValue() const = 0;
 	virtual void ClearNewValue() = 0;
 	virtual bool NeedSend(bool _no_need=false) const { return _no_need; };
+	virtual bool IsBinary() const { return false; }	// sent in the binary signal frame instead of JSON
+	virtual bool AppendBinary(std::string& _frame, bool _keyframe) { return false; }	// false when suppressed as unchanged
 };
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Binary signal frame, sent next to the gzipped JSON frame on the signal timer.
+// All fields are little-endian (host order on the ARM and x86 targets).
+//
+//   frame header : "RPSB" magic, uint8 version, uint8 flags, uint16 record count, uint32 sequence
+//   record       : uint8 name length, name, uint8 type, uint8 encoding,
+//                  uint32 element count, uint32 payload bytes, payload
+//
+// Gzip streams start with 0x1f 0x8b, so a client tells both frame kinds apart by the first byte.
+// Signals whose payload did not change since the last frame are left out; the client keeps
+// the previous copy.
+
+#define BINARY_SIGNAL_MAGIC         "RPSB"
+#define BINARY_SIGNAL_VERSION       1
+#define BINARY_SIGNAL_HEADER_SIZE   12
+#define BINARY_SIGNAL_FLAG_KEYFRAME 0x01	// every record is raw and every binary signal is present
+
+enum BinarySignalType : uint8_t
+{
+	BST_FLOAT32 = 0,
+	BST_INT16,
+	BST_INT32,
+	BST_UINT8
+};
+
+enum BinarySignalEncoding : uint8_t
+{
+	BSE_RAW = 0,	// element count values
+	BSE_SPANS		// repeated {uint16 unchanged, uint16 changed, changed values} against the previous frame
+};
+
+template <typename Type> struct TBinarySignalTraits;
+
+template <> struct TBinarySignalTraits<float>   { typedef float   WireType; static const uint8_t type = BST_FLOAT32; };
+template <> struct TBinarySignalTraits<double>  { typedef float   WireType; static const uint8_t type = BST_FLOAT32; };
+template <> struct TBinarySignalTraits<int16_t> { typedef int16_t WireType; static const uint8_t type = BST_INT16; };
+template <> struct TBinarySignalTraits<int>     { typedef int32_t WireType; static const uint8_t type = BST_INT32; };
+template <> struct TBinarySignalTraits<uint8_t> { typedef uint8_t WireType; static const uint8_t type = BST_UINT8; };
+
+inline void BinaryAppend(std::string& _out, const void* _data, size_t _size)
+{
+	_out.append(static_cast<const char*>(_data), _size);
+}
+
+template <typename T>
+inline void BinaryAppendValue(std::string& _out, T _value)
+{
+	BinaryAppend(_out, &_value, sizeof(T));
+}
+
+// Encodes the elements that differ from _prev as spans. Gives up and returns false as soon as
+// the encoding gets larger than the raw payload.
+template <typename T>
+bool BinaryEncodeSpans(const std::vector<T>& _cur, const std::vector<T>& _prev, std::string& _out)
+{
+	const size_t n = _cur.size();
+	const size_t limit = n * sizeof(T);
+	const size_t start = _out.size();
+	size_t i = 0;
+
+	while (i < n)
+	{
+		size_t same = i;
+		while (same < n && same - i < 0xFFFF && memcmp(&_cur[same], &_prev[same], sizeof(T)) == 0)
+			++same;
+		size_t diff = same;
+		while (diff < n && diff - same < 0xFFFF && memcmp(&_cur[diff], &_prev[diff], sizeof(T)) != 0)
+			++diff;
+
+		BinaryAppendValue<uint16_t>(_out, same - i);
+		BinaryAppendValue<uint16_t>(_out, diff - same);
+		BinaryAppend(_out, &_cur[same], (diff - same) * sizeof(T));
+		if (_out.size() - start >= limit)
+		{
+			_out.resize(start);
+			return false;
+		}
+		i = diff;
+	}
+	return true;
+}
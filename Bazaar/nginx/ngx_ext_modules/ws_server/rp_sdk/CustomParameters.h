@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "Parameter.h"
+#include "BinarySignal.h"
 
 #define CONFIG_VAR 1
 
@@ -185,11 +186,11 @@ template <typename Type> class CCustomSignal : public CParameter<Type, std::vect
 public:
 	CCustomSignal(std::string _name, int _size, Type _def_value)
 		:CParameter<Type, std::vector<Type> >(_name, CBaseParameter::RO, std::vector<Type>(_size, _def_value)),
-		m_Dirty(true){}
+		m_Dirty(true), m_Binary(false), m_Spans(false) {}
 
 	CCustomSignal(std::string _name, CBaseParameter::AccessMode _access_mode, int _size, Type _def_value)
 		:CParameter<Type, std::vector<Type> >(_name, _access_mode, std::vector<Type>(_size, _def_value)),
-		m_Dirty(true) {}
+		m_Dirty(true), m_Binary(false), m_Spans(false) {}
 
 	~CCustomSignal()
 	{
@@ -268,8 +269,58 @@ public:
 	{
 		m_Dirty = true;
 	}
+
+	// Moves the signal from the JSON frame to the binary frame. With _spans set only the
+	// changed parts are sent when that is smaller than the whole payload.
+	void SetBinary(bool _binary, bool _spans = false)
+	{
+		m_Binary = _binary;
+		m_Spans = _spans;
+		m_Dirty = true;
+		m_SentWire.clear();
+	}
+
+	bool IsBinary() const
+	{
+		return m_Binary;
+	}
+
+	bool AppendBinary(std::string& _frame, bool _keyframe)
+	{
+		typedef typename TBinarySignalTraits<Type>::WireType WireType;
+		const std::vector<Type>& value = this->m_Value.value;
+		std::vector<WireType> wire(value.begin(), value.end());
+
+		bool same_size = m_SentWire.size() == wire.size();
+		if (!_keyframe && same_size && !wire.empty()
+			&& memcmp(wire.data(), m_SentWire.data(), wire.size() * sizeof(WireType)) == 0)
+			return false;
+
+		BinaryAppendValue<uint8_t>(_frame, this->m_Value.name.size());
+		BinaryAppend(_frame, this->m_Value.name.data(), this->m_Value.name.size());
+		BinaryAppendValue<uint8_t>(_frame, TBinarySignalTraits<Type>::type);
+		size_t encoding_pos = _frame.size();
+		BinaryAppendValue<uint8_t>(_frame, BSE_RAW);
+		BinaryAppendValue<uint32_t>(_frame, wire.size());
+		size_t length_pos = _frame.size();
+		BinaryAppendValue<uint32_t>(_frame, 0);
+
+		size_t payload_pos = _frame.size();
+		if (m_Spans && !_keyframe && same_size && BinaryEncodeSpans(wire, m_SentWire, _frame))
+			_frame[encoding_pos] = BSE_SPANS;
+		else
+			BinaryAppend(_frame, wire.data(), wire.size() * sizeof(WireType));
+
+		uint32_t length = _frame.size() - payload_pos;
+		memcpy(&_frame[length_pos], &length, sizeof(length));
+		m_SentWire.swap(wire);
+		return true;
+	}
 private:
 	bool m_Dirty;
+	bool m_Binary;
+	bool m_Spans;
+	std::vector<typename TBinarySignalTraits<Type>::WireType> m_SentWire; // last payload sent in a binary frame
 };
 
 //custom CIntParameter
@@ -356,6 +407,17 @@ public:
 		:CCustomSignal(_name, _access_mode, _size, _def_value){};
 };
 
+//custom CInt16Signal, matches raw ADC counts and the int16 binary frame type
+class CInt16Signal : public CCustomSignal<int16_t>
+{
+public:
+	CInt16Signal(std::string _name, int _size, int16_t _def_value)
+		:CCustomSignal(_name, _size, _def_value){};
+
+	CInt16Signal(std::string _name, CBaseParameter::AccessMode _access_mode, int _size, int16_t _def_value)
+		:CCustomSignal(_name, _access_mode, _size, _def_value){};
+};
+
 //custom CByteSignal
 class CByteSignal : public CCustomSignal<uint8_t>
 {
@@ -4,12 +4,15 @@
 #include "DataManager.h"
 #include "CustomParameters.h"
 #include "misc.h"
+#include "BinarySignal.h"
 
 #include "gziping.h"
 
 CStringParameter InCommandParam("in_command", CBaseParameter::WO, "", 1);
 CStringParameter OutCommandParam("out_command", CBaseParameter::RO, "", 1);
 
+#define BINARY_KEYFRAME_INTERVAL 256 // binary signal frames between forced keyframes
+
 int dbg_printf(const char * format, ...)
 {
 	static FILE* log = fopen("/var/log/redpitaya_nginx/rp_sdk.log", "wt");
@@ -40,6 +43,9 @@ CDataManager::CDataManager()
 	, m_param_interval(20)
 	, m_signal_interval(20)
 	, m_send_all_params(true)
+	, m_signals_frame()
+	, m_signals_seq(0)
+	, m_send_all_signals(true)
 {
 }
 
@@ -129,7 +135,23 @@ std::string CDataManager::GetSignalsJson()
 	UpdateSignals();
 	JSONNode signals(JSON_NODE);
 	signals.set_name("signals");
+
+	bool keyframe = m_send_all_signals || (m_signals_seq % BINARY_KEYFRAME_INTERVAL) == 0;
+	uint16_t records = 0;
+	m_signals_frame.clear();
+	BinaryAppend(m_signals_frame, BINARY_SIGNAL_MAGIC, 4);
+	BinaryAppendValue<uint8_t>(m_signals_frame, BINARY_SIGNAL_VERSION);
+	BinaryAppendValue<uint8_t>(m_signals_frame, keyframe ? BINARY_SIGNAL_FLAG_KEYFRAME : 0);
+	BinaryAppendValue<uint16_t>(m_signals_frame, 0);
+	BinaryAppendValue<uint32_t>(m_signals_frame, m_signals_seq);
+
 	for(size_t i=0; i < m_signals.size(); i++) {
+		if(m_signals[i]->IsBinary()) {
+			if((keyframe || NeedSend(*m_signals[i])) && m_signals[i]->AppendBinary(m_signals_frame, keyframe))
+				records++;
+			m_signals[i]->Update();
+			continue;
+		}
 		if(NeedSend(*m_signals[i])) {
 			JSONNode n(JSON_NODE);
 			n = m_signals[i]->GetJSONObject();
@@ -142,9 +164,22 @@ std::string CDataManager::GetSignalsJson()
 	data_node.set_name("data");
 	data_node.push_back(signals);
 	PostUpdateSignals();
+
+	if(records) {
+		memcpy(&m_signals_frame[6], &records, sizeof(records));
+		m_signals_seq++;
+		m_send_all_signals = false;
+	} else {
+		m_signals_frame.clear();
+	}
 	return data_node.write();
 }
 
+const std::string& CDataManager::GetSignalsBinary() const
+{
+	return m_signals_frame;
+}
+
 void CDataManager::OnNewParams(std::string _params)
 {
 	JSONNode n(JSON_NODE);
@@ -170,8 +205,10 @@ void CDataManager::OnNewParams(std::string _params)
 		}
 	}
 
-	if(InCommandParam.IsNewValue())
-		m_send_all_params |= InCommandParam.NewValue() == "send_all_params";
+	if(InCommandParam.IsNewValue() && InCommandParam.NewValue() == "send_all_params") {
+		m_send_all_params = true;
+		m_send_all_signals = true; // a new client has no previous binary payloads to apply spans to
+	}
 
 	::OnNewParams();
 }
@@ -339,3 +376,16 @@ extern "C" void ws_gzip(const char* _in, void* _out, size_t* _size)
 	memcpy(_out, out.data(), out.size());
 	*_size = out.size();
 }
+
+extern "C" const void * ws_get_signals_binary(size_t* _size)
+{
+	CDataManager * man = CDataManager::GetInstance();
+	if(man)
+	{
+		const std::string& frame = man->GetSignalsBinary();
+		*_size = frame.size();
+		return frame.data();
+	}
+	*_size = 0;
+	return NULL;
+}
@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <map>
+#include <string>
+#include <stdint.h>
 #include "BaseParameter.h"
 
 struct Data {
@@ -23,6 +25,9 @@ private:
 	int m_param_interval; //parameters send time interval in milliseconds
 	int m_signal_interval; //signals send time interval in milliseconds
 	bool m_send_all_params;
+	std::string m_signals_frame; //binary signal frame built with the last JSON signal frame
+	uint32_t m_signals_seq; //binary signal frame counter
+	bool m_send_all_signals; //next binary frame is a keyframe
 
 public:
 	static CDataManager* GetInstance();
@@ -50,7 +55,8 @@ public:
 	void UnRegisterSignal(const char * _name);
 
 	std::string GetParamsJson(); //get all parameters in JSON-formatted string
-	std::string GetSignalsJson(); //get all signals in JSON-formatted string
+	std::string GetSignalsJson(); //get all signals in JSON-formatted string, binary signals go to GetSignalsBinary()
+	const std::string& GetSignalsBinary() const; //binary frame of signals opted in with SetBinary(), empty when nothing changed
 
 	void OnNewParams(std::string _params); //is involved when new data received from server, data is JSON-formatted string
 	void OnNewSignals(std::string _signals); //is involved when new data received from server, data is JSON-formatted string
@@ -86,3 +92,4 @@ extern "C" const char * ws_get_signals(void);
 extern "C" int ws_set_params(const char *_params);
 extern "C" int ws_set_signals(const char *_signals);
 extern "C" void ws_gzip(const char* _in, void* _out, size_t* size_);
+extern "C" const void * ws_get_signals_binary(size_t* _size);
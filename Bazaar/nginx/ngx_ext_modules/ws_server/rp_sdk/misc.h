@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <stdio.h>
+#include <stdint.h>
 
 extern int dbg_printf(const char * format, ...);
 
@@ -78,6 +79,21 @@ inline std::vector<int> GetValueFromJSON<std::vector<int> >(JSONNode _node, cons
 	return res;
 }
 
+//std::vector<int16_t> specialization of function
+template <>
+inline std::vector<int16_t> GetValueFromJSON<std::vector<int16_t> >(JSONNode _node, const char* _at)
+{
+	JSONNode n = _node.at(_at);
+	std::vector<int16_t> res;
+	JSONNode::const_iterator i = n.begin();
+    	while (i != n.end()){
+        	res.push_back(i->as_int());
+        	++i;
+    	}
+
+	return res;
+}
+
 //std::vector<float> specialization of function
 template <>
 inline std::vector<float> GetValueFromJSON<std::vector<float> >(JSONNode _node, const char* _at)
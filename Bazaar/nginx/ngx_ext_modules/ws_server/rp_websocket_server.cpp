@@ -144,6 +144,17 @@ void rp_websocket_server::on_signal_timer(websocketpp::lib::error_code const & e
 			m_endpoint.send(*it, buf, size, websocketpp::frame::opcode::binary);
 		}
 	}
+
+	// Signals opted in to the binary frame were collected by get_signals_func above
+	if (m_params->get_signals_binary_func) {
+		size_t bin_size = 0;
+		const void* bin = m_params->get_signals_binary_func(&bin_size);
+		if (bin && bin_size) {
+			for (it = m_connections.begin(); it != m_connections.end(); ++it) {
+				m_endpoint.send(*it, bin, bin_size, websocketpp::frame::opcode::binary);
+			}
+		}
+	}
 	// set timer for next check
 	set_signal_timer();
 }
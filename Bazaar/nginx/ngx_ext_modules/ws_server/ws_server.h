@@ -12,6 +12,7 @@ typedef const char     *(*ws_get_signals_func)(void);
 typedef int		(*ws_set_params_func)(const char *_params);
 typedef int		(*ws_set_signals_func)(const char *_signals);
 typedef void	(*ws_gzip_func)(const char *_in, void* _out, size_t* _size);
+typedef const void     *(*ws_get_signals_binary_func)(size_t* _size);
 
 // The following struct can be used to define specific parameters
 struct server_parameters {
@@ -24,6 +25,7 @@ struct server_parameters {
 	ws_set_params_func set_params_func;
 	ws_set_signals_func set_signals_func;
 	ws_gzip_func gzip_func;
+	ws_get_signals_binary_func get_signals_binary_func; // optional, may be NULL for older applications
 	int signal_interval; // in ms
 	int param_interval; // in ms
 	int port;
@@ -14,9 +14,9 @@ int main (int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    // Measure each XADC input voltage
+    // Measure all XADC input voltages
+    rp_AIpinGetValues(value);
     for (int i=0; i<4; i++) {
-        rp_AIpinGetValue(i, &value[i]);
         printf("Measured voltage on AI[%i] = %1.2fV\n", i, value[i]);
     }
 
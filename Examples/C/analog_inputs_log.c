@@ -0,0 +1,51 @@
+/* Log slow analog inputs at the XADC sample rate */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "rp.h"
+
+#define BLOCK_SCANS 256
+
+int main (int argc, char **argv) {
+    uint16_t buffer [BLOCK_SCANS * 4];
+    uint32_t rate = 0;
+    long scans = 10000;
+
+    // Sample rate in Hz and number of scans can be provided as arguments
+    if (argc > 1) rate  = atoi(argv[1]);
+    if (argc > 2) scans = atol(argv[2]);
+
+    // Initialization of API
+    if (rp_Init() != RP_OK) {
+        fprintf(stderr, "Red Pitaya API init failed!\n");
+        return EXIT_FAILURE;
+    }
+
+    if (rp_AIpinStartCapture(rate, 0) != RP_OK) {
+        fprintf(stderr, "XADC capture start failed!\n");
+        rp_Release();
+        return EXIT_FAILURE;
+    }
+    rp_AIpinGetCaptureRate(&rate);
+    fprintf(stderr, "XADC sampling frequency %u Hz\n", rate);
+
+    // Print one line of raw values per scan: AI0 AI1 AI2 AI3
+    while (scans > 0) {
+        uint32_t size = BLOCK_SCANS;
+        if (rp_AIpinReadCapture(buffer, &size, 1000) != RP_OK) {
+            fprintf(stderr, "XADC capture read failed!\n");
+            break;
+        }
+        for (uint32_t i = 0; i < size && scans > 0; i++, scans--) {
+            printf("%u %u %u %u\n", buffer[4*i], buffer[4*i+1], buffer[4*i+2], buffer[4*i+3]);
+        }
+    }
+
+    // Releasing resources
+    rp_AIpinStopCapture();
+    rp_Release();
+
+    return EXIT_SUCCESS;
+}
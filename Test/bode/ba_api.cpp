@@ -13,7 +13,7 @@
  */
 #include <iostream>
 #include <fstream>
-#include <complex.h>
+#include <complex>
 #include <limits.h>
 #include <unistd.h>
 #include <string.h>
@@ -43,205 +43,128 @@ typedef double data_t;
 static std::vector<float> calib_data;
 static pthread_mutex_t mutex;
 
-data_t RMS(const std::vector<float> &data, int size){
-    data_t result = 0;
-    for(int i = 0; i < size; i++){
-        result += data[i] * data[i];
-    }
-    result =  sqrt(result / size);
-    return result;
-}
-
-
 float l_inter(float a, float b, float f)
 {
     return a + f * (b - a);
 }
 
-data_t InterpolateLagrangePolynomial (data_t x, data_t* x_values, data_t* y_values, int size)
+/* Lock-in detection: both channels are multiplied by exp(-j*w*k) of the known excitation
+ * frequency in one pass. The rotator is advanced by complex multiplication and renormalized
+ * once per block, so no sin/cos is evaluated per sample. The mean is removed afterwards
+ * from the accumulated sums, which keeps the DC bias out of I/Q. The same pass collects the
+ * RMS and peak to peak values of the whole buffer. */
+#define BA_LOCKIN_BLOCK 1024
+
+struct ba_analysis_t {
+	std::complex<data_t> z1;
+	std::complex<data_t> z2;
+	data_t rms1;
+	data_t rms2;
+	data_t pp1;
+	data_t pp2;
+};
+
+static int lockInAnalysis(const rp_ba_buffer_t &buffer,
+					uint32_t size,
+					float samplesPerSecond,
+					float _freq,
+					ba_analysis_t *result)
 {
-	data_t lagrange_pol = 0;
-	data_t basics_pol;
-
-	for (int i = 0; i < size; i++)
-	{
-		basics_pol = 1;
-		for (int j = 0; j < size; j++)
-		{
-			if (j == i) continue;
-			basics_pol *= (x - x_values[j])/(x_values[i] - x_values[j]);		
+	if (size < 2 || size > buffer.ch1.size() || _freq <= 0 || samplesPerSecond <= 0) return RP_EOOR;
+
+	/* Use a whole number of periods to avoid leakage from the negative frequency image */
+	data_t samples_per_period = samplesPerSecond / _freq;
+	uint32_t periods = size / samples_per_period;
+	uint32_t n = periods > 0 ? (uint32_t)round(periods * samples_per_period) : size;
+	if (n > size) n = size;
+
+	const float *x = buffer.ch1.data();
+	const float *y = buffer.ch2.data();
+	data_t w = 2 * M_PI * _freq / samplesPerSecond;
+	data_t step_re = cos(w);
+	data_t step_im = -sin(w);
+	data_t rot_re = 1, rot_im = 0;
+	data_t sum_x = 0, sum_y = 0, sum_c = 0, sum_s = 0;
+	data_t sq_x = 0, sq_y = 0;
+	data_t xi = 0, xq = 0, yi = 0, yq = 0;
+	float min_x = x[0], max_x = x[0], min_y = y[0], max_y = y[0];
+
+	for (uint32_t k = 0; k < n; k += BA_LOCKIN_BLOCK) {
+		uint32_t stop = k + BA_LOCKIN_BLOCK < n ? k + BA_LOCKIN_BLOCK : n;
+		for (uint32_t i = k; i < stop; i++) {
+			data_t a = x[i];
+			data_t b = y[i];
+			sum_x += a;
+			sum_y += b;
+			sum_c += rot_re;
+			sum_s += rot_im;
+			xi += a * rot_re;
+			xq += a * rot_im;
+			yi += b * rot_re;
+			yq += b * rot_im;
+			data_t re = rot_re * step_re - rot_im * step_im;
+			rot_im = rot_re * step_im + rot_im * step_re;
+			rot_re = re;
 		}
-		lagrange_pol += basics_pol*y_values[i];
-	}
-	return lagrange_pol;
-}
-
-data_t calcPoint(data_t *a, data_t *b,int lenghtArray,int index){
-	data_t x = 0;
-	int j = 0;
-	int i = index - lenghtArray > 0 ? index - lenghtArray : 0;
-	for (; i < lenghtArray && i <= index; i++) {
-		j = index - i;
-		x +=a[i]*b[lenghtArray - j - 1];
+		data_t norm = (3.0 - (rot_re * rot_re + rot_im * rot_im)) * 0.5;
+		rot_re *= norm;
+		rot_im *= norm;
 	}
-	return x;
-}
 
-data_t getMaxArg(data_t *a, data_t *b,int start,int stop, int step,int lenghtArray){
-	int len = lenghtArray / step;
-	if (stop == 0)  stop = len;
-	data_t packBufA[len];
-	data_t packBufB[len];
-	data_t corralate[len];
-	int    corralateIndex[len];
-	
-	for(auto k = 0; k < len ; k++){
-		packBufA[k] = a[k*step];
-		packBufB[k] = b[k*step];
-		corralateIndex[k] = -1;
+	for (uint32_t i = 0; i < size; i++) {
+		sq_x += x[i] * x[i];
+		sq_y += y[i] * y[i];
+		min_x = fminf(min_x, x[i]);
+		max_x = fmaxf(max_x, x[i]);
+		min_y = fminf(min_y, y[i]);
+		max_y = fmaxf(max_y, y[i]);
 	}
 
-	for(auto k = start; k <stop ; k++){
-		corralate[k] = calcPoint(packBufA,packBufB,len,k);
-		corralateIndex[k] = k;
-	}
-	int maxK = 0;
-	int maxCor = 0;
-	bool init = true;
-	for(auto k = 0; k < len ; k++){
-		if (corralateIndex[k] != -1)
-			if (corralate[k] > maxCor || init){
-				init = false;
-				maxCor = corralate[k];
-				maxK = k;
-			}
-	}
-	return maxK * step;
+	data_t mean_x = sum_x / n;
+	data_t mean_y = sum_y / n;
+	result->z1 = std::complex<data_t>(xi - mean_x * sum_c, xq - mean_x * sum_s);
+	result->z2 = std::complex<data_t>(yi - mean_y * sum_c, yq - mean_y * sum_s);
+	result->rms1 = sqrt(sq_x / size);
+	result->rms2 = sqrt(sq_y / size);
+	result->pp1 = max_x - min_x;
+	result->pp2 = max_y - min_y;
+	return RP_OK;
 }
 
-data_t crossCorrelation(data_t *xSignalArray, data_t *ySignalArray, int lenghtArray,int sepm_Per)
+/* The phase is reported within (-90, 90], as the cross-correlation estimate did */
+static data_t foldPhase(data_t phase)
 {
-    data_t argmax = 0;
-    data_t *a = xSignalArray;
-	data_t *b = ySignalArray;
-	int step = log2(lenghtArray);
-	int maxK = -1;
-	int start = 0;
-	int stop  = 0;
-	while(step>=1){
-		maxK =getMaxArg(a,b,start/step,stop/step,step,lenghtArray);
-		start = maxK - step * 10 < 0 ? 0 : maxK - step * 10;
-		stop  = maxK + step * 10 > (lenghtArray * 2 + 1) ? (lenghtArray * 2 + 1) : maxK + step * 10;
-		step /=2;
-	}
-
-	argmax = maxK;
-
-	if (argmax > 0 && argmax < lenghtArray * 2){
-		data_t x_axis[] = { 0 , 1 , 2};
-		data_t y_axis[3];
-
-		for(int i = argmax-1,j=0; i <= argmax+1 ;i++,j++){
-			y_axis[j] = calcPoint(a,b,lenghtArray,i);
-		}
-		data_t eps = 0.0001;
-		data_t start = 0;
-		data_t stop = 2;
-		data_t y_start = InterpolateLagrangePolynomial(start,x_axis,y_axis,3);
-		data_t y_stop  = InterpolateLagrangePolynomial(stop,x_axis,y_axis,3);
-		data_t max_inter = 0;
-		while(eps  < (stop - start)){
-			data_t z = (stop - start)/2.0 + start;
-			data_t y_sub  = InterpolateLagrangePolynomial(z,x_axis,y_axis,3);
-			if (y_sub > y_start || y_sub > y_stop){
-				if (y_start > y_stop){
-					stop = z;
-					y_stop = y_sub;
-				}else{
-					start = z;
-					y_start = y_sub;
-				}
-				max_inter = z;
-			}
-			else{
-				max_inter = y_stop > y_start? stop : start;
-				break;
-			}
-		}
-		argmax = argmax-1 + max_inter;
-	}
-    return argmax;
+	if (phase <= -M_PI/2)
+		phase += M_PI;
+	else if (phase >= M_PI/2)
+		phase -= M_PI;
+	return phase;
 }
 
-data_t phaseCalculator(data_t freq_HZ, data_t samplesPerSecond, int numSamples,int sepm_Per, data_t *xSamples, data_t *ySamples)
+/* Phase of channel 2 relative to channel 1 within (-180, 180] */
+static data_t relativePhase(const ba_analysis_t &result)
 {
-    data_t timeShift, phaseShift, timeLine;
-    auto argmax = crossCorrelation(xSamples, ySamples, numSamples,sepm_Per);
-
-    timeLine = ((numSamples - 1) / samplesPerSecond);
-    timeShift = ((timeLine * argmax) / (numSamples - 1)) + (-timeLine);
-    phaseShift = ((2 * M_PI) * fmod((freq_HZ * timeShift), 1.0)) - M_PI;
-    if (phaseShift <= -M_PI/2) 
-		phaseShift += M_PI;
-	else if (phaseShift >= M_PI/2) 
-		phaseShift -= M_PI;
-	return phaseShift;
+	return std::arg(result.z2 * std::conj(result.z1));
 }
 
 int rp_BaDataAnalysis(const rp_ba_buffer_t &buffer,
 					uint32_t size,
 					float samplesPerSecond,
-					float _freq, 
-					int   samples_period,
+					float _freq,
 					float *gain,
 					float *phase_out,
-					float input_threshold) 
+					float input_threshold)
 {
-	int ret_value = RP_OK;
-	data_t buf1[size];
-	data_t buf2[size];
-	data_t max_ch1 = -100000;
-	data_t max_ch2 = -100000;
-	data_t min_ch1 = 100000;
-	data_t min_ch2 = 100000;
-
-	for (size_t i = 0; i < size; i++){
-		buf1[i] = buffer.ch1[i];
-		buf2[i] = buffer.ch2[i];
-		// Filtring 
-		//buf1[i]  = buf1[i] * ( 0.54 - 0.46 * cos(2*M_PI*i / (data_t)(size-1)));
-		//buf2[i]  = buf2[i] * ( 0.54 - 0.46 * cos(2*M_PI*i / (data_t)(size-1)));
-
-		// 
-		if ((buf1[i]) > max_ch1) {
-			max_ch1 = (buf1[i]);
-		}
-		if ((buf2[i]) > max_ch2) {
-			max_ch2 = (buf2[i]);
-		}
-		if ((buf1[i]) < min_ch1) {
-			min_ch1 = (buf1[i]);
-		}
-		if ((buf2[i]) < min_ch2) {
-			min_ch2 = (buf2[i]);
-		}
-	}
-
-	data_t sig1_rms =  RMS(buffer.ch1,size);
-	data_t sig2_rms =  RMS(buffer.ch2,size);
-	*gain = sig2_rms / sig1_rms;
-	
-	if ((max_ch1 - min_ch1) < input_threshold) ret_value = RP_EIPV;
-	if ((max_ch2 - min_ch2) < input_threshold) ret_value = RP_EIPV;
-	auto phase2 = phaseCalculator(_freq,samplesPerSecond, size ,samples_period,buf1,buf2);
+	ba_analysis_t result;
+	int ret_value = lockInAnalysis(buffer, size, samplesPerSecond, _freq, &result);
+	if (ret_value != RP_OK) return ret_value;
 
-	/* Phase has to be limited between M_PI and -M_PI. */
-	if (phase2 <= -M_PI) 
-		phase2 += 2*M_PI;
-	else if (phase2 >= M_PI) 
-		phase2 -= 2*M_PI;
+	if (result.pp1 < input_threshold) ret_value = RP_EIPV;
+	if (result.pp2 < input_threshold) ret_value = RP_EIPV;
 
-	*phase_out = phase2 *  (180.0 / M_PI) ;
+	/* Gain is the RMS ratio including DC, so calibration files stay valid */
+	*gain = result.rms2 / result.rms1;
+	*phase_out = foldPhase(relativePhase(result)) * (180.0 / M_PI);
 	return ret_value;
 }
 
@@ -360,6 +283,20 @@ int rp_BaSafeThreadGen(rp_channel_t _channel, float _frequency, float _ampl, flo
 	return RP_OK;
 }
 
+/* Retunes a running generator, used between sweep points instead of a full setup */
+int rp_BaSafeThreadGenFreq(rp_channel_t _channel, float _frequency)
+{
+	pthread_mutex_lock(&mutex);
+	EXEC_CHECK_MUTEX(rp_GenFreq(_channel, _frequency), mutex);
+	pthread_mutex_unlock(&mutex);
+
+	// Let the DUT settle for a few periods, bounded by the delay of the full setup
+	uint64_t settle_us = 4e6 / _frequency;
+	settle_us = settle_us < 100 ? 100 : (settle_us > 10000 ? 10000 : settle_us);
+	usleep(settle_us);
+	return RP_OK;
+}
+
 
 int rp_BaSafeThreadAcqData(rp_ba_buffer_t &_buffer, int _decimation, int _acq_size, float _trigger)
 {
@@ -405,18 +342,11 @@ int rp_BaSafeThreadAcqData(rp_ba_buffer_t &_buffer, int _decimation, int _acq_si
 }
 
 
-int rp_BaGetAmplPhase(float _amplitude_in, float _dc_bias, int _periods_number, rp_ba_buffer_t &_buffer, float* _amplitude, float* _phase, float _freq,float _input_threshold)
+static int calcDecimation(float _freq, int _periods_number)
 {
-    float gain = 0;
-    float phase_out = 0;
-    int acq_size;
-
-    //Generate a sinusoidal wave form
-    rp_BaSafeThreadGen(RP_CH_1, _freq, _amplitude_in, _dc_bias);
-    int size_buff_limit = ADC_BUFFER_SIZE;
-	int new_dec = round((static_cast<float>(_periods_number) * ADC_SAMPLE_RATE) / (_freq * size_buff_limit));
+	int new_dec = round((static_cast<float>(_periods_number) * ADC_SAMPLE_RATE) / (_freq * ADC_BUFFER_SIZE));
 	new_dec = new_dec < 1 ? 1 : new_dec;
-	
+
 	if (new_dec < 16){
         if (new_dec >= 8)
             new_dec = 8;
@@ -432,12 +362,22 @@ int rp_BaGetAmplPhase(float _amplitude_in, float _dc_bias, int _periods_number,
     if (new_dec > 65536){
         new_dec = 65536;
     }
-	int samples_period = round(ADC_SAMPLE_RATE / (_freq * new_dec));
+	return new_dec;
+}
+
+int rp_BaGetAmplPhase(float _amplitude_in, float _dc_bias, int _periods_number, rp_ba_buffer_t &_buffer, float* _amplitude, float* _phase, float _freq,float _input_threshold)
+{
+    float gain = 0;
+    float phase_out = 0;
+    int acq_size = ADC_BUFFER_SIZE;
+
+    //Generate a sinusoidal wave form
+    rp_BaSafeThreadGen(RP_CH_1, _freq, _amplitude_in, _dc_bias);
+	int new_dec = calcDecimation(_freq, _periods_number);
 
-    acq_size = size_buff_limit;
     rp_BaSafeThreadAcqData(_buffer,new_dec, acq_size,_amplitude_in);
     rp_GenOutDisable(RP_CH_1);
-    int ret = rp_BaDataAnalysis(_buffer, acq_size, ADC_SAMPLE_RATE / new_dec,_freq, samples_period,  &gain, &phase_out,_input_threshold);
+    int ret = rp_BaDataAnalysis(_buffer, acq_size, ADC_SAMPLE_RATE / new_dec,_freq, &gain, &phase_out,_input_threshold);
 
     *_amplitude = 10.*logf(gain);
     *_phase = phase_out;
@@ -445,3 +385,111 @@ int rp_BaGetAmplPhase(float _amplitude_in, float _dc_bias, int _periods_number,
     return ret;
 }
 
+struct ba_job_t {
+	const rp_ba_buffer_t *buffer;
+	float rate;
+	float freq;
+	float threshold;
+	data_t amplitude;             // dB
+	std::complex<data_t> rotation; // unit vector of the unfolded phase
+	int status;
+};
+
+static void *analysisThread(void *arg)
+{
+	ba_job_t *job = static_cast<ba_job_t*>(arg);
+	ba_analysis_t result;
+	job->status = lockInAnalysis(*job->buffer, ADC_BUFFER_SIZE, job->rate, job->freq, &result);
+	if (job->status != RP_OK) return NULL;
+
+	if (result.pp1 < job->threshold || result.pp2 < job->threshold) job->status = RP_EIPV;
+	job->amplitude = 10. * log(result.rms2 / result.rms1);
+	job->rotation = std::polar<data_t>(1, relativePhase(result));
+	if (std::isnan(job->amplitude) || std::isinf(job->amplitude)) job->status = RP_EOOR;
+	return NULL;
+}
+
+/* Sweep with acquisition of the next point overlapped with analysis of the current one.
+ * The generator is set up once and only retuned between frequencies. Repeated measurements
+ * of one frequency are averaged in dB like rp_BaGetAmplPhase results were, the phase is the
+ * mean direction of the measurements folded like a single one. */
+int rp_BaSweep(float _amplitude_in, float _dc_bias, int _periods_number, int _averaging, const std::vector<float> &_freqs, float _input_threshold, std::vector<rp_ba_point_t> &_points)
+{
+	int averaging = _averaging < 1 ? 1 : _averaging;
+	size_t jobs_num = _freqs.size() * averaging;
+	std::vector<data_t> amplitudes(_freqs.size(), 0);
+	std::vector<std::complex<data_t>> rotations(_freqs.size());
+	std::vector<int> counts(_freqs.size(), 0);
+	_points.assign(_freqs.size(), rp_ba_point_t());
+
+	if (_freqs.empty()) return RP_OK;
+
+	int ret = rp_BaSafeThreadGen(RP_CH_1, _freqs[0], _amplitude_in, _dc_bias);
+	if (ret != RP_OK) return ret;
+
+	rp_ba_buffer_t buffers[2] = {rp_ba_buffer_t(ADC_BUFFER_SIZE), rp_ba_buffer_t(ADC_BUFFER_SIZE)};
+	ba_job_t jobs[2];
+	pthread_t thread;
+	bool running = false;
+	size_t running_idx = 0;
+
+	auto collect = [&](size_t idx) {
+		const ba_job_t &job = jobs[idx & 1];
+		rp_ba_point_t &point = _points[idx / averaging];
+		if (job.status == RP_OK || job.status == RP_EIPV) {
+			amplitudes[idx / averaging] += job.amplitude;
+			rotations[idx / averaging] += job.rotation;
+			counts[idx / averaging]++;
+		}
+		if (job.status == RP_EIPV) point.status = RP_EIPV;
+	};
+
+	for (size_t j = 0; j < jobs_num; j++) {
+		float freq = _freqs[j / averaging];
+		if (j > 0 && j % averaging == 0) {
+			ret = rp_BaSafeThreadGenFreq(RP_CH_1, freq);
+		}
+		int dec = calcDecimation(freq, _periods_number);
+		if (ret == RP_OK) {
+			ret = rp_BaSafeThreadAcqData(buffers[j & 1], dec, ADC_BUFFER_SIZE, _amplitude_in);
+		}
+
+		if (running) {
+			pthread_join(thread, NULL);
+			collect(running_idx);
+			running = false;
+		}
+		if (ret != RP_OK) break;
+
+		ba_job_t &job = jobs[j & 1];
+		job.buffer = &buffers[j & 1];
+		job.rate = ADC_SAMPLE_RATE / dec;
+		job.freq = freq;
+		job.threshold = _input_threshold;
+		running_idx = j;
+		if (pthread_create(&thread, NULL, analysisThread, &job) == 0) {
+			running = true;
+		} else {
+			analysisThread(&job);
+			collect(j);
+		}
+	}
+
+	if (running) {
+		pthread_join(thread, NULL);
+		collect(running_idx);
+	}
+	rp_GenOutDisable(RP_CH_1);
+
+	for (size_t i = 0; i < _freqs.size(); i++) {
+		rp_ba_point_t &point = _points[i];
+		point.freq = _freqs[i];
+		if (counts[i] == 0) {
+			point.status = RP_EOOR;
+			continue;
+		}
+		point.amplitude = amplitudes[i] / counts[i];
+		point.phase = foldPhase(std::arg(rotations[i])) * (180.0 / M_PI);
+	}
+	return ret;
+}
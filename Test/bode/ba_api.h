@@ -32,11 +32,21 @@ struct rp_ba_buffer_t{
 	explicit rp_ba_buffer_t(size_t size): ch1(size), ch2(size) {}
 };
 
-  int rp_BaDataAnalysis(const rp_ba_buffer_t &buffer,uint32_t size, float samplesPerSecond,float _freq,  int  samples_period, float *gain, float *phase_out);
+struct rp_ba_point_t{
+	float freq;
+	float amplitude;	// dB
+	float phase;		// deg
+	int   status;		// RP_OK, RP_EIPV when an input is below threshold, RP_EOOR when no valid result
+	rp_ba_point_t(): freq(0), amplitude(0), phase(0), status(0) {}
+};
+
+  int rp_BaDataAnalysis(const rp_ba_buffer_t &buffer,uint32_t size, float samplesPerSecond,float _freq, float *gain, float *phase_out, float input_threshold);
   int rp_BaSafeThreadAcqPrepare();
   int rp_BaSafeThreadGen(rp_channel_t _channel, float _frequency, float _ampl, float _dc_bias);
-  int rp_BaSafeThreadAcqData(rp_ba_buffer_t &_buffer, rp_acq_decimation_t _decimation, int _acq_size, int _dec, float _trigger);
+  int rp_BaSafeThreadGenFreq(rp_channel_t _channel, float _frequency);
+  int rp_BaSafeThreadAcqData(rp_ba_buffer_t &_buffer, int _decimation, int _acq_size, float _trigger);
   int rp_BaGetAmplPhase(float _amplitude_in, float _dc_bias, int _periods_number, rp_ba_buffer_t &_buffer, float* _amplitude, float* _phase, float _freq,float _input_threshold);
+  int rp_BaSweep(float _amplitude_in, float _dc_bias, int _periods_number, int _averaging, const std::vector<float> &_freqs, float _input_threshold, std::vector<rp_ba_point_t> &_points);
 
 float rp_BaCalibGain(float _freq, float _ampl);
 float rp_BaCalibPhase(float _freq, float _phase);
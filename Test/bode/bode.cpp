@@ -235,7 +235,6 @@ int main(int argc, char *argv[]) {
     }
 
 
-    int cur_step = 0;
     float freq_step = 0;
     
     if (scale_type)
@@ -251,55 +250,39 @@ int main(int argc, char *argv[]) {
 
    // fprintf(stderr, "a %f b %f c %f\n", a, b, c);
 
-    float old_freq = start_frequency;
-    //float old_steps = steps;
-    rp_Init();
-    rp_BaSafeThreadAcqPrepare();
-
-    while(steps > 0) {
-
-
-        float amplitude = 0, phase_out = 0;
-        float current_freq = 0.;
-        //float next_freq = 0.;
-
+    std::vector<float> frequencies(steps);
+    for (unsigned int cur_step = 0; cur_step < steps; cur_step++) {
         if (scale_type) {
             // Log
-            current_freq = pow(10.f, c * cur_step + a);
-         //   next_freq = pow(10.f, c * (cur_step + 1) + a);
+            frequencies[cur_step] = pow(10.f, c * cur_step + a);
         } else {
             // Linear
-            current_freq = static_cast<float>(old_freq) + freq_step * cur_step;
-          //  next_freq = static_cast<float>(old_freq) + freq_step * (cur_step + 1);
+            frequencies[cur_step] = static_cast<float>(start_frequency) + freq_step * cur_step;
         }
+    }
 
-        for (unsigned int i = 0; i < averaging_num; ++i)
-        {
-            float ampl_out = 0;
+    rp_Init();
+    rp_BaSafeThreadAcqPrepare();
 
-            if (rp_BaGetAmplPhase(ampl, DC_bias,periods_number, buffer, &ampl_out, &phase_out, current_freq,0) ==  RP_EOOR) // isnan && isinf
-            {
-                --steps;
-                continue;
-            }
-            amplitude += ampl_out;
-        }
-        amplitude /= averaging_num;
-   
-        --steps;
-        cur_step++;
-        float calib_ampl = rp_BaCalibGain(current_freq, amplitude);
-        float calib_phase = rp_BaCalibPhase(current_freq, phase_out);
-        fprintf(file_frequency, "%.5f\n", current_freq);
+    std::vector<rp_ba_point_t> points;
+    rp_BaSweep(ampl, DC_bias, periods_number, averaging_num, frequencies, 0, points);
+
+    for (const rp_ba_point_t &point : points) {
+        if (point.status == RP_EOOR) // isnan && isinf
+            continue;
+
+        float calib_ampl = rp_BaCalibGain(point.freq, point.amplitude);
+        float calib_phase = rp_BaCalibPhase(point.freq, point.phase);
+        fprintf(file_frequency, "%.5f\n", point.freq);
         fprintf(file_amplitude, "%.5f\n", calib_ampl);
         fprintf(file_phase,     "%.5f\n", calib_phase);
             
         if (calibMode) // save data in calibration mode
         {
-			rp_BaWriteCalib(current_freq,amplitude,phase_out);
+			rp_BaWriteCalib(point.freq, point.amplitude, point.phase);
         }
 
-        printf("%.2f    %.5f    %.5f\n", current_freq, calib_phase, calib_ampl);
+        printf("%.2f    %.5f    %.5f\n", point.freq, calib_phase, calib_ampl);
     }
 
     rp_Release();
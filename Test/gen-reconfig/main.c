@@ -0,0 +1,104 @@
+/**
+ * $Id: $
+ *
+ * @brief Generator reconfiguration rate benchmark. Measures how many parameter
+ *        updates per second the generator API accepts for the patterns used by
+ *        SCPI sweeps and burst setups: frequency steps of a sine and a square,
+ *        duty cycle toggling, phase steps and frequency steps of a sweep signal.
+ *        Every update rewrites the DAC buffer of the channel, so the rate shows
+ *        the cost of synthesizing the waveform and converting it to counts.
+ *        Build it against the library before and after a change to compare.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "rp.h"
+
+#define DEFAULT_UPDATES 2000
+
+typedef enum {
+    STEP_FREQUENCY,
+    STEP_DUTY_CYCLE,
+    STEP_PHASE
+} step_t;
+
+typedef struct {
+    const char    *name;
+    rp_waveform_t  waveform;
+    step_t         step;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "sine, frequency steps",   RP_WAVEFORM_SINE,   STEP_FREQUENCY  },
+    { "square, frequency steps", RP_WAVEFORM_SQUARE, STEP_FREQUENCY  },
+    { "pwm, duty cycle toggle",  RP_WAVEFORM_PWM,    STEP_DUTY_CYCLE },
+    { "sine, phase steps",       RP_WAVEFORM_SINE,   STEP_PHASE      },
+    { "sweep, frequency steps",  RP_WAVEFORM_SWEEP,  STEP_FREQUENCY  },
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int apply(const scenario_t *s, int i)
+{
+    switch (s->step) {
+        /* Stepping through 50 frequencies like a stepped sweep does */
+        case STEP_FREQUENCY:  return rp_GenFreq(RP_CH_1, 1000.0f + (i % 50) * 1000.0f);
+        case STEP_DUTY_CYCLE: return rp_GenDutyCycle(RP_CH_1, (i % 2) ? 0.25f : 0.75f);
+        case STEP_PHASE:      return rp_GenPhase(RP_CH_1, (float)(i % 360 - 180));
+    }
+    return RP_EOOR;
+}
+
+int main(int argc, char **argv)
+{
+    int updates = argc > 1 ? atoi(argv[1]) : DEFAULT_UPDATES;
+    if (updates <= 0) {
+        fprintf(stderr, "Usage: %s [updates per scenario]\n", argv[0]);
+        return 1;
+    }
+
+    if (rp_Init() != RP_OK) {
+        fprintf(stderr, "Red Pitaya API init failed!\n");
+        return 1;
+    }
+    rp_GenReset();
+    rp_GenSweepStartFreq(RP_CH_1, 1000);
+    rp_GenSweepEndFreq(RP_CH_1, 100000);
+
+    printf("%-26s %12s %12s\n", "scenario", "updates/s", "us/update");
+    for (size_t n = 0; n < sizeof(scenarios) / sizeof(scenarios[0]); n++) {
+        const scenario_t *s = &scenarios[n];
+        rp_GenWaveform(RP_CH_1, s->waveform);
+
+        uint64_t start = now_ns();
+        for (int i = 0; i < updates; i++) {
+            if (apply(s, i) != RP_OK) {
+                fprintf(stderr, "%s: update %d failed\n", s->name, i);
+                rp_Release();
+                return 1;
+            }
+        }
+        double seconds = (now_ns() - start) * 1e-9;
+        printf("%-26s %12.0f %12.1f\n", s->name, updates / seconds, seconds * 1e6 / updates);
+    }
+
+    rp_GenReset();
+    rp_Release();
+    return 0;
+}
@@ -0,0 +1,306 @@
+/**
+ * $Id: $
+ *
+ * @brief SCPI server load generator. Opens several client connections and measures
+ *        connection setup latency and command round-trip time, optionally pipelined.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#define DEFAULT_PORT     5000
+#define DEFAULT_CLIENTS  4
+#define DEFAULT_REQUESTS 1000
+#define DEFAULT_DEPTH    1
+#define DEFAULT_COMMAND  "ACQ:TRIG:STAT?"
+#define RECV_BUFFER_SIZE (1024 * 64)
+
+typedef struct {
+    int      id;
+    int      fd;
+    char     buffer[RECV_BUFFER_SIZE];
+    size_t   begin;
+    size_t   end;
+    double   connect_us;
+    double  *rtt_us;        //!< One entry per pipelined batch
+    int      batches;
+    uint64_t bytes;
+    bool     failed;
+} client_t;
+
+static struct sockaddr_in g_addr;
+static int    g_requests = DEFAULT_REQUESTS;
+static int    g_depth = DEFAULT_DEPTH;
+static const char *g_command = DEFAULT_COMMAND;
+
+static double nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool sendAll(int fd, const char *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+/* Makes at least need bytes available in the client buffer */
+static bool fill(client_t *c, size_t need)
+{
+    while (c->end - c->begin < need) {
+        if (c->begin > 0) {
+            memmove(c->buffer, c->buffer + c->begin, c->end - c->begin);
+            c->end -= c->begin;
+            c->begin = 0;
+        }
+        if (c->end == RECV_BUFFER_SIZE) {
+            return false;
+        }
+        ssize_t n = recv(c->fd, c->buffer + c->end, RECV_BUFFER_SIZE - c->end, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+        c->end += n;
+    }
+    return true;
+}
+
+/* Skips bytes of a response body that may be larger than the receive buffer */
+static bool skip(client_t *c, size_t len)
+{
+    while (len > 0) {
+        if (!fill(c, 1)) return false;
+        size_t n = c->end - c->begin;
+        if (n > len) n = len;
+        c->begin += n;
+        len -= n;
+    }
+    return true;
+}
+
+/* Reads one response: an ASCII line terminated with \r\n or a #<n><len> binary block */
+static bool readResponse(client_t *c)
+{
+    if (!fill(c, 1)) return false;
+
+    if (c->buffer[c->begin] == '#') {
+        if (!fill(c, 2)) return false;
+        int digits = c->buffer[c->begin + 1] - '0';
+        if (digits < 1 || digits > 9 || !fill(c, 2 + digits)) return false;
+        char len_str[10];
+        memcpy(len_str, c->buffer + c->begin + 2, digits);
+        len_str[digits] = '\0';
+        size_t len = strtoul(len_str, NULL, 10);
+        c->begin += 2 + digits;
+        c->bytes += len;
+        // Payload followed by the \r\n terminator
+        return skip(c, len + 2);
+    }
+
+    while (1) {
+        char *eol = memchr(c->buffer + c->begin, '\n', c->end - c->begin);
+        if (eol != NULL) {
+            size_t len = eol - (c->buffer + c->begin) + 1;
+            c->bytes += len;
+            c->begin += len;
+            return true;
+        }
+        // Long ASCII response: drop what we have and keep reading
+        c->bytes += c->end - c->begin;
+        c->begin = c->end;
+        if (!fill(c, 1)) return false;
+    }
+}
+
+static void *clientThread(void *arg)
+{
+    client_t *c = (client_t *)arg;
+
+    double start = nowUs();
+    c->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (c->fd < 0 || connect(c->fd, (struct sockaddr *)&g_addr, sizeof(g_addr)) < 0) {
+        fprintf(stderr, "Client %d: connect failed: %s\n", c->id, strerror(errno));
+        c->failed = true;
+        return NULL;
+    }
+    int opt = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    // Connection setup counts until the first answer arrives
+    if (!sendAll(c->fd, "*IDN?\r\n", 7) || !readResponse(c)) {
+        fprintf(stderr, "Client %d: no answer to *IDN?\n", c->id);
+        c->failed = true;
+        close(c->fd);
+        return NULL;
+    }
+    c->connect_us = nowUs() - start;
+
+    size_t cmd_len = strlen(g_command) + 2;
+    char *batch = malloc(cmd_len * g_depth);
+    for (int i = 0; i < g_depth; i++) {
+        memcpy(batch + i * cmd_len, g_command, cmd_len - 2);
+        memcpy(batch + i * cmd_len + cmd_len - 2, "\r\n", 2);
+    }
+
+    int batches = (g_requests + g_depth - 1) / g_depth;
+    for (int b = 0; b < batches; b++) {
+        double t0 = nowUs();
+        if (!sendAll(c->fd, batch, cmd_len * g_depth)) {
+            c->failed = true;
+            break;
+        }
+        int i;
+        for (i = 0; i < g_depth; i++) {
+            if (!readResponse(c)) break;
+        }
+        if (i != g_depth) {
+            fprintf(stderr, "Client %d: connection lost\n", c->id);
+            c->failed = true;
+            break;
+        }
+        c->rtt_us[c->batches++] = nowUs() - t0;
+    }
+
+    free(batch);
+    close(c->fd);
+    return NULL;
+}
+
+static int cmpDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void printStats(const char *name, double *values, int count)
+{
+    if (count == 0) {
+        printf("%-12s no samples\n", name);
+        return;
+    }
+    qsort(values, count, sizeof(double), cmpDouble);
+    double sum = 0;
+    for (int i = 0; i < count; i++) sum += values[i];
+    printf("%-12s n=%-7d min=%9.1f avg=%9.1f p50=%9.1f p99=%9.1f max=%9.1f us\n",
+           name, count, values[0], sum / count, values[count / 2],
+           values[(int)(count * 0.99)], values[count - 1]);
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s <ip of server> [options]\n", name);
+    printf("\t -p <port>     Server port (default %d)\n", DEFAULT_PORT);
+    printf("\t -c <clients>  Concurrent connections (default %d)\n", DEFAULT_CLIENTS);
+    printf("\t -n <requests> Commands per connection (default %d)\n", DEFAULT_REQUESTS);
+    printf("\t -d <depth>    Commands pipelined before reading answers (default %d)\n", DEFAULT_DEPTH);
+    printf("\t -m <command>  Query to send (default \"%s\")\n", DEFAULT_COMMAND);
+}
+
+int main(int argc, char *argv[])
+{
+    int port = DEFAULT_PORT;
+    int clients = DEFAULT_CLIENTS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:c:n:d:m:h")) != -1) {
+        switch (opt) {
+            case 'p': port = atoi(optarg); break;
+            case 'c': clients = atoi(optarg); break;
+            case 'n': g_requests = atoi(optarg); break;
+            case 'd': g_depth = atoi(optarg); break;
+            case 'm': g_command = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc || clients < 1 || g_requests < 1 || g_depth < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    memset(&g_addr, 0, sizeof(g_addr));
+    g_addr.sin_family = AF_INET;
+    g_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, argv[optind], &g_addr.sin_addr) <= 0) {
+        printf("\n inet_pton error occured\n");
+        return 1;
+    }
+
+    int batches = (g_requests + g_depth - 1) / g_depth;
+    client_t *c = calloc(clients, sizeof(client_t));
+    pthread_t *threads = calloc(clients, sizeof(pthread_t));
+    double *connect_us = calloc(clients, sizeof(double));
+    double *rtt_us = calloc((size_t)clients * batches, sizeof(double));
+
+    double start = nowUs();
+    for (int i = 0; i < clients; i++) {
+        c[i].id = i;
+        c[i].rtt_us = calloc(batches, sizeof(double));
+        pthread_create(&threads[i], NULL, clientThread, &c[i]);
+    }
+
+    int ok_clients = 0, rtt_count = 0;
+    uint64_t bytes = 0;
+    for (int i = 0; i < clients; i++) {
+        pthread_join(threads[i], NULL);
+        if (c[i].connect_us > 0) {
+            connect_us[ok_clients++] = c[i].connect_us;
+        }
+        memcpy(rtt_us + rtt_count, c[i].rtt_us, c[i].batches * sizeof(double));
+        rtt_count += c[i].batches;
+        bytes += c[i].bytes;
+        free(c[i].rtt_us);
+    }
+    double elapsed = (nowUs() - start) / 1e6;
+
+    printf("Command: %s, clients: %d, requests: %d, pipeline depth: %d\n",
+           g_command, clients, g_requests, g_depth);
+    printStats("connect", connect_us, ok_clients);
+    printStats(g_depth > 1 ? "batch rtt" : "rtt", rtt_us, rtt_count);
+    printf("Throughput: %.0f commands/s, %.2f MB/s received in %.2f s\n",
+           (double)rtt_count * g_depth / elapsed, bytes / elapsed / 1e6, elapsed);
+
+    int failed = 0;
+    for (int i = 0; i < clients; i++) {
+        failed += c[i].failed;
+    }
+
+    free(c);
+    free(threads);
+    free(connect_us);
+    free(rtt_us);
+    return failed ? 1 : 0;
+}
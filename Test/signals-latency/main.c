@@ -0,0 +1,260 @@
+/**
+ * $Id: $
+ *
+ * @brief Signal delivery latency benchmark. Compares how fast a /data request
+ *        of the nginx module gets new signals from an application when it
+ *        polls rp_get_signals() with usleep(1000) retries and when it sleeps
+ *        in rp_wait_signals() until the worker publishes them.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#define DEFAULT_PERIOD_US 20000
+#define DEFAULT_REQUESTS  500
+#define SIG_LEN           2048
+#define SIG_NUM           3
+/* Same limit as rp_data_get_signals() */
+#define RETRIES           200
+
+/* The application side, modelled on the spectrum worker: the worker thread
+ * copies new signals under a mutex and marks them dirty, rp_get_signals()
+ * copies them out and clears the flag.
+ */
+static pthread_mutex_t sig_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sig_cond = PTHREAD_COND_INITIALIZER;
+static float           signals[SIG_NUM][SIG_LEN];
+static int             signals_dirty = 0;
+static uint64_t        signals_time = 0;
+static volatile int    running = 1;
+
+typedef struct {
+    const char *name;
+    int         use_wait;
+    uint64_t   *latency;  /* publish -> delivery [ns], one per request */
+    int         fresh;    /* requests which got new signals */
+    uint64_t    get_calls;
+    uint64_t    cpu_ns;
+    uint64_t    wall_ns;
+} result_t;
+
+static uint64_t now_ns(clockid_t clk)
+{
+    struct timespec ts;
+    clock_gettime(clk, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int app_get_signals(float s[SIG_NUM][SIG_LEN], uint64_t *published)
+{
+    pthread_mutex_lock(&sig_mutex);
+    if(signals_dirty == 0) {
+        pthread_mutex_unlock(&sig_mutex);
+        return -1;
+    }
+    memcpy(s, signals, sizeof(signals));
+    *published = signals_time;
+    signals_dirty = 0;
+    pthread_mutex_unlock(&sig_mutex);
+    return 0;
+}
+
+static int app_wait_signals(int timeout_ms)
+{
+    struct timespec deadline;
+    int ret_val = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec  += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&sig_mutex);
+    while(signals_dirty == 0 && ret_val == 0)
+        ret_val = pthread_cond_timedwait(&sig_cond, &sig_mutex, &deadline);
+    ret_val = signals_dirty;
+    pthread_mutex_unlock(&sig_mutex);
+    return ret_val;
+}
+
+static void *worker_thread(void *arg)
+{
+    int period_us = *(int *)arg;
+    float tmp[SIG_NUM][SIG_LEN];
+    uint64_t frame = 0;
+    int i;
+
+    while(running) {
+        usleep(period_us);
+        frame++;
+        for(i = 0; i < SIG_LEN; i++)
+            tmp[0][i] = tmp[1][i] = tmp[2][i] = (float)(frame + i);
+
+        pthread_mutex_lock(&sig_mutex);
+        memcpy(signals, tmp, sizeof(signals));
+        signals_time = now_ns(CLOCK_MONOTONIC);
+        signals_dirty = 1;
+        pthread_cond_broadcast(&sig_cond);
+        pthread_mutex_unlock(&sig_mutex);
+    }
+    return NULL;
+}
+
+/* One /data request, the same sequence as rp_data_get_signals() */
+static void request(result_t *res, float s[SIG_NUM][SIG_LEN])
+{
+    uint64_t published = 0;
+    int retries = RETRIES;
+    int ret_val;
+
+    ret_val = app_get_signals(s, &published);
+    res->get_calls++;
+
+    if(res->use_wait) {
+        if((ret_val == -1) && (app_wait_signals(retries) > 0)) {
+            ret_val = app_get_signals(s, &published);
+            res->get_calls++;
+        }
+    } else {
+        while(ret_val == -1) {
+            ret_val = app_get_signals(s, &published);
+            res->get_calls++;
+            if(retries-- <= 0)
+                break;
+            else
+                usleep(1000);
+        }
+    }
+
+    if(ret_val == 0) {
+        res->latency[res->fresh++] = now_ns(CLOCK_MONOTONIC) - published;
+    }
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void run(result_t *res, int requests)
+{
+    static float s[SIG_NUM][SIG_LEN];
+    uint64_t cpu0, wall0;
+    int i;
+
+    pthread_mutex_lock(&sig_mutex);
+    signals_dirty = 0;
+    pthread_mutex_unlock(&sig_mutex);
+
+    cpu0 = now_ns(CLOCK_THREAD_CPUTIME_ID);
+    wall0 = now_ns(CLOCK_MONOTONIC);
+    for(i = 0; i < requests; i++)
+        request(res, s);
+    res->cpu_ns = now_ns(CLOCK_THREAD_CPUTIME_ID) - cpu0;
+    res->wall_ns = now_ns(CLOCK_MONOTONIC) - wall0;
+}
+
+static void print(const result_t *res, int requests)
+{
+    uint64_t sum = 0;
+    int i, n = res->fresh;
+
+    qsort(res->latency, n, sizeof(uint64_t), cmp_u64);
+    for(i = 0; i < n; i++)
+        sum += res->latency[i];
+
+    printf("%-5s: %d/%d fresh, latency mean %.1f us, p50 %.1f us, "
+           "p99 %.1f us, max %.1f us; %.1f get calls and %.1f us CPU "
+           "per request; %.1f requests/s\n",
+           res->name, n, requests,
+           n ? sum / n / 1e3 : 0.0,
+           n ? res->latency[n / 2] / 1e3 : 0.0,
+           n ? res->latency[(n * 99) / 100] / 1e3 : 0.0,
+           n ? res->latency[n - 1] / 1e3 : 0.0,
+           (double)res->get_calls / requests,
+           res->cpu_ns / 1e3 / requests,
+           requests / (res->wall_ns / 1e9));
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-p period_us] [-n requests]\n"
+            "  -p  worker frame period in microseconds (default %d)\n"
+            "  -n  number of requests per mode (default %d)\n",
+            name, DEFAULT_PERIOD_US, DEFAULT_REQUESTS);
+}
+
+int main(int argc, char *argv[])
+{
+    int period_us = DEFAULT_PERIOD_US;
+    int requests = DEFAULT_REQUESTS;
+    pthread_t worker;
+    result_t poll_res, wait_res;
+    int opt;
+
+    while((opt = getopt(argc, argv, "p:n:h")) != -1) {
+        switch(opt) {
+        case 'p':
+            period_us = atoi(optarg);
+            break;
+        case 'n':
+            requests = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if(period_us <= 0 || requests <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    memset(&poll_res, 0, sizeof(poll_res));
+    memset(&wait_res, 0, sizeof(wait_res));
+    poll_res.name = "poll";
+    wait_res.name = "wait";
+    wait_res.use_wait = 1;
+    poll_res.latency = (uint64_t *)malloc(requests * sizeof(uint64_t));
+    wait_res.latency = (uint64_t *)malloc(requests * sizeof(uint64_t));
+    if(poll_res.latency == NULL || wait_res.latency == NULL) {
+        fprintf(stderr, "malloc() failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    if(pthread_create(&worker, NULL, worker_thread, &period_us) != 0) {
+        fprintf(stderr, "pthread_create() failed\n");
+        return 1;
+    }
+
+    printf("frame period %d us, %d requests per mode\n", period_us, requests);
+    run(&poll_res, requests);
+    print(&poll_res, requests);
+    run(&wait_res, requests);
+    print(&wait_res, requests);
+
+    running = 0;
+    pthread_join(worker, NULL);
+    free(poll_res.latency);
+    free(wait_res.latency);
+    return 0;
+}
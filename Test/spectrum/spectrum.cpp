@@ -3,6 +3,7 @@
 #include <locale>
 #include <algorithm>
 #include <array>
+#include <limits>
 #include <vector>
 #include <cmath>
 #include <csignal>
@@ -86,19 +87,15 @@ static void spectrum_worker(cli_args_t args) {
         signal_array = signal_array_t(spectrum_signal_size, 0);
     }
 
-    std::vector<double> cha_in(rp_get_spectr_signal_max_length(), 0);
-    std::vector<double> chb_in(rp_get_spectr_signal_max_length(), 0);
-    std::vector<double> cha_fft(rp_get_spectr_out_signal_max_length(), 0);
-    std::vector<double> chb_fft(rp_get_spectr_out_signal_max_length(), 0);
+    std::vector<float> cha_in(rp_get_spectr_signal_max_length(), 0);
+    std::vector<float> chb_in(rp_get_spectr_signal_max_length(), 0);
 
     // API compatible
     // float *tmp_signal_0 = tmp_signals[0].data();
     float *tmp_signal_1 = tmp_signals[1].data();
     float *tmp_signal_2 = tmp_signals[2].data();
-    double *p_cha_fft = cha_fft.data();
-    double *p_chb_fft = chb_fft.data();
-    double *p_cha_in = cha_in.data();
-    double *p_chb_in = chb_in.data();
+    float *p_cha_in = cha_in.data();
+    float *p_chb_in = chb_in.data();
 
     const float freq_step = current_freq_range / (spectrum_signal_size - 1);
     const size_t freq_index_min = std::floor(args.freq_min / freq_step);
@@ -148,11 +145,9 @@ static void spectrum_worker(cli_args_t args) {
         // Retrieve data and process it
         uint32_t trig_pos;
         rp_AcqGetWritePointerAtTrig(&trig_pos);
-        rp_AcqGetDataV2D(trig_pos,&buffer_size, p_cha_in, p_chb_in);
+        rp_AcqGetDataV2(trig_pos,&buffer_size, p_cha_in, p_chb_in);
     //    rp_spectr_prepare_freq_vector(&tmp_signal_0, ADC_SAMPLE_RATE, decimation);
-        rp_spectr_window_filter(p_cha_in, p_chb_in, &p_cha_in, &p_chb_in);
-        rp_spectr_fft(p_cha_in, p_chb_in, &p_cha_fft, &p_chb_fft);
-        rp_spectr_decimate(p_cha_fft, p_chb_fft, &tmp_signal_1, &tmp_signal_2, rp_get_spectr_out_signal_length(), spectrum_signal_size);
+        rp_spectr_fft_decimate(p_cha_in, p_chb_in, &tmp_signal_1, &tmp_signal_2, spectrum_signal_size);
 
         // Unused
         rp_spectr_worker_res_t tmp_result;
@@ -0,0 +1,144 @@
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+extern "C" {
+    #include <../../rp-api/api/src/spec_dsp.h>
+}
+
+// Compares the double precision spectrum pipeline (window, two real FFTs,
+// decimation) with the fused single precision one on synthetic signals.
+// Does not need the FPGA, only the spectrum DSP part of librp.
+
+namespace {
+using clock_type = std::chrono::steady_clock;
+
+static constexpr size_t spectrum_signal_size = 8 * 1024;
+
+struct frame_result_t {
+    std::vector<float> cha;
+    std::vector<float> chb;
+    float peak_cha;
+    float peak_chb;
+};
+
+static void make_signals(std::vector<double> &cha, std::vector<double> &chb) {
+    std::mt19937 gen(1);
+    std::normal_distribution<double> noise(0, 1e-4);
+    const double n = cha.size();
+
+    for (size_t i = 0; i < cha.size(); ++i) {
+        cha[i] = 0.5 * std::sin(2 * M_PI * 1000.3 * i / n) + noise(gen);
+        chb[i] = 0.05 * std::sin(2 * M_PI * 3001.7 * i / n) + 0.01 * std::cos(2 * M_PI * 7.5 * i / n) + noise(gen);
+    }
+}
+
+static void to_dBm(frame_result_t &res, int decimation) {
+    float *cha = res.cha.data();
+    float *chb = res.chb.data();
+    float freq_cha, freq_chb;
+    rp_spectr_cnv_to_metric(cha, chb, &cha, &chb, &res.peak_cha, &freq_cha, &res.peak_chb, &freq_chb, decimation);
+}
+
+static double run_double(const std::vector<double> &cha, const std::vector<double> &chb, int frames, frame_result_t &res) {
+    std::vector<double> cha_in(cha.size()), chb_in(chb.size());
+    std::vector<double> cha_fft(rp_get_spectr_out_signal_max_length()), chb_fft(rp_get_spectr_out_signal_max_length());
+    double *p_cha_in = cha_in.data();
+    double *p_chb_in = chb_in.data();
+    double *p_cha_fft = cha_fft.data();
+    double *p_chb_fft = chb_fft.data();
+    float *p_cha_out = res.cha.data();
+    float *p_chb_out = res.chb.data();
+
+    const auto start = clock_type::now();
+    for (int f = 0; f < frames; ++f) {
+        // the window is applied in place, so start from fresh data as an acquisition would
+        std::copy(cha.begin(), cha.end(), cha_in.begin());
+        std::copy(chb.begin(), chb.end(), chb_in.begin());
+        rp_spectr_window_filter(p_cha_in, p_chb_in, &p_cha_in, &p_chb_in);
+        rp_spectr_fft(p_cha_in, p_chb_in, &p_cha_fft, &p_chb_fft);
+        rp_spectr_decimate(p_cha_fft, p_chb_fft, &p_cha_out, &p_chb_out, rp_get_spectr_out_signal_length(), spectrum_signal_size);
+    }
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+static double run_float(const std::vector<double> &cha, const std::vector<double> &chb, int frames, frame_result_t &res) {
+    std::vector<float> cha_in(cha.begin(), cha.end()), chb_in(chb.begin(), chb.end());
+    float *p_cha_out = res.cha.data();
+    float *p_chb_out = res.chb.data();
+
+    const auto start = clock_type::now();
+    for (int f = 0; f < frames; ++f) {
+        if (rp_spectr_fft_decimate(cha_in.data(), chb_in.data(), &p_cha_out, &p_chb_out, spectrum_signal_size)) {
+            std::exit(1);
+        }
+    }
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+// Largest difference in dB over the bins less than 80 dB below the peak. Further
+// down the single precision rounding of the packed FFT (about 140 dB below the
+// stronger channel) starts to show, which is still under the ADC noise floor.
+static float max_difference(const std::vector<float> &ref, const std::vector<float> &val, float peak) {
+    float diff = 0;
+    for (size_t i = 0; i < ref.size(); ++i) {
+        if (ref[i] > peak - 80) {
+            diff = std::max(diff, std::fabs(ref[i] - val[i]));
+        }
+    }
+    return diff;
+}
+}
+
+int main(int argc, char *argv[]) {
+    std::cout.imbue(std::locale::classic());
+    std::cout << std::fixed << std::setprecision(2);
+
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 100;
+    const int decimation = 1;
+    const char *mode_names[] = {"dBm", "V", "dBu"};
+    bool ok = true;
+
+    if (rp_spectr_window_init(HANNING) || rp_spectr_fft_init()) {
+        std::cerr << "Error: spectrum DSP init failed" << std::endl;
+        return 1;
+    }
+
+    std::vector<double> cha(rp_get_spectr_signal_length()), chb(rp_get_spectr_signal_length());
+    make_signals(cha, chb);
+
+    for (int mode = 0; mode < 3; ++mode) {
+        rp_spectr_set_mode(mode);
+
+        frame_result_t ref = {std::vector<float>(spectrum_signal_size), std::vector<float>(spectrum_signal_size), 0, 0};
+        frame_result_t res = ref;
+
+        const double t_double = run_double(cha, chb, frames, ref);
+        const double t_float = run_float(cha, chb, frames, res);
+
+        to_dBm(ref, decimation);
+        to_dBm(res, decimation);
+        const float diff = std::max(max_difference(ref.cha, res.cha, ref.peak_cha),
+                                    max_difference(ref.chb, res.chb, ref.peak_chb));
+        const bool mode_ok = diff < (mode == 1 ? 1e-3 : 0.01);
+        ok = ok && mode_ok;
+
+        std::cout << mode_names[mode] << ": " << rp_get_spectr_signal_length() << " points, "
+                  << "double " << frames / t_double << " frames/s, "
+                  << "fused float " << frames / t_float << " frames/s, "
+                  << "speedup " << t_double / t_float << "x, "
+                  << "max difference " << std::setprecision(4) << diff << std::setprecision(2)
+                  << (mode_ok ? " OK" : " FAILED") << "\n";
+    }
+
+    rp_spectr_fft_clean();
+    rp_spectr_window_clean();
+
+    return ok ? 0 : 1;
+}
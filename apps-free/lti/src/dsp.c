@@ -27,6 +27,10 @@
 #include "kiss_fftr.h"
 #include "complex.h"
 
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
 
 
 extern float g_lti_fpga_adc_max_v;
@@ -435,3 +439,295 @@ int rp_lti_calc_fresp(float **cha_out, float **chb_out,
 
     return 0;
 }
+
+
+/*----------------------------------------------------------------------------------*/
+/* Roots of z^n + c[0] z^(n-1) + ... + c[n-1] (Durand-Kerner iteration) */
+#define RP_LTI_ROOT_ITER 2000
+static void rp_lti_poly_roots(const double *c, int n, double complex *roots)
+{
+    int cluster[RP_LTI_SOS_MAX * 2];
+    int i, j, it;
+
+    for(i = 0; i < n; i++)
+        roots[i] = cpow(0.4 + 0.9 * I, i);
+
+    for(it = 0; it < RP_LTI_ROOT_ITER; it++) {
+        double delta = 0;
+        for(i = 0; i < n; i++) {
+            double complex p = 1, q = 1, d;
+            for(j = 0; j < n; j++)
+                p = p * roots[i] + c[j];
+            for(j = 0; j < n; j++)
+                if(j != i)
+                    q *= roots[i] - roots[j];
+            d = (cabs(q) > 0) ? p / q : 1e-9;
+            roots[i] -= d;
+            if(cabs(d) > delta * (1 + cabs(roots[i])))
+                delta = cabs(d) / (1 + cabs(roots[i]));
+        }
+        if(delta < 1e-14)
+            return;
+    }
+
+    /* Multiple roots do not converge, they end up as a small cloud around the
+     * true root. The centre of the cloud is accurate, so it replaces the members.
+     * Only done when the iteration failed, distinct close roots converge. */
+    for(i = 0; i < n; i++)
+        cluster[i] = -1;
+    for(i = 0; i < n; i++) {
+        double complex sum = 0;
+        int cnt = 0;
+        if(cluster[i] >= 0)
+            continue;
+        for(j = i; j < n; j++) {
+            if(cluster[j] < 0 && cabs(roots[j] - roots[i]) < 1e-2 * (1 + cabs(roots[i]))) {
+                cluster[j] = i;
+                sum += roots[j];
+                cnt++;
+            }
+        }
+        /* A root of multiplicity cnt is a simple root of the (cnt-1)th derivative */
+        sum /= cnt;
+        for(it = 0; cnt > 1 && it < 20; it++) {
+            double complex t[RP_LTI_SOS_MAX * 2 + 1];
+            int m;
+            t[0] = 1;
+            for(j = 0; j < n; j++)
+                t[j + 1] = c[j];
+            /* repeated synthetic division leaves p^(m)(x)/m! in t[n-m] */
+            for(m = 0; m <= cnt; m++)
+                for(j = 1; j <= n - m; j++)
+                    t[j] += sum * t[j - 1];
+            if(cabs(t[n - cnt]) == 0)
+                break;
+            sum -= t[n - cnt + 1] / (cnt * t[n - cnt]);
+        }
+        for(j = i; j < n; j++) {
+            if(cluster[j] == i)
+                roots[j] = sum;
+        }
+    }
+}
+
+/* Real quadratic factor c[0] + c[1] z^-1 + c[2] z^-2 of a transfer function polynomial */
+typedef struct rp_lti_quad_s {
+    double         c[3];
+    double complex root;     /* largest root, used for pairing and ordering */
+    int            delay;    /* numerator factor made only of delays */
+} rp_lti_quad_t;
+
+/* Groups n roots (and delays z^-1 factors) into real quadratic factors: complex
+ * roots with their conjugates, real roots with their nearest neighbour */
+static int rp_lti_pair_roots(const double complex *r, int n, int delays,
+                             rp_lti_quad_t *q)
+{
+    int used[RP_LTI_SOS_MAX * 2] = { 0 };
+    int cnt = 0, i, j;
+
+    for(;;) {
+        int a = -1, b = -1;
+        for(i = 0; i < n; i++) {
+            if(!used[i] && (a < 0 || fabs(cimag(r[i])) > fabs(cimag(r[a]))))
+                a = i;
+        }
+        if(a < 0)
+            break;
+        used[a] = 1;
+
+        for(j = 0; j < n; j++) {
+            if(used[j])
+                continue;
+            if(b < 0 || cabs(r[j] - conj(r[a])) < cabs(r[b] - conj(r[a])))
+                b = j;
+        }
+
+        memset(&q[cnt], 0, sizeof(rp_lti_quad_t));
+        q[cnt].root = r[a];
+        if(b >= 0) {
+            used[b] = 1;
+            /* (1 - ra z^-1)(1 - rb z^-1) */
+            q[cnt].c[0] = 1;
+            q[cnt].c[1] = -creal(r[a] + r[b]);
+            q[cnt].c[2] = creal(r[a] * r[b]);
+            if(cabs(r[b]) > cabs(r[a]))
+                q[cnt].root = r[b];
+        } else if(delays > 0) {
+            /* (1 - ra z^-1) z^-1 */
+            q[cnt].c[1] = 1;
+            q[cnt].c[2] = -creal(r[a]);
+            delays--;
+        } else {
+            q[cnt].c[0] = 1;
+            q[cnt].c[1] = -creal(r[a]);
+        }
+        cnt++;
+    }
+
+    for(; delays > 0; delays -= 2, cnt++) {
+        memset(&q[cnt], 0, sizeof(rp_lti_quad_t));
+        q[cnt].c[delays > 1 ? 2 : 1] = 1;
+        q[cnt].delay = 1;
+    }
+    return cnt;
+}
+
+int rp_lti_sos_design(const double *dsp_par, rp_lti_sos_t *sos)
+{
+    double complex zr[RP_LTI_SOS_MAX * 2], pr[RP_LTI_SOS_MAX * 2];
+    double zc[RP_LTI_SOS_MAX * 2], pc[RP_LTI_SOS_MAX * 2];
+    rp_lti_quad_t zq[RP_LTI_SOS_MAX], pq[RP_LTI_SOS_MAX], tmp;
+    int used[RP_LTI_SOS_MAX] = { 0 };
+    int order = (int)dsp_par[64];
+    int m, d, i, j, n;
+    double gain;
+
+    if(order < 1 || order > 2 * RP_LTI_SOS_MAX)
+        return -1;
+    m = order - 1;
+
+    /* Leading zero taps are pure delays */
+    for(d = 0; d < order && dsp_par[d] == 0; d++)
+        ;
+    gain = (d < order) ? dsp_par[d] : 0;
+    if(d == order)
+        d = m;
+
+    for(i = 0; i < m - d; i++)
+        zc[i] = dsp_par[d + 1 + i] / gain;
+    for(i = 0; i < m; i++)
+        pc[i] = dsp_par[65 + i];
+
+    rp_lti_poly_roots(zc, m - d, zr);
+    rp_lti_poly_roots(pc, m, pr);
+    n = rp_lti_pair_roots(pr, m, 0, pq);
+    rp_lti_pair_roots(zr, m - d, d, zq);
+
+    /* Sections with poles closest to the unit circle go last, each pole pair
+     * gets the nearest zeros */
+    for(i = 1; i < n; i++) {
+        for(j = i; j > 0 && cabs(pq[j - 1].root) > cabs(pq[j].root); j--) {
+            tmp = pq[j];
+            pq[j] = pq[j - 1];
+            pq[j - 1] = tmp;
+        }
+    }
+
+    memset(sos, 0, sizeof(rp_lti_sos_t));
+    sos->sections = n;
+    for(i = n - 1; i >= 0; i--) {
+        int best = -1;
+        for(j = 0; j < n; j++) {
+            if(used[j])
+                continue;
+            if(best < 0 || (zq[best].delay && !zq[j].delay) ||
+               (zq[best].delay == zq[j].delay &&
+                cabs(zq[j].root - pq[i].root) < cabs(zq[best].root - pq[i].root)))
+                best = j;
+        }
+        used[best] = 1;
+        sos->b0[i] = zq[best].c[0];
+        sos->b1[i] = zq[best].c[1];
+        sos->b2[i] = zq[best].c[2];
+        sos->a1[i] = pq[i].c[1];
+        sos->a2[i] = pq[i].c[2];
+    }
+
+    /* A pure gain still needs one section, padding sections pass through */
+    if(n == 0) {
+        sos->sections = n = 1;
+        sos->b0[0] = 1;
+    }
+    for(i = n; i < ((n + 3) & ~3); i++)
+        sos->b0[i] = 1;
+
+    sos->b0[0] *= gain;
+    sos->b1[0] *= gain;
+    sos->b2[0] *= gain;
+    return 0;
+}
+
+#ifdef __ARM_NEON
+/* Runs sections s..s+3 as a pipeline: lane k filters sample t-k through section
+ * s+k, so one step advances all four sections. The pipeline is filled and drained
+ * within the call, so the cascade adds no delay. */
+static void rp_lti_sos_filter4(const rp_lti_sos_t *sos, int s, double *state,
+                               float *buf, int len)
+{
+    const float32x4_t b0 = vld1q_f32(sos->b0 + s);
+    const float32x4_t b1 = vld1q_f32(sos->b1 + s);
+    const float32x4_t b2 = vld1q_f32(sos->b2 + s);
+    const float32x4_t a1 = vld1q_f32(sos->a1 + s);
+    const float32x4_t a2 = vld1q_f32(sos->a2 + s);
+    const int32_t c_lanes[4] = { 0, 1, 2, 3 };
+    const int32x4_t lanes = vld1q_s32(c_lanes);
+    const int32x4_t v_len = vdupq_n_s32(len);
+    float z[8];
+    float32x4_t z1, z2, y = vdupq_n_f32(0);
+    int i, t;
+
+    for(i = 0; i < 4; i++) {
+        z[i] = state[2 * i];
+        z[4 + i] = state[2 * i + 1];
+    }
+    z1 = vld1q_f32(z);
+    z2 = vld1q_f32(z + 4);
+
+    for(t = 0; t < len + 3; t++) {
+        float32x4_t in = (t < len) ? vld1q_dup_f32(buf + t) : vdupq_n_f32(0);
+        float32x4_t x = vextq_f32(in, y, 3);
+        float32x4_t n1, n2;
+
+        y = vmlaq_f32(z1, b0, x);
+        n1 = vmlsq_f32(vmlaq_f32(z2, b1, x), a1, y);
+        n2 = vmlsq_f32(vmulq_f32(b2, x), a2, y);
+        if(t >= 3 && t < len) {
+            z1 = n1;
+            z2 = n2;
+        } else {
+            /* filling or draining: only lanes with a sample in range move on */
+            int32x4_t k = vsubq_s32(vdupq_n_s32(t), lanes);
+            uint32x4_t on = vandq_u32(vcgeq_s32(k, vdupq_n_s32(0)), vcltq_s32(k, v_len));
+            z1 = vbslq_f32(on, n1, z1);
+            z2 = vbslq_f32(on, n2, z2);
+        }
+        if(t >= 3)
+            vst1q_lane_f32(buf + t - 3, y, 3);
+    }
+
+    vst1q_f32(z, z1);
+    vst1q_f32(z + 4, z2);
+    for(i = 0; i < 4; i++) {
+        state[2 * i] = z[i];
+        state[2 * i + 1] = z[4 + i];
+    }
+}
+#endif
+
+void rp_lti_sos_filter(const rp_lti_sos_t *sos, double *state,
+                       float *buf, int len)
+{
+    int s, i;
+
+#ifdef __ARM_NEON
+    for(s = 0; s < sos->sections; s += 4)
+        rp_lti_sos_filter4(sos, s, state + 2 * s, buf, len);
+    (void)i;
+#else
+    for(s = 0; s < sos->sections; s++) {
+        const float b0 = sos->b0[s], b1 = sos->b1[s], b2 = sos->b2[s];
+        const float a1 = sos->a1[s], a2 = sos->a2[s];
+        float z1 = state[2 * s], z2 = state[2 * s + 1];
+
+        for(i = 0; i < len; i++) {
+            float x = buf[i];
+            float y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            buf[i] = y;
+        }
+        state[2 * s] = z1;
+        state[2 * s + 1] = z2;
+    }
+#endif
+}
@@ -65,5 +65,31 @@ int rp_lti_calc_fresp(float **cha_out, float **chb_out,
                          double **dsp_par_a, double **dsp_par_b,
                          float freq_range);
 
+/* Online LTI filter as a cascade of second order sections (biquads).
+ * Coefficients are stored per section in structure-of-arrays form so that
+ * groups of 4 sections can be loaded into NEON registers. The coefficient
+ * arrays are filled up to the next multiple of 4 sections with pass-through
+ * sections, the section count itself is not padded.
+ */
+#define RP_LTI_SOS_MAX 32 // 64 taps -> up to 63 poles
+typedef struct rp_lti_sos_s {
+    int   sections;       /* used sections, coefficients padded to a multiple of 4 */
+    float b0[RP_LTI_SOS_MAX];
+    float b1[RP_LTI_SOS_MAX];
+    float b2[RP_LTI_SOS_MAX];
+    float a1[RP_LTI_SOS_MAX];
+    float a2[RP_LTI_SOS_MAX];
+} rp_lti_sos_t;
+
+/* Factors the direct form transfer function in dsp_par (same layout as used
+ * by rp_lti_calc_fresp(): b0..b[order-1] at 0, order at 64, a1..a[order-1] at 65)
+ * into second order sections. */
+int rp_lti_sos_design(const double *dsp_par, rp_lti_sos_t *sos);
+
+/* Filters len samples in place. Two states per section are kept in state
+ * (transposed direct form II), so state needs 2*sos->sections entries. */
+void rp_lti_sos_filter(const rp_lti_sos_t *sos, double *state,
+                       float *buf, int len);
+
 
 #endif //__DSP_H
@@ -23,8 +23,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
 
 #include "fpga_lti.h"
+#include "dsp.h"
 
 
 /* internals */
@@ -307,13 +309,78 @@ int lti_fpga_get_signal(double **cha_signal, double **chb_signal)
     return 0;
 }
 
+/* Sign extension of 14 bit ADC samples held in 32 bit FPGA words */
+#define LTI_S14_SHIFT (32 - 14)
+
+/* Online DSP block: samples converted and filtered at once */
+#define LTI_DSP_BLOCK 1024
+
+/* Second order sections of the online filter, redesigned when the parameters change */
+static rp_lti_sos_t    g_lti_sos;
+static double          g_lti_sos_par[LTI_DSP_PARAMS];
+static int             g_lti_sos_order = -1;
+static lti_dsp_stats_t g_lti_dsp_stats;
+
+static double lti_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Returns 0 when the filter in dsp_par is already designed */
+static int lti_sos_update(const double *dsp_par)
+{
+    int order = (int)dsp_par[64];
+    int i;
+
+    if(order < 1 || order > 64) {
+        fprintf(stderr, "lti_fpga_online_dsp() invalid filter order %d\n", order);
+        g_lti_sos_order = -1;
+        return -1;
+    }
+    if(order == g_lti_sos_order) {
+        for(i = 0; i < order; i++) {
+            if(dsp_par[i] != g_lti_sos_par[i] || dsp_par[64 + i] != g_lti_sos_par[64 + i])
+                break;
+        }
+        if(i == order)
+            return 0;
+    }
+
+    if(rp_lti_sos_design(dsp_par, &g_lti_sos) < 0) {
+        g_lti_sos_order = -1;
+        return -1;
+    }
+    for(i = 0; i < order; i++) {
+        g_lti_sos_par[i] = dsp_par[i];
+        g_lti_sos_par[64 + i] = dsp_par[64 + i];
+    }
+    g_lti_sos_order = order;
+    memset(&g_lti_dsp_stats, 0, sizeof(g_lti_dsp_stats));
+    g_lti_dsp_stats.min_headroom = LTI_FPGA_SIG_LEN;
+    return 1;
+}
+
+/* Clamps to the 14 bit range, rounds half away from zero and returns two's complement */
+static inline int lti_float_to_s14(float sig)
+{
+    if(sig > (float)((1 << 13) - 1))
+        sig = (float)((1 << 13) - 1);
+    if(sig < (float)(-(1 << 13)))
+        sig = (float)(-(1 << 13));
+    return (int)(sig < 0 ? sig - 0.5f : sig + 0.5f) & ((1 << 14) - 1);
+}
+
 int lti_fpga_online_dsp(double **ch1_data, double **ch2_data, int gen_delay,  
 			   double **state_a, double **state_b, double **dsp_par_a, 
 			   double **dsp_par_b, int dsp_loc_ptr, int **awg_a_ptr, 
 			   int **awg_b_ptr)
 {
-    int curr_ptr, dsp_ptr;
-    int in_idx, out_idx, in_loc, out_loc;
+    int curr_ptr, end_ptr, dsp_ptr;
+    int done, len, total, i;
+    double t_start;
+    float buf[LTI_DSP_BLOCK];
     double *cha_in = *ch1_data;  // Use this variables to pass DSP signals to GUI
     double *chb_in = *ch2_data;
     
@@ -321,146 +388,92 @@ int lti_fpga_online_dsp(double **ch1_data, double **ch2_data, int gen_delay,
     //double *chb_state = *state_b;  DSP enabled on channel 1 only
 
     double *cha_dsp_par = *dsp_par_a; // DSP parameters array
-    
-    double fir,iir,curr_in; // DSP variables    
-    int order;   
-    int dsp_ix;
      
     int *cha_awg=*awg_a_ptr;       
     //int *chb_awg=*awg_b_ptr;     DSP enabled on channel 1 only
 
-    order= (int) (cha_dsp_par[64]); //IIR filter specific
-    
     if(!cha_in || !chb_in) {
         fprintf(stderr, "lti_fpga_get_signal() not initialized\n");
         return -1;
     }  
-     
-     // Check current input write pointer (the buffer is running ("live" mode) ) 
-      lti_fpga_get_wr_ptr(&curr_ptr, NULL);
-    
-    
-   // Process the samples behind write pointer   
-     
-      
-      // Resolve buffer wrapping  
-      if ((curr_ptr)<dsp_loc_ptr)
-      {
-	curr_ptr=curr_ptr+LTI_FPGA_SIG_LEN;
-      }
-      //Now dsp_loc_ptr <= curr_ptr 
-      
-   
-      
-      //(loc. to be processed from dsp_loc_ptr to curr_ptr-1)  
-      for(in_idx= dsp_loc_ptr, out_idx=0; in_idx<(curr_ptr-1); in_idx++, out_idx++) {
-	
-	// Resolve buffer wrapping
-	in_loc = in_idx % LTI_FPGA_SIG_LEN;
-	
-	// Calculates output buffer location corresponting to current DSP input buffer location	
-	// The buffers are started simultaneously 
-	out_loc= (in_idx+gen_delay) % LTI_FPGA_SIG_LEN;
-	
-	
-	
-	// ADD DSP CODE HERE	
-	
-	// IIR FILTER implementation
-	
-	
-/**	
-**                      +--------------+      FIR             IIR                                                  
-**  INPUT               |              |                                                            OUTPUT             
-**+----------+---------->   x b0 (p0)  +----->(+)------------>(+)---------------------------------+--------->
-**           |          |              |       ^               ^                                  |          
-**           |          +--------------+       |               |                                  |          
-**           |                                 |               |                                  |          
-**           |                                 |               |                                  |    
-**    +------v------+                          |               |                           +------v------+   
-**    |             |                          |               |                           |             |   
-**    |     s0      |                          |               |                           |     s64     |   
-**    |             |                          |               |                           |             |   
-**    +------+------+                          |               |                           +------+------+                 
-**           |          +--------------+       |               |        +----------------+        |          
-**           |          |              |       |               |        |                |        |          
-**           +---------->   x b1 (p1)  +----->(+)             (+)<------+  x -a1 (-p65)  <--------+          
-**           |          |              |       ^               ^        |                |        |          
-**           |          +--------------+       |               |        +----------------+        |          
-**    +------v------+                          |               |                           +------v------+   
-**    |             |                          |               |                           |             |   
-**    |     s1      |                          |               |                           |     s65     |   
-**    |             |                          |               |                           |             |   
-**    +------+------+                          |               |                           +------+------+   
-**           |                                 |               |                                  |          
-**           |          +--------------+       |               |        +----------------+        |          
-**           |          |              |       |               |        |                |        |          
-**           +---------->   x b2 (p2)  +----->(+)             (+)<------+  x -a2 (-p66)  <--------+          
-**           |          |              |       ^               ^        |                |        |          
-**           |          +--------------+       |               |        +----------------+        |          
-**           v                                 +               +                                  v          
-**                                                                                                           */
-
-// MAC (MultiplyAndAccumulate) 
-	
-	// Retrieve input signal
-	curr_in=conv_s14_to_double(g_lti_fpga_cha_mem[in_loc]);
-	
-	//First FIR coefficient (b0)
-	fir=curr_in*cha_dsp_par[0];
-	//Initialize IIR
-	iir=0;
-	
-	// For every FIR and IIR coeff.
-	for (dsp_ix=0; dsp_ix<(order-1); dsp_ix++)
-	{
-	  // Accumulate delayed FIR input times FIR coeffs. (starting from s0*b1 (at loc 1))
-	  fir+=cha_state[dsp_ix]*cha_dsp_par[dsp_ix+1];
-	  // Accumulate delayes IIR output state times IIR coeffs. (starting from s64*(-a1) (at loc p65), a0 is by definition =1, (at loc. p64 is stored filter order))
-	  iir+=cha_state[64+dsp_ix]*(-cha_dsp_par[64+dsp_ix+1]);
-	   
-	  //fprintf(fp3, "  dsp_ix: %d (in_idx: %d) fir: %4.4f iir: %4.4f ParFIR: %4.4f ParIIR: %4.4f  stat_fir: %4.4f  stat_iir: %4.4f\n", dsp_ix, in_idx, fir, iir, cha_dsp_par[dsp_ix+1], (-cha_dsp_par[64+dsp_ix+1]), cha_state[dsp_ix], cha_state[64+dsp_ix] );   
-	 
-	}
-	//add also FIR term
-	iir+=fir;
-	
-	// Propagating states for next iteration: from last register in the chain to the first
-	
-	for (dsp_ix=(order-1); dsp_ix>0 ;dsp_ix--)
-	{
-	  // FIR states
-	  cha_state[dsp_ix]=cha_state[dsp_ix-1];
-	  // IIR states
-	  cha_state[64+dsp_ix]=cha_state[64+dsp_ix-1];
-	}
-	//Updating first registers
-	cha_state[0]=curr_in;
-	cha_state[64]=iir;
-	
-	// First IIR register corresponds to output to be applied to DAC
-	cha_awg[out_loc] = conv_double_to_s14(cha_state[64]);
-	
-	
-	//IIR implementation ends
-	
-	
 
-	// Signal acquisition: pass processed samples for GUI visualization purposes
-	cha_in[out_idx] = g_lti_fpga_cha_mem[in_loc];
-        chb_in[out_idx] = g_lti_fpga_chb_mem[in_loc];
-	
-      }
-      // return next DSP cycle pointer
-      dsp_ptr=(curr_ptr-1) % LTI_FPGA_SIG_LEN;;
-      
-      //Thid pointer can be used to calculate elapsed DSP time
-      //lti_fpga_get_wr_ptr(&curr_ptr, NULL);
- 
-      
-      
-      
-  return dsp_ptr;
+    if(lti_sos_update(cha_dsp_par) < 0)
+        return dsp_loc_ptr;
+
+    t_start = lti_time_us();
+
+    // Check current input write pointer (the buffer is running ("live" mode) ) 
+    lti_fpga_get_wr_ptr(&curr_ptr, NULL);
+
+    // Resolve buffer wrapping, now dsp_loc_ptr <= curr_ptr
+    if(curr_ptr < dsp_loc_ptr)
+        curr_ptr = curr_ptr + LTI_FPGA_SIG_LEN;
+
+    /* Samples from dsp_loc_ptr to curr_ptr-2 are processed in blocks that do not
+     * cross the end of the input nor the output buffer, so the inner loops run
+     * over contiguous memory. The cascade keeps its state in registers within a
+     * block and in cha_state between blocks and calls.
+     *
+     *   INPUT -> [ biquad 0 ] -> [ biquad 1 ] -> ... -> [ biquad N-1 ] -> OUTPUT (DAC)
+     *
+     * Each biquad is a transposed direct form II section:
+     *   y = b0*x + z1,  z1 = b1*x - a1*y + z2,  z2 = b2*x - a2*y
+     */
+    total = curr_ptr - 1 - dsp_loc_ptr;
+    if(total <= 0)
+        return dsp_loc_ptr;
+
+    for(done = 0; done < total; done += len) {
+        int in_loc = (dsp_loc_ptr + done) % LTI_FPGA_SIG_LEN;
+        // Output buffer location corresponding to the DSP input buffer location
+        // (the buffers are started simultaneously)
+        int out_loc = (dsp_loc_ptr + done + gen_delay) % LTI_FPGA_SIG_LEN;
+
+        len = total - done;
+        if(len > LTI_FPGA_SIG_LEN - in_loc)
+            len = LTI_FPGA_SIG_LEN - in_loc;
+        if(len > LTI_FPGA_SIG_LEN - out_loc)
+            len = LTI_FPGA_SIG_LEN - out_loc;
+        if(len > LTI_DSP_BLOCK)
+            len = LTI_DSP_BLOCK;
+
+        // Each input sample is read from the FPGA once, for the filter and for the GUI
+        for(i = 0; i < len; i++) {
+            uint32_t raw = g_lti_fpga_cha_mem[in_loc + i];
+            buf[i] = (float)((int32_t)(raw << LTI_S14_SHIFT) >> LTI_S14_SHIFT);
+            cha_in[done + i] = raw;
+            chb_in[done + i] = g_lti_fpga_chb_mem[in_loc + i];
+        }
+
+        rp_lti_sos_filter(&g_lti_sos, cha_state, buf, len);
+
+        for(i = 0; i < len; i++)
+            cha_awg[out_loc + i] = lti_float_to_s14(buf[i]);
+    }
+
+    // return next DSP cycle pointer
+    dsp_ptr = (curr_ptr - 1) % LTI_FPGA_SIG_LEN;
+
+    /* Headroom: how far the generator still is from the oldest output written in
+     * this call, assuming all outputs were written at the end of it */
+    lti_fpga_get_wr_ptr(&end_ptr, NULL);
+    g_lti_dsp_stats.samples = total;
+    g_lti_dsp_stats.proc_us = lti_time_us() - t_start;
+    g_lti_dsp_stats.headroom = gen_delay - 
+        (end_ptr - dsp_loc_ptr + 2 * LTI_FPGA_SIG_LEN) % LTI_FPGA_SIG_LEN;
+    if(g_lti_dsp_stats.headroom < g_lti_dsp_stats.min_headroom)
+        g_lti_dsp_stats.min_headroom = g_lti_dsp_stats.headroom;
+    if(g_lti_dsp_stats.headroom < 0)
+        g_lti_dsp_stats.late_calls++;
+    g_lti_dsp_stats.calls++;
+
+    return dsp_ptr;
+}
+
+int lti_fpga_get_dsp_stats(lti_dsp_stats_t *stats)
+{
+    *stats = g_lti_dsp_stats;
+    return 0;
 }
 
 double conv_s14_to_double(int sigs14)
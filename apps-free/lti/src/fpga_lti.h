@@ -210,8 +210,21 @@ int lti_fpga_get_sig_ptr(int **cha_signal, int **chb_signal);
 /* Copies the last acquisition (trig wr. ptr -> curr. wr. ptr) */
 int lti_fpga_get_signal(double **cha_signal, double **chb_signal);
 
+/* Timing of the last lti_fpga_online_dsp() call */
+typedef struct lti_dsp_stats_s {
+    int      samples;       /* samples processed */
+    double   proc_us;       /* processing time [us] */
+    /* samples left before the generator reads the oldest output of the call,
+     * negative when the output was written too late */
+    int      headroom;
+    int      min_headroom;  /* smallest headroom since the filter was designed */
+    unsigned calls;
+    unsigned late_calls;    /* calls with negative headroom */
+} lti_dsp_stats_t;
+
 /* Acquisition embedded DSP module */
 int lti_fpga_online_dsp(double **ch1_data, double **ch2_data, int gen_delay, double **state_a, double **state_b, double **dsp_par_a, double **dsp_par_b, int dsp_loc_ptr, int **awg_a_ptr, int **awg_b_ptr);
+int lti_fpga_get_dsp_stats(lti_dsp_stats_t *stats);
 
 /* Helper function: complement two's conversion*/
 double conv_s14_to_double(int sigs14);
@@ -41,9 +41,18 @@ double            *rp_dft_out_re_U = NULL;
 double            *rp_dft_out_im_U = NULL;
 double            *rp_dft_out_re_I = NULL;
 double            *rp_dft_out_im_I = NULL; 
+double            *rp_dft_work     = NULL;
+int                rp_dft_capacity = 0;
 
 const double PI2 = 2 * M_PI;
 
+/* Goertzel block length - recurrences restart every block to bound round-off
+ * growth, block results are combined through a renormalized phase rotator */
+#define PWR_DFT_BLOCK 1024
+/* Per harmonic work arrays: coef, cos, sin, block rotator re/im, phasor re/im,
+ * U state s1/s2, I state s1/s2 */
+#define PWR_DFT_WORK_ARRAYS 11
+
 
 int rp_pwr_hann_init(int length)
 {
@@ -185,11 +194,29 @@ int rp_pwr_dft_init()
         rp_pwr_dft_clean();
     }
 
-    rp_dft_out_re_U = (double *)malloc(sizeof(double) * pwr_dft_harmonic_num);
-    rp_dft_out_im_U = (double *)malloc(sizeof(double) * pwr_dft_harmonic_num);
-    rp_dft_out_re_I = (double *)malloc(sizeof(double) * pwr_dft_harmonic_num);
-    rp_dft_out_im_I = (double *)malloc(sizeof(double) * pwr_dft_harmonic_num);
-    
+    return rp_pwr_dft_reserve(pwr_dft_harmonic_num);
+}
+
+int rp_pwr_dft_reserve(int harmonic_num)
+{
+    if(harmonic_num <= rp_dft_capacity)
+        return 0;
+
+    rp_pwr_dft_clean();
+
+    rp_dft_out_re_U = (double *)malloc(sizeof(double) * harmonic_num);
+    rp_dft_out_im_U = (double *)malloc(sizeof(double) * harmonic_num);
+    rp_dft_out_re_I = (double *)malloc(sizeof(double) * harmonic_num);
+    rp_dft_out_im_I = (double *)malloc(sizeof(double) * harmonic_num);
+    rp_dft_work = (double *)malloc(sizeof(double) * harmonic_num * PWR_DFT_WORK_ARRAYS);
+
+    if(!rp_dft_out_re_U || !rp_dft_out_im_U || !rp_dft_out_re_I || !rp_dft_out_im_I || !rp_dft_work) {
+        fprintf(stderr, "rp_pwr_dft_reserve() can not allocate mem");
+        rp_pwr_dft_clean();
+        return -1;
+    }
+    rp_dft_capacity = harmonic_num;
+
     return 0;
 }
 
@@ -214,23 +241,31 @@ int rp_pwr_dft_clean()
         free(rp_dft_out_im_I);
         rp_dft_out_im_I = NULL;
     }
+
+    if(rp_dft_work) {
+        free(rp_dft_work);
+        rp_dft_work = NULL;
+    }
+    rp_dft_capacity = 0;
     
     return 0;
 }
 
 int rp_pwr_dft(double *cha_in, double *chb_in, int length, float rel_freq, 
                double *amp_U, double *amp_I, double *fi_U, double *fi_I)
+{
+    return rp_pwr_harmonics(cha_in, chb_in, length, rel_freq, pwr_dft_harmonic_num,
+                            amp_U, amp_I, fi_U, fi_I);
+}
+
+int rp_pwr_harmonics(const double *cha_in, const double *chb_in, int length,
+                     float rel_freq, int harmonic_num,
+                     double *amp_U, double *amp_I, double *fi_U, double *fi_I)
 {
     int k;
-    int n;
-    double K;
-    double angle = 0;
-    double sum_re_U = 0;
-    double sum_im_U = 0;
-    double sum_re_I = 0;
-    double sum_im_I = 0; 
-         
-    if(!cha_in || !chb_in ||  !*amp_U ||  !*amp_I || !*fi_U || !*fi_I)
+    int n, n0, blk_len;
+
+    if(!cha_in || !chb_in || !amp_U || !amp_I || !fi_U || !fi_I || length <= 0 || harmonic_num <= 0)
          return -1;
 
     if(!rp_dft_out_re_U || !rp_dft_out_im_U || !rp_dft_out_re_I || !rp_dft_out_im_I) {
@@ -238,30 +273,93 @@ int rp_pwr_dft(double *cha_in, double *chb_in, int length, float rel_freq,
          return -1;
     }
 
-    for(k = 0; k < pwr_dft_harmonic_num; k++ ) {
-     
-        sum_re_U = 0;
-        sum_im_U = 0;
-        sum_re_I = 0;
-        sum_im_I = 0; 
-         
-         K = (k + 1) * PI2 * rel_freq / length;	
-
-         for(n = 0; n < length; n++) { 
-             
-             angle = n * K;
-             
-             sum_re_U += cha_in[n] * cos(angle);
-             sum_im_U += -cha_in[n] * sin(angle);
-             sum_re_I += chb_in[n] * cos(angle);
-             sum_im_I += -chb_in[n] * sin(angle);
-         }
-
-         rp_dft_out_re_U[k] = sum_re_U;
-         rp_dft_out_im_U[k] = sum_im_U;
-         rp_dft_out_re_I[k] = sum_re_I;
-         rp_dft_out_im_I[k] = sum_im_I;
+    if(rp_pwr_dft_reserve(harmonic_num) < 0)
+         return -1;
+
+    double *coef  = rp_dft_work;
+    double *cos_w = coef  + harmonic_num;
+    double *sin_w = cos_w + harmonic_num;
+    double *blk_re = sin_w + harmonic_num;
+    double *blk_im = blk_re + harmonic_num;
+    double *ph_re = blk_im + harmonic_num;
+    double *ph_im = ph_re + harmonic_num;
+    double *s1_U  = ph_im + harmonic_num;
+    double *s2_U  = s1_U + harmonic_num;
+    double *s1_I  = s2_U + harmonic_num;
+    double *s2_I  = s1_I + harmonic_num;
+
+    /* Harmonic k+1 is evaluated at w = (k + 1) * 2pi * rel_freq / length */
+    for(k = 0; k < harmonic_num; k++) {
+        double w = (k + 1) * PI2 * rel_freq / length;
+        cos_w[k] = cos(w);
+        sin_w[k] = sin(w);
+        coef[k]  = 2 * cos_w[k];
+        /* e^(-jw(B-1)) - moves a full block result to the block start */
+        blk_re[k] = cos(w * (PWR_DFT_BLOCK - 1));
+        blk_im[k] = -sin(w * (PWR_DFT_BLOCK - 1));
+        /* e^(-jw*n0) for n0 = 0 */
+        ph_re[k] = 1;
+        ph_im[k] = 0;
+        rp_dft_out_re_U[k] = 0;
+        rp_dft_out_im_U[k] = 0;
+        rp_dft_out_re_I[k] = 0;
+        rp_dft_out_im_I[k] = 0;
+    }
+
+    for(n0 = 0; n0 < length; n0 += PWR_DFT_BLOCK) {
+        blk_len = length - n0 < PWR_DFT_BLOCK ? length - n0 : PWR_DFT_BLOCK;
+
+        memset(s1_U, 0, sizeof(double) * harmonic_num * 4);
+
+        /* Goertzel recurrences of all harmonics for both channels, each
+         * sample is loaded once */
+        for(n = n0; n < n0 + blk_len; n++) {
+            double u = cha_in[n];
+            double i = chb_in[n];
+            for(k = 0; k < harmonic_num; k++) {
+                double s_U = u + coef[k] * s1_U[k] - s2_U[k];
+                double s_I = i + coef[k] * s1_I[k] - s2_I[k];
+                s2_U[k] = s1_U[k];
+                s1_U[k] = s_U;
+                s2_I[k] = s1_I[k];
+                s1_I[k] = s_I;
+            }
+        }
 
+        for(k = 0; k < harmonic_num; k++) {
+            double r_re = blk_re[k], r_im = blk_im[k];
+            if(blk_len != PWR_DFT_BLOCK) {
+                double w = (k + 1) * PI2 * rel_freq / length;
+                r_re = cos(w * (blk_len - 1));
+                r_im = -sin(w * (blk_len - 1));
+            }
+
+            /* t = e^(-jw(n0 + L - 1)) */
+            double t_re = r_re * ph_re[k] - r_im * ph_im[k];
+            double t_im = r_re * ph_im[k] + r_im * ph_re[k];
+
+            /* y = s1 - e^(-jw) * s2 = sum x[m] e^(jw(L-1-m)) */
+            double yU_re = s1_U[k] - cos_w[k] * s2_U[k];
+            double yU_im = sin_w[k] * s2_U[k];
+            double yI_re = s1_I[k] - cos_w[k] * s2_I[k];
+            double yI_im = sin_w[k] * s2_I[k];
+
+            rp_dft_out_re_U[k] += t_re * yU_re - t_im * yU_im;
+            rp_dft_out_im_U[k] += t_re * yU_im + t_im * yU_re;
+            rp_dft_out_re_I[k] += t_re * yI_re - t_im * yI_im;
+            rp_dft_out_im_I[k] += t_re * yI_im + t_im * yI_re;
+
+            /* Next block start: e^(-jw(n0 + L)) = t * e^(-jw), renormalized
+             * so the rotator does not drift in magnitude */
+            double p_re = t_re * cos_w[k] + t_im * sin_w[k];
+            double p_im = t_im * cos_w[k] - t_re * sin_w[k];
+            double mag = sqrt(p_re * p_re + p_im * p_im);
+            ph_re[k] = p_re / mag;
+            ph_im[k] = p_im / mag;
+        }
+    }
+
+    for(k = 0; k < harmonic_num; k++) {
          amp_U[k] = sqrt(pow(rp_dft_out_re_U[k], 2) + 
                          pow(rp_dft_out_im_U[k], 2)) *
                     2 / length;
@@ -270,11 +368,10 @@ int rp_pwr_dft(double *cha_in, double *chb_in, int length, float rel_freq,
                     2 / length;
          fi_U[k] = atan2(rp_dft_out_im_U[k], rp_dft_out_re_U[k]);
          fi_I[k] = atan2(rp_dft_out_im_I[k], rp_dft_out_re_I[k]);
-
-        }
+    }
      
-     return 0;
-}     
+    return 0;
+}
 
 double rp_pwr_calc_d(double max_amp_bin_1, double max_amp_bin_2, 
                      double max_amp_bin_3)
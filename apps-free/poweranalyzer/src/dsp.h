@@ -37,8 +37,18 @@ int rp_pwr_fft(double *ch_in, double *max_amp_bin_1,
 int rp_pwr_dft_init(void);
 int rp_pwr_dft_clean(void);
 
+/* Grows DFT work buffers to hold harmonic_num harmonics */
+int rp_pwr_dft_reserve(int harmonic_num);
+
+/* First pwr_dft_harmonic_num harmonics of rel_freq (in bins of length) */
 int rp_pwr_dft(double *cha_in, double *chb_in, int length, float rel_freq, 
                double *amp_U, double *amp_I, double *fi_U, double *fi_I);
+
+/* Amplitude & phase of harmonics 1..harmonic_num for both channels in one
+ * pass, Goertzel recurrences restarted every block to control drift */
+int rp_pwr_harmonics(const double *cha_in, const double *chb_in, int length,
+                     float rel_freq, int harmonic_num,
+                     double *amp_U, double *amp_I, double *fi_U, double *fi_I);
                
 double rp_pwr_calc_d(double max_amp_bin_1, double max_amp_bin_2, 
                      double max_amp_bin_3);
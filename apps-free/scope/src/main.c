@@ -293,6 +293,12 @@ static rp_app_params_t rp_main_params[PARAMS_NUM+1] = {
     { /* pid_NN_kd - PID NN derivative gain   Kd in [ADC] counts. */
         "pid_22_kd",  0, 1, 0, -8192, 8191 },
 
+    { /* dec_mode - Display decimation mode:
+       *    0 - sample (every n-th sample)
+       *    1 - peak detect (min/max envelope)
+       *    2 - average                        */
+        "dec_mode", 0, 0, 0, 0, 2 },
+
     { /* Must be last! */
         NULL, 0.0, -1, -1, 0.0, 0.0 }     
 };
@@ -651,11 +657,11 @@ int rp_set_params(rp_app_params_t *p, int len)
             continue;
 
         if(rp_main_params[p_idx].value != p[i].value) {
-            if(p_idx < PARAMS_AWG_PARAMS) 
+            if((p_idx < PARAMS_AWG_PARAMS) || (p_idx >= PARAMS_OSC_EXT_PARAMS))
                 params_change = 1;
             if ( (p_idx >= PARAMS_AWG_PARAMS) && (p_idx < PARAMS_PID_PARAMS) )
                 awg_params_change = 1;
-            if(p_idx >= PARAMS_PID_PARAMS)
+            if((p_idx >= PARAMS_PID_PARAMS) && (p_idx < PARAMS_OSC_EXT_PARAMS))
                 pid_params_change = 1;
             if(rp_main_params[p_idx].fpga_update)
                 fpga_update = 1;
@@ -45,7 +45,7 @@ typedef struct rp_osc_meas_res_s {
 
 /* Parameters indexes - these defines should be in the same order as 
  * rp_app_params_t structure defined in main.c */
-#define PARAMS_NUM        81
+#define PARAMS_NUM        82
 #define MIN_GUI_PARAM     0
 #define MAX_GUI_PARAM     1
 #define TRIG_MODE_PARAM   2
@@ -129,6 +129,8 @@ typedef struct rp_osc_meas_res_s {
 #define PID_22_KP         78
 #define PID_22_KI         79
 #define PID_22_KD         80
+/* Additional oscilloscope parameters */
+#define DEC_MODE_PARAM    81
 
 /* Defines from which parameters on are AWG parameters (used in set_param() to
  * trigger update only on needed part - either Oscilloscope, AWG or PID */
@@ -139,6 +141,10 @@ typedef struct rp_osc_meas_res_s {
 #define PARAMS_PID_PARAMS 57
 #define PARAMS_PER_PID     6
 
+/* Defines from which parameters on are additional Oscilloscope parameters,
+ * appended after PID to keep existing indexes */
+#define PARAMS_OSC_EXT_PARAMS 81
+
 /* Output signals */
 #define SIGNAL_LENGTH (1024) /* Must be 2^n! */
 #define SIGNALS_NUM   3
@@ -24,6 +24,14 @@
 #include "worker.h"
 #include "fpga.h"
 
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+/* Shift used to sign-extend ADC counts held in 32 bit FPGA words,
+ * 14 matches c_osc_fpga_adc_bits (NEON shifts need a constant) */
+#define ADC_SEXT_SHIFT (32 - 14)
+
 pthread_t *rp_osc_thread_handler = NULL;
 void *rp_osc_worker_thread(void *args);
 
@@ -45,6 +53,11 @@ int                  *rp_fpga_cha_signal, *rp_fpga_chb_signal;
 /* Calibration parameters read from EEPROM */
 rp_calib_params_t *rp_calib_params = NULL;
 
+/* Per bucket statistics of the display window, used only from worker */
+static int rp_osc_bucket_min[2][SIGNAL_LENGTH];
+static int rp_osc_bucket_max[2][SIGNAL_LENGTH];
+static int rp_osc_bucket_sum[2][SIGNAL_LENGTH];
+
 
 /*----------------------------------------------------------------------------------*/
 int rp_osc_worker_init(rp_app_params_t *params, int params_len,
@@ -499,15 +512,19 @@ void *rp_osc_worker_thread(void *args)
             /* Triggered, decimate & convert the values */
             rp_osc_meas_clear(&ch1_meas);
             rp_osc_meas_clear(&ch2_meas);
-            rp_osc_decimate((float **)&rp_tmp_signals[1], &rp_fpga_cha_signal[0],
-                            (float **)&rp_tmp_signals[2], &rp_fpga_chb_signal[0],
-                            (float **)&rp_tmp_signals[0], dec_factor, 
-                            curr_params[MIN_GUI_PARAM].value,
-                            curr_params[MAX_GUI_PARAM].value,
-                            curr_params[TIME_UNIT_PARAM].value, 
-                            &ch1_meas, &ch2_meas, ch1_max_adc_v, ch2_max_adc_v,
-                            curr_params[GEN_DC_OFFS_1].value,
-                            curr_params[GEN_DC_OFFS_2].value);
+            if(rp_osc_decimate((float **)&rp_tmp_signals[1], &rp_fpga_cha_signal[0],
+                               (float **)&rp_tmp_signals[2], &rp_fpga_chb_signal[0],
+                               (float **)&rp_tmp_signals[0], dec_factor, 
+                               curr_params[MIN_GUI_PARAM].value,
+                               curr_params[MAX_GUI_PARAM].value,
+                               curr_params[TIME_UNIT_PARAM].value, 
+                               &ch1_meas, &ch2_meas, ch1_max_adc_v, ch2_max_adc_v,
+                               curr_params[GEN_DC_OFFS_1].value,
+                               curr_params[GEN_DC_OFFS_2].value,
+                               curr_params[DEC_MODE_PARAM].value) < 0) {
+                /* Do not publish stale buckets & measurements */
+                continue;
+            }
         } else {
             long_acq_idx = rp_osc_decimate_partial((float **)&rp_tmp_signals[1], 
                                              &rp_fpga_cha_signal[0], 
@@ -608,6 +625,141 @@ int rp_osc_prepare_time_vector(float **out_signal, int dec_factor,
 }
 
 
+/*----------------------------------------------------------------------------------*/
+/* Min, max & sum of len contiguous samples, sign-extended from ADC counts */
+static void rp_osc_span_stats(const int *in, int len, int *min, int *max, int *sum)
+{
+    int i = 0;
+    int s_min = *min, s_max = *max, s_sum = 0;
+#ifdef __ARM_NEON
+    if(len >= 4) {
+        int32x4_t v_min = vdupq_n_s32(s_min);
+        int32x4_t v_max = vdupq_n_s32(s_max);
+        int32x4_t v_sum = vdupq_n_s32(0);
+        for(; i + 4 <= len; i += 4) {
+            int32x4_t v = vld1q_s32(in + i);
+            v = vshrq_n_s32(vshlq_n_s32(v, ADC_SEXT_SHIFT), ADC_SEXT_SHIFT);
+            v_min = vminq_s32(v_min, v);
+            v_max = vmaxq_s32(v_max, v);
+            v_sum = vaddq_s32(v_sum, v);
+        }
+        int32x2_t p_min = vpmin_s32(vget_low_s32(v_min), vget_high_s32(v_min));
+        int32x2_t p_max = vpmax_s32(vget_low_s32(v_max), vget_high_s32(v_max));
+        int32x2_t p_sum = vpadd_s32(vget_low_s32(v_sum), vget_high_s32(v_sum));
+        s_min = vget_lane_s32(vpmin_s32(p_min, p_min), 0);
+        s_max = vget_lane_s32(vpmax_s32(p_max, p_max), 0);
+        s_sum = vget_lane_s32(vpadd_s32(p_sum, p_sum), 0);
+    }
+#endif
+    for(; i < len; i++) {
+        int v = (int)((unsigned)in[i] << ADC_SEXT_SHIFT) >> ADC_SEXT_SHIFT;
+        if(v < s_min)
+            s_min = v;
+        if(v > s_max)
+            s_max = v;
+        s_sum += v;
+    }
+    *min = s_min;
+    *max = s_max;
+    *sum += s_sum;
+}
+
+
+/*----------------------------------------------------------------------------------*/
+/* Same as rp_osc_span_stats() on the FPGA ring, starting at pos (wraps around) */
+static void rp_osc_ring_stats(const int *in, int pos, int len, int *min, int *max, int *sum)
+{
+    int first = OSC_FPGA_SIG_LEN - pos;
+    if(len <= first) {
+        rp_osc_span_stats(in + pos, len, min, max, sum);
+    } else {
+        rp_osc_span_stats(in + pos, first, min, max, sum);
+        rp_osc_span_stats(in, len - first, min, max, sum);
+    }
+}
+
+
+/*----------------------------------------------------------------------------------*/
+int rp_osc_peak_detect(const int *in_signal, int start, int step, int buckets,
+                       int *bucket_min, int *bucket_max, int *bucket_sum,
+                       rp_osc_meas_res_t *ch_meas)
+{
+    int b, pos = start % OSC_FPGA_SIG_LEN;
+    int g_min = INT_MAX, g_max = INT_MIN;
+    /* 16k samples of 14 bit counts fit in int, per span sums are added here */
+    long long g_sum = 0;
+
+    /* Buckets must not overlap the ring, otherwise measurements would count
+     * samples twice */
+    if(step * buckets > OSC_FPGA_SIG_LEN)
+        return -1;
+
+    for(b = 0; b < buckets; b++) {
+        int b_min = INT_MAX, b_max = INT_MIN, b_sum = 0;
+
+        rp_osc_ring_stats(in_signal, pos, step, &b_min, &b_max, &b_sum);
+
+        bucket_min[b] = b_min;
+        bucket_max[b] = b_max;
+        if(bucket_sum)
+            bucket_sum[b] = b_sum;
+
+        if(b_min < g_min)
+            g_min = b_min;
+        if(b_max > g_max)
+            g_max = b_max;
+        g_sum += b_sum;
+
+        pos += step;
+        if(pos >= OSC_FPGA_SIG_LEN)
+            pos -= OSC_FPGA_SIG_LEN;
+    }
+
+    /* Rest of the buffer only contributes to measurements */
+    if(step * buckets < OSC_FPGA_SIG_LEN) {
+        int r_sum = 0;
+        rp_osc_ring_stats(in_signal, pos, OSC_FPGA_SIG_LEN - step * buckets,
+                          &g_min, &g_max, &r_sum);
+        g_sum += r_sum;
+    }
+
+    if(ch_meas->min > g_min)
+        ch_meas->min = g_min;
+    if(ch_meas->max < g_max)
+        ch_meas->max = g_max;
+    ch_meas->avg += g_sum;
+
+    return 0;
+}
+
+
+/*----------------------------------------------------------------------------------*/
+/* Display sample for out_idx from the bucket statistics of one channel,
+ * returned as raw ADC counts for osc_fpga_cnv_cnt_to_v() */
+static int rp_osc_bucket_cnt(int ch, int out_idx, int dec_mode, int t_step,
+                             const int *in_signal, int in_idx)
+{
+    const int cnt_mask = (1 << c_osc_fpga_adc_bits) - 1;
+    int pair = out_idx & ~1;
+
+    switch(dec_mode) {
+    case rp_osc_dec_peak:
+        /* Each pair of points shows min & max of both buckets */
+        if(out_idx & 1)
+            return cnt_mask &
+                (rp_osc_bucket_max[ch][pair] > rp_osc_bucket_max[ch][pair+1] ?
+                 rp_osc_bucket_max[ch][pair] : rp_osc_bucket_max[ch][pair+1]);
+        return cnt_mask &
+            (rp_osc_bucket_min[ch][pair] < rp_osc_bucket_min[ch][pair+1] ?
+             rp_osc_bucket_min[ch][pair] : rp_osc_bucket_min[ch][pair+1]);
+    case rp_osc_dec_mean:
+        return cnt_mask & (int)lroundf(rp_osc_bucket_sum[ch][out_idx] / (float)t_step);
+    default:
+        return in_signal[in_idx];
+    }
+}
+
+
 /*----------------------------------------------------------------------------------*/
 int rp_osc_decimate(float **cha_signal, int *in_cha_signal,
                     float **chb_signal, int *in_chb_signal,
@@ -615,12 +767,13 @@ int rp_osc_decimate(float **cha_signal, int *in_cha_signal,
                     float t_start, float t_stop, int time_unit,
                     rp_osc_meas_res_t *ch1_meas, rp_osc_meas_res_t *ch2_meas,
                     float ch1_max_adc_v, float ch2_max_adc_v,
-                    float ch1_user_dc_off, float ch2_user_dc_off)
+                    float ch1_user_dc_off, float ch2_user_dc_off,
+                    int dec_mode)
 {
     int t_start_idx, t_stop_idx;
     float smpl_period = c_osc_fpga_smpl_period * dec_factor;
     int   t_unit_factor = rp_osc_get_time_unit_factor(time_unit);
-    int t_step;
+    int t_step, buckets;
     int in_idx, out_idx, t_idx;
     int wr_ptr_curr, wr_ptr_trig;
 
@@ -646,6 +799,17 @@ int rp_osc_decimate(float **cha_signal, int *in_cha_signal,
          */
         t_step = round((t_stop_idx-t_start_idx)/(float)(SIGNAL_LENGTH-1));
     }
+    /* Peak & mean buckets must not overlap, so their window must fit into
+     * the FPGA buffer */
+    if((dec_mode != rp_osc_dec_sample) &&
+       (t_step > OSC_FPGA_SIG_LEN / SIGNAL_LENGTH))
+        t_step = OSC_FPGA_SIG_LEN / SIGNAL_LENGTH;
+    /* Nothing to detect when every sample is shown */
+    if(t_step == 1)
+        dec_mode = rp_osc_dec_sample;
+    /* Sample mode needs no buckets, the pass performs only the measurements */
+    buckets = (dec_mode == rp_osc_dec_sample) ? 0 : SIGNAL_LENGTH;
+
     osc_fpga_get_wr_ptr(&wr_ptr_curr, &wr_ptr_trig);
     in_idx = wr_ptr_trig + t_start_idx - 3;
 
@@ -654,15 +818,22 @@ int rp_osc_decimate(float **cha_signal, int *in_cha_signal,
     if(in_idx >= OSC_FPGA_SIG_LEN)
         in_idx = in_idx % OSC_FPGA_SIG_LEN;
 
-    /* First perform measurements on non-decimated signal:
-     *  - min, max - performed in the loop
-     *  - avg, amp - performed after the loop
-     *  - freq, period - performed in the next decimation loop
+    /* One pass over the non-decimated signal gives both the display buckets
+     * and the measurements:
+     *  - min, max - performed in the pass
+     *  - avg, amp - performed after the pass
+     *  - freq, period - performed in rp_osc_meas_period()
      */
-    for(out_idx=0; out_idx < OSC_FPGA_SIG_LEN; out_idx++) {
-        rp_osc_meas_min_max(ch1_meas, in_cha_signal[out_idx]);
-        rp_osc_meas_min_max(ch2_meas, in_chb_signal[out_idx]);
-    }
+    if(rp_osc_peak_detect(in_cha_signal, in_idx, t_step, buckets,
+                          rp_osc_bucket_min[0], rp_osc_bucket_max[0],
+                          dec_mode == rp_osc_dec_mean ? rp_osc_bucket_sum[0] : NULL,
+                          ch1_meas) < 0)
+        return -1;
+    if(rp_osc_peak_detect(in_chb_signal, in_idx, t_step, buckets,
+                          rp_osc_bucket_min[1], rp_osc_bucket_max[1],
+                          dec_mode == rp_osc_dec_mean ? rp_osc_bucket_sum[1] : NULL,
+                          ch2_meas) < 0)
+        return -1;
 
     for(out_idx=0, t_idx=0; out_idx < SIGNAL_LENGTH; 
         out_idx++, in_idx+=t_step, t_idx+=t_step) {
@@ -670,13 +841,17 @@ int rp_osc_decimate(float **cha_signal, int *in_cha_signal,
         if(in_idx >= OSC_FPGA_SIG_LEN)
             in_idx = in_idx % OSC_FPGA_SIG_LEN;
 
-        cha_s[out_idx] = osc_fpga_cnv_cnt_to_v(in_cha_signal[in_idx], ch1_max_adc_v,
-                                               rp_calib_params->fe_ch1_dc_offs,
-                                               ch1_user_dc_off);
-
-        chb_s[out_idx] = osc_fpga_cnv_cnt_to_v(in_chb_signal[in_idx], ch2_max_adc_v,
-                                               rp_calib_params->fe_ch2_dc_offs,
-                                               ch2_user_dc_off);
+        cha_s[out_idx] = osc_fpga_cnv_cnt_to_v(
+                             rp_osc_bucket_cnt(0, out_idx, dec_mode, t_step,
+                                               in_cha_signal, in_idx),
+                             ch1_max_adc_v, rp_calib_params->fe_ch1_dc_offs,
+                             ch1_user_dc_off);
+
+        chb_s[out_idx] = osc_fpga_cnv_cnt_to_v(
+                             rp_osc_bucket_cnt(1, out_idx, dec_mode, t_step,
+                                               in_chb_signal, in_idx),
+                             ch2_max_adc_v, rp_calib_params->fe_ch2_dc_offs,
+                             ch2_user_dc_off);
 
         t[out_idx] = (t_start + (t_idx * smpl_period)) * t_unit_factor;
 
@@ -18,6 +18,13 @@
 #include "main.h"
 #include "calib.h"
 
+/* Display decimation modes (dec_mode parameter) */
+typedef enum rp_osc_dec_mode_e {
+    rp_osc_dec_sample = 0, /* first sample of each bucket */
+    rp_osc_dec_peak,       /* peak detect - bucket min & max on adjacent points */
+    rp_osc_dec_mean        /* bucket average */
+} rp_osc_dec_mode_t;
+
 typedef enum rp_osc_worker_state_e {
     rp_osc_idle_state = 0, /* do nothing */
     rp_osc_quit_state, /* shutdown worker */
@@ -70,7 +77,21 @@ int rp_osc_decimate(float **cha_signal, int *in_cha_signal,
                     float t_start, float t_stop, int time_unit,
                     rp_osc_meas_res_t *ch1_meas, rp_osc_meas_res_t *ch2_meas,
                     float ch1_max_adc_v, float ch2_max_adc_v,
-                    float ch1_user_dc_off, float ch2_user_dc_off);
+                    float ch1_user_dc_off, float ch2_user_dc_off,
+                    int dec_mode);
+
+/* Single pass over the whole FPGA buffer:
+ * bucket_min, bucket_max - per bucket min & max of 'buckets' buckets of 'step'
+ *                          samples, starting at 'start' (wraps around)
+ * bucket_sum             - per bucket sum, skipped when NULL
+ * ch_meas                - min, max & avg accumulation over all OSC_FPGA_SIG_LEN
+ *                          samples, same as rp_osc_meas_min_max() on each one
+ * With 0 buckets only the measurements are performed. Returns -1 when the
+ * buckets would overlap (step * buckets > OSC_FPGA_SIG_LEN).
+ */
+int rp_osc_peak_detect(const int *in_signal, int start, int step, int buckets,
+                       int *bucket_min, int *bucket_max, int *bucket_sum,
+                       rp_osc_meas_res_t *ch_meas);
 
 int rp_osc_decimate_partial(float **cha_out_signal, int *cha_in_signal, 
                             float **chb_out_signal, int *chb_in_signal,
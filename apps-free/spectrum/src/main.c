@@ -25,6 +25,7 @@
 #include "version.h"
 #include "worker.h"
 #include "fpga.h"
+#include "waterfall.h"
 
 /* Describe app. parameters with some info/limitations */
 static rp_app_params_t rp_main_params[PARAMS_NUM+1] = {
@@ -57,12 +58,15 @@ static rp_app_params_t rp_main_params[PARAMS_NUM+1] = {
         "peak2_power", 0, 0, 1,         -1e7, 1e7 },
     { /* peak2_unit - same enumeration as freq_unit */
         "peak2_unit", 0, 0, 1,         0,         2 },
-    { /* JPG Waterfall files index */
-        "w_idx", 0, 0, 1, 0, 1000 },
+    { /* wf_export - store the Waterfall to /tmp/ram/wat[1|2].jpg when set,
+       * the value is not kept */
+        "wf_export", 0, 0, 0, 0, 1 },
 	{ /* en_avg_at_dec:
 		   *    0 - disable
 		   *    1 - enable */
 		"en_avg_at_dec", 1, 0, 1,      0,         1 },
+    { /* wf_depth - number of lines kept in the Waterfall */
+        "wf_depth", RP_SPECTR_WF_LIN, 0, 0, 16, RP_SPECTR_WF_LIN_MAX },
     { /* Must be last! */
         NULL, 0.0, -1, -1, 0.0, 0.0 }
 };
@@ -70,6 +74,9 @@ static rp_app_params_t rp_main_params[PARAMS_NUM+1] = {
 /* params initialized */
 static int params_init = 0;
 
+/* Sequence number of the next Waterfall line to be sent */
+static uint32_t wf_next_seq = 0;
+
 const char *rp_app_desc(void)
 {
     return (const char *)"Red Pitaya spectrum analyser application.\n";
@@ -138,7 +145,8 @@ int rp_set_params(rp_app_params_t *p, int len)
             continue;
         }
 
-        if(rp_main_params[p_idx].value != p[i].value) {
+        if((rp_main_params[p_idx].value != p[i].value) &&
+           (p_idx != WF_EXPORT_PARAM) && (p_idx != WF_DEPTH_PARAM)) {
             params_change = 1;
             if(rp_main_params[p_idx].fpga_update)
                 fpga_update = 1;
@@ -155,6 +163,18 @@ int rp_set_params(rp_app_params_t *p, int len)
             p[i].value = rp_main_params[p_idx].max_val;
         }
 
+        /* Waterfall parameters do not touch the acquisition */
+        if(p_idx == WF_EXPORT_PARAM) {
+            if(p[i].value != 0)
+                rp_spectr_export_waterfall();
+            continue;
+        }
+        if(p_idx == WF_DEPTH_PARAM) {
+            rp_main_params[p_idx].value = p[i].value;
+            rp_spectr_wf_set_depth((int)p[i].value);
+            continue;
+        }
+
         rp_main_params[p_idx].value = p[i].value;
     }
 
@@ -223,7 +243,6 @@ int rp_get_signals(float ***s, int *sig_num, int *sig_len)
         return -1;
     }
 
-    rp_main_params[JPG_FILE_IDX_PARAM].value     = (float)result.jpg_idx;
     rp_main_params[PEAK_PW_CHA_PARAM].value      = (float)result.peak_pw_cha;
     rp_main_params[PEAK_PW_FREQ_CHA_PARAM].value = (float)result.peak_pw_freq_cha;
     rp_main_params[PEAK_PW_CHB_PARAM].value      = (float)result.peak_pw_chb;
@@ -233,6 +252,31 @@ int rp_get_signals(float ***s, int *sig_num, int *sig_len)
     return 0;
 }
 
+int rp_wait_signals(int timeout_ms)
+{
+    return rp_spectr_wait_signals(timeout_ms);
+}
+
+int rp_get_wf_rows(unsigned char *cha, unsigned char *chb, int max_rows,
+                   int *cols, unsigned int *seq)
+{
+    uint32_t first = wf_next_seq;
+    int rows;
+
+    *cols = rp_spectr_wf_get_cols();
+    if(max_rows == 0)
+        return 0;
+
+    rows = rp_spectr_wf_get_lines(&first, cha, chb, max_rows);
+    if(rows < 0)
+        return -1;
+
+    wf_next_seq = first + rows;
+    *seq = first;
+
+    return rows;
+}
+
 int rp_create_signals(float ***a_signals)
 {
     int i;
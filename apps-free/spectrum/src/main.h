@@ -27,7 +27,7 @@ typedef struct rp_app_params_s {
 
 /* Parameters indexes - these defines should be in the same order as
  * rp_app_params_t structure defined in main.c */
-#define PARAMS_NUM             12
+#define PARAMS_NUM             13
 #define MIN_GUI_PARAM          0
 #define MAX_GUI_PARAM          1
 #define FREQ_RANGE_PARAM       2
@@ -38,8 +38,9 @@ typedef struct rp_app_params_s {
 #define PEAK_PW_FREQ_CHB_PARAM 7
 #define PEAK_PW_CHB_PARAM      8
 #define PEAK_UNIT_CHB_PARAM    9
-#define JPG_FILE_IDX_PARAM     10
+#define WF_EXPORT_PARAM        10
 #define EN_AVG_AT_DEC   		11
+#define WF_DEPTH_PARAM         12
 
 /* Output signals */
 #define SPECTR_OUT_SIG_LEN (2*1024)
@@ -50,6 +51,18 @@ int rp_app_exit(void);
 int rp_set_params(rp_app_params_t *p, int len);
 int rp_get_params(rp_app_params_t **p);
 int rp_get_signals(float ***s, int *sig_num, int *sig_len);
+/* Blocks until rp_get_signals() has new signals to return, at most
+ * timeout_ms. Returns 1 when new signals are available, 0 on timeout.
+ */
+int rp_wait_signals(int timeout_ms);
+
+/* Waterfall lines added since the last call (single consumer), oldest first,
+ * at most max_rows lines of *cols bytes per channel. *seq is set to the
+ * sequence number of the first returned line. With max_rows == 0 only *cols
+ * is set. Returns the number of lines or -1 on error.
+ */
+int rp_get_wf_rows(unsigned char *cha, unsigned char *chb, int max_rows,
+                   int *cols, unsigned int *seq);
 
 /* Internal helper functions */
 int  rp_create_signals(float ***a_signals);
@@ -18,6 +18,7 @@
 #include <math.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "jpeglib.h"
 
@@ -50,18 +51,17 @@ int g_spectr_wf_col;
 int *rp_wf_cha_dec_map = NULL;
 int *rp_wf_chb_dec_map = NULL;
 
-/* Maps which is builded from multiple acquisitions, size:
- * RP_SPECTR_WF_COL * RP_SPECTR_WF_LIN 
+/* Maps which is builded from multiple acquisitions, ring buffers of
+ * rp_wf_depth lines, line with sequence number n is at n % rp_wf_depth.
+ * Allocated for RP_SPECTR_WF_COL * RP_SPECTR_WF_LIN_MAX, one byte per column.
+ * Access from the worker and the client side is guarded by rp_wf_mutex.
  */
-int *rp_wf_cha_cont_map = NULL;
-int *rp_wf_chb_cont_map = NULL;
-int  rp_wf_cont_map_idx = -1;
-
-/* The following structures are of R,G,B order data 
- * Size is RP_SPECTR_WF_COL * RP_SPECTR_WF_LIN * 3 (for RGB) 
- */
-JSAMPLE *rp_wf_cha_wat = NULL;
-JSAMPLE *rp_wf_chb_wat = NULL;
+uint8_t *rp_wf_cha_cont_map = NULL;
+uint8_t *rp_wf_chb_cont_map = NULL;
+int      rp_wf_depth = RP_SPECTR_WF_LIN;
+uint32_t rp_wf_seq = 0;         /* sequence number of the next line */
+uint32_t rp_wf_seq_first = 0;   /* first line after the last reset */
+pthread_mutex_t rp_wf_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 int rp_spectr_wf_init(void)
 {
@@ -109,28 +109,16 @@ int rp_spectr_wf_init(void)
         return -1;
     }
 
-    rp_wf_cha_cont_map = (int *)malloc(RP_SPECTR_WF_LIN * g_spectr_wf_col
-                                       * sizeof(int));
-    rp_wf_chb_cont_map = (int *)malloc(RP_SPECTR_WF_LIN * g_spectr_wf_col
-                                       * sizeof(int));
+    rp_wf_cha_cont_map = (uint8_t *)malloc(RP_SPECTR_WF_LIN_MAX * 
+                                           g_spectr_wf_col * sizeof(uint8_t));
+    rp_wf_chb_cont_map = (uint8_t *)malloc(RP_SPECTR_WF_LIN_MAX * 
+                                           g_spectr_wf_col * sizeof(uint8_t));
     if(!rp_wf_cha_cont_map || !rp_wf_chb_cont_map) {
         fprintf(stderr, "rp_spectr_wf_init() can not allocate memory\n");
         rp_spectr_wf_clean();
         return -1;
     }
     rp_spectr_wf_clean_map();
-    
-    /* Initialize the rp_wf_cha_wat & chb_wat structures which will be used
-     * to build a picture - x3 is for R,G,B
-     */
-    rp_wf_cha_wat = (JSAMPLE *)malloc(RP_SPECTR_WF_LIN * g_spectr_wf_col *
-                                      3 * sizeof(JSAMPLE));
-    rp_wf_chb_wat = (JSAMPLE *)malloc(RP_SPECTR_WF_LIN * g_spectr_wf_col *
-                                      3 * sizeof(JSAMPLE));
-    if(!rp_wf_cha_wat || !rp_wf_chb_wat) {
-        fprintf(stderr, "rp_spectr_wf_init() can not allocate memory\n");
-        return -1;
-    }
 
     return 0;
 }
@@ -157,6 +145,7 @@ int rp_spectr_wf_clean(void)
         free(rp_wf_chb_dec_map);
         rp_wf_chb_dec_map = NULL;
     }
+    pthread_mutex_lock(&rp_wf_mutex);
     if(rp_wf_cha_cont_map) {
         free(rp_wf_cha_cont_map);
         rp_wf_cha_cont_map = NULL;
@@ -165,33 +154,113 @@ int rp_spectr_wf_clean(void)
         free(rp_wf_chb_cont_map);
         rp_wf_chb_cont_map = NULL;
     }
-    if(rp_wf_cha_wat) {
-        free(rp_wf_cha_wat);
-        rp_wf_cha_wat = NULL;
-    }
-    if(rp_wf_chb_wat) {
-        free(rp_wf_chb_wat);
-        rp_wf_chb_wat = NULL;
-    }
+    pthread_mutex_unlock(&rp_wf_mutex);
     return 0;
 }
 
 int rp_spectr_wf_clean_map(void)
 {
+    pthread_mutex_lock(&rp_wf_mutex);
     if(!rp_wf_cha_cont_map || !rp_wf_chb_cont_map) {
+        pthread_mutex_unlock(&rp_wf_mutex);
         fprintf(stderr, "rp_spectr_wf_clean_map() not initialized!\n");
         return -1;
     }
 
     memset(rp_wf_cha_cont_map, 0, 
-           RP_SPECTR_WF_LIN * g_spectr_wf_col * sizeof(int));
+           RP_SPECTR_WF_LIN_MAX * g_spectr_wf_col * sizeof(uint8_t));
     memset(rp_wf_chb_cont_map, 0, 
-           RP_SPECTR_WF_LIN * g_spectr_wf_col * sizeof(int));
-    rp_wf_cont_map_idx = RP_SPECTR_WF_LIN - 1; /* start with the last line */
+           RP_SPECTR_WF_LIN_MAX * g_spectr_wf_col * sizeof(uint8_t));
+    /* Keep the sequence going so that the clients see the reset as a jump */
+    rp_wf_seq_first = rp_wf_seq;
+    pthread_mutex_unlock(&rp_wf_mutex);
 
     return 0;
 }
 
+int rp_spectr_wf_set_depth(int lines)
+{
+    if(lines < 1 || lines > RP_SPECTR_WF_LIN_MAX) {
+        fprintf(stderr, "rp_spectr_wf_set_depth() wrong depth: %d\n", lines);
+        return -1;
+    }
+    if(lines == rp_wf_depth) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&rp_wf_mutex);
+    rp_wf_depth = lines;
+    pthread_mutex_unlock(&rp_wf_mutex);
+
+    return rp_spectr_wf_clean_map();
+}
+
+int rp_spectr_wf_get_depth(void)
+{
+    return rp_wf_depth;
+}
+
+int rp_spectr_wf_get_cols(void)
+{
+    return g_spectr_wf_col;
+}
+
+uint32_t rp_spectr_wf_get_seq(void)
+{
+    uint32_t seq;
+
+    pthread_mutex_lock(&rp_wf_mutex);
+    seq = rp_wf_seq;
+    pthread_mutex_unlock(&rp_wf_mutex);
+
+    return seq;
+}
+
+int rp_spectr_wf_get_lines(uint32_t *seq, uint8_t *cha_out, uint8_t *chb_out,
+                           int max_lines)
+{
+    uint32_t first, avail, n, i;
+
+    if(!seq || !cha_out || !chb_out || max_lines <= 0) {
+        fprintf(stderr, "rp_spectr_wf_get_lines() wrong arguments\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&rp_wf_mutex);
+    if(!rp_wf_cha_cont_map || !rp_wf_chb_cont_map) {
+        pthread_mutex_unlock(&rp_wf_mutex);
+        fprintf(stderr, "rp_spectr_wf_get_lines() not initialized\n");
+        return -1;
+    }
+
+    /* Lines still in the map: the last rp_wf_depth since the last reset */
+    avail = rp_wf_seq - rp_wf_seq_first;
+    if(avail > (uint32_t)rp_wf_depth)
+        avail = rp_wf_depth;
+    first = rp_wf_seq - avail;
+
+    /* Sequence numbers wrap, so compare distances to the newest line */
+    if(rp_wf_seq - *seq < avail)
+        first = *seq;
+    n = rp_wf_seq - first;
+    if(n > (uint32_t)max_lines) {
+        first = rp_wf_seq - max_lines;
+        n = max_lines;
+    }
+
+    for(i = 0; i < n; i++) {
+        int row = (first + i) % rp_wf_depth;
+        memcpy(&cha_out[i * g_spectr_wf_col], 
+               &rp_wf_cha_cont_map[row * g_spectr_wf_col], g_spectr_wf_col);
+        memcpy(&chb_out[i * g_spectr_wf_col], 
+               &rp_wf_chb_cont_map[row * g_spectr_wf_col], g_spectr_wf_col);
+    }
+    *seq = first;
+    pthread_mutex_unlock(&rp_wf_mutex);
+
+    return n;
+}
+
 int rp_spectr_wf_calc(double *cha_in, double *chb_in)
 {
     if(!cha_in || !chb_in) {
@@ -225,37 +294,53 @@ int rp_spectr_wf_calc(double *cha_in, double *chb_in)
 
 int rp_spectr_wf_save_jpeg(const char *wf_cha_file, const char *wf_chb_file) 
 {
-    if(!rp_wf_cha_cont_map || !rp_wf_chb_cont_map || 
-       !rp_wf_cha_wat || !rp_wf_chb_wat) {
+    JSAMPLE *cha_wat, *chb_wat;
+    int ret = -1;
+
+    /* The images are only needed on export, so they are not kept around
+     * x3 is for R,G,B */
+    cha_wat = (JSAMPLE *)malloc(RP_SPECTR_WF_LIN_MAX * g_spectr_wf_col *
+                                3 * sizeof(JSAMPLE));
+    chb_wat = (JSAMPLE *)malloc(RP_SPECTR_WF_LIN_MAX * g_spectr_wf_col *
+                                3 * sizeof(JSAMPLE));
+    if(!cha_wat || !chb_wat) {
+        fprintf(stderr, "rp_spectr_wf_save_jpeg() can not allocate memory\n");
+        goto out;
+    }
+
+    pthread_mutex_lock(&rp_wf_mutex);
+    if(!rp_wf_cha_cont_map || !rp_wf_chb_cont_map) {
+        pthread_mutex_unlock(&rp_wf_mutex);
         fprintf(stderr, "rp_spectr_wf_save_jpeg(): not initialized\n");
-        return -1;
+        goto out;
     }
     
-    if(rp_spectr_wf_create_rgb(rp_wf_cha_cont_map, &rp_wf_cha_wat) < 0) {
+    if((rp_spectr_wf_create_rgb(rp_wf_cha_cont_map, &cha_wat) < 0) ||
+       (rp_spectr_wf_create_rgb(rp_wf_chb_cont_map, &chb_wat) < 0)) {
+        pthread_mutex_unlock(&rp_wf_mutex);
         fprintf(stderr, "rp_spectr_wf_save_jpeg(): rp_spectr_wf_create_rgb() "
                 " failed\n");
-        return -1;
-    }
-
-    if(rp_spectr_wf_create_rgb(rp_wf_chb_cont_map, &rp_wf_chb_wat) < 0) {
-        fprintf(stderr, "rp_spectr_wf_save_jpeg(): rp_spectr_wf_create_rgb() "
-                " failed\n");
-        return -1;
+        goto out;
     }
+    pthread_mutex_unlock(&rp_wf_mutex);
 
-    if(rp_spectr_wf_comp_jpeg(rp_wf_cha_wat, wf_cha_file) < 0) {
+    if(rp_spectr_wf_comp_jpeg(cha_wat, wf_cha_file) < 0) {
         fprintf(stderr, "rp_spectr_wf_save_jpeg(): rp_spectr_wf_comp_jpeg() "
                 " failed\n");
-        return -1;
+        goto out;
     }
 
-    if(rp_spectr_wf_comp_jpeg(rp_wf_chb_wat, wf_chb_file) < 0) {
+    if(rp_spectr_wf_comp_jpeg(chb_wat, wf_chb_file) < 0) {
         fprintf(stderr, "rp_spectr_wf_save_jpeg(): rp_spectr_wf_comp_jpeg() "
                 " failed\n");
-        return -1;
+        goto out;
     }
+    ret = 0;
 
-    return 0;
+out:
+    free(cha_wat);
+    free(chb_wat);
+    return ret;
 }
 
 /* Signal lengths:
@@ -334,53 +419,61 @@ int rp_spectr_wf_dec_map(double *cha_in, double *chb_in,
 
 int rp_spectr_wf_add_to_map(int *cha_in, int *chb_in)
 {
-    int start_idx;
-    if(!cha_in || !chb_in || !rp_wf_cha_cont_map || !rp_wf_chb_cont_map ||
-       (rp_wf_cont_map_idx == -1)) {
+    uint8_t *cha_o, *chb_o;
+    int i;
+
+    pthread_mutex_lock(&rp_wf_mutex);
+    if(!cha_in || !chb_in || !rp_wf_cha_cont_map || !rp_wf_chb_cont_map) {
+        pthread_mutex_unlock(&rp_wf_mutex);
         fprintf(stderr, "rp_spectr_wf_add_to_map() not initialized\n");
         return -1;
     }
 
-    start_idx = (rp_wf_cont_map_idx * g_spectr_wf_col);
+    cha_o = &rp_wf_cha_cont_map[(rp_wf_seq % rp_wf_depth) * g_spectr_wf_col];
+    chb_o = &rp_wf_chb_cont_map[(rp_wf_seq % rp_wf_depth) * g_spectr_wf_col];
 
-    memcpy(&rp_wf_cha_cont_map[start_idx], &cha_in[0], 
-           g_spectr_wf_col * sizeof(int));
-    memcpy(&rp_wf_chb_cont_map[start_idx], &chb_in[0], 
-           g_spectr_wf_col * sizeof(int));
-    
-    /* Decrease the rp_wf_cont_map_idx and wraps it if necessary but be sure to 
-     * wrap it if necessary 
-     * TODO: Should we clean last map or override it?
-     */
-    if(--rp_wf_cont_map_idx < 0)
-        rp_wf_cont_map_idx = RP_SPECTR_WF_LIN - 1;
+    /* Values are already limited to the colour map range */
+    for(i = 0; i < g_spectr_wf_col; i++) {
+        cha_o[i] = (uint8_t)cha_in[i];
+        chb_o[i] = (uint8_t)chb_in[i];
+    }
+    rp_wf_seq++;
+    pthread_mutex_unlock(&rp_wf_mutex);
 
     return 0;
 }
 
-int rp_spectr_wf_create_rgb(int *data_in, JSAMPLE **data_out)
+/* Called with rp_wf_mutex locked */
+int rp_spectr_wf_create_rgb(uint8_t *data_in, JSAMPLE **data_out)
 {
     JSAMPLE *data_o = *data_out;
-    int i, j;
-    int start_map_idx = (rp_wf_cont_map_idx+1) * g_spectr_wf_col - 1;
+    uint32_t lines = rp_wf_seq - rp_wf_seq_first;
+    int l, i;
 
     if(!data_in || !data_o) {
         fprintf(stderr, "rp_spectr_wf_create_rgb() not initialized\n");
         return -1;
     }
 
-    /* Data out is of format R, G, B, R, G, B ... R, G, B */
-    for(i = (g_spectr_wf_col * RP_SPECTR_WF_LIN * 3 - 1), j = start_map_idx; 
-        i >= 2; i-=3, j--) {
-        int colmap_idx;
-        if(j < 0) {
-            j = g_spectr_wf_col * RP_SPECTR_WF_LIN - 1;
-        }
-        colmap_idx = data_in[j];
+    /* Data out is of format R, G, B, R, G, B ... R, G, B, newest line on
+     * top, lines not written since the last reset are shown as the lowest
+     * level */
+    for(l = 0; l < rp_wf_depth; l++) {
+        const uint8_t *line = NULL;
+        JSAMPLE *out = &data_o[l * g_spectr_wf_col * 3];
 
-        data_o[i-2] = rp_wf_colmap[colmap_idx][0];
-        data_o[i-1] = rp_wf_colmap[colmap_idx][1];
-        data_o[i-0] = rp_wf_colmap[colmap_idx][2];
+        if((uint32_t)l < lines) {
+            line = &data_in[((rp_wf_seq - 1 - l) % rp_wf_depth) * g_spectr_wf_col];
+        }
+        for(i = 0; i < g_spectr_wf_col; i++) {
+            int colmap_idx = line ? line[i] : 0;
+            if(colmap_idx > RP_SPECTR_WF_MAP_MAX - 1)
+                colmap_idx = RP_SPECTR_WF_MAP_MAX - 1;
+
+            out[3*i+0] = rp_wf_colmap[colmap_idx][0];
+            out[3*i+1] = rp_wf_colmap[colmap_idx][1];
+            out[3*i+2] = rp_wf_colmap[colmap_idx][2];
+        }
     }
 
     return 0;
@@ -410,7 +503,7 @@ int rp_spectr_wf_comp_jpeg(JSAMPLE *data_in, const char *file_str)
     jpeg_stdio_dest(&cinfo, out_file);
 
     cinfo.image_width      = g_spectr_wf_col;
-    cinfo.image_height     = RP_SPECTR_WF_LIN;
+    cinfo.image_height     = rp_wf_depth;
     cinfo.input_components = 3;
     cinfo.in_color_space   = JCS_RGB;
 
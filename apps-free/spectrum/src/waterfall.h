@@ -15,7 +15,9 @@
 #ifndef __WATERFALL_H
 #define __WATERFALL_H
 
+/* Default and maximal number of lines kept in the waterfall ring buffer */
 #define RP_SPECTR_WF_LIN 100
+#define RP_SPECTR_WF_LIN_MAX 1024
 /* In fact Columns are re-calculated based on possible decimation */
 #define RP_SPECTR_WF_COL 640
 
@@ -25,6 +27,8 @@
 #define RP_SPECTR_WF_MAP_MAX  64
 #define RP_SPECTR_WF_MAP_NOI  20
 
+#include <stdint.h>
+
 #include "jpeglib.h"
 
 /*** Main Warerfall module calls ****/
@@ -34,13 +38,35 @@ int rp_spectr_wf_clean(void);
 /* Reset the main map structure */
 int rp_spectr_wf_clean_map(void);
 
+/* Sets the number of lines kept in the map (1 - RP_SPECTR_WF_LIN_MAX) and
+ * resets the map */
+int rp_spectr_wf_set_depth(int lines);
+int rp_spectr_wf_get_depth(void);
+
+/* Number of columns (bins) in one line */
+int rp_spectr_wf_get_cols(void);
+
+/* Copies the lines added after line *seq, oldest first, at most max_lines.
+ * Each line has rp_spectr_wf_get_cols() bytes, the colour map index of each
+ * column. If the lines after *seq were already overwritten, only the lines
+ * still in the map are returned. On return *seq is the sequence number of
+ * the first copied line, the function returns the number of copied lines.
+ */
+int rp_spectr_wf_get_lines(uint32_t *seq, uint8_t *cha_out, uint8_t *chb_out,
+                           int max_lines);
+
+/* Sequence number of the next line to be added */
+uint32_t rp_spectr_wf_get_seq(void);
+
 /* Processes the input signal and put it to the map which is builded from 
  * multiple acquisitions.
  * Input signal length = c_dsp_sig_len (output from FFT) */
 int rp_spectr_wf_calc(double *cha_in, double *chb_in);
 
 
-/* Build the waterfall diagram out of the collected acquisitions and stores it */
+/* Build the waterfall diagram out of the collected acquisitions and stores it.
+ * Only used to export the waterfall, the lines are delivered to the client
+ * with rp_spectr_wf_get_lines(). */
 int rp_spectr_wf_save_jpeg(const char *wf_file1, const char *wf_file2);
 
 /*** Internal steps used in the processing ***/
@@ -62,14 +88,15 @@ int rp_spectr_wf_dec_map(double *cha_in, double *chb_in,
  */
 int rp_spectr_wf_add_to_map(int *cha_in, int *chb_in);
 
-/* Creates RGB image in internal structures, used to dump JPEG or BMP
- * Input signal length = RP_SPECTR_WF_COL * RP_SPECTR_WF_LIN 
- * Output signal length = RP_SPECTR_WF_COL * RP_SPECTR_WF_LIN * 3 (RGB) 
+/* Creates RGB image in internal structures, used to dump JPEG or BMP,
+ * newest line on top
+ * Input signal length = RP_SPECTR_WF_COL * depth
+ * Output signal length = RP_SPECTR_WF_COL * depth * 3 (RGB) 
  */
-int rp_spectr_wf_create_rgb(int *data_in, JSAMPLE **data_out);
+int rp_spectr_wf_create_rgb(uint8_t *data_in, JSAMPLE **data_out);
 
 /* Compress image and store it, 
- * Input signal is of size RP_SPECTR_WF_COL * RP_SPECTR_WF_LIN *3 
+ * Input signal is of size RP_SPECTR_WF_COL * depth * 3 
  */
 int rp_spectr_wf_comp_jpeg(JSAMPLE *data_in, const char *file_out);
 
@@ -22,21 +22,20 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <time.h>
 
 #include "worker.h"
 #include "fpga.h"
 #include "dsp.h"
 #include "waterfall.h"
 
-/* JPG outputs: c_jpg_file_path+[1|2]+_+jpg_cnt(3 digits)+c_jpg_file_suf */
+/* JPG waterfall export: c_jpg_file_name+[1|2]+c_jpg_file_suf, written only
+ * on request, the lines are delivered to the client from memory */
 const char c_jpg_dir_path[]="/tmp/ram";
 const char c_jpg_file_name[]="wat";
-const char c_jpg_file_path[]="/tmp/ram/wat";
+const char c_jpg_file_cha[]="/tmp/ram/wat1.jpg";
+const char c_jpg_file_chb[]="/tmp/ram/wat2.jpg";
 const char c_jpg_file_suf[]=".jpg";
-const int  c_jpg_max_file  = 63;
-const int  c_save_jpg_cnt  = 10; /* Repetition how often the JPG is stored */
-char      *jpg_fname_cha = NULL;
-char      *jpg_fname_chb = NULL;
 
 pthread_t *rp_spectr_thread_handler = NULL;
 void *rp_spectr_worker_thread(void *args);
@@ -65,6 +64,8 @@ int                   rp_spectr_params_dirty;
 int                   rp_spectr_params_fpga_update;
 
 pthread_mutex_t        rp_spectr_sig_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Signalled with rp_spectr_sig_mutex held whenever new signals are set */
+pthread_cond_t         rp_spectr_sig_cond = PTHREAD_COND_INITIALIZER;
 float                **rp_spectr_signals = NULL;
 rp_spectr_worker_res_t rp_spectr_result;
 int                    rp_spectr_signals_dirty = 0;
@@ -99,15 +100,6 @@ int rp_spectr_worker_init(void)
         return -1;
     }
 
-    jpg_fname_cha = 
-        (char *)malloc((strlen(c_jpg_file_path)+strlen(c_jpg_file_suf)+5+1));
-    jpg_fname_chb = 
-        (char *)malloc((strlen(c_jpg_file_path)+strlen(c_jpg_file_suf)+5+1));
-    if(!jpg_fname_cha || !jpg_fname_chb) {
-        rp_spectr_worker_clean();
-        return -1;
-    }
-
     if(spectr_fpga_init() < 0) {
         rp_spectr_worker_clean();
         return -1;
@@ -162,14 +154,6 @@ int rp_spectr_worker_clean(void)
     rp_spectr_fft_clean();
     rp_spectr_wf_clean();
 
-    if(jpg_fname_cha) {
-        free(jpg_fname_cha);
-        jpg_fname_cha = NULL;
-    }
-    if(jpg_fname_chb) {
-        free(jpg_fname_chb);
-        jpg_fname_chb = NULL;
-    }
     if(rp_cha_in) {
         free(rp_cha_in);
         rp_cha_in = NULL;
@@ -237,6 +221,11 @@ int rp_spectr_clean_signals(void)
     return 0;
 }
 
+int rp_spectr_export_waterfall(void)
+{
+    return rp_spectr_wf_save_jpeg(c_jpg_file_cha, c_jpg_file_chb);
+}
+
 int rp_spectr_clean_tmpdir(const char *dir)
 {
     DIR *dp;
@@ -301,7 +290,6 @@ int rp_spectr_get_signals(float ***signals, rp_spectr_worker_res_t *result)
 
     rp_spectr_signals_dirty = 0;
 
-    result->jpg_idx          = rp_spectr_result.jpg_idx;
     result->peak_pw_cha      = rp_spectr_result.peak_pw_cha;
     result->peak_pw_freq_cha = rp_spectr_result.peak_pw_freq_cha;
     result->peak_pw_chb      = rp_spectr_result.peak_pw_chb;
@@ -320,27 +308,47 @@ int rp_spectr_set_signals(float **source, rp_spectr_worker_res_t result)
 
     rp_spectr_signals_dirty = 1;
 
-    rp_spectr_result.jpg_idx          = result.jpg_idx;
     rp_spectr_result.peak_pw_cha      = result.peak_pw_cha;
     rp_spectr_result.peak_pw_freq_cha = result.peak_pw_freq_cha;
     rp_spectr_result.peak_pw_chb      = result.peak_pw_chb;
     rp_spectr_result.peak_pw_freq_chb = result.peak_pw_freq_chb;
 
+    pthread_cond_broadcast(&rp_spectr_sig_cond);
     pthread_mutex_unlock(&rp_spectr_sig_mutex);
 
     return 0;
 }
 
+int rp_spectr_wait_signals(int timeout_ms)
+{
+    struct timespec deadline;
+    int ret_val = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec  += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&rp_spectr_sig_mutex);
+    while(rp_spectr_signals_dirty == 0 && ret_val == 0) {
+        ret_val = pthread_cond_timedwait(&rp_spectr_sig_cond,
+                                         &rp_spectr_sig_mutex, &deadline);
+    }
+    ret_val = rp_spectr_signals_dirty;
+    pthread_mutex_unlock(&rp_spectr_sig_mutex);
+
+    return ret_val;
+}
+
 void *rp_spectr_worker_thread(void *args)
 {
     rp_spectr_worker_state_t old_state, state;
     rp_app_params_t          curr_params[PARAMS_NUM];
     int                      fpga_update = 1;
     int                      params_dirty = 1;
-    int                      loop_cnt = 0; /* each N save jpeg */
-    int                      jpg_fn_cnt = 0;
-    /* depends on freq_range - do not save too much or too less */
-    int                      jpg_write_div = 10;
     rp_spectr_worker_res_t   tmp_result;
 
     pthread_mutex_lock(&rp_spectr_ctrl_mutex);
@@ -377,20 +385,6 @@ void *rp_spectr_worker_thread(void *args)
 
             fpga_update = 0;
             rp_spectr_wf_clean_map();
-            switch((int)curr_params[FREQ_RANGE_PARAM].value) {
-            case 0:
-            case 1:
-                jpg_write_div = 10;
-                break;
-            case 2:
-            case 3:
-                jpg_write_div = 5;
-                break;
-            case 4:
-            case 5:
-                jpg_write_div = 0;
-                break;
-            }
         }
 
         if(state == rp_spectr_idle_state) {
@@ -463,29 +457,11 @@ void *rp_spectr_worker_thread(void *args)
                              &tmp_result.peak_pw_freq_chb,
                              curr_params[FREQ_RANGE_PARAM].value);
 
-        /* Calculate the map used for Waterfall diagram  */
+        /* Add a line to the Waterfall map, every acquisition is kept and
+         * the client fetches the new lines with rp_spectr_wf_get_lines() */
         rp_spectr_wf_calc(&rp_cha_fft[0], &rp_chb_fft[0]);
 
-        if((jpg_write_div == 0) || (loop_cnt++%jpg_write_div == 0)) {
-            jpg_fn_cnt++;
-            if(jpg_fn_cnt > c_jpg_max_file) 
-                jpg_fn_cnt = 0;
-
-            sprintf(jpg_fname_cha, "%s%01d_%03d%s", c_jpg_file_path, 
-                    1, jpg_fn_cnt, c_jpg_file_suf);
-            sprintf(jpg_fname_chb, "%s%01d_%03d%s", c_jpg_file_path, 
-                    2, jpg_fn_cnt, c_jpg_file_suf);
-            rp_spectr_wf_save_jpeg(jpg_fname_cha, jpg_fname_chb);
-
-            /* Report index back to the user */
-        } else if(loop_cnt > 1e6) {
-            loop_cnt = 0;
-        }
-
-
-        /* Copy the result to the output part - and also the index of
-         * last JPEG file index */
-        tmp_result.jpg_idx = jpg_fn_cnt;
+        /* Copy the result to the output part */
         rp_spectr_set_signals(rp_tmp_signals, tmp_result);
 
         usleep(10000);
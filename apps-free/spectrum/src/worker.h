@@ -25,9 +25,8 @@ typedef enum rp_spectr_worker_state_e {
     rp_spectr_nonexisting_state /* must be last */
 } rp_spectr_worker_state_t;
 
-/* Worker results (not signal but calculated peaks and jpeg index */
+/* Worker results (not signal but calculated peaks) */
 typedef struct rp_spectr_worker_res_s {
-    int   jpg_idx;
     float peak_pw_cha;
     float peak_pw_freq_cha;
     float peak_pw_chb;
@@ -44,6 +43,8 @@ int rp_spectr_worker_update_params(rp_app_params_t *params, int fpga_update);
 int rp_spectr_clean_signals(void);
 /* Cleans up temporary directory (JPGs) */
 int rp_spectr_clean_tmpdir(const char *dir);
+/* Stores the current Waterfall maps to /tmp/ram/wat[1|2].jpg */
+int rp_spectr_export_waterfall(void);
 
 /* Returns:
  *  0 - new signals (dirty signal) are copied to the output 
@@ -56,4 +57,11 @@ int rp_spectr_get_signals(float ***signals, rp_spectr_worker_res_t *result);
  */
 int rp_spectr_set_signals(float **source, rp_spectr_worker_res_t result);
 
+/* Blocks until new signals are set or timeout_ms passes.
+ * Returns:
+ *  1 - new signals are available
+ *  0 - timeout, no new signals
+ */
+int rp_spectr_wait_signals(int timeout_ms);
+
 #endif /* __WORKER_H*/
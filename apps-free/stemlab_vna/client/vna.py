@@ -89,13 +89,14 @@ class VNA(QMainWindow, Ui_VNA):
     self.sweep_size = 600
     self.xaxis, self.sweep_step = np.linspace(self.sweep_start, self.sweep_stop, self.sweep_size, retstep = True)
     self.xaxis *= 1000
-    # buffer and offset for the incoming samples
-    self.buffer = bytearray(24 * VNA.max_size)
-    self.offset = 0
+    # buffer for the incoming points, 16 bytes (adc1 and adc2) per point
+    self.buffer = bytearray(16 * VNA.max_size)
     self.data = np.frombuffer(self.buffer, np.complex64)
     self.adc1 = np.zeros(VNA.max_size, np.complex64)
     self.adc2 = np.zeros(VNA.max_size, np.complex64)
-    self.dac1 = np.zeros(VNA.max_size, np.complex64)
+    # frame being received: header is (first point, number of points)
+    self.points = 0
+    self.header = None
     self.open = np.zeros(VNA.max_size, np.complex64)
     self.short = np.zeros(VNA.max_size, np.complex64)
     self.load = np.zeros(VNA.max_size, np.complex64)
@@ -195,22 +196,25 @@ class VNA(QMainWindow, Ui_VNA):
     if not self.reading:
       self.socket.readAll()
       return
-    size = self.socket.bytesAvailable()
-    self.progress.setValue((self.offset + size) / 24)
-    limit = 24 * (self.sweep_size + 1)
-    if self.offset + size < limit:
-      self.buffer[self.offset:self.offset + size] = self.socket.read(size)
-      self.offset += size
-    else:
-      self.buffer[self.offset:limit] = self.socket.read(limit - self.offset)
-      self.adc1 = self.data[0::3]
-      self.adc2 = self.data[1::3]
-      self.dac1 = self.data[2::3]
-      getattr(self, self.mode)[0:self.sweep_size] = self.adc1[1:self.sweep_size + 1] / self.dac1[1:self.sweep_size + 1]
-      getattr(self, 'plot_%s' % self.mode)()
-      self.reading = False
-      self.sweepFrame.setEnabled(True)
-      self.selectFrame.setEnabled(True)
+    # the server sends frames of up to 1024 points, read each one as a whole
+    while True:
+      if self.header is None:
+        if self.socket.bytesAvailable() < 8: return
+        self.header = struct.unpack('<II', self.socket.read(8))
+      first, count = self.header
+      if self.socket.bytesAvailable() < 16 * count: return
+      self.buffer[16 * first:16 * (first + count)] = self.socket.read(16 * count)
+      self.header = None
+      self.points = first + count
+      self.progress.setValue(self.points)
+      if self.points >= self.sweep_size: break
+    self.adc1 = self.data[0::2]
+    self.adc2 = self.data[1::2]
+    getattr(self, self.mode)[0:self.sweep_size] = self.adc1[0:self.sweep_size] / self.adc2[0:self.sweep_size]
+    getattr(self, 'plot_%s' % self.mode)()
+    self.reading = False
+    self.sweepFrame.setEnabled(True)
+    self.selectFrame.setEnabled(True)
 
   def display_error(self, socketError):
     self.startTimer.stop()
@@ -252,24 +256,26 @@ class VNA(QMainWindow, Ui_VNA):
 
   def set_level(self, value):
     if self.idle: return
-    self.socket.write(struct.pack('<I', 5<<28 | int(32767 * np.power(10.0, value / 20.0))))
+    self.socket.write(struct.pack('<I', 7<<28 | int(32766 * np.power(10.0, value / 20.0))))
 
   def sweep(self):
     if self.idle: return
     self.sweepFrame.setEnabled(False)
     self.selectFrame.setEnabled(False)
-    self.socket.write(struct.pack('<I', 6<<28))
-    self.offset = 0
+    self.socket.write(struct.pack('<I', 10<<28))
+    self.points = 0
+    self.header = None
     self.reading = True
-    self.progress = QProgressDialog('Sweep status', 'Cancel', 0, self.sweep_size + 1)
+    self.progress = QProgressDialog('Sweep status', 'Cancel', 0, self.sweep_size)
     self.progress.setModal(True)
     self.progress.setMinimumDuration(1000)
     self.progress.canceled.connect(self.cancel)
 
   def cancel(self):
-    self.offset = 0
+    self.points = 0
+    self.header = None
     self.reading = False
-    self.socket.write(struct.pack('<I', 7<<28))
+    self.socket.write(struct.pack('<I', 11<<28))
     self.sweepFrame.setEnabled(True)
     self.selectFrame.setEnabled(True)
 
@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <math.h>
+#include <time.h>
 #include <pthread.h>
 #include <sys/mman.h>
 #include <sys/socket.h>
@@ -18,6 +19,26 @@ int sock_thread = -1;
 uint32_t rate_thread = 5;
 uint32_t size_thread = 6000;
 
+/* completed points are sent in frames of up to FRAME_POINTS points */
+#define FRAME_POINTS 1024
+/* a frame that is not full is sent when its oldest point waited this long */
+#define FRAME_LATENCY_US 20000
+/* limits of the adaptive polling interval */
+#define POLL_MIN_US 50
+#define POLL_MAX_US 2000
+
+typedef struct
+{
+  uint32_t first; /* index of the first point in the sweep */
+  uint32_t count; /* number of points, 4 floats each */
+} frame_header_t;
+
+typedef struct
+{
+  frame_header_t header;
+  float data[FRAME_POINTS][4];
+} frame_t;
+
 void *read_handler(void *arg);
 
 int main(int argc, char *argv[])
@@ -210,25 +231,75 @@ int main(int argc, char *argv[])
   return EXIT_SUCCESS;
 }
 
+static int send_frame(int sock, frame_t *frame, uint32_t first, uint32_t count)
+{
+  uint8_t *buffer = (uint8_t *)frame;
+  size_t size = sizeof(frame_header_t) + count * 16;
+  ssize_t result;
+
+  frame->header.first = first;
+  frame->header.count = count;
+
+  while(size > 0)
+  {
+    result = send(sock, buffer, size, MSG_NOSIGNAL);
+    if(result < 0) return -1;
+    buffer += result;
+    size -= result;
+  }
+
+  return 0;
+}
+
+static uint64_t time_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 void *read_handler(void *arg)
 {
-  uint32_t i, j, cntr;
+  uint32_t i, j, n, cntr, first, count, delay;
   uint32_t rate = rate_thread;
   uint32_t size = size_thread;
+  uint64_t oldest = 0;
   float buffer[4];
+  frame_t frame;
 
   i = 0;
+  n = 0;
   cntr = 0;
+  first = 0;
+  count = 0;
+  delay = POLL_MIN_US;
   while(cntr < size * (rate + 5))
   {
-    if(sock_thread < 0) break;
+    if(sock_thread < 0) return NULL;
 
-    if(*rx_cntr < 4)
+    if(n == 0)
     {
-      usleep(1000);
+      /* drain everything the FIFO holds, 4 words per accumulation */
+      n = *rx_cntr / 4;
+      if(n > 0 && delay > POLL_MIN_US) delay /= 2;
+    }
+
+    if(n == 0)
+    {
+      /* the FIFO has no interrupt, so back off while it stays empty */
+      if(count > 0 && time_us() - oldest >= FRAME_LATENCY_US)
+      {
+        if(send_frame(sock_thread, &frame, first, count) < 0) return NULL;
+        first += count;
+        count = 0;
+      }
+      usleep(delay);
+      if(delay < POLL_MAX_US) delay *= 2;
       continue;
     }
 
+    --n;
+
     if(i < 5)
     {
       for(j = 0; j < 4; ++j)
@@ -254,10 +325,21 @@ void *read_handler(void *arg)
 
     for(j = 0; j < 4; ++j)
     {
-      buffer[j] /= rate;
+      frame.data[count][j] = buffer[j] / rate;
     }
 
-    if(send(sock_thread, buffer, 16, MSG_NOSIGNAL) < 0) break;
+    if(count++ == 0) oldest = time_us();
+
+    if(count < FRAME_POINTS) continue;
+
+    if(send_frame(sock_thread, &frame, first, count) < 0) return NULL;
+    first += count;
+    count = 0;
+  }
+
+  if(count > 0 && sock_thread >= 0)
+  {
+    send_frame(sock_thread, &frame, first, count);
   }
 
   return NULL;
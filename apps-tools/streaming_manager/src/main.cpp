@@ -645,6 +645,7 @@ void StartServer(){
 					ip_addr_host,
 					sock_port,
 					protocol == CStreamSettings::TCP ? asionet::Protocol::TCP : asionet::Protocol::UDP);
+			s_manger->setCompression(g_serverNetConfig->getCompression());
 		}else{
 			auto file_type = Stream_FileType::WAV_TYPE;
 			if (format == CStreamSettings::TDMS) file_type = Stream_FileType::TDMS_TYPE;
@@ -20,6 +20,9 @@ std::map<std::string,uint64_t>        g_BytesCount;
 std::map<std::string,uint64_t>        g_lostRate;
 std::map<std::string,uint64_t>        g_packCounter_ch1;
 std::map<std::string,uint64_t>        g_packCounter_ch2;
+std::map<std::string,uint64_t>        g_lastPackId;
+std::map<std::string,uint64_t>        g_lastPackSamples;
+std::map<std::string,uint64_t>        g_lostPacks;
 
 std::vector<std::thread>              clients;
 
@@ -41,17 +44,31 @@ void reciveData(std::error_code error,uint8_t *buff,size_t _size,std::string hos
     uint32_t resolution = 0;
     uint32_t adc_mode = 0;
     uint32_t adc_bits = 0;
-    asionet::CAsioNet::ExtractPack(buff,_size, id, lostRate,oscRate, resolution, adc_mode , adc_bits, ch1, size_ch1, ch2 , size_ch2);
+    auto pool = g_manger[host]->getBufferPool();
+    bool extracted = asionet::CAsioNet::ExtractPack(buff,_size, id, lostRate,oscRate, resolution, adc_mode , adc_bits, ch1, size_ch1, ch2 , size_ch2, pool.get());
     g_packCounter_ch1[host] += size_ch1 / (resolution == 16 ? 2 : 1);
     g_packCounter_ch2[host] += size_ch2 / (resolution == 16 ? 2 : 1);
+    // Packs are numbered by the server, a gap means datagrams lost on the network.
+    // Their samples are filled up like the ones lost on the board.
+    if (extracted) {
+        if (id > g_lastPackId[host] + 1 && g_lastPackSamples[host] > 0) {
+            uint64_t gap = id - g_lastPackId[host] - 1;
+            g_lostPacks[host] += gap;
+            lostRate += gap * g_lastPackSamples[host];
+        }
+        g_lastPackId[host] = id;
+        if (size_ch1 + size_ch2 > 0) {
+            g_lastPackSamples[host] = MAX(size_ch1, size_ch2) / (resolution == 16 ? 2 : 1);
+        }
+    }
     g_lostRate[host] += lostRate;
     // std::cout << id << " ; " <<  _size  <<  " ; " << resolution << " ; " << size_ch1 << " ; " << size_ch2 << "\n";
 
     g_manger[host]->passBuffers(lostRate, oscRate , adc_mode , adc_bits, ch1 , size_ch1 ,  ch2 , size_ch2 , resolution, id);
 
 
-    delete [] ch1;
-    delete [] ch2;
+    pool->release(ch1);
+    pool->release(ch2);
 
     std::chrono::system_clock::time_point timeNow = std::chrono::system_clock::now();
     auto curTime = std::chrono::time_point_cast<std::chrono::milliseconds >(timeNow);
@@ -72,9 +89,10 @@ void reciveData(std::error_code error,uint8_t *buff,size_t _size,std::string hos
             pref = " Mi";
         }
         std::cout << time_point_to_string(timeNow) << "\tHOST IP:" << host << ": Bandwidth:\t" << bw <<  pref <<"B/s\tData count ch1:\t" << g_packCounter_ch1[host]
-        << "\tch2:\t" << g_packCounter_ch2[host]  <<  "\tLost:\t" << g_lostRate[host]  << "\n";
+        << "\tch2:\t" << g_packCounter_ch2[host]  <<  "\tLost:\t" << g_lostRate[host]  << "\tLost packs:\t" << g_lostPacks[host] << "\n";
         g_BytesCount[host]  = 0;
         g_lostRate[host]  = 0;
+        g_lostPacks[host] = 0;
         g_timeBegin[host] = value.count();
     }
 }
@@ -85,6 +103,9 @@ auto runClient(std::string  host,StateRunnedHosts state) -> void{
 
     g_packCounter_ch1[host] = 0;
     g_packCounter_ch2[host] = 0;
+    g_lastPackId[host] = 0;
+    g_lastPackSamples[host] = 0;
+    g_lostPacks[host] = 0;
     g_lostRate[host] = 0;
     g_BytesCount[host] = 0;
     g_terminate[host] = false;
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "file_async_writer.h"
+#include "csv_converter.h"
+
+using namespace std;
+using clock_type = std::chrono::steady_clock;
+
+// Compares the BIN to CSV conversion of CCSVConverter with the legacy
+// FileQueueManager::ReadCSV loop. Synthetic captures are generated for every
+// sample format and channel layout, both converters write a CSV file, the
+// outputs must be byte identical and the throughput of each one is reported in
+// MB of CSV written per second.
+//
+// Usage: convert_bench [capture size MB] [work directory] [threads]
+
+struct capture_t {
+    const char *name;
+    unsigned short resolution;
+    bool ch1;
+    bool ch2;
+};
+
+static const size_t seg_samples = 16384;
+
+static auto fileSize(const string &_file) -> int64_t {
+    ifstream fs(_file, std::ios::binary | std::ios::ate);
+    return fs.good() ? (int64_t)fs.tellg() : -1;
+}
+
+static auto fillChannel(vector<uint8_t> &_buf, unsigned short _resolution, size_t _seg, int _ch) -> void {
+    for (size_t i = 0; i < seg_samples; i++) {
+        double v = sin((double)(_seg * seg_samples + i) * (0.001 + 0.0007 * _ch)) + (double)(rand() % 200 - 100) / 1000.0;
+        switch (_resolution) {
+            case 8:  ((int8_t*)_buf.data())[i]  = (int8_t)(v * 120); break;
+            case 16: ((int16_t*)_buf.data())[i] = (int16_t)(v * 8000); break;
+            case 32: ((float*)_buf.data())[i]   = (float)(v * 0.5); break;
+        }
+    }
+}
+
+static auto buildCapture(const string &_file, const capture_t &_cap, int64_t _size) -> int32_t {
+    FileQueueManager fm;
+    ofstream out(_file, std::ios::binary | std::ios::trunc);
+    size_t bytes = seg_samples * (_cap.resolution / 8);
+    vector<uint8_t> ch1(bytes), ch2(bytes);
+    int64_t written = 0;
+    int32_t segments = 0;
+    srand(1);
+    while (written < _size) {
+        // Every 7th segment from the 4th one reports lost samples
+        uint32_t lost = (segments % 7 == 3) ? (uint32_t)(rand() % 5000) : 0;
+        fillChannel(ch1, _cap.resolution, segments, 1);
+        fillChannel(ch2, _cap.resolution, segments, 2);
+        auto seg = fm.BuildBINStream(_cap.ch1 ? ch1.data() : nullptr, _cap.ch1 ? bytes : 0,
+                                     _cap.ch2 ? ch2.data() : nullptr, _cap.ch2 ? bytes : 0,
+                                     _cap.resolution, lost);
+        seg->seekg(0, std::ios::beg);
+        out << seg->rdbuf();
+        delete seg;
+        written = out.tellp();
+        segments++;
+    }
+    return segments;
+}
+
+static auto legacyConvert(const string &_bin, const string &_csv, int32_t _start, int32_t _end) -> bool {
+    std::fstream fs;
+    std::fstream fs_out;
+    fs.open(_bin, std::ios::binary | std::ofstream::in | std::ofstream::out);
+    fs_out.open(_csv, std::ofstream::in | std::ofstream::trunc | std::ofstream::out);
+    if (fs.fail() || fs_out.fail()) return false;
+    int64_t position = 0;
+    int32_t curSegment = 0;
+    int     channels = 0;
+    _start = max(_start, 1);
+    while (position >= 0) {
+        curSegment++;
+        bool notSkip = (_start <= curSegment) && ((_end != -2 && _end >= curSegment) || _end == -2);
+        auto csv_seg = FileQueueManager::ReadCSV(&fs, &position, &channels, !notSkip);
+        if (notSkip && csv_seg) {
+            csv_seg->seekg(0, csv_seg->beg);
+            fs_out << csv_seg->rdbuf();
+            fs_out.flush();
+        }
+        delete csv_seg;
+        if (_end != -2 && _end < curSegment) break;
+        if (fs.fail() || fs_out.fail()) return false;
+    }
+    return true;
+}
+
+static auto sameFiles(const string &_a, const string &_b) -> bool {
+    ifstream a(_a, std::ios::binary);
+    ifstream b(_b, std::ios::binary);
+    vector<char> ba(1 << 20), bb(1 << 20);
+    while (a && b) {
+        a.read(ba.data(), ba.size());
+        b.read(bb.data(), bb.size());
+        if (a.gcount() != b.gcount() || !equal(ba.begin(), ba.begin() + a.gcount(), bb.begin())) return false;
+    }
+    return a.eof() && b.eof();
+}
+
+static auto seconds(clock_type::time_point _from) -> double {
+    return std::chrono::duration<double>(clock_type::now() - _from).count();
+}
+
+int main(int argc, char *argv[]) {
+    int64_t size = (argc > 1 ? atoll(argv[1]) : 64) * 1024 * 1024;
+    string dir = argc > 2 ? argv[2] : "/tmp";
+    unsigned threads = argc > 3 ? (unsigned)atoi(argv[3]) : 0;
+
+    const capture_t captures[] = {
+        {"8 bit, 2 ch",  8,  true,  true},
+        {"16 bit, 2 ch", 16, true,  true},
+        {"16 bit, ch1",  16, true,  false},
+        {"16 bit, ch2",  16, false, true},
+        {"32 bit, 2 ch", 32, true,  true},
+        {"32 bit, ch1",  32, true,  false},
+    };
+
+    string bin = dir + "/convert_bench.bin";
+    string csv_legacy = dir + "/convert_bench_legacy.csv";
+    string csv_new = dir + "/convert_bench.csv";
+    bool ok = true;
+
+    cout << left << setw(22) << "capture" << right
+         << setw(10) << "segments" << setw(12) << "csv MB"
+         << setw(14) << "legacy MB/s" << setw(12) << "new MB/s"
+         << setw(10) << "speedup" << "  result\n";
+
+    for (auto &cap : captures) {
+        int32_t segments = buildCapture(bin, cap, size);
+
+        // Whole file and a range of segments, the range starts with a segment
+        // that has lost samples to check the channel count of the filling
+        const int32_t ranges[][2] = {{-2, -2}, {4, segments / 2}};
+        for (auto &range : ranges) {
+            auto t = clock_type::now();
+            bool legacy_ok = legacyConvert(bin, csv_legacy, range[0], range[1]);
+            double legacy_s = seconds(t);
+
+            std::atomic_bool stop(false);
+            CCSVConverter conv(bin);
+            conv.setThreads(threads);
+            t = clock_type::now();
+            auto res = conv.convert(csv_new, range[0], range[1], stop, nullptr);
+            double new_s = seconds(t);
+
+            double csv_mb = (double)fileSize(csv_new) / (1024 * 1024);
+            bool same = legacy_ok && res == CCSVConverter::Result::OK && sameFiles(csv_legacy, csv_new);
+            ok = ok && same;
+            string name = string(cap.name) + (range[0] == -2 ? "" : " (range)");
+            cout << left << setw(22) << name << right << fixed << setprecision(1)
+                 << setw(10) << segments
+                 << setw(12) << csv_mb
+                 << setw(14) << csv_mb / legacy_s
+                 << setw(12) << csv_mb / new_s
+                 << setw(9) << legacy_s / new_s << "x"
+                 << "  " << (same ? "identical" : "MISMATCH") << "\n";
+        }
+    }
+
+    remove(bin.c_str());
+    remove(csv_legacy.c_str());
+    remove(csv_new.c_str());
+    return ok ? 0 : 1;
+}
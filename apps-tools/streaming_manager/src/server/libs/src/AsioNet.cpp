@@ -1,6 +1,7 @@
 #include <fstream>
 #include "asio.hpp"
 #include "AsioNet.h"
+#include "sample_codec.h"
 
 #define UNUSED(x) [&x]{}()
 
@@ -76,6 +77,7 @@ namespace  asionet {
         prefix_lenght += sizeof(int32_t) * 2; // size of channel1 and channel2 (8 byte)
         prefix_lenght += sizeof(int32_t);     // resolution (4 byte)
         prefix_lenght += sizeof(int32_t);     // adc_mode (4 byte)
+        prefix_lenght += sizeof(int32_t);     // adc_bits (4 byte)
         size_t  buffer_size = prefix_lenght + _size_ch1 + _size_ch2;
 //       printf("buffer_size %d, prefix_size %d\n",buffer_size,prefix_lenght);
         memcpy(buffer,ID_PACK,16);
@@ -103,6 +105,70 @@ namespace  asionet {
 
     }
 
+    void CAsioNet::BuildPackHeader(
+            CAsioSocket::send_buffer buffer ,
+            uint64_t _id ,
+            uint64_t _lostRate ,
+            uint32_t _oscRate  ,
+            uint32_t _resolution ,
+            uint32_t _adc_mode,
+            uint32_t _adc_bits,
+            size_t _size_ch1 ,
+            size_t _size_ch2){
+        memcpy(buffer,ID_PACK,16);
+        ((uint64_t*)buffer)[2] = _id;
+        ((uint64_t*)buffer)[3] = _lostRate;
+        ((uint32_t*)buffer)[8] = _oscRate;
+        ((uint32_t*)buffer)[9] = (uint32_t)(PACK_PREFIX_SIZE + _size_ch1 + _size_ch2);
+        ((uint32_t*)buffer)[10] = (uint32_t)_size_ch1;
+        ((uint32_t*)buffer)[11] = (uint32_t)_size_ch2;
+        ((uint32_t*)buffer)[12] = _resolution;
+        ((uint32_t*)buffer)[13] = _adc_mode;
+        ((uint32_t*)buffer)[14] = _adc_bits;
+    }
+
+    bool CAsioNet::BuildCompressedPack(
+            CAsioSocket::send_buffer buffer ,
+            uint64_t _id ,
+            uint64_t _lostRate ,
+            uint32_t _oscRate  ,
+            uint32_t _resolution ,
+            uint32_t _adc_mode,
+            uint32_t _adc_bits,
+            const void *_ch1 ,
+            size_t _size_ch1 ,
+            const void  *_ch2 ,
+            size_t _size_ch2 ,
+            size_t &_buffer_size){
+        size_t  raw_size = PACK_PREFIX_SIZE + _size_ch1 + _size_ch2;
+        size_t  coded_ch1 = 0;
+        size_t  coded_ch2 = 0;
+        // The coded channels have to fit into the space of the raw ones
+        if (_size_ch1 > 0){
+            coded_ch1 = CSampleCodec::encode(_ch1, _size_ch1, _resolution, buffer + PACK_PREFIX_SIZE, _size_ch1);
+            if (coded_ch1 == 0) return false;
+        }
+        if (_size_ch2 > 0){
+            coded_ch2 = CSampleCodec::encode(_ch2, _size_ch2, _resolution, buffer + PACK_PREFIX_SIZE + coded_ch1, raw_size - PACK_PREFIX_SIZE - coded_ch1);
+            if (coded_ch2 == 0) return false;
+        }
+        size_t  buffer_size = PACK_PREFIX_SIZE + coded_ch1 + coded_ch2;
+        if (buffer_size >= raw_size) return false;
+
+        memcpy(buffer,ID_PACK,16);
+        ((uint64_t*)buffer)[2] = _id;
+        ((uint64_t*)buffer)[3] = _lostRate;
+        ((uint32_t*)buffer)[8] = _oscRate;
+        ((uint32_t*)buffer)[9] = (uint32_t)buffer_size;
+        ((uint32_t*)buffer)[10] = (uint32_t)coded_ch1;
+        ((uint32_t*)buffer)[11] = (uint32_t)coded_ch2;
+        ((uint32_t*)buffer)[12] = _resolution | PACK_FLAG_COMPRESSED;
+        ((uint32_t*)buffer)[13] = _adc_mode;
+        ((uint32_t*)buffer)[14] = _adc_bits;
+        _buffer_size = buffer_size;
+        return true;
+    }
+
     bool CAsioNet::ExtractPack(
                     CAsioSocket::send_buffer _buffer ,
                     size_t _size ,
@@ -115,7 +181,8 @@ namespace  asionet {
                     CAsioSocket::send_buffer &_ch1 ,
                     size_t &_size_ch1 ,
                     CAsioSocket::send_buffer  &_ch2 ,
-                    size_t &_size_ch2){
+                    size_t &_size_ch2,
+                    CBufferPool *_pool){
         UNUSED(_size);
 
         if (strncmp((const char*)_buffer,ID_PACK,16) == 0){
@@ -128,17 +195,35 @@ namespace  asionet {
             _resolution = ((uint32_t*)_buffer)[12];
             _adc_mode = ((uint32_t*)_buffer)[13];     
             _adc_bits = ((uint32_t*)_buffer)[14];            
-            uint16_t prefix = 60;
+            uint16_t prefix = PACK_PREFIX_SIZE;
+
+            if (_resolution & PACK_FLAG_COMPRESSED) {
+                _resolution &= ~PACK_FLAG_COMPRESSED;
+                const uint8_t *coded_ch2 = _buffer + prefix + _size_ch1;
+                _ch1 = nullptr;
+                _ch2 = nullptr;
+                if ((_size_ch1 > 0 && !DecodeChannel(_buffer + prefix, _size_ch1, _ch1, _pool)) ||
+                    (_size_ch2 > 0 && !DecodeChannel(coded_ch2, _size_ch2, _ch2, _pool))) {
+                    if (_ch1) {
+                        if (_pool) _pool->release(_ch1); else delete[] _ch1;
+                        _ch1 = nullptr;
+                    }
+                    _size_ch1 = 0;
+                    _size_ch2 = 0;
+                    return false;
+                }
+                return true;
+            }
 
             if (_size_ch1 > 0) {
-                _ch1 = new uint8_t[_size_ch1];
+                _ch1 = _pool ? _pool->acquire(_size_ch1) : new uint8_t[_size_ch1];
                 memcpy_neon(_ch1,_buffer + prefix,_size_ch1);
             }else{
                 _ch1 = nullptr;
             }
 
             if (_size_ch2 > 0) {
-                _ch2 = new uint8_t[_size_ch2];
+                _ch2 = _pool ? _pool->acquire(_size_ch2) : new uint8_t[_size_ch2];
                 memcpy_neon(_ch2,_buffer + prefix + _size_ch1,_size_ch2);
             }else{
                 _ch2 = nullptr;
@@ -148,6 +233,20 @@ namespace  asionet {
         return false;
     }
 
+    // Replaces _size with the decoded size
+    bool CAsioNet::DecodeChannel(const uint8_t *_data, size_t &_size, CAsioSocket::send_buffer &_ch, CBufferPool *_pool){
+        size_t size = CSampleCodec::decodedSize(_data, _size);
+        if (size == 0) return false;
+        _ch = _pool ? _pool->acquire(size) : new uint8_t[size];
+        if (CSampleCodec::decode(_data, _size, _ch, size) != size) {
+            if (_pool) _pool->release(_ch); else delete[] _ch;
+            _ch = nullptr;
+            return false;
+        }
+        _size = size;
+        return true;
+    }
+
     CAsioNet::Ptr CAsioNet::Create(asionet::Mode _mode,asionet::Protocol _protocol,std::string _host , std::string _port) {
 
         return std::make_shared<CAsioNet>(_mode,_protocol,_host,_port);
@@ -260,4 +359,18 @@ namespace  asionet {
         }
         return false;
     }
+
+    bool CAsioNet::SendDatagrams(const CAsioSocket::Datagram *_datagrams, size_t _count){
+        if (m_server){
+            return m_server->SendDatagrams(_datagrams,_count);
+        }
+        return false;
+    }
+
+    size_t CAsioNet::GetMaxDatagramSize(){
+        if (m_server){
+            return m_server->GetMaxDatagramSize();
+        }
+        return UDP_DEFAULT_DATAGRAM;
+    }
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <deque>
 
 #include "neon_asm.h"
+#include "buffer_pool.h"
 #include "asio.hpp"
 #include "EventHandlers.h"
 #include "AsioSocket.h"
@@ -18,6 +19,11 @@
 //#define  SOCKET_BUFFER_SIZE 65536
 //#define  FIFO_BUFFER_SIZE  SOCKET_BUFFER_SIZE * 3
 
+// Size of the header written by CAsioNet::BuildPack in front of channel data
+#define  PACK_PREFIX_SIZE 60
+// Set in the resolution field when the channel data is coded with CSampleCodec
+#define  PACK_FLAG_COMPRESSED 0x80000000
+
 using  namespace std;
 using  namespace asio;
 
@@ -47,6 +53,8 @@ namespace  asionet {
         void addCallReceived(function<void(error_code error,uint8_t*,size_t)> _func);
 
         bool SendData(bool async,CAsioSocket::send_buffer _buffer,size_t _size);
+        bool SendDatagrams(const CAsioSocket::Datagram *_datagrams, size_t _count);
+        size_t GetMaxDatagramSize();
     Protocol GetProtocol() { return  m_protocol;};
         bool IsConnected();
 
@@ -77,6 +85,35 @@ namespace  asionet {
                 size_t _size_ch2 ,
                 size_t &_buffer_size);
 
+        // Writes only the header of a pack, the channel data is sent from its own buffers
+        static void BuildPackHeader(
+                CAsioSocket::send_buffer buffer ,
+                uint64_t _id ,
+                uint64_t _lostRate ,
+                uint32_t _oscRate  ,
+                uint32_t _resolution ,
+                uint32_t _adc_mode,
+                uint32_t _adc_bits,
+                size_t _size_ch1 ,
+                size_t _size_ch2);
+
+        // Same layout as BuildPack with the channel data coded by CSampleCodec.
+        // The buffer must hold a raw pack. Returns false if coding does not make
+        // the pack smaller, the raw pack should be sent then.
+        static bool BuildCompressedPack(
+                CAsioSocket::send_buffer buffer ,
+                uint64_t _id ,
+                uint64_t _lostRate ,
+                uint32_t _oscRate  ,
+                uint32_t _resolution ,
+                uint32_t _adc_mode,
+                uint32_t _adc_bits,
+                const void *_ch1 ,
+                size_t _size_ch1 ,
+                const void  *_ch2 ,
+                size_t _size_ch2 ,
+                size_t &_buffer_size);
+
         static bool     ExtractPack(
                 CAsioSocket::send_buffer _buffer ,
                 size_t _size ,
@@ -89,13 +126,15 @@ namespace  asionet {
                 CAsioSocket::send_buffer &_ch1 ,
                 size_t &_size_ch1 ,
                 CAsioSocket::send_buffer  &_ch2 ,
-                size_t &_size_ch2);
+                size_t &_size_ch2,
+                CBufferPool *_pool = nullptr);
 
     private:
 
         CAsioNet(const CAsioNet &) = delete;
         CAsioNet(CAsioNet &&) = delete;
         void SendServerStop();
+        static bool DecodeChannel(const uint8_t *_data, size_t &_size, CAsioSocket::send_buffer &_ch, CBufferPool *_pool);
 
         Mode m_mode;
         Protocol m_protocol;
@@ -1,9 +1,32 @@
 #include <fstream>
+#include <algorithm>
+#include <array>
 #include "asio.hpp"
 #include "AsioNet.h"
 
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef IP_MTU
+#define IP_MTU 14
+#endif
+#endif
+
 #define UNUSED(x) [&x]{}()
 
+#define UDP_RECV_BATCH_SIZE 32
+
 
 
 namespace  asionet {
@@ -28,7 +51,11 @@ namespace  asionet {
             m_is_udp_connected(false),
             m_is_tcp_connected(false),
             m_pos_last_in_fifo(0),
-            m_last_pack_id(0)
+            m_last_pack_id(0),
+            m_has_last_pack_id(false),
+            m_max_datagram(UDP_DEFAULT_DATAGRAM),
+            m_udp_gso(false),
+            m_udp_batch_buffer(nullptr)
     {
         m_SocketReadBuffer = new uint8_t[SOCKET_BUFFER_SIZE];
         m_tcp_fifo_buffer = new uint8_t[FIFO_BUFFER_SIZE];
@@ -38,7 +65,7 @@ namespace  asionet {
         CloseSocket();
         delete [] m_SocketReadBuffer;
         delete [] m_tcp_fifo_buffer;
-
+        delete [] m_udp_batch_buffer;
     }
 
 
@@ -49,9 +76,17 @@ namespace  asionet {
         m_is_udp_connected = false;
         m_is_tcp_connected = false;
         m_last_pack_id = 0;
+        m_has_last_pack_id = false;
         if (m_protocol == asionet::Protocol::UDP) {
             m_udp_socket = std::make_shared<asio::ip::udp::udp::socket>(m_io_service, asio::ip::udp::udp::endpoint(asio::ip::udp::udp::v4(), std::stoi(m_port)));
             m_udp_socket->set_option(asio::ip::udp::socket::reuse_address(true));
+            asio::error_code ec;
+            m_udp_socket->set_option(asio::socket_base::send_buffer_size(UDP_SEND_BUFFER), ec);
+#ifdef __linux__
+            // Kernels without UDP GSO reject the option
+            int gso = 0;
+            m_udp_gso = setsockopt(m_udp_socket->native_handle(), SOL_UDP, UDP_SEGMENT, &gso, sizeof(gso)) == 0;
+#endif
             WaitClient();
         }
 
@@ -110,6 +145,7 @@ namespace  asionet {
         if (!error) {
             m_is_udp_connected = (bool) m_udp_recv_server_buffer[0];
             if (m_is_udp_connected){
+                UpdateMaxDatagramSize();
                 m_callback_Str.emitEvent(Events::CONNECT_SERVER,m_udp_endpoint.address().to_string());
             }
             else {
@@ -182,16 +218,12 @@ namespace  asionet {
             }
 
             if (m_protocol == Protocol::UDP) {
-                if (strncmp((const char*)m_SocketReadBuffer,ID_PACK,16) == 0) {
-                    uint64_t id_pack = ((uint64_t *) (m_SocketReadBuffer))[2];
-                    if (id_pack > m_last_pack_id)
-                    {
-                        m_callbackErrorUInt8Int.emitEvent(Events::RECIVED_DATA_FROM_SERVER, ErrorCode,
-                                                          m_SocketReadBuffer,
-                                                          (uint32_t) bytes_transferred);
-                        m_last_pack_id = id_pack;
-                    }
-                }
+                ReceiveDatagram(ErrorCode, m_SocketReadBuffer, bytes_transferred);
+#ifdef __linux__
+                // Take everything else that is already queued with one call
+                if (m_udp_batch_buffer)
+                    ReceiveDatagramBatch(ErrorCode);
+#endif
             }
 
 
@@ -212,6 +244,80 @@ namespace  asionet {
         }
     }
 
+    void CAsioSocket::ReceiveDatagram(const asio::error_code &ErrorCode, uint8_t *_buffer, size_t _size){
+        // A datagram normally holds one pack, coalesced segments hold several
+        size_t offset = 0;
+        while (offset + PACK_PREFIX_SIZE <= _size) {
+            uint8_t *pack = _buffer + offset;
+            if (strncmp((const char*)pack,ID_PACK,16) != 0)
+                break;
+            uint64_t id_pack = 0;
+            uint32_t pack_size = 0;
+            memcpy(&id_pack, pack + 16, sizeof(id_pack));
+            memcpy(&pack_size, pack + 36, sizeof(pack_size));
+            if (pack_size < PACK_PREFIX_SIZE || offset + pack_size > _size)
+                break;
+            // Older and repeated packs are dropped, the receiver counts the gaps.
+            // The server numbers its packs from zero again after a restart.
+            if (!m_has_last_pack_id || id_pack > m_last_pack_id || id_pack == 0)
+            {
+                m_callbackErrorUInt8Int.emitEvent(Events::RECIVED_DATA_FROM_SERVER, ErrorCode, pack, pack_size);
+                m_last_pack_id = id_pack;
+                m_has_last_pack_id = true;
+            }
+            offset += pack_size;
+        }
+    }
+
+    void CAsioSocket::ReceiveDatagramBatch(const asio::error_code &ErrorCode){
+#ifdef __linux__
+        mmsghdr msgs[UDP_RECV_BATCH_SIZE];
+        iovec   iovs[UDP_RECV_BATCH_SIZE];
+        int fd = m_udp_socket->native_handle();
+        while (m_udp_socket->is_open()) {
+            memset(msgs, 0, sizeof(msgs));
+            for (int i = 0; i < UDP_RECV_BATCH_SIZE; i++) {
+                iovs[i].iov_base = m_udp_batch_buffer + i * SOCKET_BUFFER_SIZE;
+                iovs[i].iov_len = SOCKET_BUFFER_SIZE;
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            int ret = recvmmsg(fd, msgs, UDP_RECV_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+            if (ret <= 0)
+                break;
+            for (int i = 0; i < ret; i++) {
+                ReceiveDatagram(ErrorCode, m_udp_batch_buffer + i * SOCKET_BUFFER_SIZE, msgs[i].msg_len);
+            }
+            if (ret < UDP_RECV_BATCH_SIZE)
+                break;
+        }
+#else
+        UNUSED(ErrorCode);
+#endif
+    }
+
+    void CAsioSocket::UpdateMaxDatagramSize(){
+        m_max_datagram = UDP_DEFAULT_DATAGRAM;
+#ifdef __linux__
+        // The kernel knows the MTU of the route to the client, jumbo frames included
+        int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0)
+            return;
+        int mtu = 0;
+        socklen_t len = sizeof(mtu);
+        if (::connect(fd, m_udp_endpoint.data(), m_udp_endpoint.size()) == 0 &&
+            getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &len) == 0 && mtu > 576) {
+            // IPv4 and UDP headers
+            m_max_datagram = std::min<size_t>(mtu - 28, UDP_MAX_DATAGRAM);
+        }
+        ::close(fd);
+#endif
+    }
+
+    size_t CAsioSocket::GetMaxDatagramSize(){
+        return m_max_datagram;
+    }
+
     bool CAsioSocket::IsConnected(){
         return m_is_tcp_connected || m_is_udp_connected;
     }
@@ -272,6 +378,13 @@ namespace  asionet {
             asio::ip::udp::udp::resolver::query query(asio::ip::udp::udp::v4(), m_host, m_port);
             asio::ip::udp::udp::resolver::iterator iter = resolver.resolve(query);
             m_udp_socket = std::make_shared<asio::ip::udp::udp::socket>(m_io_service, asio::ip::udp::udp::endpoint(asio::ip::udp::udp::v4(), 0));
+            asio::error_code ec;
+            m_udp_socket->set_option(asio::socket_base::receive_buffer_size(UDP_RECV_BUFFER), ec);
+            m_has_last_pack_id = false;
+#ifdef __linux__
+            if (!m_udp_batch_buffer)
+                m_udp_batch_buffer = new uint8_t[UDP_RECV_BATCH_SIZE * SOCKET_BUFFER_SIZE];
+#endif
             m_udp_endpoint = *iter;
             m_udp_socket->send_to(asio::buffer("\x01",1),m_udp_endpoint);
             m_callback_Str.emitEvent(Events::CONNECT_CLIENT,m_udp_endpoint.address().to_string());
@@ -361,6 +474,130 @@ namespace  asionet {
         return false;
     }
 
+    namespace {
+        size_t datagramSize(const CAsioSocket::Datagram &_datagram){
+            return _datagram.size[0] + _datagram.size[1] + _datagram.size[2];
+        }
+    }
+
+    bool CAsioSocket::SendDatagrams(const Datagram *_datagrams, size_t _count){
+        if (m_protocol != Protocol::UDP || !m_is_udp_connected || !m_udp_socket || !m_udp_socket->is_open())
+            return false;
+#ifdef __linux__
+        union Control{
+            char    buf[CMSG_SPACE(sizeof(uint16_t))];
+            cmsghdr align;
+        };
+        mmsghdr msgs[UDP_BATCH_SIZE];
+        iovec   iovs[UDP_BATCH_SIZE * 3];
+        Control controls[UDP_BATCH_SIZE];
+        size_t  msg_datagrams[UDP_BATCH_SIZE];
+        size_t  total = 0;
+        int fd = m_udp_socket->native_handle();
+        for (size_t i = 0; i < _count; i++) {
+            total += datagramSize(_datagrams[i]);
+        }
+
+        size_t done = 0;
+        while (done < _count) {
+            size_t msg_count = 0;
+            size_t iov_count = 0;
+            size_t next = done;
+            memset(msgs, 0, sizeof(msgs));
+            while (next < _count && msg_count < UDP_BATCH_SIZE) {
+                // With GSO the kernel splits one send into equal segments, only the last may be shorter
+                size_t seg = datagramSize(_datagrams[next]);
+                size_t n = 1;
+                if (m_udp_gso) {
+                    while (next + n < _count && n < UDP_GSO_MAX_SEGMENTS && (n + 1) * seg <= UDP_MAX_DATAGRAM) {
+                        size_t size = datagramSize(_datagrams[next + n]);
+                        if (size > seg)
+                            break;
+                        n++;
+                        if (size < seg)
+                            break;
+                    }
+                }
+                if (iov_count + n * 3 > UDP_BATCH_SIZE * 3)
+                    break;
+
+                auto &hdr = msgs[msg_count].msg_hdr;
+                hdr.msg_name = (void*)m_udp_endpoint.data();
+                hdr.msg_namelen = m_udp_endpoint.size();
+                hdr.msg_iov = &iovs[iov_count];
+                for (size_t i = next; i < next + n; i++) {
+                    for (int p = 0; p < 3; p++) {
+                        if (_datagrams[i].size[p] == 0)
+                            continue;
+                        iovs[iov_count].iov_base = (void*)_datagrams[i].part[p];
+                        iovs[iov_count].iov_len = _datagrams[i].size[p];
+                        iov_count++;
+                    }
+                }
+                hdr.msg_iovlen = &iovs[iov_count] - hdr.msg_iov;
+                if (n > 1) {
+                    hdr.msg_control = controls[msg_count].buf;
+                    hdr.msg_controllen = sizeof(controls[msg_count].buf);
+                    cmsghdr *cm = CMSG_FIRSTHDR(&hdr);
+                    cm->cmsg_level = SOL_UDP;
+                    cm->cmsg_type = UDP_SEGMENT;
+                    cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                    uint16_t gso_size = (uint16_t)seg;
+                    memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+                }
+                msg_datagrams[msg_count] = n;
+                msg_count++;
+                next += n;
+            }
+
+            size_t sent = 0;
+            while (sent < msg_count) {
+                int ret = sendmmsg(fd, msgs + sent, msg_count - sent, 0);
+                if (ret < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                        // asio keeps the socket non-blocking while it waits for the client
+                        pollfd pfd = {fd, POLLOUT, 0};
+                        poll(&pfd, 1, 100);
+                        continue;
+                    }
+                    if (m_udp_gso && (errno == EIO || errno == EINVAL)) {
+                        // No segmentation offload on this path, resend the rest one datagram per message
+                        m_udp_gso = false;
+                        break;
+                    }
+                    HandlerSend(asio::error_code(errno, asio::system_category()), 0);
+                    return false;
+                }
+                for (int i = 0; i < ret; i++) {
+                    done += msg_datagrams[sent + i];
+                }
+                sent += ret;
+            }
+        }
+        HandlerSend(asio::error_code(), total);
+        return true;
+#else
+        return SendDatagramsSingle(_datagrams, _count);
+#endif
+    }
+
+    bool CAsioSocket::SendDatagramsSingle(const Datagram *_datagrams, size_t _count){
+        asio::error_code _error;
+        for (size_t i = 0; i < _count; i++) {
+            std::array<asio::const_buffer, 3> buffers = {{
+                asio::buffer(_datagrams[i].part[0], _datagrams[i].size[0]),
+                asio::buffer(_datagrams[i].part[1], _datagrams[i].size[1]),
+                asio::buffer(_datagrams[i].part[2], _datagrams[i].size[2])}};
+            m_udp_socket->send_to(buffers, m_udp_endpoint, 0, _error);
+            this->HandlerSend(_error, datagramSize(_datagrams[i]));
+            if (_error)
+                return false;
+        }
+        return true;
+    }
+
     void CAsioSocket::HandlerSend2(const asio::error_code &_error, size_t _bytesTransferred, uint8_t *buffer){
         HandlerSend(_error,_bytesTransferred);
         delete[] buffer;
@@ -18,6 +18,15 @@
 #define  SOCKET_BUFFER_SIZE 65536
 #define  FIFO_BUFFER_SIZE  SOCKET_BUFFER_SIZE * 3
 
+// UDP payload limits: IPv4 maximum and the payload of a 1500 byte Ethernet frame
+#define  UDP_MAX_DATAGRAM     65507
+#define  UDP_DEFAULT_DATAGRAM 1472
+// Datagrams per sendmmsg/recvmmsg call and segments per UDP GSO send
+#define  UDP_BATCH_SIZE       64
+#define  UDP_GSO_MAX_SEGMENTS 64
+#define  UDP_SEND_BUFFER      4194304
+#define  UDP_RECV_BUFFER      8388608
+
 using  namespace std;
 using  namespace asio;
 
@@ -49,7 +58,12 @@ namespace  asionet {
     class CAsioSocket {
     public:
         typedef uint8_t* send_buffer;
-       
+
+        // One datagram gathered from up to three pieces (pack header and channels)
+        struct Datagram{
+            const void *part[3];
+            size_t      size[3];
+        };
 
         using Ptr = shared_ptr<CAsioSocket>;
 
@@ -63,6 +77,10 @@ namespace  asionet {
         bool IsConnected();
         void SendBuffer(const void *_buffer, size_t _size);
         bool SendBuffer(bool async,send_buffer _buffer, size_t _size);
+        // UDP server only. Sends the datagrams in order with as few system calls as possible.
+        bool SendDatagrams(const Datagram *_datagrams, size_t _count);
+        // Largest UDP payload that reaches the client without IP fragmentation
+        size_t GetMaxDatagramSize();
         void addHandler(Events _event, std::function<void(string host)> _func);
         void addHandler(Events _event, std::function<void(error_code error)> _func);
         void addHandler(Events _event, std::function<void(error_code error,size_t)> _func);
@@ -81,6 +99,10 @@ namespace  asionet {
         void HandlerSend(const asio::error_code &_error, size_t _bytesTransferred);
         void HandlerSend2(const asio::error_code &_error, size_t _bytesTransferred, uint8_t *buffer);
         void HandlerReceiveFromServer(const asio::error_code &ErrorCode, size_t bytes_transferred);
+        void ReceiveDatagram(const asio::error_code &ErrorCode, uint8_t *_buffer, size_t _size);
+        void ReceiveDatagramBatch(const asio::error_code &ErrorCode);
+        void UpdateMaxDatagramSize();
+        bool SendDatagramsSingle(const Datagram *_datagrams, size_t _count);
 
         Mode m_mode;
         Protocol m_protocol;
@@ -101,6 +123,10 @@ namespace  asionet {
         uint8_t  *m_tcp_fifo_buffer;
         uint32_t  m_pos_last_in_fifo;
         uint64_t  m_last_pack_id;
+        bool      m_has_last_pack_id;
+        size_t    m_max_datagram;
+        bool      m_udp_gso;
+        uint8_t  *m_udp_batch_buffer;
 
 
         EventList<std::string> m_callback_Str;
@@ -1,3 +1,5 @@
+#include <chrono>
+#include <thread>
 #include "DACAsioNetController.h"
 #define UNUSED(x) [&x]{}()
 constexpr char DAC_ID_PACK[] = "#DAC_STREAM_PACK";
@@ -13,6 +15,7 @@ CDACAsioNetController::CDACAsioNetController():
     m_asionet(nullptr),
     m_bufferLimit(10),
     m_index(0),
+    m_pos_last_in_fifo(0),
     m_stopFlag(false),
     m_bufferdeq(),
     m_recieve_mutex()
@@ -43,6 +46,7 @@ bool CDACAsioNetController::startAsioNet(CAsioSocketSimple::ASMode _mode, std::s
     m_host = _host;
     m_port = _port;
     m_index = 0;
+    m_pos_last_in_fifo = 0;
     m_stopFlag = false;
     if (m_host == ""  || m_port == "")
         return false;
@@ -153,8 +157,14 @@ void CDACAsioNetController::receiveHandler(std::error_code error,uint8_t* _buff,
 
 auto CDACAsioNetController::extractBuffer(uint8_t* buff,size_t size) -> void{
     if (m_stopFlag) return;
-    while(m_bufferdeq.size() > m_bufferLimit){
+    // Holds back the socket (and so the sender) until the consumer catches up
+    while(true){
+        {
+            const std::lock_guard<std::mutex> lock(m_recieve_mutex);
+            if (m_bufferdeq.size() <= m_bufferLimit) break;
+        }
         if (m_stopFlag) return;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
     }
     const std::lock_guard<std::mutex> lock(m_recieve_mutex);
     BufferPack obj;
@@ -197,7 +207,9 @@ auto CDACAsioNetController::sendBuffer(uint8_t *buffer_ch1,size_t size_ch1,uint8
     if (m_asionet->isConnected()){
         size_t size = 0;
         auto buf = BuildPack(m_index++,buffer_ch1,size_ch1,buffer_ch2,size_ch2,size);
-        return m_asionet->sendData(false,buf,size);
+        auto ret = m_asionet->sendData(false,buf,size);
+        delete[] buf;
+        return ret;
     }
     return false;
 }
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cstring>
+#include "DACJitterBuffer.h"
+#include "neon_asm.h"
+
+CDACJitterBuffer::CDACJitterBuffer(size_t _blockSize, size_t _maxBlocks, size_t _prefillBlocks):
+    m_blockSize(_blockSize),
+    m_maxBytes(_blockSize * _maxBlocks),
+    m_prefillBytes(_blockSize * std::min(_prefillBlocks, _maxBlocks)),
+    m_frontOffset(0),
+    m_playing(false),
+    m_draining(false),
+    m_hasIndex(false),
+    m_lastIndex(0),
+    m_stats(),
+    m_mtx(),
+    m_packs()
+{
+}
+
+CDACJitterBuffer::~CDACJitterBuffer(){
+    reset();
+}
+
+auto CDACJitterBuffer::packLength(const CDACAsioNetController::BufferPack &_pack) -> size_t{
+    return std::max(_pack.size_ch1, _pack.size_ch2);
+}
+
+auto CDACJitterBuffer::freePack(CDACAsioNetController::BufferPack &_pack) -> void{
+    delete[] _pack.ch1;
+    delete[] _pack.ch2;
+    _pack.ch1 = nullptr;
+    _pack.ch2 = nullptr;
+}
+
+auto CDACJitterBuffer::push(CDACAsioNetController::BufferPack &_pack) -> bool{
+    const std::lock_guard<std::mutex> lock(m_mtx);
+    if (_pack.empty) return true;
+
+    // The sender numbers its packs from zero on each connection
+    if (_pack.index == 0){
+        m_hasIndex = false;
+    }
+
+    if (m_hasIndex && _pack.index <= m_lastIndex){
+        m_stats.late++;
+        freePack(_pack);
+        return true;
+    }
+
+    if (m_stats.level >= m_maxBytes) return false;
+
+    if (m_hasIndex && _pack.index > m_lastIndex + 1){
+        m_stats.lost += _pack.index - m_lastIndex - 1;
+    }
+    m_hasIndex = true;
+    m_lastIndex = _pack.index;
+
+    auto len = packLength(_pack);
+    if (len == 0){
+        freePack(_pack);
+        return true;
+    }
+    m_packs.push_back(_pack);
+    m_stats.level += len;
+    m_draining = false;
+    return true;
+}
+
+auto CDACJitterBuffer::isFull() -> bool{
+    const std::lock_guard<std::mutex> lock(m_mtx);
+    return m_stats.level >= m_maxBytes;
+}
+
+auto CDACJitterBuffer::isReady() -> bool{
+    const std::lock_guard<std::mutex> lock(m_mtx);
+    return m_stats.level > 0 && (m_playing || m_draining || m_stats.level >= m_prefillBytes);
+}
+
+auto CDACJitterBuffer::isEmpty() -> bool{
+    const std::lock_guard<std::mutex> lock(m_mtx);
+    return m_stats.level == 0;
+}
+
+auto CDACJitterBuffer::drain() -> void{
+    const std::lock_guard<std::mutex> lock(m_mtx);
+    m_draining = true;
+}
+
+auto CDACJitterBuffer::copyChannel(uint8_t *_dst, const uint8_t *_src, size_t _srcSize, size_t _offset, size_t _size) -> void{
+    if (!_dst) return;
+    size_t n = 0;
+    if (_src && _offset < _srcSize){
+        n = std::min(_size, _srcSize - _offset);
+        memcpy_neon(_dst, _src + _offset, n);
+    }
+    if (n < _size){
+        memset(_dst + n, 0, _size - n);
+    }
+}
+
+auto CDACJitterBuffer::pop(uint8_t *_ch1, uint8_t *_ch2) -> bool{
+    const std::lock_guard<std::mutex> lock(m_mtx);
+    if (!m_playing && (m_stats.level >= m_prefillBytes || (m_draining && m_stats.level > 0))){
+        m_playing = true;
+    }
+
+    size_t filled = 0;
+    while (m_playing && filled < m_blockSize && !m_packs.empty()){
+        auto &pack = m_packs.front();
+        size_t n = std::min(packLength(pack) - m_frontOffset, m_blockSize - filled);
+        copyChannel(_ch1 ? _ch1 + filled : nullptr, pack.ch1, pack.size_ch1, m_frontOffset, n);
+        copyChannel(_ch2 ? _ch2 + filled : nullptr, pack.ch2, pack.size_ch2, m_frontOffset, n);
+        filled += n;
+        m_frontOffset += n;
+        m_stats.level -= n;
+        if (m_frontOffset == packLength(pack)){
+            freePack(pack);
+            m_packs.pop_front();
+            m_frontOffset = 0;
+        }
+    }
+
+    if (filled < m_blockSize){
+        if (_ch1) memset(_ch1 + filled, 0, m_blockSize - filled);
+        if (_ch2) memset(_ch2 + filled, 0, m_blockSize - filled);
+    }
+    m_stats.blocks++;
+    if (filled == m_blockSize) return true;
+
+    // The tail of a finished source is not an underrun
+    if (!(m_draining && filled > 0)){
+        m_stats.underruns++;
+    }
+    // Wait for the prefill level again before resuming
+    m_playing = false;
+    return false;
+}
+
+auto CDACJitterBuffer::getStats() -> Stats{
+    const std::lock_guard<std::mutex> lock(m_mtx);
+    return m_stats;
+}
+
+auto CDACJitterBuffer::reset() -> void{
+    const std::lock_guard<std::mutex> lock(m_mtx);
+    for (auto &pack : m_packs) {
+        freePack(pack);
+    }
+    m_packs.clear();
+    m_frontOffset = 0;
+    m_playing = false;
+    m_draining = false;
+    m_hasIndex = false;
+    m_lastIndex = 0;
+    m_stats = Stats();
+}
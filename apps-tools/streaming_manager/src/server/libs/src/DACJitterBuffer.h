@@ -0,0 +1,69 @@
+#ifndef STREAMING_ROOT_DACJITTERBUFFER_H
+#define STREAMING_ROOT_DACJITTERBUFFER_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include "DACAsioNetController.h"
+
+// Bounded queue between the buffer source (network or local file) and the
+// generator DMA. Incoming packs may have any size, the generator is always
+// fed whole blocks of _blockSize bytes per channel.
+//
+// Playback starts (and restarts after an underrun) only when _prefillBlocks
+// blocks are queued, so short stalls of the source do not reach the DAC.
+// A block that cannot be filled is completed with zeros and counted as an
+// underrun. Packs with an index at or below the last accepted one arrived
+// too late to be played in order and are dropped.
+class CDACJitterBuffer
+{
+public:
+    struct Stats{
+        uint64_t blocks = 0;        // blocks handed to the generator
+        uint64_t underruns = 0;     // blocks completed with silence
+        uint64_t late = 0;          // packs dropped as out of order
+        uint64_t lost = 0;          // packs missing in the index sequence
+        size_t   level = 0;         // bytes per channel waiting
+    };
+
+    CDACJitterBuffer(size_t _blockSize, size_t _maxBlocks, size_t _prefillBlocks);
+    ~CDACJitterBuffer();
+
+    CDACJitterBuffer(const CDACJitterBuffer&) = delete;
+    CDACJitterBuffer& operator=(const CDACJitterBuffer&) = delete;
+
+    // Takes ownership of the pack buffers. Returns false if the buffer is full,
+    // the pack is then left to the caller.
+    auto push(CDACAsioNetController::BufferPack &_pack) -> bool;
+    auto isFull() -> bool;
+    // True when enough data is queued to (re)start playback
+    auto isReady() -> bool;
+    auto isEmpty() -> bool;
+    // Fills one block per channel. Returns false on underrun, the missing part
+    // is zeros then. Null channel pointers are skipped.
+    auto pop(uint8_t *_ch1, uint8_t *_ch2) -> bool;
+    // Stops waiting for the prefill, used when the source has ended
+    auto drain() -> void;
+    auto getStats() -> Stats;
+    auto getBlockSize() -> size_t { return m_blockSize; }
+    auto reset() -> void;
+
+private:
+    auto packLength(const CDACAsioNetController::BufferPack &_pack) -> size_t;
+    auto copyChannel(uint8_t *_dst, const uint8_t *_src, size_t _srcSize, size_t _offset, size_t _size) -> void;
+    auto freePack(CDACAsioNetController::BufferPack &_pack) -> void;
+
+    size_t     m_blockSize;
+    size_t     m_maxBytes;
+    size_t     m_prefillBytes;
+    size_t     m_frontOffset;
+    bool       m_playing;
+    bool       m_draining;
+    bool       m_hasIndex;
+    uint64_t   m_lastIndex;
+    Stats      m_stats;
+    std::mutex m_mtx;
+    std::deque<CDACAsioNetController::BufferPack> m_packs;
+};
+
+#endif //STREAMING_ROOT_DACJITTERBUFFER_H
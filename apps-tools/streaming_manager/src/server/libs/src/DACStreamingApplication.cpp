@@ -3,14 +3,26 @@
 #include <fstream>
 #include <functional>
 #include <cstdlib>
+#include <algorithm>
 #include "DACStreamingApplication.h"
 #include "AsioNet.h"
 
 #define UNUSED(x) [&x]{}()
 
+// Blocks of dac_buf_size bytes per channel held in the jitter buffer
+#define JITTER_BUFFER_BLOCKS 16
+// Blocks queued before playback starts or resumes after an underrun
+#define JITTER_PREFILL_BLOCKS 4
+// Sleep while neither the source nor the DMA needs attention
+#define POLL_INTERVAL_US 50
+#define STATS_PERIOD_MS 5000
+
 CDACStreamingApplication::CDACStreamingApplication(CDACStreamingManager::Ptr _streamingManager,CGenerator::Ptr _gen) :
     m_gen(_gen),
     m_streamingManager(_streamingManager),
+    m_jitterBuffer(dac_buf_size, JITTER_BUFFER_BLOCKS, JITTER_PREFILL_BLOCKS),
+    m_block_ch1(dac_buf_size),
+    m_block_ch2(dac_buf_size),
     m_Thread(),
     mtx(),
     m_ReadyToPass(0),
@@ -72,55 +84,106 @@ auto CDACStreamingApplication::stop(bool wait) -> bool{
     return state;
 }
 
+void CDACStreamingApplication::fillSource()
+{
+    while (!m_jitterBuffer.isFull()){
+        auto pack = m_streamingManager->getBuffer();
+        if (pack.empty) break;
+        if (!m_jitterBuffer.push(pack)){
+            delete[] pack.ch1;
+            delete[] pack.ch2;
+        }
+    }
+}
+
+void CDACStreamingApplication::printStats(const CDACJitterBuffer::Stats &_prev)
+{
+    auto stats = m_jitterBuffer.getStats();
+    std::cout << "DAC streaming: blocks " << stats.blocks - _prev.blocks
+              << " underruns " << stats.underruns - _prev.underruns
+              << " late " << stats.late - _prev.late
+              << " lost " << stats.lost - _prev.lost
+              << " buffered " << stats.level / dac_buf_size << " blocks\n";
+}
+
 void CDACStreamingApplication::genWorker()
 {
-       
-    auto timeNow = std::chrono::system_clock::now();
-    auto curTime = std::chrono::time_point_cast<std::chrono::milliseconds >(timeNow);
-    auto value = curTime.time_since_epoch();
-
-    long long int timeBegin = value.count();
-    uintmax_t counter = 0;
-    uintmax_t passCounter = 0;
-    uint8_t   skipBuffs = 0;
+    auto timeBegin = std::chrono::steady_clock::now();
+    CDACJitterBuffer::Stats prevStats;
+    bool started = false;
+    bool finished = false;
+
+    m_jitterBuffer.reset();
     m_gen->prepare();
 try{
     while (m_GenThreadRun.test_and_set())
     {
+        bool idle = true;
+
+        fillSource();
 
-        // oscNotify(overFlow, m_oscRate, m_adc_mode, m_adc_bits, m_WriteBuffer_ch1, m_size_ch1, m_WriteBuffer_ch2, m_size_ch2);
-        // ++counter;
-
-        // timeNow = std::chrono::system_clock::now();
-        // curTime = std::chrono::time_point_cast<std::chrono::milliseconds >(timeNow);
-        // value = curTime.time_since_epoch();
-
-          
-        // if ((value.count() - timeBegin) >= 5000) {
-        //     std::cout << "Lost samples: " << m_lostRate  << "\n";
-        //     counter = 0;
-        //     m_lostRate = 0;
-        //     passCounter = 0;
-        //     timeBegin = value.count();
-        // }
-
-        // if (!m_StreamingManager->isFileThreadWork()){
-            
-        //     if (m_StreamingManager->notifyStop){
-        //         if (m_StreamingManager->isOutOfSpace())
-        //             m_StreamingManager->notifyStop(0);
-        //         else 
-        //             m_StreamingManager->notifyStop(1);
-        //         m_StreamingManager->notifyStop = nullptr;                
-        //     }
-        // }
+        if (m_streamingManager->isEndOfStream()){
+            if (m_jitterBuffer.isEmpty()){
+                finished = true;
+                break;
+            }
+            // Play out the tail without waiting for the prefill level
+            m_jitterBuffer.drain();
+        }
+
+        if (!started){
+            // Both DMA halves are loaded before the generator is started
+            if (m_jitterBuffer.isReady()){
+                m_jitterBuffer.pop(m_block_ch1.data(), m_block_ch2.data());
+                m_gen->initFirst(m_block_ch1.data(), m_block_ch2.data(), dac_buf_size);
+                m_jitterBuffer.pop(m_block_ch1.data(), m_block_ch2.data());
+                m_gen->initSecond(m_block_ch1.data(), m_block_ch2.data(), dac_buf_size);
+                m_gen->start();
+                started = true;
+                idle = false;
+            }
+        } else if (m_gen->needData()){
+            // The DMA is done with one half, refill it from the jitter buffer
+            m_jitterBuffer.pop(m_block_ch1.data(), m_block_ch2.data());
+            m_gen->write(m_block_ch1.data(), m_block_ch2.data(), dac_buf_size);
+            idle = false;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - timeBegin >= std::chrono::milliseconds(STATS_PERIOD_MS)) {
+            printStats(prevStats);
+            prevStats = m_jitterBuffer.getStats();
+            timeBegin = now;
+        }
+
+        if (idle){
+            std::this_thread::sleep_for(std::chrono::microseconds(POLL_INTERVAL_US));
+        }
     }
-    
+
+    if (finished && started){
+        // End in silence instead of repeating the last two halves
+        std::fill(m_block_ch1.begin(), m_block_ch1.end(), 0);
+        std::fill(m_block_ch2.begin(), m_block_ch2.end(), 0);
+        for (int half = 0; half < 2 && m_GenThreadRun.test_and_set();){
+            if (m_gen->needData()){
+                m_gen->write(m_block_ch1.data(), m_block_ch2.data(), dac_buf_size);
+                half++;
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(POLL_INTERVAL_US));
+            }
+        }
+    }
+    printStats(CDACJitterBuffer::Stats());
 }catch (std::exception& e)
 	{
-		std::cerr << "Error: oscWorker() " << e.what() << std::endl ;
+		std::cerr << "Error: genWorker() " << e.what() << std::endl ;
 	}
     m_isRun = false;
+    if (finished && m_streamingManager->notifyStop){
+        m_streamingManager->notifyStop(0);
+        m_streamingManager->notifyStop = nullptr;
+    }
 }
 
 void CDACStreamingApplication::signalHandler(const asio::error_code &_error, int _signalNumber)
@@ -9,6 +9,7 @@
 
 #include <Generator.h>
 #include <DACStreamingManager.h>
+#include <DACJitterBuffer.h>
 
 
 class CDACStreamingApplication
@@ -21,12 +22,16 @@ public:
     auto runNonBlock() -> void;
     auto stop(bool wait) -> bool;
     auto isRun() -> bool {return m_isRun;}
+    auto getStats() -> CDACJitterBuffer::Stats {return m_jitterBuffer.getStats();}
 
 private:
     int m_PerformanceCounterPeriod = 10;
 
     CGenerator::Ptr m_gen;
     CDACStreamingManager::Ptr m_streamingManager;
+    CDACJitterBuffer m_jitterBuffer;
+    std::vector<uint8_t> m_block_ch1;
+    std::vector<uint8_t> m_block_ch2;
     std::thread m_Thread;
     std::mutex mtx;
     std::atomic_flag m_GenThreadRun = ATOMIC_FLAG_INIT;
@@ -36,5 +41,7 @@ private:
     static_assert(ATOMIC_INT_LOCK_FREE == 2,"this implementation does not guarantee that std::atomic<int> is always lock free.");
 
     void genWorker();
+    void fillSource();
+    void printStats(const CDACJitterBuffer::Stats &_prev);
     void signalHandler(const asio::error_code &_error, int _signalNumber);
 };
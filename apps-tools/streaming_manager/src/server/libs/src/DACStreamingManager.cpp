@@ -4,12 +4,56 @@
 #include <time.h>
 #include <functional>
 #include <cstdlib>
+#include <cmath>
 #include "DACStreamingManager.h"
+#include "wavReader.h"
+#include "common/TDMS/File.h"
 
 
 
 #define UNUSED(x) [&x]{}()
 
+// Buffers read ahead from the local file, dac_buf_size bytes per channel each
+#define FILE_BUFFERS_LIMIT 10
+// 14-bit DAC, 1 V full scale
+#define DAC_FULL_SCALE 8191
+
+namespace {
+    // Converts a block of file samples to DAC counts. In RAW mode the file holds
+    // DAC counts, in VOLT mode floats are volts and integers use their full range.
+    static auto convertSamples(TDMS::TDMSType _type, const uint8_t *_data, size_t _bytes, CDACStreamingManager::DACMode _mode, std::vector<int16_t> &_out) -> bool{
+        bool volt = _mode == CDACStreamingManager::DACMode::VOLT;
+        switch (_type) {
+            case TDMS::TDMSType::Integer8:{
+                auto d = reinterpret_cast<const int8_t*>(_data);
+                for (size_t i = 0; i < _bytes; i++)
+                    _out.push_back(volt ? d[i] * 64 : d[i]);
+                return true;
+            }
+            case TDMS::TDMSType::Integer16:{
+                auto d = reinterpret_cast<const int16_t*>(_data);
+                for (size_t i = 0; i < _bytes / 2; i++)
+                    _out.push_back(volt ? d[i] / 4 : d[i]);
+                return true;
+            }
+            case TDMS::TDMSType::SingleFloat:
+            case TDMS::TDMSType::DoubleFloat:{
+                bool single = _type == TDMS::TDMSType::SingleFloat;
+                size_t count = _bytes / (single ? sizeof(float) : sizeof(double));
+                for (size_t i = 0; i < count; i++){
+                    double v = single ? reinterpret_cast<const float*>(_data)[i] : reinterpret_cast<const double*>(_data)[i];
+                    if (volt) v *= DAC_FULL_SCALE;
+                    v = std::max(std::min(std::round(v), (double)DAC_FULL_SCALE), (double)-DAC_FULL_SCALE - 1);
+                    _out.push_back((int16_t)v);
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+}
+
 CDACStreamingManager::Ptr CDACStreamingManager::Create(DACStream_FileType _fileType, std::string _filePath, DACMode _mode){
 
     return std::make_shared<CDACStreamingManager>(_fileType, _filePath, _mode);
@@ -23,10 +67,16 @@ CDACStreamingManager::CDACStreamingManager(DACStream_FileType _fileType, std::st
     m_port(""),
     m_filePath(_filePath),
     m_asionet(nullptr),
-    m_mode(_mode)
-{   
-    if (m_use_local_file){
-    }
+    m_mode(_mode),
+    m_fileThread(),
+    m_fileThreadRun(false),
+    m_fileEnd(false),
+    m_repeatInf(false),
+    m_fileMutex(),
+    m_fileCond(),
+    m_fileBuffers(),
+    m_fileIndex(0)
+{
 }
 
 CDACStreamingManager::Ptr CDACStreamingManager::Create(std::string _host,std::string _port){
@@ -41,7 +91,15 @@ CDACStreamingManager::CDACStreamingManager(std::string _host, std::string _port)
     m_port(_port),
     m_filePath(""),
     m_asionet(nullptr),
-    m_mode(DACMode::RAW)
+    m_mode(DACMode::RAW),
+    m_fileThread(),
+    m_fileThreadRun(false),
+    m_fileEnd(false),
+    m_repeatInf(false),
+    m_fileMutex(),
+    m_fileCond(),
+    m_fileBuffers(),
+    m_fileIndex(0)
 {
 }
 
@@ -73,9 +131,153 @@ auto CDACStreamingManager::stopServer() -> void {
     }
 }
 
+auto CDACStreamingManager::startFileReader() -> void{
+    stopFileReader();
+    m_fileIndex = 0;
+    m_fileEnd = false;
+    m_fileThreadRun = true;
+    m_fileThread = std::thread(&CDACStreamingManager::fileReader, this);
+}
+
+auto CDACStreamingManager::stopFileReader() -> void{
+    {
+        const std::lock_guard<std::mutex> lock(m_fileMutex);
+        m_fileThreadRun = false;
+    }
+    m_fileCond.notify_all();
+    if (m_fileThread.joinable()){
+        m_fileThread.join();
+    }
+    const std::lock_guard<std::mutex> lock(m_fileMutex);
+    for (auto &obj : m_fileBuffers) {
+        delete[] obj.ch1;
+        delete[] obj.ch2;
+    }
+    m_fileBuffers.clear();
+}
+
+auto CDACStreamingManager::fileReader() -> void{
+    try{
+        bool ok = true;
+        do{
+            auto index = m_fileIndex;
+            ok = m_fileType == WAV_TYPE ? readWav() : readTdms();
+            // Nothing to repeat in an empty file
+            if (m_fileIndex == index) ok = false;
+        }while(ok && m_repeatInf && m_fileThreadRun);
+    }catch (std::exception& e){
+        std::cerr << "Error: CDACStreamingManager::fileReader() " << e.what() << std::endl;
+    }
+    m_fileEnd = true;
+}
+
+// Takes ownership of the buffers
+auto CDACStreamingManager::pushFileBuffer(uint8_t *_ch1, size_t _size_ch1, uint8_t *_ch2, size_t _size_ch2) -> bool{
+    std::unique_lock<std::mutex> lock(m_fileMutex);
+    m_fileCond.wait(lock, [this]{ return m_fileBuffers.size() < FILE_BUFFERS_LIMIT || !m_fileThreadRun; });
+    if (!m_fileThreadRun){
+        delete[] _ch1;
+        delete[] _ch2;
+        return false;
+    }
+    CDACAsioNetController::BufferPack pack;
+    pack.ch1 = _ch1;
+    pack.ch2 = _ch2;
+    pack.size_ch1 = _size_ch1;
+    pack.size_ch2 = _size_ch2;
+    pack.index = m_fileIndex++;
+    pack.empty = false;
+    m_fileBuffers.push_back(pack);
+    return true;
+}
+
+auto CDACStreamingManager::readWav() -> bool{
+    CWaveReader reader;
+    if (!reader.openFile(m_filePath)) return false;
+    while (m_fileThreadRun){
+        uint8_t *ch1 = nullptr;
+        uint8_t *ch2 = nullptr;
+        size_t size_ch1 = 0, size_ch2 = 0;
+        if (!reader.getBuffers(&ch1, &size_ch1, &ch2, &size_ch2)){
+            std::cerr << "Error: unsupported WAV format, 16 bit PCM is needed" << std::endl;
+            delete[] ch1;
+            delete[] ch2;
+            return false;
+        }
+        if (size_ch1 == 0 && size_ch2 == 0){
+            delete[] ch1;
+            delete[] ch2;
+            break;
+        }
+        // PCM full scale to the DAC range
+        if (m_mode == VOLT){
+            for (size_t i = 0; ch1 && i < size_ch1 / 2; i++) ((int16_t*)ch1)[i] /= 4;
+            for (size_t i = 0; ch2 && i < size_ch2 / 2; i++) ((int16_t*)ch2)[i] /= 4;
+        }
+        if (!pushFileBuffer(ch1, size_ch1, ch2, size_ch2)) return false;
+    }
+    return m_fileThreadRun;
+}
+
+auto CDACStreamingManager::readTdms() -> bool{
+    TDMS::File file;
+    auto segments = file.ReadFileWithoutClose(m_filePath);
+    if (segments.size() == 0){
+        file.Close();
+        return false;
+    }
+
+    const size_t block = dac_buf_size / sizeof(int16_t);
+    std::vector<int16_t> pending[2];
+    bool present[2] = {false, false};
+
+    auto flush = [&](bool _all) -> bool{
+        while ((present[0] || present[1]) &&
+               (!present[0] || pending[0].size() >= block || (_all && pending[0].size() > 0)) &&
+               (!present[1] || pending[1].size() >= block || (_all && pending[1].size() > 0))){
+            uint8_t *ch[2] = {nullptr, nullptr};
+            size_t size[2] = {0, 0};
+            for (int c = 0; c < 2; c++){
+                if (!present[c]) continue;
+                size_t n = std::min(block, pending[c].size());
+                ch[c] = new uint8_t[n * sizeof(int16_t)];
+                memcpy(ch[c], pending[c].data(), n * sizeof(int16_t));
+                size[c] = n * sizeof(int16_t);
+                pending[c].erase(pending[c].begin(), pending[c].begin() + n);
+            }
+            if (!pushFileBuffer(ch[0], size[0], ch[1], size[1])) return false;
+            if ((!present[0] || pending[0].empty()) && (!present[1] || pending[1].empty())) break;
+        }
+        return true;
+    };
+
+    bool ok = true;
+    for (auto &seg : segments){
+        if (!m_fileThreadRun) { ok = false; break; }
+        auto metadata = file.GetMetadata(seg);
+        for (auto &meta : metadata){
+            if (meta->Path.size() < 2 || meta->RawData.Count == 0 || meta->RawData.IsInterleaved) continue;
+            int c = meta->Path[1] == "'ch1'" ? 0 : (meta->Path[1] == "'ch2'" ? 1 : -1);
+            if (c < 0) continue;
+            for (auto &raw : meta->RawData.DataType.GetRawVector()){
+                if (!convertSamples(raw->dataType, raw->data, raw->size, m_mode, pending[c])){
+                    std::cerr << "Error: unsupported TDMS data type in " << m_filePath << std::endl;
+                    file.Close();
+                    return false;
+                }
+                present[c] = true;
+            }
+        }
+        if (!flush(false)) { ok = false; break; }
+    }
+    if (ok) ok = flush(true);
+    file.Close();
+    return ok && m_fileThreadRun;
+}
+
 auto CDACStreamingManager::run() -> void {
     if (m_use_local_file){
-        
+        this->startFileReader();
     }
     else
         this->startServer();
@@ -83,14 +285,33 @@ auto CDACStreamingManager::run() -> void {
 
 auto CDACStreamingManager::stop() -> void {
     if (m_use_local_file){
-        
+        this->stopFileReader();
     } else{
         this->stopServer();
     }
 }
 
+auto CDACStreamingManager::setRepeatInf(bool _inf) -> void{
+    m_repeatInf = _inf;
+}
+
+auto CDACStreamingManager::isEndOfStream() -> bool{
+    if (!m_use_local_file) return false;
+    const std::lock_guard<std::mutex> lock(m_fileMutex);
+    return m_fileEnd && m_fileBuffers.empty();
+}
+
 auto CDACStreamingManager::getBuffer() -> const CDACAsioNetController::BufferPack {
     if (m_use_local_file){
+        CDACAsioNetController::BufferPack pack;
+        {
+            const std::lock_guard<std::mutex> lock(m_fileMutex);
+            if (m_fileBuffers.empty()) return pack;
+            pack = m_fileBuffers.front();
+            m_fileBuffers.pop_front();
+        }
+        m_fileCond.notify_all();
+        return pack;
     } else{
         if (m_asionet)
             return m_asionet->getBuffer();
@@ -7,6 +7,7 @@
 #include <thread>
 #include <vector>
 #include <string>
+#include <deque>
 #include <asio.hpp>
 #include "Generator.h"
 #include "DACAsioNetController.h"
@@ -48,8 +49,14 @@ class CDACStreamingManager
         auto run() -> void;
         auto stop() -> void;
         auto isLocalMode() -> bool;
+        // Buffers must be freed by the caller (delete[] ch1, ch2)
         auto getBuffer() -> const CDACAsioNetController::BufferPack;
+        // Plays the local file in a loop
+        auto setRepeatInf(bool _inf) -> void;
+        // Local mode: the whole file was read and handed out
+        auto isEndOfStream() -> bool;
 
+        // Called with 0 when the local file playback is finished
         CDACStreamingManager::Callback notifyStop;
         
 private:
@@ -60,9 +67,24 @@ private:
            std::string m_filePath;
               DACAsio *m_asionet;
               DACMode  m_mode;
-    
+
+           std::thread m_fileThread;
+      std::atomic_bool m_fileThreadRun;
+      std::atomic_bool m_fileEnd;
+      std::atomic_bool m_repeatInf;
+            std::mutex m_fileMutex;
+std::condition_variable m_fileCond;
+std::deque<CDACAsioNetController::BufferPack> m_fileBuffers;
+              uint64_t m_fileIndex;
+
         auto startServer() -> void;
         auto stopServer() -> void;
+        auto startFileReader() -> void;
+        auto stopFileReader() -> void;
+        auto fileReader() -> void;
+        auto readWav() -> bool;
+        auto readTdms() -> bool;
+        auto pushFileBuffer(uint8_t *_ch1, size_t _size_ch1, uint8_t *_ch2, size_t _size_ch2) -> bool;
 };
 
 #endif
\ No newline at end of file
@@ -22,7 +22,11 @@ m_reciveData(0),
 m_reciveData_ch1(0),
 m_reciveData_ch2(0),
 m_old_id(0),
-m_current_sample(0)
+m_current_sample(0),
+m_poolHits(0),
+m_poolMisses(0),
+m_poolHighWater(0),
+m_poolSlots(0)
 {
     ResetCounters();
     m_file_open = true;
@@ -109,6 +113,13 @@ void CFileLogger::AddMetric(uint64_t _samples_data,uint64_t _lost){
     }
 }
 
+void CFileLogger::SetBufferPoolStats(uint64_t _hits,uint64_t _misses,uint32_t _highWater,uint32_t _slots){
+    const std::lock_guard<std::mutex> lock(m_mtx);
+    m_poolHits = _hits;
+    m_poolMisses = _misses;
+    m_poolHighWater = _highWater;
+    m_poolSlots = _slots;
+}
 
 void CFileLogger::DumpToFile(){
     const std::lock_guard<std::mutex> lock(m_mtx);    
@@ -150,6 +161,11 @@ void CFileLogger::DumpToFile(){
         log << "\t-" << m_reciveData_ch2 << "b \n";
         log << "\t-" << m_reciveData_ch2 / 1024 << "kb \n";
         log << "\t-" << m_reciveData_ch2 / (1024 * 1024) << "Mb \n";
+        log << "\n";
+        log << "Buffer pool usage:\n";
+        log << "\t-hits:\t" << m_poolHits << "\n";
+        log << "\t-misses (heap allocations):\t" << m_poolMisses << "\n";
+        log << "\t-high water:\t" << m_poolHighWater << " of " << m_poolSlots << " slots\n";
     }
     catch (std::exception& e)
 	{
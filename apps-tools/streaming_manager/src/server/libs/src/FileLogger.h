@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <fstream>
 #include <memory>
 #include <mutex>
 
@@ -25,6 +26,7 @@ public:
     void AddMetric(CFileLogger::Metric _metric, uint64_t _value);
     void AddMetricId(uint64_t _id);
     void AddMetric(uint64_t _samples_data,uint64_t _lost);
+    void SetBufferPoolStats(uint64_t _hits,uint64_t _misses,uint32_t _highWater,uint32_t _slots);
 
     void DumpToFile();
 
@@ -46,5 +48,9 @@ private:
     uint64_t    m_reciveData_ch2;
     uint64_t    m_old_id;
     uint64_t    m_current_sample;
+    uint64_t    m_poolHits;
+    uint64_t    m_poolMisses;
+    uint32_t    m_poolHighWater;
+    uint32_t    m_poolSlots;
     std::ofstream m_fileLost;
 };
\ No newline at end of file
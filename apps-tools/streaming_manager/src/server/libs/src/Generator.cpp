@@ -244,6 +244,18 @@ auto CGenerator::write(uint8_t *_buffer1,uint8_t *_buffer2, size_t _size) -> boo
     return ret;
 }
 
+auto CGenerator::needData() -> bool
+{
+    const std::lock_guard<std::mutex> lock(m_waitLock);
+    bool chA = m_Map->chA_dma_status & (m_BufferNumber[0] == 0 ? 0x3 : 0xC);
+    bool chB = m_Map->chB_dma_status & (m_BufferNumber[1] == 0 ? 0x1 : 0x4);
+    if (m_Channel1 && m_Channel2){
+        // write() fills both channels at once, so both halves must be free
+        // or the channels drift apart
+        return chA && chB;
+    }
+    return m_Channel2 ? chB : chA;
+}
 
 auto CGenerator::start() -> void{
     const std::lock_guard<std::mutex> lock(m_waitLock);
@@ -50,6 +50,9 @@ public:
     auto initSecond(uint8_t *_buffer1,uint8_t *_buffer2, size_t _size) -> bool;
     
     auto write(uint8_t *_buffer1,uint8_t *_buffer2, size_t _size) -> bool;
+    // True when the DMA is done with the half that write() fills next
+    // on every enabled channel
+    auto needData() -> bool;
     auto setCalibration(int32_t ch1_offset,float ch1_gain, int32_t ch2_offset, float ch2_gain) -> void;
     // bool clearBuffer();
     // bool wait();
@@ -19,6 +19,8 @@ ServerNetConfigManager::ServerNetConfigManager(std::string defualt_file_settings
     m_pNetConfManager->addHandlerError(std::bind(&ServerNetConfigManager::serverError, this, std::placeholders::_1));
     startServer(host,port);
     readFromFile(defualt_file_settings_path);
+    // Only a client can enable compression, older clients cannot decode it
+    setCompression(false);
 }
 
 ServerNetConfigManager::~ServerNetConfigManager(){
@@ -78,6 +80,8 @@ auto ServerNetConfigManager::receiveCommand(uint32_t command) -> void{
     if (c == CNetConfigManager::Commands::BEGIN_SEND_SETTING){
         m_currentState = States::GET_DATA;
         reset();
+        // Stays off unless the new settings carry the key
+        setCompression(false);
     }
     if (c == CNetConfigManager::Commands::END_SEND_SETTING){
         m_currentState = States::NORMAL;
@@ -86,6 +90,7 @@ auto ServerNetConfigManager::receiveCommand(uint32_t command) -> void{
             m_pNetConfManager->sendData(CNetConfigManager::Commands::SETTING_GET_SUCCES);
         }else{
             reset();
+            setCompression(false);
             m_pNetConfManager->sendData(CNetConfigManager::Commands::SETTING_GET_FAIL);
         }
     }
@@ -100,6 +105,7 @@ auto ServerNetConfigManager::receiveCommand(uint32_t command) -> void{
 
     if (c == CNetConfigManager::Commands::LOAD_SETTING_FROM_FILE){
         if (readFromFile(m_file_settings)){
+            setCompression(false);
             m_callbacks.emitEvent(static_cast<int>(Events::GET_NEW_SETTING));
             m_pNetConfManager->sendData(CNetConfigManager::Commands::LOAD_FROM_FILE_SUCCES);
         }else{
@@ -151,6 +157,7 @@ auto ServerNetConfigManager::serverError(std::error_code error) -> void{
     m_errorCallback.emitEvent(0,Errors::SERVER_INTERNAL);
     if (m_currentState == States::GET_DATA){
         reset();
+        setCompression(false);
         m_currentState = States::NORMAL;
         m_errorCallback.emitEvent(0,Errors::BREAK_RECEIVE_SETTINGS);
     }
@@ -195,6 +202,9 @@ auto ServerNetConfigManager::sendConfig(bool _async) -> bool{
         if (!m_pNetConfManager->sendData("attenuator",static_cast<uint32_t>(getAttenuator()),_async)) return false;
         if (!m_pNetConfManager->sendData("calibration",static_cast<uint32_t>(getCalibration()),_async)) return false;
         if (!m_pNetConfManager->sendData("coupling",static_cast<uint32_t>(getAC_DC()),_async)) return false;
+        // Only a client that enabled compression knows the key, older clients reject it
+        if (getCompression())
+            if (!m_pNetConfManager->sendData("compression",static_cast<uint32_t>(getCompression()),_async)) return false;
         if (!m_pNetConfManager->sendData(CNetConfigManager::Commands::END_SEND_SETTING,_async)) return false;
         return true;
     }
@@ -5,6 +5,7 @@
 #include <functional>
 #include <cstdlib>
 #include "StreamingManager.h"
+#include "csv_converter.h"
 
 #ifdef _WIN32
 #include <dir.h>
@@ -91,6 +92,7 @@ CStreamingManager::CStreamingManager(Stream_FileType _fileType,std::string _file
     m_passSizeSamples(0),
     m_volt_mode(_v_mode),
     m_use_local_file(true),
+    m_compression(false),
     m_fileType(_fileType)
 {
     
@@ -100,6 +102,8 @@ CStreamingManager::CStreamingManager(Stream_FileType _fileType,std::string _file
         m_waveWriter = new CWaveWriter();
         memset(m_zeroBuffer,0,sizeof(uint8_t) * ZERO_BUFFER_SIZE);
     }
+    // The largest converted channel is a full DMA half in float format (8 bit -> 32 bit)
+    m_bufferPool = CBufferPool::Create(osc_buf_size * sizeof(float), FILE_POOL_SLOTS);
 }
 
 CStreamingManager::Ptr CStreamingManager::Create(string _host, string _port, asionet::Protocol _protocol){
@@ -124,9 +128,11 @@ CStreamingManager::CStreamingManager(string _host, string _port, asionet::Protoc
         m_samples(0),
         m_passSizeSamples(0),
         m_volt_mode(false),
-        m_use_local_file(false)
+        m_use_local_file(false),
+        m_compression(false)
 {
         m_stopWriteCSV = false;
+        m_bufferPool = CBufferPool::Create(PACK_PREFIX_SIZE + TCP_BUFFER_LIMIT * 2, NET_POOL_SLOTS);
 }
 
 CStreamingManager::~CStreamingManager()
@@ -191,6 +197,8 @@ void CStreamingManager::stopServer(){
         m_asionet->Stop();
         delete m_asionet;
         m_asionet = nullptr;
+        auto stats = getBufferPoolStats();
+        std::cout << "Buffer pool: hits " << stats.hits << " misses " << stats.misses << " high water " << stats.highWater << "/" << stats.slots << '\n';
     }
 }
 
@@ -235,8 +243,61 @@ void CStreamingManager::stop(){
     } else{
         this->stopServer();
     }
-    if (m_fileLogger)
+    if (m_fileLogger){
+        auto stats = getBufferPoolStats();
+        m_fileLogger->SetBufferPoolStats(stats.hits, stats.misses, stats.highWater, stats.slots);
         m_fileLogger->DumpToFile();
+    }
+}
+
+// UDP: the buffers go out as packs sized to the path MTU, submitted in batches.
+// Raw packs are gathered from their header and the channel buffers without a copy.
+auto CStreamingManager::sendDatagrams(uint32_t _oscRate, uint32_t _adc_mode, uint32_t _adc_bits, const uint8_t *_ch1, uint32_t _size_ch1, const uint8_t *_ch2, uint32_t _size_ch2, unsigned short _resolution) -> bool{
+    uint32_t buffer_size = MAX(_size_ch1, _size_ch2);
+    uint32_t channels = (_size_ch1 > 0 ? 1 : 0) + (_size_ch2 > 0 ? 1 : 0);
+    if (buffer_size == 0)
+        return true;
+    // Keep every pack on whole 16 bit samples of both channels
+    uint32_t split_size = ((m_asionet->GetMaxDatagramSize() - PACK_PREFIX_SIZE) / channels) & ~3u;
+    split_size = MIN(split_size, buffer_size);
+    size_t count = (buffer_size + split_size - 1) / split_size;
+    size_t stride = PACK_PREFIX_SIZE + (m_compression ? split_size * channels : 0);
+    if (m_datagrams.size() < count)
+        m_datagrams.resize(count);
+    if (m_datagramBuffer.size() < count * stride)
+        m_datagramBuffer.resize(count * stride);
+
+    for (size_t i = 0; i < count; i++){
+        uint32_t offset = i * split_size;
+        uint32_t size = MIN(split_size, buffer_size - offset);
+        uint32_t size_ch1 = _size_ch1 == 0 ? 0 : size;
+        uint32_t size_ch2 = _size_ch2 == 0 ? 0 : size;
+        const uint8_t *ch1 = size_ch1 ? _ch1 + offset : nullptr;
+        const uint8_t *ch2 = size_ch2 ? _ch2 + offset : nullptr;
+        auto pack = m_datagramBuffer.data() + i * stride;
+        auto &datagram = m_datagrams[i];
+        size_t pack_size = 0;
+        if (m_compression && asionet::CAsioNet::BuildCompressedPack(pack, m_index_of_message, 0, _oscRate, _resolution, _adc_mode, _adc_bits, ch1, size_ch1, ch2, size_ch2, pack_size)){
+            datagram = {{pack, nullptr, nullptr}, {pack_size, 0, 0}};
+        }else{
+            asionet::CAsioNet::BuildPackHeader(pack, m_index_of_message, 0, _oscRate, _resolution, _adc_mode, _adc_bits, size_ch1, size_ch2);
+            datagram = {{pack, ch1, ch2}, {PACK_PREFIX_SIZE, size_ch1, size_ch2}};
+        }
+        m_index_of_message++;
+    }
+    return m_asionet->SendDatagrams(m_datagrams.data(), count);
+}
+
+auto CStreamingManager::setCompression(bool _enable) -> void{
+    m_compression = _enable;
+}
+
+auto CStreamingManager::getBufferPool() -> CBufferPool::Ptr{
+    return m_bufferPool;
+}
+
+auto CStreamingManager::getBufferPoolStats() -> CBufferPool::Stats{
+    return m_bufferPool->getStats();
 }
 
 uint8_t * CStreamingManager::convertBuffers(const void *_buffer,uint32_t _buf_size,size_t &_dest_buff_size,uint32_t _lostSize, uint32_t _adc_mode, uint32_t _adc_bits, unsigned short _resolution){
@@ -244,7 +305,7 @@ uint8_t * CStreamingManager::convertBuffers(const void *_buffer,uint32_t _buf_si
     uint8_t *dest = nullptr;
 
     if (!m_volt_mode) {
-        dest = new uint8_t[_buf_size + _lostSize];
+        dest = m_bufferPool->acquire(_buf_size + _lostSize);
         _dest_buff_size = _buf_size + _lostSize;
         memcpy_neon(dest, _buffer, _buf_size);
    
@@ -254,7 +315,7 @@ uint8_t * CStreamingManager::convertBuffers(const void *_buffer,uint32_t _buf_si
         //     exit(1);
     }else{
         uint32_t samples = _buf_size / (_resolution  / 8);
-        float *dest_f = new float[samples + _lostSize / 4];
+        float *dest_f = reinterpret_cast<float*>(m_bufferPool->acquire((samples + _lostSize / 4) * sizeof(float)));
         _dest_buff_size = (samples + _lostSize / 4) * sizeof(float);
         for(uint32_t i = 0 ; i < samples; i++){
             float cnt = (_resolution == 8) ?  ((int8_t*)_buffer)[i]:((int16_t*)_buffer)[i];
@@ -329,6 +390,8 @@ int CStreamingManager::passBuffers(uint64_t _lostRate, uint32_t _oscRate, uint32
                 {
                     m_fileLogger->AddMetric(CFileLogger::Metric::FILESYSTEM_RATE,1);
                 }
+                m_bufferPool->release(buff_ch1);
+                m_bufferPool->release(buff_ch2);
             }
 
 
@@ -351,8 +414,8 @@ int CStreamingManager::passBuffers(uint64_t _lostRate, uint32_t _oscRate, uint32
                         m_fileLogger->AddMetric(CFileLogger::Metric::FILESYSTEM_RATE,1);
                     }
                 }
-                delete [] buff_ch1;
-                delete [] buff_ch2;
+                m_bufferPool->release(buff_ch1);
+                m_bufferPool->release(buff_ch2);
 
                 uint64_t saveLostSize = 0;
                 uint64_t saveSize = (ZERO_BUFFER_SIZE < lostSize ? ZERO_BUFFER_SIZE : lostSize);
@@ -385,8 +448,8 @@ int CStreamingManager::passBuffers(uint64_t _lostRate, uint32_t _oscRate, uint32
                 {
                     m_fileLogger->AddMetric(CFileLogger::Metric::FILESYSTEM_RATE,1);
                 }
-                delete [] buff_ch1;
-                delete [] buff_ch2;
+                m_bufferPool->release(buff_ch1);
+                m_bufferPool->release(buff_ch2);
             }
         }
 
@@ -409,8 +472,7 @@ int CStreamingManager::passBuffers(uint64_t _lostRate, uint32_t _oscRate, uint32
                 int m_ReadyToPass = 0;
                 uint32_t frame_offset = 0;
                 uint32_t buffer_size = MAX(_size_ch1, _size_ch2);
-                uint32_t split_size = (m_asionet->GetProtocol() == asionet::Protocol::TCP ? TCP_BUFFER_LIMIT
-                                                                                          : UDP_BUFFER_LIMIT);        
+                uint32_t split_size = TCP_BUFFER_LIMIT;
 
                 if (split_size > buffer_size) {
                     split_size = buffer_size;
@@ -420,29 +482,50 @@ int CStreamingManager::passBuffers(uint64_t _lostRate, uint32_t _oscRate, uint32
                 buff_ch2 = (uint8_t *) _buffer_ch2;
  
                 size_t new_buff_size = 0;
-                while ((frame_offset + split_size) <= buffer_size) {
-                    if (frame_offset + split_size > buffer_size)
-                        split_size = buffer_size - frame_offset;
+                if (m_asionet->GetProtocol() == asionet::Protocol::UDP) {
+                    if (buffer_size > 0) {
+                        ++m_ReadyToPass;
+                        if (!sendDatagrams(_oscRate, _adc_mode, _adc_bits, buff_ch1, _size_ch1, buff_ch2, _size_ch2, _resolution)) {
+                            m_ReadyToPass--;
+                        }
+                    }
+                } else {
+                    while ((frame_offset + split_size) <= buffer_size) {
+                        if (frame_offset + split_size > buffer_size)
+                            split_size = buffer_size - frame_offset;
 
                     
-                    auto buffer = asionet::CAsioNet::BuildPack(m_index_of_message++, 0, _oscRate,  _resolution, _adc_mode ,_adc_bits,
-                                                                (&*buff_ch1 + frame_offset),
-                                                                (_size_ch1 == 0 ? 0 : split_size),
-                                                                (&*buff_ch2 + frame_offset),
-                                                                (_size_ch2 == 0 ? 0 : split_size),
-                                                                new_buff_size);
-
-                    ++m_ReadyToPass;
+                        auto buffer = m_bufferPool->acquire(PACK_PREFIX_SIZE + (_size_ch1 == 0 ? 0 : split_size) + (_size_ch2 == 0 ? 0 : split_size));
+                        // Frames which do not get smaller are sent raw
+                        if (!m_compression ||
+                            !asionet::CAsioNet::BuildCompressedPack(buffer, m_index_of_message, 0, _oscRate,  _resolution, _adc_mode ,_adc_bits,
+                                                                    (&*buff_ch1 + frame_offset),
+                                                                    (_size_ch1 == 0 ? 0 : split_size),
+                                                                    (&*buff_ch2 + frame_offset),
+                                                                    (_size_ch2 == 0 ? 0 : split_size),
+                                                                    new_buff_size)){
+                            asionet::CAsioNet::BuildPack(buffer, m_index_of_message, 0, _oscRate,  _resolution, _adc_mode ,_adc_bits,
+                                                                    (&*buff_ch1 + frame_offset),
+                                                                    (_size_ch1 == 0 ? 0 : split_size),
+                                                                    (&*buff_ch2 + frame_offset),
+                                                                    (_size_ch2 == 0 ? 0 : split_size),
+                                                                    new_buff_size);
+                        }
+                        m_index_of_message++;
+
+                        ++m_ReadyToPass;
                     
-                    if (!m_asionet->SendData(false, buffer, new_buff_size)) {
-                        m_ReadyToPass--;
+                        if (!m_asionet->SendData(false, buffer, new_buff_size)) {
+                            m_ReadyToPass--;
+                        }
+                        m_bufferPool->release(buffer);
+                        frame_offset += split_size;
                     }
-                    delete buffer;
-                    frame_offset += split_size;
                 }
                  // Send empty pack with lost
                 if (_lostRate>0) {
-                    auto buffer = asionet::CAsioNet::BuildPack(m_index_of_message++, _lostRate, _oscRate,  _resolution, _adc_mode ,_adc_bits,
+                    auto buffer = m_bufferPool->acquire(PACK_PREFIX_SIZE);
+                    asionet::CAsioNet::BuildPack(buffer, m_index_of_message++, _lostRate, _oscRate,  _resolution, _adc_mode ,_adc_bits,
                                                                     nullptr,
                                                                     0,
                                                                     nullptr,
@@ -452,7 +535,7 @@ int CStreamingManager::passBuffers(uint64_t _lostRate, uint32_t _oscRate, uint32
                     if (!m_asionet->SendData(false, buffer, new_buff_size)) {
                         m_ReadyToPass--;
                     }
-                    delete buffer;
+                    m_bufferPool->release(buffer);
                 }
 
                 if (m_ReadyToPass > 0)
@@ -483,71 +566,46 @@ bool CStreamingManager::convertToCSV(std::string _file_name,int32_t start_seg, i
         acout() << _prefix << "Started converting to CSV\n";
         std::string csv_file = _file_name.substr(0, _file_name.size()-3) + "csv";
         acout() << _prefix << csv_file << "\n";
-        std::fstream fs;
-        std::fstream fs_out;
-        fs.open(_file_name, std::ios::binary | std::ofstream::in | std::ofstream::out);
-        fs_out.open(csv_file, std::ofstream::in |  std::ofstream::trunc | std::ofstream::out);
-        if (fs.fail() || fs_out.fail()) {
-            acout() << " Error open files\n";
-            ret = false;
-        }else{
-            fs.seekg(0, std::ios::end);
-            int64_t Length = fs.tellg();
-            int64_t position = 0;
-            int32_t curSegment = 0;
-            int     channels = 0;
-            start_seg = MAX(start_seg,1);
-            while(position >= 0){
-                auto freeSize = FileQueueManager::GetFreeSpaceDisk(csv_file);
-                if (freeSize <= USING_FREE_SPACE){
-                    acout() << _prefix << "\nDisk is full\n";
-                    ret = false;
-                    break;
-                }
-                if (m_stopWriteCSV){
-                    acout() << _prefix << "\nAbort writing to CSV file\n";
-                    ret = false;
-                    break;
-                }
-                curSegment++;
-                bool notSkip = (start_seg <= curSegment) && ((end_seg != -2 && end_seg >= curSegment) || end_seg == -2);
-                auto csv_seg = FileQueueManager::ReadCSV(&fs,&position, &channels, !notSkip);
-                if (end_seg == -2){
-                    if (position >=0) {
-                        acout() << "\r" << _prefix << "PROGRESS: " << (position * 100) / Length  << " %";
-                    }else{
-                        if (position == -2){
-                            acout() << "\r" << _prefix << "PROGRESS: 100 %";
-                        }
-                    }
+        start_seg = MAX(start_seg,1);
+        CCSVConverter converter(_file_name);
+        auto result = converter.convert(csv_file, start_seg, end_seg, m_stopWriteCSV, [&](int32_t curSegment, int64_t position, int64_t Length){
+            if (end_seg == -2){
+                if (position >=0) {
+                    acout() << "\r" << _prefix << "PROGRESS: " << (position * 100) / Length  << " %";
                 }else{
-                    if (curSegment - start_seg >= 0 && (end_seg-1) > start_seg) {
-                        acout() << "\r" << _prefix << "PROGRESS: " << ((curSegment - start_seg - 1) * 100) / (end_seg - start_seg)  << " %";
-                    }
-                }
-                
-                if (notSkip && csv_seg){
-                    csv_seg->seekg(0, csv_seg->beg);  
-                    fs_out << csv_seg->rdbuf();
-                    fs_out.flush();
-                    fs_out.sync();
-                }
-                delete csv_seg;
-                
-                if (end_seg != -2 && end_seg < curSegment){
-                    break;
+                    acout() << "\r" << _prefix << "PROGRESS: 100 %";
                 }
-
-                if (fs.fail() || fs_out.fail()) {
-                    acout() << "\n" << _prefix <<"Error write to CSV file\n";
-                    if (fs.fail()) acout() << _prefix << "FS is fail\n";
-                    if (fs_out.fail()) acout()  << _prefix << "FS out is fail\n";
-                    
-                    ret = false;
-                    break;
+            }else{
+                if (curSegment - start_seg >= 0 && (end_seg-1) > start_seg) {
+                    acout() << "\r" << _prefix << "PROGRESS: " << ((curSegment - start_seg - 1) * 100) / (end_seg - start_seg)  << " %";
                 }
-                
             }
+        });
+        switch(result){
+            case CCSVConverter::Result::OK:
+                break;
+            case CCSVConverter::Result::ERROR_OPEN:
+                acout() << " Error open files\n";
+                ret = false;
+                break;
+            case CCSVConverter::Result::DISK_FULL:
+                acout() << _prefix << "\nDisk is full\n";
+                ret = false;
+                break;
+            case CCSVConverter::Result::ABORTED:
+                acout() << _prefix << "\nAbort writing to CSV file\n";
+                ret = false;
+                break;
+            case CCSVConverter::Result::ERROR_READ:
+                acout() << "\n" << _prefix <<"Error write to CSV file\n";
+                acout() << _prefix << "FS is fail\n";
+                ret = false;
+                break;
+            case CCSVConverter::Result::ERROR_WRITE:
+                acout() << "\n" << _prefix <<"Error write to CSV file\n";
+                acout()  << _prefix << "FS out is fail\n";
+                ret = false;
+                break;
         }
         acout() << "\n" << _prefix << "Ended converting\n";
     }catch (std::exception& e)
@@ -9,6 +9,7 @@
 #include <Oscilloscope.h>
 #include <file_async_writer.h>
 #include <wavWriter.h>
+#include <buffer_pool.h>
 #include "AsioNet.h"
 #include "FileLogger.h"
 #include "neon_asm.h"
@@ -18,10 +19,13 @@
 //#define FILE_PATH "/opt/redpitaya/www/apps/streaming_manager/upload"
 #define FILE_PATH "/tmp/stream_files"
 
-#define UDP_BUFFER_LIMIT 512
 #define TCP_BUFFER_LIMIT 65536/2
 #define ZERO_BUFFER_SIZE 1048576
 
+// Two channels from the network pack plus two converted channels in flight at once
+#define FILE_POOL_SLOTS 8
+#define NET_POOL_SLOTS  4
+
 #define MIN(X,Y) ((X < Y) ? X: Y)
 #define MAX(X,Y) ((X > Y) ? X: Y)
 
@@ -59,6 +63,11 @@ public:
     bool convertToCSV(std::string _file_name,int32_t start_seg, int32_t end_seg,std::string _prefix);
     void stopWriteToCSV();
     int passBuffers(uint64_t _lostRate, uint32_t _oscRate, uint32_t _adc_mode,uint32_t _adc_bits,const void *_buffer_ch1, uint32_t _size_ch1,const void *_buffer_ch2, uint32_t _size_ch2, unsigned short _resolution ,uint64_t _id);
+    // Network mode only: code frames with CSampleCodec when it makes them smaller.
+    // Enable it only when the client asked for it, older clients cannot decode it
+    auto setCompression(bool _enable) -> void;
+    auto getBufferPool() -> CBufferPool::Ptr;
+    auto getBufferPoolStats() -> CBufferPool::Stats;
     CStreamingManager::Callback notifyPassData;
     CStreamingManager::Callback notifyStop;
     CStreamingManager::CallbackVoid notifyPassDataReset;
@@ -79,13 +88,18 @@ private:
     int               m_samples;  
     int               m_passSizeSamples;
     uint8_t           m_zeroBuffer[ZERO_BUFFER_SIZE];
+    CBufferPool::Ptr  m_bufferPool;
+    std::vector<uint8_t> m_datagramBuffer;
+    std::vector<asionet::CAsioSocket::Datagram> m_datagrams;
     
     bool m_volt_mode;
     bool m_use_local_file;
+    bool m_compression;
     std::atomic_bool m_stopWriteCSV;
     Stream_FileType m_fileType;
     void startServer();
     void stopServer();
+    auto sendDatagrams(uint32_t _oscRate, uint32_t _adc_mode, uint32_t _adc_bits, const uint8_t *_ch1, uint32_t _size_ch1, const uint8_t *_ch2, uint32_t _size_ch2, unsigned short _resolution) -> bool;
     uint8_t * convertBuffers(const void *_buffer,uint32_t _buf_size,size_t &_dest_buff_size,uint32_t _lostSize, uint32_t _adc_mode, uint32_t _adc_bits, unsigned short _resolution);
     
 };
@@ -1,4 +1,7 @@
 #include "File.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 
 using namespace TDMS;
 
@@ -54,7 +57,7 @@ auto File::ReadFile(string m_fileName) -> vector<shared_ptr<Metadata>>{
     fsize = ifs.tellg() - fsize;
     ifs.seekg(0, ios::beg);
     Reader reader(ifs, fsize);
-    vector<shared_ptr<Metadata>> metadata = LoadMetadata(reader);
+    vector<shared_ptr<Metadata>> metadata = LoadMetadata(reader,m_fileName + TDMS_INDEX_SUFFIX);
     ifs.close();
     return  metadata;
 }
@@ -65,6 +68,7 @@ auto File::ReadFileWithoutClose(string m_fileName) -> vector<shared_ptr<Segment>
     if (m_reader)
         delete m_reader;
     m_prevMetaDataLookup.clear();
+    m_prevObjects.clear();
     m_read_fs.open(m_fileName, ios::binary | std::ifstream::in );
     if (m_read_fs.fail()) {
         cout << "File " << m_fileName << " not exist" << std::endl;
@@ -78,15 +82,16 @@ auto File::ReadFileWithoutClose(string m_fileName) -> vector<shared_ptr<Segment>
     fsize = m_read_fs.tellg() - fsize;
     m_read_fs.seekg(0, ios::beg);
     m_reader = new Reader(m_read_fs,fsize);
-    return GetSegments(*m_reader);
+    return GetSegments(*m_reader,m_fileName + TDMS_INDEX_SUFFIX);
 }
 
 auto File::GetMetadata(shared_ptr<Segment> segment) -> vector<shared_ptr<Metadata>>{
-    return GetMetadataItem(*m_reader,segment,m_prevMetaDataLookup);
+    return GetMetadataItem(*m_reader,segment,m_prevMetaDataLookup,m_prevObjects);
 }
 
 auto File::Close() -> bool{
     m_prevMetaDataLookup.clear();
+    m_prevObjects.clear();
     if (m_reader){
         delete m_reader;
     }
@@ -117,10 +122,11 @@ auto File::WriteMemory(std::iostream& stream,WriterSegment &segment) -> void{
     writer.Write(segment);
 }
 
-auto File::LoadMetadata(Reader &reader) -> vector<shared_ptr<Metadata>>{
-    vector<shared_ptr<Segment>> segments = GetSegments(reader);
+auto File::LoadMetadata(Reader &reader,string indexFileName) -> vector<shared_ptr<Metadata>>{
+    vector<shared_ptr<Segment>> segments = GetSegments(reader,indexFileName);
     vector<shared_ptr<Metadata>> metadataRet;
     map<string, map<string, shared_ptr<Metadata>>> prevMetaDataLookup;
+    vector<shared_ptr<Metadata>> prevObjects;
     for (auto &segment : segments)
     {
         if (!(segment->TableOfContents.ContainsNewObjects ||
@@ -129,13 +135,16 @@ auto File::LoadMetadata(Reader &reader) -> vector<shared_ptr<Metadata>>{
             segment->TableOfContents.HasRawData)) {
             continue;
         }
-        auto metadata = GetMetadataItem(reader,segment,prevMetaDataLookup);
+        auto metadata = GetMetadataItem(reader,segment,prevMetaDataLookup,prevObjects);
         metadataRet.insert(metadataRet.end(), metadata.begin(), metadata.end());
     }
     return metadataRet;
 }
 
-auto File::GetMetadataItem(Reader &reader,shared_ptr<Segment> segment,map<string, map<string, shared_ptr<Metadata>>> &prevMetaDataLookup) -> vector<shared_ptr<Metadata>>{
+auto File::GetMetadataItem(Reader &reader,shared_ptr<Segment> segment,map<string, map<string, shared_ptr<Metadata>>> &prevMetaDataLookup,vector<shared_ptr<Metadata>> &prevObjects) -> vector<shared_ptr<Metadata>>{
+    if (!segment->TableOfContents.HasMetaData)
+        return GetRawOnlyItem(reader,segment,prevObjects);
+
     vector<shared_ptr<Metadata>> metadataRet;
     vector<shared_ptr<Metadata>> metadatas = reader.ReadMetadata(segment);
     long rawDataSize = 0;
@@ -189,7 +198,7 @@ auto File::GetMetadataItem(Reader &reader,shared_ptr<Segment> segment,map<string
             {
                 if (metadata->Path.size() > 1)
                 {
-                    shared_ptr<Metadata> implicitMetadata;
+                    shared_ptr<Metadata> implicitMetadata = make_shared<Metadata>();
                     implicitMetadata->Path = metadata->Path;
                     implicitMetadata->RawData.Count = metadata->RawData.Count;
                     implicitMetadata->RawData.DataType = metadata->RawData.DataType;
@@ -221,12 +230,115 @@ auto File::GetMetadataItem(Reader &reader,shared_ptr<Segment> segment,map<string
         }
         metadataRet.push_back(metadata);
     }
+
+    // Object list used by the following segments without metadata
+    if (segment->TableOfContents.ContainsNewObjects)
+        prevObjects.clear();
+    for (auto &metadata : metadatas){
+        if (metadata->Path.size() != 2)
+            continue;
+        auto it = std::find_if(prevObjects.begin(), prevObjects.end(),
+                [&metadata](const shared_ptr<Metadata> &obj){ return obj->PathStr == metadata->PathStr; });
+        if (it != prevObjects.end())
+            *it = metadata;
+        else
+            prevObjects.push_back(metadata);
+    }
     return metadataRet;
 }
 
-vector<shared_ptr<Segment>> File::GetSegments(Reader &reader){
+auto File::GetRawOnlyItem(Reader &reader,shared_ptr<Segment> segment,vector<shared_ptr<Metadata>> &prevObjects) -> vector<shared_ptr<Metadata>>{
+    vector<shared_ptr<Metadata>> metadataRet;
+    if (!segment->TableOfContents.HasRawData)
+        return metadataRet;
+
+    long end = segment->NextSegmentOffset > 0 ? segment->NextSegmentOffset : (long)reader.GetFileSize();
+    long offset = segment->RawDataOffset;
+    // The segment holds one or more chunks laid out as described by the previous objects
+    while (offset < end){
+        long chunkStart = offset;
+        for (auto &prev : prevObjects){
+            if (prev->RawData.Count == 0 || prev->RawData.IsInterleaved)
+                continue;
+            if (offset + prev->RawData.Size > end)
+                return metadataRet;
+            shared_ptr<Metadata> metadata = make_shared<Metadata>();
+            metadata->TableOfContents = segment->TableOfContents;
+            metadata->Version = segment->Version;
+            metadata->PathStr = prev->PathStr;
+            metadata->Path = prev->Path;
+            metadata->RawData.Offset = offset;
+            metadata->RawData.Count = prev->RawData.Count;
+            metadata->RawData.Size = prev->RawData.Size;
+            metadata->RawData.Dimension = prev->RawData.Dimension;
+            metadata->RawData.IsInterleaved = false;
+            metadata->RawData.InterleaveStride = 0;
+            TDMSType dataType = prev->RawData.DataType.GetDataType();
+            metadata->RawData.DataType.InitDataType(dataType, NULL);
+            vector<shared_ptr<DataType::Raw>> raw = reader.ReadRawData(metadata->RawData);
+            metadata->RawData.DataType.InitDataType(dataType, raw);
+            metadataRet.push_back(metadata);
+            offset += metadata->RawData.Size;
+        }
+        if (offset == chunkStart)
+            break;
+    }
+    return metadataRet;
+}
+
+auto File::ReadIndex(string indexFileName,uint64_t fileSize) -> vector<shared_ptr<Segment>>{
     vector<shared_ptr<Segment>> list;
-    shared_ptr<Segment> segment = reader.ReadFirstSegment();
+    std::ifstream ifs(indexFileName, ios::binary);
+    if (ifs.fail())
+        return list;
+    vector<char> index((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    uint64_t pos = 0;
+    uint64_t dataPos = 0;
+    while (pos + 28 <= index.size()){
+        const char *leadin = index.data() + pos;
+        uint32_t tableOfContentsMask;
+        int32_t  version;
+        int64_t  nextsegment;
+        int64_t  rawdataoffset;
+        memcpy(&tableOfContentsMask, leadin + 4, sizeof(tableOfContentsMask));
+        memcpy(&version, leadin + 8, sizeof(version));
+        memcpy(&nextsegment, leadin + 12, sizeof(nextsegment));
+        memcpy(&rawdataoffset, leadin + 20, sizeof(rawdataoffset));
+        if (memcmp(leadin, "TDSh", 4) != 0 || nextsegment < 0 || rawdataoffset < 0 || rawdataoffset > nextsegment)
+            break;
+        // Entries past the end of the data file are left to the scan
+        if (dataPos + 28 + nextsegment > fileSize)
+            break;
+        uint64_t metadataSize = ((tableOfContentsMask >> 1) & 1) ? rawdataoffset : 0;
+        if (pos + 28 + metadataSize > index.size())
+            break;
+
+        shared_ptr<Segment> segment = make_shared<Segment>();
+        segment->Identifier = "TDSm";
+        segment->Offset = dataPos;
+        segment->MetadataOffset = dataPos + segment->Length;
+        segment->RawDataOffset = dataPos + segment->Length + rawdataoffset;
+        segment->NextSegmentOffset = dataPos + segment->Length + nextsegment;
+        segment->TableOfContents.ContainsNewObjects = ((tableOfContentsMask >> 2) & 1) == 1;
+        segment->TableOfContents.HasDaqMxData = ((tableOfContentsMask >> 7) & 1) == 1;
+        segment->TableOfContents.HasMetaData = ((tableOfContentsMask >> 1) & 1) == 1;
+        segment->TableOfContents.HasRawData = ((tableOfContentsMask >> 3) & 1) == 1;
+        segment->TableOfContents.NumbersAreBigEndian = ((tableOfContentsMask >> 6) & 1) == 1;
+        segment->TableOfContents.RawDataIsInterleaved = ((tableOfContentsMask >> 5) & 1) == 1;
+        segment->Version = version;
+        list.push_back(segment);
+
+        pos += 28 + metadataSize;
+        dataPos = segment->NextSegmentOffset;
+    }
+    return list;
+}
+
+vector<shared_ptr<Segment>> File::GetSegments(Reader &reader,string indexFileName){
+    // Segments listed in the index are not visited, the scan only covers the
+    // tail written after the last index entry
+    vector<shared_ptr<Segment>> list = ReadIndex(indexFileName,reader.GetFileSize());
+    shared_ptr<Segment> segment = list.empty() ? reader.ReadFirstSegment() : reader.ReadSegment(list.back()->NextSegmentOffset);
     while (segment != nullptr){
         list.push_back(segment);
         segment = reader.ReadSegment(segment->NextSegmentOffset);
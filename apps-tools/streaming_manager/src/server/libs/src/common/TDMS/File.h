@@ -10,6 +10,10 @@
 
 using namespace std;
 
+// Index files follow the NI layout: the lead in and metadata of every segment
+// with the "TDSh" tag and without raw data, stored next to the data file
+#define TDMS_INDEX_SUFFIX "_index"
+
 namespace TDMS
 {
 	class File
@@ -27,12 +31,15 @@ namespace TDMS
             auto Print(vector<shared_ptr<Metadata>> &data,bool PrintRaw,long limitData) -> void;
 
         private:
-    	    auto LoadMetadata(Reader &reader) -> vector<shared_ptr<Metadata>>;
-    	    auto GetSegments(Reader &reader) -> vector<shared_ptr<Segment>>;
-    	    auto GetMetadataItem(Reader &reader,shared_ptr<Segment> segment,map<string, map<string, shared_ptr<Metadata>>> &prevMetaDataLookup) -> vector<shared_ptr<Metadata>>;
+    	    auto LoadMetadata(Reader &reader,string indexFileName) -> vector<shared_ptr<Metadata>>;
+    	    auto GetSegments(Reader &reader,string indexFileName) -> vector<shared_ptr<Segment>>;
+    	    auto ReadIndex(string indexFileName,uint64_t fileSize) -> vector<shared_ptr<Segment>>;
+    	    auto GetMetadataItem(Reader &reader,shared_ptr<Segment> segment,map<string, map<string, shared_ptr<Metadata>>> &prevMetaDataLookup,vector<shared_ptr<Metadata>> &prevObjects) -> vector<shared_ptr<Metadata>>;
+    	    auto GetRawOnlyItem(Reader &reader,shared_ptr<Segment> segment,vector<shared_ptr<Metadata>> &prevObjects) -> vector<shared_ptr<Metadata>>;
 
     	    std::fstream m_read_fs;
     	    Reader*      m_reader;
     	    map<string, map<string, shared_ptr<Metadata>>> m_prevMetaDataLookup;
+    	    vector<shared_ptr<Metadata>> m_prevObjects;
 	};
 }
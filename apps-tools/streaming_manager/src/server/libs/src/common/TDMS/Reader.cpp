@@ -46,9 +46,9 @@ auto Reader::ReadSegment(uint64_t offset) -> shared_ptr<Segment>{
     if (nextsegment != -1)
         nextsegment +=  offset + leadin->Length;
     leadin->NextSegmentOffset = nextsegment;
+    // Segments without metadata store 0 here, their raw data follows the lead in
     int64_t rawdataoffset = m_bstream.Read<int64_t>(*m_fileStream, TDMSType::Integer64);
-    if (rawdataoffset !=0)
-        rawdataoffset +=   offset + leadin->Length;
+    rawdataoffset +=   offset + leadin->Length;
     leadin->RawDataOffset = rawdataoffset;
     cout << "Segment offset :" << offset << "\n";
     return leadin;
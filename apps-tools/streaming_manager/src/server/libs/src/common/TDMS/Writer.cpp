@@ -18,6 +18,14 @@ auto WriterSegment::LoadMetadata(vector<shared_ptr<Metadata>> data) -> void{
     m_nodes = data;
 }
 
+auto WriterSegment::ReleaseRaw() -> void{
+    for(auto &n : m_nodes){
+        for(auto &r : n->RawData.DataType.GetRawVector()){
+            r->data = nullptr;
+        }
+    }
+}
+
 auto WriterSegment::IsRootNodePresent() -> bool{
     for(auto &n : m_nodes){
         if (n->Path.size() == 0)
@@ -144,6 +152,18 @@ auto Writer::Write(WriterSegment &segment) -> void{
     WriteNextSegmentAddress(posSegmentBegin,posSegmentEnd - posSegmentBegin - 28);
 }
 
+auto Writer::WriteRaw(shared_ptr<Metadata> leadin, const vector<pair<const uint8_t*,uint64_t>> &raw) -> void{
+    m_fileStream->seekp(0,ios::end);
+    auto posSegmentBegin = m_fileStream->tellp();
+    WriteSegment(posSegmentBegin,leadin);
+    for(auto &r : raw){
+        if (r.second > 0)
+            m_fileStream->write((const char*)r.first,r.second);
+    }
+    auto posSegmentEnd = m_fileStream->tellp();
+    WriteNextSegmentAddress(posSegmentBegin,posSegmentEnd - posSegmentBegin - 28);
+}
+
 auto Writer::WriteRawHeader(shared_ptr<Metadata> metadata) -> int64_t{
     if (metadata->RawData.DataType.GetDataType() == TDMSType::String)
         throw std::invalid_argument("[ERROR] Save string raw data not implemented!");
@@ -251,3 +271,73 @@ auto Writer::PopPPosition() -> void{
     m_fileStream->seekp(pos);
     m_stek_pos_p.pop_back();
 }
+
+StreamWriter::StreamWriter(string groupName):
+    m_group(groupName),
+    m_hasLayout(false),
+    m_type(TDMSType::Empty),
+    m_count_ch1(0),
+    m_count_ch2(0)
+{
+    WriterSegment segment;
+    m_rawLeadin = segment.GenerateRoot();
+    m_rawLeadin->TableOfContents.HasRawData = true;
+}
+
+auto StreamWriter::Reset() -> void{
+    m_hasLayout = false;
+}
+
+auto StreamWriter::Write(iostream &stream, TDMSType type, const uint8_t *ch1, uint64_t count_ch1, const uint8_t *ch2, uint64_t count_ch2) -> void{
+    if (count_ch1 == 0 && count_ch2 == 0)
+        return;
+
+    if (m_hasLayout && m_type == type && m_count_ch1 == count_ch1 && m_count_ch2 == count_ch2){
+        auto length = DataType::GetLength(type);
+        vector<pair<const uint8_t*,uint64_t>> raw;
+        raw.push_back(make_pair(ch1, count_ch1 * length));
+        raw.push_back(make_pair(ch2, count_ch2 * length));
+        Writer writer(stream, true);
+        writer.WriteRaw(m_rawLeadin, raw);
+        return;
+    }
+
+    WriteMetadata(stream, type, ch1, count_ch1, ch2, count_ch2);
+    m_hasLayout = true;
+    m_type = type;
+    m_count_ch1 = count_ch1;
+    m_count_ch2 = count_ch2;
+}
+
+auto StreamWriter::WriteMetadata(iostream &stream, TDMSType type, const uint8_t *ch1, uint64_t count_ch1, const uint8_t *ch2, uint64_t count_ch2) -> void{
+    WriterSegment segment;
+    vector<shared_ptr<Metadata>> data;
+    auto root = segment.GenerateRoot();
+    root->TableOfContents.HasMetaData = true;
+    root->TableOfContents.HasRawData = true;
+    root->TableOfContents.ContainsNewObjects = true;
+    data.push_back(root);
+    data.push_back(segment.GenerateGroup(m_group));
+
+    if (count_ch1 != 0){
+        auto channel = segment.GenerateChannel(m_group, "ch1");
+        data.push_back(channel);
+        segment.AddRaw(channel, type, count_ch1, (void*)ch1);
+    }
+
+    if (count_ch2 != 0){
+        auto channel = segment.GenerateChannel(m_group, "ch2");
+        data.push_back(channel);
+        segment.AddRaw(channel, type, count_ch2, (void*)ch2);
+    }
+
+    segment.LoadMetadata(data);
+    try{
+        Writer writer(stream, true);
+        writer.Write(segment);
+    }catch(...){
+        segment.ReleaseRaw();
+        throw;
+    }
+    segment.ReleaseRaw();
+}
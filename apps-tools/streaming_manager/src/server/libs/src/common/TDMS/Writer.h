@@ -16,6 +16,9 @@ namespace TDMS
         public:
             auto AddProperties(shared_ptr<Metadata> metadata,string key,DataType value) -> void;
             auto AddRaw(shared_ptr<Metadata> metadata,TDMSType type,int64_t count, void *rawData) -> void;
+            // Detaches the raw buffers from the nodes, so they are not freed with the
+            // segment. Used when the buffers belong to the caller.
+            auto ReleaseRaw() -> void;
             auto LoadMetadata(vector<shared_ptr<Metadata>> data) -> void;
             auto IsRootNodePresent() -> bool;
             auto GenerateRoot() -> shared_ptr<Metadata>;
@@ -33,6 +36,9 @@ namespace TDMS
         public:
             Writer(iostream &fileStream, bool append);
             auto Write(WriterSegment &segment) -> void;
+            // Writes a segment without metadata, the raw data is described by the
+            // object list and raw indexes of the previous segment
+            auto WriteRaw(shared_ptr<Metadata> leadin, const vector<pair<const uint8_t*,uint64_t>> &raw) -> void;
             auto GetFileSize() -> uint64_t;
 
         private:
@@ -52,6 +58,29 @@ namespace TDMS
             vector<std::ios::pos_type> m_stek_pos_g;
             vector<std::ios::pos_type> m_stek_pos_p;
     };
+
+    // Stateful writer for streams of one or two channels. The metadata is written
+    // with the first segment and again only when the data type or the number of
+    // samples per channel changes, all other segments carry raw data only.
+    class StreamWriter
+    {
+        public:
+            StreamWriter(string groupName);
+            // The next segment starts a new object list, used for a new file or
+            // after a segment was dropped
+            auto Reset() -> void;
+            auto Write(iostream &stream, TDMSType type, const uint8_t *ch1, uint64_t count_ch1, const uint8_t *ch2, uint64_t count_ch2) -> void;
+
+        private:
+            auto WriteMetadata(iostream &stream, TDMSType type, const uint8_t *ch1, uint64_t count_ch1, const uint8_t *ch2, uint64_t count_ch2) -> void;
+
+            string               m_group;
+            shared_ptr<Metadata> m_rawLeadin;
+            bool                 m_hasLayout;
+            TDMSType             m_type;
+            uint64_t             m_count_ch1;
+            uint64_t             m_count_ch2;
+    };
 }
 
 #endif //TDMS_LIB_WRITER_H
@@ -0,0 +1,132 @@
+#include <cstdlib>
+#include <new>
+#include "buffer_pool.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#define POOL_ALIGN       64
+#define POOL_EMPTY_INDEX 0xFFFFFFFFu
+#define POOL_INDEX_MASK  0xFFFFFFFFull
+
+static auto poolAlloc(size_t _size) -> uint8_t*{
+#ifdef _WIN32
+    return static_cast<uint8_t*>(_aligned_malloc(_size, POOL_ALIGN));
+#else
+    return static_cast<uint8_t*>(aligned_alloc(POOL_ALIGN, _size));
+#endif
+}
+
+static auto poolFree(uint8_t *_memory) -> void{
+#ifdef _WIN32
+    _aligned_free(_memory);
+#else
+    free(_memory);
+#endif
+}
+
+static auto makeHead(uint64_t _oldHead, uint32_t _index) -> uint64_t{
+    return ((((_oldHead >> 32) + 1) & POOL_INDEX_MASK) << 32) | _index;
+}
+
+CBufferPool::Ptr CBufferPool::Create(size_t _slotSize, uint32_t _slots){
+    return std::make_shared<CBufferPool>(_slotSize, _slots);
+}
+
+CBufferPool::CBufferPool(size_t _slotSize, uint32_t _slots):
+    m_slotSize(((_slotSize + POOL_ALIGN - 1) / POOL_ALIGN) * POOL_ALIGN),
+    m_slots(_slots),
+    m_memory(nullptr),
+    m_head(POOL_EMPTY_INDEX),
+    m_next(new std::atomic<uint32_t>[_slots > 0 ? _slots : 1]),
+    m_hits(0),
+    m_misses(0),
+    m_inUse(0),
+    m_highWater(0)
+{
+    if (m_slots > 0 && m_slotSize > 0){
+        m_memory = poolAlloc(m_slotSize * m_slots);
+    }
+    if (m_memory == nullptr){
+        m_slots = 0;
+        return;
+    }
+    for(uint32_t i = 0; i < m_slots; i++){
+        m_next[i].store(i + 1 < m_slots ? i + 1 : POOL_EMPTY_INDEX, std::memory_order_relaxed);
+    }
+    m_head.store(0, std::memory_order_release);
+}
+
+CBufferPool::~CBufferPool(){
+    poolFree(m_memory);
+}
+
+auto CBufferPool::pop() -> uint32_t{
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    while(true){
+        uint32_t index = static_cast<uint32_t>(head & POOL_INDEX_MASK);
+        if (index == POOL_EMPTY_INDEX)
+            return POOL_EMPTY_INDEX;
+        uint32_t next = m_next[index].load(std::memory_order_relaxed);
+        if (m_head.compare_exchange_weak(head, makeHead(head, next), std::memory_order_acq_rel, std::memory_order_acquire))
+            return index;
+    }
+}
+
+auto CBufferPool::push(uint32_t _index) -> void{
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    do{
+        m_next[_index].store(static_cast<uint32_t>(head & POOL_INDEX_MASK), std::memory_order_relaxed);
+    }while(!m_head.compare_exchange_weak(head, makeHead(head, _index), std::memory_order_release, std::memory_order_relaxed));
+}
+
+auto CBufferPool::acquire(size_t _size) -> uint8_t*{
+    uint8_t *buffer = nullptr;
+    if (_size <= m_slotSize){
+        uint32_t index = pop();
+        if (index != POOL_EMPTY_INDEX){
+            buffer = m_memory + m_slotSize * index;
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            uint32_t used = m_inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+            uint32_t high = m_highWater.load(std::memory_order_relaxed);
+            while(used > high && !m_highWater.compare_exchange_weak(high, used, std::memory_order_relaxed));
+            return buffer;
+        }
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    buffer = new (std::nothrow) uint8_t[_size > 0 ? _size : 1];
+    return buffer;
+}
+
+auto CBufferPool::isOwned(const uint8_t *_buffer) const -> bool{
+    return m_memory != nullptr && _buffer >= m_memory && _buffer < m_memory + m_slotSize * m_slots;
+}
+
+auto CBufferPool::release(uint8_t *_buffer) -> void{
+    if (_buffer == nullptr)
+        return;
+    if (isOwned(_buffer)){
+        push(static_cast<uint32_t>((_buffer - m_memory) / m_slotSize));
+        m_inUse.fetch_sub(1, std::memory_order_relaxed);
+    }else{
+        delete[] _buffer;
+    }
+}
+
+auto CBufferPool::getStats() const -> Stats{
+    Stats stats;
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.misses = m_misses.load(std::memory_order_relaxed);
+    stats.inUse = m_inUse.load(std::memory_order_relaxed);
+    stats.highWater = m_highWater.load(std::memory_order_relaxed);
+    stats.slots = m_slots;
+    stats.slotSize = m_slotSize;
+    return stats;
+}
+
+auto CBufferPool::resetStats() -> void{
+    m_hits = 0;
+    m_misses = 0;
+    m_highWater = m_inUse.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+// Fixed-size recycled buffer pool.
+// All slots are allocated once in the constructor and handed out through a lock-free
+// free list, so the streaming hot path does not touch the heap. Requests larger than
+// a slot or made while every slot is busy fall back to new[] and are counted as misses.
+class CBufferPool
+{
+public:
+
+    struct Stats{
+        uint64_t hits;
+        uint64_t misses;
+        uint32_t inUse;
+        uint32_t highWater;
+        uint32_t slots;
+        size_t   slotSize;
+    };
+
+    using Ptr = std::shared_ptr<CBufferPool>;
+
+    static Ptr Create(size_t _slotSize, uint32_t _slots);
+    CBufferPool(size_t _slotSize, uint32_t _slots);
+    ~CBufferPool();
+
+    auto acquire(size_t _size) -> uint8_t*;
+    auto release(uint8_t *_buffer) -> void;
+    auto isOwned(const uint8_t *_buffer) const -> bool;
+    auto slotSize() const -> size_t { return m_slotSize; }
+    auto getStats() const -> Stats;
+    auto resetStats() -> void;
+
+private:
+
+    CBufferPool(const CBufferPool &) = delete;
+    CBufferPool(CBufferPool &&) = delete;
+
+    auto pop() -> uint32_t;
+    auto push(uint32_t _index) -> void;
+
+    size_t                  m_slotSize;
+    uint32_t                m_slots;
+    uint8_t                *m_memory;
+    // Free list head: high 32 bits are an ABA tag, low 32 bits are the slot index
+    std::atomic<uint64_t>   m_head;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+
+    std::atomic<uint64_t>   m_hits;
+    std::atomic<uint64_t>   m_misses;
+    std::atomic<uint32_t>   m_inUse;
+    std::atomic<uint32_t>   m_highWater;
+};
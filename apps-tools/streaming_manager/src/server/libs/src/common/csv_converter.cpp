@@ -0,0 +1,430 @@
+#define _FILE_OFFSET_BITS 64
+#include "csv_converter.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#include <locale.h>
+#else
+#include <io.h>
+#endif
+
+// Input bytes formatted by one worker at a time
+#define CSV_JOB_SIZE 1024 * 1024
+// Upper bounds of a formatted line: "-32768,-32768\n" and "-1.17549e-38,-1.17549e-38\n"
+#define CSV_LINE_INT  16
+#define CSV_LINE_REAL 32
+#define CSV_LINE_LOST 4
+
+static const char g_digits[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static inline auto formatInt(char *_out, int32_t _value) -> char*{
+    uint32_t v = _value;
+    if (_value < 0){
+        *_out++ = '-';
+        v = -(uint32_t)_value;
+    }
+    char tmp[12];
+    char *p = tmp + sizeof(tmp);
+    while (v >= 100){
+        uint32_t i = (v % 100) * 2;
+        v /= 100;
+        *--p = g_digits[i + 1];
+        *--p = g_digits[i];
+    }
+    if (v >= 10){
+        *--p = g_digits[v * 2 + 1];
+        *--p = g_digits[v * 2];
+    }else{
+        *--p = '0' + v;
+    }
+    size_t n = tmp + sizeof(tmp) - p;
+    memcpy(_out, p, n);
+    return _out + n;
+}
+
+// Same text as operator<< of a stream in the classic locale
+static inline auto formatReal(char *_out, float _value) -> char*{
+    return _out + snprintf(_out, CSV_LINE_REAL / 2, "%g", (double)_value);
+}
+
+template<typename T>
+static inline auto load(const uint8_t *_data, size_t _index) -> T{
+    T value;
+    memcpy(&value, _data + _index * sizeof(T), sizeof(T));
+    return value;
+}
+
+template<typename T>
+static auto formatOne(char *_out, const uint8_t *_ch, uint32_t _count) -> char*{
+    for (uint32_t i = 0; i < _count; i++){
+        _out = formatInt(_out, load<T>(_ch, i));
+        *_out++ = '\n';
+    }
+    return _out;
+}
+
+template<typename T>
+static auto formatTwo(char *_out, const uint8_t *_ch1, const uint8_t *_ch2, uint32_t _count, uint32_t _count_ch2) -> char*{
+    for (uint32_t i = 0; i < _count; i++){
+        _out = formatInt(_out, load<T>(_ch1, i));
+        *_out++ = ',';
+        _out = formatInt(_out, i < _count_ch2 ? load<T>(_ch2, i) : 0);
+        *_out++ = '\n';
+    }
+    return _out;
+}
+
+static auto formatOneReal(char *_out, const uint8_t *_ch, uint32_t _count) -> char*{
+    for (uint32_t i = 0; i < _count; i++){
+        _out = formatReal(_out, load<float>(_ch, i));
+        *_out++ = '\n';
+    }
+    return _out;
+}
+
+static auto formatTwoReal(char *_out, const uint8_t *_ch1, const uint8_t *_ch2, uint32_t _count, uint32_t _count_ch2) -> char*{
+    for (uint32_t i = 0; i < _count; i++){
+        _out = formatReal(_out, load<float>(_ch1, i));
+        *_out++ = ',';
+        _out = formatReal(_out, i < _count_ch2 ? load<float>(_ch2, i) : 0);
+        *_out++ = '\n';
+    }
+    return _out;
+}
+
+static auto readAt(int _fd, uint8_t *_buffer, size_t _size, uint64_t _offset) -> bool{
+#ifdef _WIN32
+    if (_lseeki64(_fd, _offset, SEEK_SET) < 0)
+        return false;
+    return _read(_fd, _buffer, _size) == (int)_size;
+#else
+    return pread(_fd, _buffer, _size, _offset) == (ssize_t)_size;
+#endif
+}
+
+static auto writeAll(int _fd, const char *_buffer, size_t _size) -> bool{
+    while(_size > 0){
+#ifdef _WIN32
+        int ret = _write(_fd, _buffer, _size);
+#else
+        ssize_t ret = write(_fd, _buffer, _size);
+#endif
+        if (ret < 0){
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (ret == 0)
+            return false;
+        _buffer += ret;
+        _size -= ret;
+    }
+    return true;
+}
+
+CCSVConverter::CCSVConverter(const std::string &_binFile):
+    m_binFile(_binFile),
+    m_fd(-1),
+    m_length(0),
+    m_threads(0),
+    m_segments(),
+    m_jobs()
+{
+}
+
+CCSVConverter::~CCSVConverter(){
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+auto CCSVConverter::setThreads(unsigned _threads) -> void{
+    m_threads = _threads;
+}
+
+// Collects the segments to convert, in the order and with the channel count
+// ReadCSV would see when called for each segment from the start of the file
+auto CCSVConverter::buildIndex(int32_t _startSeg, int32_t _endSeg, bool &_readError) -> void{
+    uint64_t position = 0;
+    int32_t  curSegment = 0;
+    int      channels = 0;
+    const uint8_t endOfSegment[12] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+    // An empty file fails like a truncated one
+    _readError = m_length == 0;
+    m_segments.clear();
+    _startSeg = std::max(_startSeg, 1);
+    while (position < m_length){
+        curSegment++;
+        if (_endSeg != -2 && _endSeg < curSegment)
+            break;
+
+        Segment seg;
+        uint8_t endSeg[12];
+        uint64_t next = position + sizeof(BinHeader);
+        if (next > m_length || !readAt(m_fd, (uint8_t*)&seg.header, sizeof(BinHeader), position)){
+            _readError = true;
+            break;
+        }
+        next += seg.header.sigmentLength;
+        uint64_t data = ((uint64_t)seg.header.sizeCh1 + seg.header.sizeCh2) * seg.header.dataFormatSize;
+        if (next + 12 > m_length || !readAt(m_fd, endSeg, 12, next)){
+            _readError = true;
+            break;
+        }
+        if (memcmp(endSeg, endOfSegment, 12) != 0 || data > seg.header.sigmentLength)
+            break;
+
+        if (_startSeg <= curSegment){
+            if (channels == 0)
+                channels = (seg.header.sizeCh1 > 0 ? 1 : 0) + (seg.header.sizeCh2 > 0 ? 1 : 0);
+            seg.offset = position;
+            seg.number = curSegment;
+            seg.channels = channels;
+            m_segments.push_back(seg);
+        }
+        position = next + 12;
+    }
+}
+
+auto CCSVConverter::buildJobs() -> void{
+    m_jobs.clear();
+    size_t i = 0;
+    while (i < m_segments.size()){
+        Job job;
+        job.first = i;
+        job.begin = m_segments[i].offset;
+        uint64_t size = 0;
+        do {
+            size += sizeof(BinHeader) + m_segments[i].header.sigmentLength + 12;
+            i++;
+        } while (i < m_segments.size() && size < CSV_JOB_SIZE);
+        job.last = i - 1;
+        job.end = m_segments[job.last].offset + sizeof(BinHeader) + m_segments[job.last].header.sigmentLength + 12;
+        m_jobs.push_back(job);
+    }
+}
+
+auto CCSVConverter::maxSegmentSize(const Segment &_seg) -> size_t{
+    size_t lines = std::max(_seg.header.sizeCh1, _seg.header.sizeCh2);
+    size_t line = _seg.header.dataFormatSize == 4 ? CSV_LINE_REAL : CSV_LINE_INT;
+    return lines * line + (size_t)_seg.header.lostCount * CSV_LINE_LOST;
+}
+
+auto CCSVConverter::formatSegment(const Segment &_seg, const uint8_t *_data, char *_out) -> char*{
+    const BinHeader &h = _seg.header;
+    const uint8_t *ch1 = _data;
+    const uint8_t *ch2 = _data + (size_t)h.sizeCh1 * h.dataFormatSize;
+    const int resolution = h.dataFormatSize * 8;
+
+    if (h.sizeCh1 != 0 && h.sizeCh2 == 0){
+        if (resolution == 8)  _out = formatOne<int8_t>(_out, ch1, h.sizeCh1);
+        if (resolution == 16) _out = formatOne<int16_t>(_out, ch1, h.sizeCh1);
+        if (resolution == 32) _out = formatOneReal(_out, ch1, h.sizeCh1);
+    }
+
+    if (h.sizeCh1 == 0 && h.sizeCh2 != 0){
+        if (resolution == 8)  _out = formatOne<int8_t>(_out, ch2, h.sizeCh2);
+        if (resolution == 16) _out = formatOne<int16_t>(_out, ch2, h.sizeCh2);
+        if (resolution == 32) _out = formatOneReal(_out, ch2, h.sizeCh2);
+    }
+
+    if (h.sizeCh1 != 0 && h.sizeCh2 != 0){
+        if (resolution == 8)  _out = formatTwo<int8_t>(_out, ch1, ch2, h.sizeCh1, h.sizeCh2);
+        if (resolution == 16) _out = formatTwo<int16_t>(_out, ch1, ch2, h.sizeCh1, h.sizeCh2);
+        if (resolution == 32) _out = formatTwoReal(_out, ch1, ch2, h.sizeCh1, h.sizeCh2);
+    }
+
+    if (h.lostCount > 0 && _seg.channels > 0){
+        const char *s = _seg.channels == 2 ? "0,0\n" : "0\n";
+        size_t n = _seg.channels == 2 ? 4 : 2;
+        for (uint32_t i = 0; i < h.lostCount; i++){
+            memcpy(_out, s, n);
+            _out += n;
+        }
+    }
+    return _out;
+}
+
+auto CCSVConverter::formatJob(const Job &_job, std::vector<char> &_out, size_t &_size) -> bool{
+    size_t size = 0;
+    for (size_t i = _job.first; i <= _job.last; i++){
+        size += maxSegmentSize(m_segments[i]);
+    }
+    // Chunks are reused, they only grow
+    if (_out.size() < size)
+        _out.resize(size);
+
+#ifndef _WIN32
+    static const uint64_t page = sysconf(_SC_PAGE_SIZE);
+    uint64_t base = _job.begin & ~(page - 1);
+    size_t length = _job.end - base;
+    void *map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, m_fd, base);
+    if (map == MAP_FAILED)
+        return false;
+    madvise(map, length, MADV_SEQUENTIAL);
+    const uint8_t *data = (const uint8_t*)map - base;
+#else
+    static std::mutex readMutex;
+    std::vector<uint8_t> buffer(_job.end - _job.begin);
+    {
+        std::lock_guard<std::mutex> lock(readMutex);
+        if (!readAt(m_fd, buffer.data(), buffer.size(), _job.begin))
+            return false;
+    }
+    const uint8_t *data = buffer.data() - _job.begin;
+#endif
+
+    char *out = _out.data();
+    for (size_t i = _job.first; i <= _job.last; i++){
+        out = formatSegment(m_segments[i], data + m_segments[i].offset + sizeof(BinHeader), out);
+    }
+    _size = out - _out.data();
+
+#ifndef _WIN32
+    munmap(map, length);
+#endif
+    return true;
+}
+
+auto CCSVConverter::convert(const std::string &_csvFile, int32_t _startSeg, int32_t _endSeg, const std::atomic_bool &_stop, ProgressFunc _progress) -> Result{
+#ifdef _WIN32
+    m_fd = open(m_binFile.c_str(), O_RDONLY | O_BINARY);
+    int out_fd = open(_csvFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+#else
+    m_fd = open(m_binFile.c_str(), O_RDONLY);
+    int out_fd = open(_csvFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+#endif
+    if (m_fd < 0 || out_fd < 0){
+        if (out_fd >= 0) close(out_fd);
+        return Result::ERROR_OPEN;
+    }
+
+#ifdef _WIN32
+    m_length = _lseeki64(m_fd, 0, SEEK_END);
+#else
+    m_length = lseek(m_fd, 0, SEEK_END);
+#endif
+    bool readError = false;
+    buildIndex(_startSeg, _endSeg, readError);
+    buildJobs();
+
+    // Each chunk is formatted into its slot and written by this thread in order
+    const unsigned threads = m_threads ? m_threads : std::max(1u, std::thread::hardware_concurrency());
+    const size_t slots = threads * 2;
+    std::vector<std::vector<char>> output(slots);
+    std::vector<size_t> output_size(slots, 0);
+    std::vector<int> state(slots, 0); // 0 - free, 1 - formatting, 2 - done, 3 - failed
+    std::mutex mtx;
+    std::condition_variable cv;
+    size_t next = 0;
+    size_t written = 0;
+    bool cancel = false;
+
+    auto worker = [&](){
+#ifndef _WIN32
+        // snprintf must use '.' whatever the locale of the process is
+        locale_t loc = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+        locale_t old = loc ? uselocale(loc) : (locale_t)0;
+#endif
+        while (true){
+            size_t job;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&]{ return cancel || next >= m_jobs.size() || next < written + slots; });
+                if (cancel || next >= m_jobs.size())
+                    break;
+                job = next++;
+                state[job % slots] = 1;
+            }
+            bool ok = formatJob(m_jobs[job], output[job % slots], output_size[job % slots]);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                state[job % slots] = ok ? 2 : 3;
+            }
+            cv.notify_all();
+        }
+#ifndef _WIN32
+        if (loc){
+            uselocale(old);
+            freelocale(loc);
+        }
+#endif
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < std::min<size_t>(threads, m_jobs.size()); i++){
+        pool.emplace_back(worker);
+    }
+
+    Result result = Result::OK;
+    for (size_t job = 0; job < m_jobs.size(); job++){
+        int slot_state;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&]{ return state[job % slots] >= 2; });
+            slot_state = state[job % slots];
+        }
+        if (slot_state == 3){
+            result = Result::ERROR_READ;
+            break;
+        }
+        if (_stop){
+            result = Result::ABORTED;
+            break;
+        }
+        if (FileQueueManager::GetFreeSpaceDisk(_csvFile) <= USING_FREE_SPACE){
+            result = Result::DISK_FULL;
+            break;
+        }
+        if (!writeAll(out_fd, output[job % slots].data(), output_size[job % slots])){
+            result = Result::ERROR_WRITE;
+            break;
+        }
+        if (_progress){
+            const auto &last = m_segments[m_jobs[job].last];
+            int64_t position = m_jobs[job].end >= m_length ? -2 : (int64_t)m_jobs[job].end;
+            _progress(last.number, position, m_length);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            state[job % slots] = 0;
+            written++;
+        }
+        cv.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        cancel = true;
+    }
+    cv.notify_all();
+    for (auto &th : pool){
+        th.join();
+    }
+
+    if (result == Result::OK && readError)
+        result = Result::ERROR_READ;
+    if (close(out_fd) != 0 && result == Result::OK)
+        result = Result::ERROR_WRITE;
+    close(m_fd);
+    m_fd = -1;
+    return result;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "file_async_writer.h"
+
+// Converts a BIN capture to CSV with the same output as FileQueueManager::ReadCSV.
+// The segment headers are indexed in one pass, then groups of segments are mapped
+// and formatted on worker threads into reusable output chunks, which the calling
+// thread writes in file order.
+class CCSVConverter
+{
+public:
+    enum class Result{
+        OK,
+        ERROR_OPEN,
+        ERROR_READ,
+        ERROR_WRITE,
+        DISK_FULL,
+        ABORTED
+    };
+
+    // Called after each written chunk with the number of the last converted segment
+    // and the file position after it, -2 when the end of the file is reached
+    using ProgressFunc = std::function<void(int32_t _segment, int64_t _position, int64_t _length)>;
+
+    CCSVConverter(const std::string &_binFile);
+    ~CCSVConverter();
+
+    // 0 selects the number of hardware threads
+    auto setThreads(unsigned _threads) -> void;
+    // Segments are numbered from 1, -2 means from the first or up to the last one
+    auto convert(const std::string &_csvFile, int32_t _startSeg, int32_t _endSeg, const std::atomic_bool &_stop, ProgressFunc _progress) -> Result;
+
+private:
+    struct Segment{
+        uint64_t  offset;
+        BinHeader header;
+        int32_t   number;
+        int       channels;
+    };
+
+    struct Job{
+        size_t   first;
+        size_t   last;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    CCSVConverter(const CCSVConverter &) = delete;
+    CCSVConverter(CCSVConverter &&) = delete;
+
+    auto buildIndex(int32_t _startSeg, int32_t _endSeg, bool &_readError) -> void;
+    auto buildJobs() -> void;
+    auto formatJob(const Job &_job, std::vector<char> &_out, size_t &_size) -> bool;
+    static auto formatSegment(const Segment &_seg, const uint8_t *_data, char *_out) -> char*;
+    static auto maxSegmentSize(const Segment &_seg) -> size_t;
+
+    std::string          m_binFile;
+    int                  m_fd;
+    uint64_t             m_length;
+    unsigned             m_threads;
+    std::vector<Segment> m_segments;
+    std::vector<Job>     m_jobs;
+};
@@ -1,12 +1,18 @@
+#define _FILE_OFFSET_BITS 64
 #include "file_async_writer.h"
 #include "common/TDMS/File.h"
 #include <ctime>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 
 #ifndef _WIN32
 #include <sys/statvfs.h>
 #include <unistd.h>
 #else
 #include <windows.h>
+#include <io.h>
+#include <malloc.h>
 #endif
 
 std::string DirNameOf(const std::string& fname)
@@ -17,17 +23,76 @@ std::string DirNameOf(const std::string& fname)
            : fname.substr(0, pos);
 }
 
-FileQueueManager::FileQueueManager():Queue(){
+static auto allocBatch(size_t _size) -> uint8_t*{
+#ifdef _WIN32
+    return static_cast<uint8_t*>(_aligned_malloc(_size, WRITE_BATCH_ALIGN));
+#else
+    return static_cast<uint8_t*>(aligned_alloc(WRITE_BATCH_ALIGN, _size));
+#endif
+}
+
+static auto freeBatch(uint8_t *_buffer) -> void{
+#ifdef _WIN32
+    _aligned_free(_buffer);
+#else
+    free(_buffer);
+#endif
+}
+
+static auto writeAt(int _fd, const uint8_t *_buffer, size_t _size, uint64_t _offset) -> bool{
+    while(_size > 0){
+#ifdef _WIN32
+        if (_lseeki64(_fd, _offset, SEEK_SET) < 0)
+            return false;
+        int ret = _write(_fd, _buffer, _size);
+#else
+        ssize_t ret = pwrite(_fd, _buffer, _size, _offset);
+#endif
+        if (ret < 0){
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (ret == 0)
+            return false;
+        _buffer += ret;
+        _size -= ret;
+        _offset += ret;
+    }
+    return true;
+}
+
+static auto readAt(int _fd, uint8_t *_buffer, size_t _size, uint64_t _offset) -> bool{
+#ifdef _WIN32
+    if (_lseeki64(_fd, _offset, SEEK_SET) < 0)
+        return false;
+    return _read(_fd, _buffer, _size) == (int)_size;
+#else
+    return pread(_fd, _buffer, _size, _offset) == (ssize_t)_size;
+#endif
+}
+
+FileQueueManager::FileQueueManager():Queue(),m_tdmsWriter("Group"){
     m_threadWork = false;
     m_waitAllWrite = false;    
     m_hasErrorWrite = false;
     m_IsOutOfSpace = false;
+    m_ThreadRun = false;
+    m_fd = -1;
+    m_fileOffset = 0;
+    m_batchUsed = 0;
+    m_wavDataAdded = 0;
+    m_indexEnabled = false;
+    m_indexFd = -1;
+    m_indexOffset = 0;
+    m_batchBuffer = allocBatch(WRITE_BATCH_SIZE);
     th = nullptr;
     memset(endOfSegment, 0xFF, 12);
 }
 
 FileQueueManager::~FileQueueManager(){
     this->StopWrite(false);
+    this->CloseFile();
+    freeBatch(m_batchBuffer);
 }
 
 unsigned long long getTotalSystemMemory()
@@ -81,6 +146,8 @@ auto FileQueueManager::AddBufferToWrite(std::iostream *buffer) -> bool{
     }
     else{
         delete buffer;
+        // A dropped TDMS segment may have carried the metadata of the next ones
+        m_tdmsWriter.Reset();
         return false;
     }
 }
@@ -100,14 +167,33 @@ auto FileQueueManager::GetFreeSpaceDisk(std::string _filePath) -> ulong{
 }
 
 auto FileQueueManager::OpenFile(std::string FileName,bool Append) -> void{
-    fs.open(FileName, std::ios::binary | std::ofstream::out| std::ofstream::in | (Append? std::ofstream::binary  : std::ofstream::trunc));
-    if (fs.fail()) {
-        fs.open(FileName, std::ios::binary | std::ofstream::out| std::ofstream::in |  std::ofstream::trunc);
-        if (fs.fail()) {
-            std::cout << "File " << FileName << " not exist" << std::endl;
-            return;
-        }
+    CloseFile();
+#ifdef _WIN32
+    m_fd = _open(FileName.c_str(), _O_RDWR | _O_CREAT | _O_BINARY | (Append ? 0 : _O_TRUNC), _S_IREAD | _S_IWRITE);
+#else
+    m_fd = open(FileName.c_str(), O_RDWR | O_CREAT | (Append ? 0 : O_TRUNC), 0666);
+#endif
+    if (m_fd < 0) {
+        std::cout << "File " << FileName << " not exist" << std::endl;
+        return;
     }
+    m_fileOffset = 0;
+    if (Append) {
+#ifdef _WIN32
+        auto end = _lseeki64(m_fd, 0, SEEK_END);
+#else
+        auto end = lseek(m_fd, 0, SEEK_END);
+#endif
+        m_fileOffset = end > 0 ? end : 0;
+    }
+    m_batchUsed = 0;
+    m_wavDataAdded = 0;
+    m_fileName = FileName;
+    m_tdmsWriter.Reset();
+    // An appended file keeps its old index, the readers scan the part past it
+    m_indexEnabled = m_fileOffset == 0;
+    m_indexOffset = 0;
+    m_indexBatch.clear();
     auto dirName = DirNameOf(FileName);
     if (dirName == ""){
         dirName = ".";
@@ -122,12 +208,19 @@ auto FileQueueManager::OpenFile(std::string FileName,bool Append) -> void{
 }
 
 auto FileQueueManager::CloseFile() -> void{
-    if (fs.is_open())
-        fs.close();
+    CloseIndex();
+    if (m_fd >= 0){
+#ifdef _WIN32
+        _close(m_fd);
+#else
+        close(m_fd);
+#endif
+        m_fd = -1;
+    }
 }
 
 auto FileQueueManager::StartWrite(Stream_FileType _fileType) -> void{
-    m_ThreadRun.test_and_set();
+    m_ThreadRun = true;
     m_threadWork = true;
     m_fileType = _fileType;
     m_firstSectionWrite = false;
@@ -142,7 +235,8 @@ auto FileQueueManager::StopWrite(bool waitAllWrite) -> void{
         m_waitLock.lock();
         m_waitAllWrite = waitAllWrite;
         m_waitLock.unlock();
-        m_ThreadRun.clear();
+        m_ThreadRun = false;
+        wakeUpQueue();
     }
     m_threadControl.lock();
     if (th) {
@@ -157,8 +251,9 @@ auto FileQueueManager::StopWrite(bool waitAllWrite) -> void{
 }
 
 auto FileQueueManager::Task() -> void{
-    while (m_ThreadRun.test_and_set()){
-        WriteToFile();        
+    while (m_ThreadRun){
+        waitQueue();
+        WriteToFile();
     }
     m_waitLock.lock();
     if (this->m_waitAllWrite) {
@@ -175,37 +270,32 @@ auto FileQueueManager::Task() -> void{
 }
 
 auto FileQueueManager::WriteToFile() -> int{
-    auto bstream = popQueue();
-    if (bstream == nullptr)
+    std::list<std::iostream*> batch;
+    popAllQueue(batch);
+    if (batch.empty())
         return -1;
 
-    if (m_hasErrorWrite) {
+    for(auto bstream : batch){
+        if (!m_hasErrorWrite) {
+            AppendToBatch(bstream);
+        }
         delete bstream;
-        return 1;
-    }
-    
-    bstream->seekg(0, bstream->end);
-    auto Length = bstream->tellg();
-
-    if (fs.good() && ((m_hasWriteSize + Length) < m_freeSize)) {
-        bstream->seekg(0, bstream->beg);        
-        fs << bstream->rdbuf();
-        fs.flush();
-//        bstream->seekg(0, std::ios::end);
-//        auto Length = bstream->tellg();
-        m_hasWriteSize += Length;
-    
-        if (m_fileType == Stream_FileType::WAV_TYPE){
-            if (m_firstSectionWrite){
-                UpdateWavFile(Length);
-            }
+    }
 
-            if (m_firstSectionWrite == false){
-                m_firstSectionWrite = true;
-            }
-        }
+    if (!m_hasErrorWrite) {
+        FlushBatch();
+    }
+    return m_hasErrorWrite ? 1 : 0;
+}
+
+auto FileQueueManager::AppendToBatch(std::iostream *buffer) -> bool{
+    buffer->seekg(0, buffer->end);
+    uint64_t Length = buffer->tellg();
+    buffer->seekg(0, buffer->beg);
 
-    } else{
+    if (m_fd < 0 || m_batchBuffer == nullptr || !((m_hasWriteSize + Length) < m_freeSize)) {
+        // The segments already batched passed the check, write them before stopping
+        FlushBatch();
         m_IsOutOfSpace  = true;
         m_hasErrorWrite = true;
         m_hasWriteSize += Length;
@@ -214,81 +304,138 @@ auto FileQueueManager::WriteToFile() -> int{
         }else {
             acout() << "Disk is full or error state\n";
         }
-        return 1;
+        return false;
+    }
+
+    auto rdbuf = buffer->rdbuf();
+    uint64_t left = Length;
+    while(left > 0){
+        size_t chunk = WRITE_BATCH_SIZE - m_batchUsed;
+        if (chunk > left) chunk = left;
+        m_batchUsed += rdbuf->sgetn(reinterpret_cast<char*>(m_batchBuffer + m_batchUsed), chunk);
+        left -= chunk;
+        if (m_batchUsed == WRITE_BATCH_SIZE && !FlushBatch())
+            return false;
+    }
+    m_hasWriteSize += Length;
+
+    if (m_fileType == Stream_FileType::TDMS_TYPE && m_indexEnabled){
+        AppendToIndex(buffer);
+    }
+
+    if (m_fileType == Stream_FileType::WAV_TYPE){
+        // The first section carries the WAV header, the following ones extend its data size
+        if (m_firstSectionWrite){
+            m_wavDataAdded += Length;
+        }
+        m_firstSectionWrite = true;
+    }
+    return true;
+}
+
+auto FileQueueManager::FlushBatch() -> bool{
+    if (m_batchUsed == 0)
+        return true;
+
+    if (!writeAt(m_fd, m_batchBuffer, m_batchUsed, m_fileOffset)){
+        m_IsOutOfSpace  = true;
+        m_hasErrorWrite = true;
+        acout() << "Disk is full or error state\n";
+        return false;
+    }
+    m_fileOffset += m_batchUsed;
+    m_batchUsed = 0;
+
+    // The index is only extended after the data it points to is written
+    if (!m_indexBatch.empty()){
+        if (m_indexFd >= 0 && !writeAt(m_indexFd, m_indexBatch.data(), m_indexBatch.size(), m_indexOffset)){
+            acout() << "Error write to TDMS index file\n";
+            CloseIndex();
+            m_indexEnabled = false;
+        }
+        m_indexOffset += m_indexBatch.size();
+        m_indexBatch.clear();
+    }
+
+    if (m_wavDataAdded > 0){
+        UpdateWavFile(m_wavDataAdded);
+        m_wavDataAdded = 0;
+    }
+    return true;
+}
+
+auto FileQueueManager::AppendToIndex(std::iostream *buffer) -> void{
+    // Every queued TDMS stream holds one segment: its lead in and metadata go to
+    // the index with the "TDSh" tag
+    char leadin[28];
+    buffer->clear();
+    buffer->seekg(0, buffer->beg);
+    if (!buffer->read(leadin, sizeof(leadin)) || memcmp(leadin, "TDSm", 4) != 0)
+        return;
+    uint32_t tableOfContentsMask = 0;
+    int64_t  metadataSize = 0;
+    memcpy(&tableOfContentsMask, leadin + 4, sizeof(tableOfContentsMask));
+    if ((tableOfContentsMask >> 1) & 1)
+        memcpy(&metadataSize, leadin + 20, sizeof(metadataSize));
+
+    if (m_indexFd < 0){
+        std::string indexName = m_fileName + TDMS_INDEX_SUFFIX;
+#ifdef _WIN32
+        m_indexFd = _open(indexName.c_str(), _O_RDWR | _O_CREAT | _O_BINARY | _O_TRUNC, _S_IREAD | _S_IWRITE);
+#else
+        m_indexFd = open(indexName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+#endif
+        if (m_indexFd < 0){
+            acout() << "Can't create TDMS index file " << indexName << "\n";
+            m_indexEnabled = false;
+            return;
+        }
+    }
+
+    size_t pos = m_indexBatch.size();
+    m_indexBatch.resize(pos + sizeof(leadin) + metadataSize);
+    memcpy(m_indexBatch.data() + pos, leadin, sizeof(leadin));
+    memcpy(m_indexBatch.data() + pos, "TDSh", 4);
+    if (metadataSize > 0 && !buffer->read(reinterpret_cast<char*>(m_indexBatch.data() + pos + sizeof(leadin)), metadataSize)){
+        m_indexBatch.resize(pos);
+        m_indexEnabled = false;
+    }
+}
+
+auto FileQueueManager::CloseIndex() -> void{
+    if (m_indexFd >= 0){
+#ifdef _WIN32
+        _close(m_indexFd);
+#else
+        close(m_indexFd);
+#endif
+        m_indexFd = -1;
     }
-    delete bstream;
-    return 0;
 }
 
 auto FileQueueManager::UpdateWavFile(int _size) -> void{
     int offset1 = 4;
     int offset2 = 40;
-   
-    auto cur_p = fs.tellp();
-    auto cur_g = fs.tellg();
 
     int32_t size1 = 0;
     int32_t size2 = 0;
-    fs.seekg(offset1, fs.beg);
-    fs.read ((char*)&size1, sizeof(size1));
-    size1 += _size;
-    fs.seekp(offset1, fs.beg);
-    fs.write((char*)&size1, sizeof(size1));
-    fs.seekg(offset2, fs.beg);
-    fs.read ((char*)&size2, sizeof(size2));
-    size2 += _size;
-    fs.seekp(offset2, fs.beg);
-    fs.write((char*)&size2, sizeof(size2));
-
- 
-    fs.seekp(cur_p);
-    fs.seekg(cur_g);
+    if (readAt(m_fd, (uint8_t*)&size1, sizeof(size1), offset1)){
+        size1 += _size;
+        writeAt(m_fd, (uint8_t*)&size1, sizeof(size1), offset1);
+    }
+    if (readAt(m_fd, (uint8_t*)&size2, sizeof(size2), offset2)){
+        size2 += _size;
+        writeAt(m_fd, (uint8_t*)&size2, sizeof(size2), offset2);
+    }
 }
 
 auto FileQueueManager::BuildTDMSStream(uint8_t* buffer_ch1,size_t size_ch1,uint8_t* buffer_ch2,size_t size_ch2, unsigned short resolution) -> std::iostream *{
-    TDMS::File outFile;
-    TDMS::WriterSegment segment;
-    vector<shared_ptr<TDMS::Metadata>> data;
-//    std::time_t tim_sec = std::time(0);
- //   std::time_t local = std::mktime(std::localtime(&tim_sec));
- //   std::time_t gmt = std::mktime(std::gmtime(&tim_sec));
- //   auto timezone = static_cast<long> (local - gmt);
-
-    auto root = segment.GenerateRoot();
-    root->TableOfContents.HasMetaData = true;
-    root->TableOfContents.HasRawData = true;
-    data.push_back(root);
-    auto group = segment.GenerateGroup("Group");
-    data.push_back(group);
-
-//    auto *time = TDMS::DataType::GetRawTimeValue(tim_sec + timezone);
-//    TDMS::DataType dataprop;
-//    dataprop.InitDataType(TDMS::DataType::TimeStamp,time);
-//    segment.AddProperties(root,"time_stamp_now",dataprop);
-
     auto data_type = TDMS::TDMSType::Integer8;
     if (resolution == 16) data_type = TDMS::TDMSType::Integer16;
     if (resolution == 32) data_type = TDMS::TDMSType::SingleFloat;
 
-    if (size_ch1 != 0)
-    {       
-        size_ch1 /= (resolution / 8);
-        auto channel = segment.GenerateChannel("Group", "ch1");
-        data.push_back(channel);
-        segment.AddRaw(channel, data_type, size_ch1 , buffer_ch1);
-    }
-
-    if (size_ch2 != 0)
-    {       
-        size_ch2 /= (resolution / 8);
-        auto channel = segment.GenerateChannel("Group", "ch2");
-        data.push_back(channel);
-        segment.AddRaw(channel, data_type, size_ch2 , buffer_ch2);
-    }
-
-    segment.LoadMetadata(data);
     stringstream *memory = new stringstream(ios_base::in | ios_base::out | ios_base::binary);
-    outFile.WriteMemory(*memory,segment);
+    m_tdmsWriter.Write(*memory, data_type, buffer_ch1, size_ch1 / (resolution / 8), buffer_ch2, size_ch2 / (resolution / 8));
     return memory;
 }
 
@@ -463,7 +610,7 @@ auto FileQueueManager::ReadBinInfo(std::iostream *buffer) -> BinInfo{
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-Queue::Queue(): m_useMemory(0)
+Queue::Queue(): m_useMemory(0), m_wakeUp(false)
 {}
 
 Queue::~Queue(){
@@ -476,11 +623,12 @@ auto Queue::pushQueue(std::iostream* buffer) -> void{
     auto Length = buffer->tellg();
     m_useMemory += Length;
     m_mutex.unlock();
+    m_cv.notify_one();
 }
 
 auto Queue::popQueue() -> std::iostream*{
     m_mutex.lock();
-    std::iostream* buffer = m_queue.front();
+    std::iostream* buffer = m_queue.empty() ? nullptr : m_queue.front();
     if (buffer != nullptr){
         m_queue.pop_front();
         buffer->seekg(0, std::ios::end);
@@ -492,6 +640,30 @@ auto Queue::popQueue() -> std::iostream*{
     return buffer;
 }
 
+auto Queue::popAllQueue(std::list<std::iostream*> &_list) -> void{
+    m_mutex.lock();
+    _list.splice(_list.end(), m_queue);
+    for(auto buffer : _list){
+        buffer->seekg(0, std::ios::end);
+        auto Length = buffer->tellg();
+        m_useMemory -= Length;
+    }
+    m_mutex.unlock();
+}
+
+auto Queue::waitQueue() -> void{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]{ return !m_queue.empty() || m_wakeUp; });
+    m_wakeUp = false;
+}
+
+auto Queue::wakeUpQueue() -> void{
+    m_mutex.lock();
+    m_wakeUp = true;
+    m_mutex.unlock();
+    m_cv.notify_all();
+}
+
 auto Queue::queueSize() -> long{
     m_mutex.lock();
     long size = m_queue.size();
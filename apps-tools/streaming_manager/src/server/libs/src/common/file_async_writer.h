@@ -1,3 +1,5 @@
+#pragma once
+
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
@@ -8,8 +10,11 @@
 #include <fstream>
 #include <iostream>
 #include "thread_cout.h"
+#include "common/TDMS/Writer.h"
 
 #define USING_FREE_SPACE 1024 * 1024 * 30 // Left free on disk 30 Mb
+#define WRITE_BATCH_SIZE 1024 * 1024 * 4  // Queued segments are coalesced into writes of up to 4 Mb
+#define WRITE_BATCH_ALIGN 4096
 
 enum Stream_FileType{
     TDMS_TYPE,
@@ -57,12 +62,17 @@ class Queue
 
         auto pushQueue(std::iostream* buffer) -> void;
         auto popQueue() -> std::iostream*;
+        auto popAllQueue(std::list<std::iostream*> &_list) -> void;
+        auto waitQueue() -> void;
+        auto wakeUpQueue() -> void;
 
         uint64_t m_useMemory;
 
     private:
         std::list<std::iostream*> m_queue;
         std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_wakeUp;
 };
 
 class FileQueueManager:public Queue{
@@ -91,11 +101,19 @@ class FileQueueManager:public Queue{
     private:
 
         auto Task() -> void;
+        auto AppendToBatch(std::iostream *buffer) -> bool;
+        auto AppendToIndex(std::iostream *buffer) -> void;
+        auto FlushBatch() -> bool;
+        auto CloseIndex() -> void;
 
         char endOfSegment[12];
-        std::fstream fs;
+        int  m_fd;
+        uint64_t m_fileOffset;
+        uint8_t *m_batchBuffer;
+        size_t   m_batchUsed;
+        int64_t  m_wavDataAdded;
         std::thread *th;
-        std::atomic_flag m_ThreadRun = ATOMIC_FLAG_INIT;
+        std::atomic_bool m_ThreadRun;
         bool m_threadWork;
         int  m_waitAllWrite;
         std::mutex       m_waitLock;
@@ -107,4 +125,10 @@ class FileQueueManager:public Queue{
         ulong m_freeSize;
         ulong m_hasWriteSize;
         uint64_t m_aviablePhyMemory;
+        TDMS::StreamWriter   m_tdmsWriter; // Keeps the metadata of the last TDMS segment
+        std::string          m_fileName;
+        bool                 m_indexEnabled; // TDMS index is kept only for files written from the start
+        int                  m_indexFd;
+        uint64_t             m_indexOffset;
+        std::vector<uint8_t> m_indexBatch;
 };
@@ -0,0 +1,210 @@
+#include <cstring>
+#include <algorithm>
+#include "sample_codec.h"
+
+#ifdef ARCH_ARM
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+    template<typename U>
+    auto bitWidth(U _value) -> uint32_t{
+        uint32_t width = 0;
+        while (_value) {
+            width++;
+            _value >>= 1;
+        }
+        return width;
+    }
+
+    // Number of low bits that are zero in every sample
+    template<typename S, typename U>
+    auto commonShiftScalar(const S *_src, size_t _n, U _acc) -> uint32_t{
+        for (size_t i = 0; i < _n; i++) {
+            _acc |= (U)_src[i];
+        }
+        if (_acc == 0) return 0;
+        uint32_t shift = 0;
+        while (!(_acc & 1)) {
+            shift++;
+            _acc >>= 1;
+        }
+        return shift;
+    }
+
+    auto commonShift(const int8_t *_src, size_t _n) -> uint32_t{
+        return commonShiftScalar<int8_t, uint8_t>(_src, _n, 0);
+    }
+
+    auto commonShift(const int16_t *_src, size_t _n) -> uint32_t{
+#ifdef ARCH_ARM
+        uint16x8_t acc = vdupq_n_u16(0);
+        size_t i = 0;
+        for (; i + 8 <= _n; i += 8) {
+            acc = vorrq_u16(acc, vld1q_u16((const uint16_t*)_src + i));
+        }
+        uint16x4_t r = vorr_u16(vget_low_u16(acc), vget_high_u16(acc));
+        r = vorr_u16(r, vext_u16(r, r, 2));
+        r = vorr_u16(r, vext_u16(r, r, 1));
+        return commonShiftScalar<int16_t, uint16_t>(_src + i, _n - i, vget_lane_u16(r, 0));
+#else
+        return commonShiftScalar<int16_t, uint16_t>(_src, _n, 0);
+#endif
+    }
+
+    // Zig-zag coded differences of the shifted samples, returns the OR of all values
+    template<typename S, typename U>
+    auto deltaBlockScalar(const S *_src, size_t _n, S &_prev, uint32_t _shift, U *_zz) -> U{
+        const uint32_t sign = sizeof(S) * 8 - 1;
+        U acc = 0;
+        S prev = _prev;
+        for (size_t i = 0; i < _n; i++) {
+            S cur = (S)(_src[i] >> _shift);
+            S d = (S)((U)cur - (U)prev);
+            U z = (U)(((U)d << 1) ^ (U)(d >> sign));
+            _zz[i] = z;
+            acc |= z;
+            prev = cur;
+        }
+        _prev = prev;
+        return acc;
+    }
+
+    auto deltaBlock(const int8_t *_src, size_t _n, int8_t &_prev, uint32_t _shift, uint8_t *_zz) -> uint8_t{
+        return deltaBlockScalar<int8_t, uint8_t>(_src, _n, _prev, _shift, _zz);
+    }
+
+    auto deltaBlock(const int16_t *_src, size_t _n, int16_t &_prev, uint32_t _shift, uint16_t *_zz) -> uint16_t{
+#ifdef ARCH_ARM
+        if (_n == CODEC_BLOCK_SAMPLES) {
+            const int16x8_t shift = vdupq_n_s16(-(int16_t)_shift);
+            int16x8_t prev = vdupq_n_s16(_prev);
+            uint16x8_t acc = vdupq_n_u16(0);
+            for (size_t i = 0; i < CODEC_BLOCK_SAMPLES; i += 8) {
+                int16x8_t cur = vshlq_s16(vld1q_s16(_src + i), shift);
+                int16x8_t d = vsubq_s16(cur, vextq_s16(prev, cur, 7));
+                uint16x8_t z = veorq_u16(vreinterpretq_u16_s16(vshlq_n_s16(d, 1)), vreinterpretq_u16_s16(vshrq_n_s16(d, 15)));
+                vst1q_u16(_zz + i, z);
+                acc = vorrq_u16(acc, z);
+                prev = cur;
+            }
+            _prev = vgetq_lane_s16(prev, 7);
+            uint16x4_t r = vorr_u16(vget_low_u16(acc), vget_high_u16(acc));
+            r = vorr_u16(r, vext_u16(r, r, 2));
+            r = vorr_u16(r, vext_u16(r, r, 1));
+            return vget_lane_u16(r, 0);
+        }
+#endif
+        return deltaBlockScalar<int16_t, uint16_t>(_src, _n, _prev, _shift, _zz);
+    }
+
+    template<typename U>
+    auto packBlock(const U *_zz, size_t _n, uint32_t _width, uint8_t *_dst) -> size_t{
+        uint64_t acc = 0;
+        uint32_t fill = 0;
+        uint8_t *out = _dst;
+        for (size_t i = 0; i < _n; i++) {
+            acc |= (uint64_t)_zz[i] << fill;
+            fill += _width;
+            if (fill >= 32) {
+                uint32_t word = (uint32_t)acc;
+                memcpy(out, &word, sizeof(word));
+                out += sizeof(word);
+                acc >>= 32;
+                fill -= 32;
+            }
+        }
+        while (fill > 0) {
+            *out++ = (uint8_t)acc;
+            acc >>= 8;
+            fill = fill > 8 ? fill - 8 : 0;
+        }
+        return out - _dst;
+    }
+
+    template<typename S, typename U>
+    auto encodeSamples(const S *_src, size_t _n, uint8_t *_dst, size_t _dstSize) -> size_t{
+        const uint32_t shift = commonShift(_src, _n);
+        U zz[CODEC_BLOCK_SAMPLES];
+        S prev = 0;
+        size_t pos = CODEC_HEADER_SIZE;
+        _dst[5] = (uint8_t)shift;
+        for (size_t i = 0; i < _n; i += CODEC_BLOCK_SAMPLES) {
+            size_t n = std::min<size_t>(CODEC_BLOCK_SAMPLES, _n - i);
+            uint32_t width = bitWidth(deltaBlock(_src + i, n, prev, shift, zz));
+            size_t bytes = (n * width + 7) / 8;
+            if (pos + 1 + bytes > _dstSize) return 0;
+            _dst[pos++] = (uint8_t)width;
+            pos += packBlock(zz, n, width, _dst + pos);
+        }
+        return pos;
+    }
+
+    template<typename S, typename U>
+    auto decodeSamples(const uint8_t *_src, size_t _size, S *_dst, size_t _n) -> bool{
+        const uint32_t bits = sizeof(S) * 8;
+        const uint32_t shift = _src[5];
+        if (shift >= bits) return false;
+        S prev = 0;
+        size_t pos = CODEC_HEADER_SIZE;
+        for (size_t i = 0; i < _n; i += CODEC_BLOCK_SAMPLES) {
+            size_t n = std::min<size_t>(CODEC_BLOCK_SAMPLES, _n - i);
+            if (pos >= _size) return false;
+            uint32_t width = _src[pos++];
+            if (width > bits) return false;
+            size_t bytes = (n * width + 7) / 8;
+            if (pos + bytes > _size) return false;
+            const uint8_t *in = _src + pos;
+            const uint32_t mask = (1u << width) - 1;
+            uint64_t acc = 0;
+            uint32_t avail = 0;
+            for (size_t k = 0; k < n; k++) {
+                while (avail < width) {
+                    acc |= (uint64_t)*in++ << avail;
+                    avail += 8;
+                }
+                U z = (U)(acc & mask);
+                acc >>= width;
+                avail -= width;
+                prev = (S)((U)prev + (U)((z >> 1) ^ (U)(0 - (z & 1))));
+                _dst[i + k] = (S)((U)prev << shift);
+            }
+            pos += bytes;
+        }
+        return true;
+    }
+}
+
+auto CSampleCodec::encode(const void *_src, size_t _size, uint32_t _bits, uint8_t *_dst, size_t _dstSize) -> size_t{
+    if ((_bits != 8 && _bits != 16) || _size % (_bits / 8) || _size > UINT32_MAX) return 0;
+    if (_dstSize < CODEC_HEADER_SIZE) return 0;
+    uint32_t size = (uint32_t)_size;
+    memcpy(_dst, &size, sizeof(size));
+    _dst[4] = (uint8_t)_bits;
+    _dst[6] = 0;
+    _dst[7] = 0;
+    if (_bits == 8)
+        return encodeSamples<int8_t, uint8_t>((const int8_t*)_src, _size, _dst, _dstSize);
+    return encodeSamples<int16_t, uint16_t>((const int16_t*)_src, _size / 2, _dst, _dstSize);
+}
+
+auto CSampleCodec::decodedSize(const uint8_t *_src, size_t _size) -> size_t{
+    if (_size < CODEC_HEADER_SIZE) return 0;
+    if (_src[4] != 8 && _src[4] != 16) return 0;
+    uint32_t size = 0;
+    memcpy(&size, _src, sizeof(size));
+    return size;
+}
+
+auto CSampleCodec::decode(const uint8_t *_src, size_t _size, void *_dst, size_t _dstSize) -> size_t{
+    size_t size = decodedSize(_src, _size);
+    if (size == 0 || size > _dstSize) return 0;
+    bool ret = false;
+    if (_src[4] == 8) {
+        ret = decodeSamples<int8_t, uint8_t>(_src, _size, (int8_t*)_dst, size);
+    } else if (size % 2 == 0) {
+        ret = decodeSamples<int16_t, uint16_t>(_src, _size, (int16_t*)_dst, size / 2);
+    }
+    return ret ? size : 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Lossless codec for ADC sample frames on the streaming link.
+// Samples of one channel are replaced by the zig-zag coded difference to the
+// previous sample and packed with the smallest bit width that fits a block of
+// CODEC_BLOCK_SAMPLES values. Low bits that are zero in every sample of the
+// frame (12 or 14 bit ADC data in a 16 bit word) are not transmitted at all.
+//
+// Stream layout:
+//   uint32 decoded size in bytes, uint8 sample bits (8 or 16), uint8 shift,
+//   uint16 reserved, then for each block one byte with the bit width followed
+//   by the packed values, least significant bit first.
+
+#define CODEC_BLOCK_SAMPLES 128
+#define CODEC_HEADER_SIZE   8
+
+class CSampleCodec
+{
+public:
+    // Returns the encoded size or 0 if the stream does not fit into _dstSize bytes
+    static auto encode(const void *_src, size_t _size, uint32_t _bits, uint8_t *_dst, size_t _dstSize) -> size_t;
+    // Size of the decoded data, 0 if the header is damaged
+    static auto decodedSize(const uint8_t *_src, size_t _size) -> size_t;
+    // Returns the number of decoded bytes or 0 if the stream is damaged or _dst is too small
+    static auto decode(const uint8_t *_src, size_t _size, void *_dst, size_t _dstSize) -> size_t;
+};
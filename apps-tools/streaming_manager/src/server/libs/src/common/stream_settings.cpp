@@ -19,6 +19,7 @@ CStreamSettings::CStreamSettings(){
     m_attenuator = A_1_1;
     m_calib = false;
     m_ac_dc = AC;
+    m_compression = false;
     reset();
 }
 
@@ -79,6 +80,7 @@ bool CStreamSettings::writeToFile(string _filename){
         root["attenuator"] = getAttenuator();
         root["calibration"] = getCalibration();
         root["coupling"] = getAC_DC();
+        root["compression"] = getCompression();
         Json::StreamWriterBuilder builder;
         const std::string json_file = Json::writeString(builder, root);
         ofstream file(_filename , 	ios::out | ios::trunc);
@@ -107,6 +109,7 @@ auto CStreamSettings::getJson()-> std::string{
         root["attenuator"] = getAttenuator();
         root["calibration"] = getCalibration();
         root["coupling"] = getAC_DC();
+        root["compression"] = getCompression();
         Json::StreamWriterBuilder builder;
         const std::string json = Json::writeString(builder, root);
         return json;
@@ -179,6 +182,7 @@ auto CStreamSettings::String()-> std::string{
                 break;
         }
         str = str + "AC/DC mode:\t\t" + coupling  +" (250-12 only)\n";
+        str = str + "Compression:\t\t" + (getCompression() ? "Enable" : "Disable")  +" (In network mode)\n";
 
         std::string  savetype = "ERROR";
         switch (getSaveType()) {
@@ -263,6 +267,8 @@ auto CStreamSettings::readFromFile(string _filename) -> bool {
         setCalibration(root["calibration"].asBool());
     if (root.isMember("coupling"))
         setAC_DC(static_cast<AC_DC>(root["coupling"].asInt()));
+    if (root.isMember("compression"))
+        setCompression(root["compression"].asBool());
     return isSetted();
 
 }
@@ -411,6 +417,11 @@ auto CStreamSettings::setValue(std::string key,uint32_t value) -> bool{
         setAC_DC(static_cast<AC_DC>(value));
         return true;
     }
+
+    if (key == "compression") {
+        setCompression(static_cast<bool>(value));
+        return true;
+    }
     return false;
 }
 
@@ -447,3 +458,11 @@ void CStreamSettings::setAC_DC(CStreamSettings::AC_DC _value){
 CStreamSettings::AC_DC CStreamSettings::getAC_DC(){
     return m_ac_dc;
 }
+
+void CStreamSettings::setCompression(bool _compression){
+    m_compression = _compression;
+}
+
+bool CStreamSettings::getCompression(){
+    return m_compression;
+}
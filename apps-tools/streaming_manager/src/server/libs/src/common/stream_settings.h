@@ -84,6 +84,9 @@ public:
     auto getCalibration() -> bool;
     auto setAC_DC(AC_DC _value) -> void;
     auto getAC_DC() -> AC_DC;
+    // Optional, older clients do not send it
+    auto setCompression(bool _compression) -> void;
+    auto getCompression() -> bool;
 
 private:
     bool m_Bport;
@@ -110,6 +113,7 @@ private:
     Attenuator  m_attenuator;
     AC_DC       m_ac_dc;
     bool        m_Bac_dc;
+    bool        m_compression;
 
 };
 
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <cstring>
+#include <csignal>
+#include <string>
+#include <thread>
+#include <chrono>
+
+#include "UioParser.h"
+#include "Generator.h"
+#include "DACStreamingApplication.h"
+#include "DACStreamingManager.h"
+
+// Plays a WAV or TDMS file from the local file system through the DAC
+
+static volatile sig_atomic_t stop = 0;
+
+void sigHandler (int){
+    stop = 1;
+}
+
+void installTermSignalHandler()
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(struct sigaction));
+    action.sa_handler = sigHandler;
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+}
+
+void usage(const char *_name)
+{
+    std::cerr << "Usage: " << _name << " <file.wav|file.tdms> [raw|volt] [-r]\n"
+              << "\traw|volt\tsample format of a TDMS file (default raw)\n"
+              << "\t-r\t\tplay the file in a loop until stopped\n";
+}
+
+bool endsWith(const std::string &_str, const std::string &_suffix)
+{
+    return _str.size() >= _suffix.size() &&
+           _str.compare(_str.size() - _suffix.size(), _suffix.size(), _suffix) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string filePath = argv[1];
+    auto fileType = endsWith(filePath, ".wav") ? CDACStreamingManager::WAV_TYPE : CDACStreamingManager::TDMS_TYPE;
+    auto mode = CDACStreamingManager::RAW;
+    bool repeat = false;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-r") {
+            repeat = true;
+        } else if (arg == "raw") {
+            mode = CDACStreamingManager::RAW;
+        } else if (arg == "volt") {
+            mode = CDACStreamingManager::VOLT;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    installTermSignalHandler();
+
+    CGenerator::Ptr gen = nullptr;
+    for (const UioT &uio : GetUioList())
+    {
+        if (uio.nodeName == "rp_dac")
+        {
+            gen = CGenerator::Create(uio, true , true );
+        }
+    }
+
+    if (!gen) {
+        std::cerr << "Error: rp_dac not found" << std::endl;
+        return 1;
+    }
+
+    auto manager = CDACStreamingManager::Create(fileType, filePath, mode);
+    manager->setRepeatInf(repeat);
+    manager->notifyStop = [](int){
+        std::cerr << "End of file\n";
+    };
+
+    CDACStreamingApplication app(manager, gen);
+    app.runNonBlock();
+    while (stop == 0 && app.isRun()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    app.stop(true);
+    std::cerr << "End of programm\n";
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DACAsioNetController.h"
+#include "DACJitterBuffer.h"
+#include "Generator.h"
+
+using namespace std;
+using clock_type = std::chrono::steady_clock;
+
+// Sustained rate benchmark of the DAC streaming path: a client streams packs of
+// dac_buf_size bytes per channel over loopback TCP, the server side feeds them
+// through the jitter buffer to a simulated DAC that takes one block per block
+// period. Samples carry a running counter, so gaps and corruption are detected.
+//
+// Usage: dac_net_test_bench [rate MS/s] [seconds] [port]
+// Without a rate the unthrottled throughput is measured first and the stream is
+// then played at 80 % of it.
+
+struct result_t {
+    double   seconds = 0;
+    uint64_t blocks = 0;
+    uint64_t errors = 0;
+    CDACJitterBuffer::Stats stats;
+};
+
+static const size_t block_samples = dac_buf_size / sizeof(int16_t);
+
+static auto fillPack(vector<int16_t> &_ch1, vector<int16_t> &_ch2, uint32_t _first) -> void {
+    for (size_t i = 0; i < block_samples; i++) {
+        _ch1[i] = (int16_t)(_first + i);
+        _ch2[i] = (int16_t)~(_first + i);
+    }
+}
+
+// Returns the number of wrong samples, _expected is the counter of the first one
+static auto checkBlock(const int16_t *_ch1, const int16_t *_ch2, uint32_t _expected) -> uint64_t {
+    uint64_t errors = 0;
+    for (size_t i = 0; i < block_samples; i++) {
+        if (_ch1[i] != (int16_t)(_expected + i) || _ch2[i] != (int16_t)~(_expected + i))
+            errors++;
+    }
+    return errors;
+}
+
+// rate == 0: the simulated DAC takes blocks as soon as they are available
+static auto run(double _rate, double _seconds, const string &_port) -> result_t {
+    result_t res;
+    atomic_bool connected(false);
+    atomic_bool sending(true);
+
+    auto server = new CDACAsioNetController();
+    server->setReceivedBufferLimit(4);
+    server->startAsioNet(asionet_simple::CAsioSocketSimple::ASMode::AS_SERVER, "127.0.0.1", _port);
+
+    auto client = new CDACAsioNetController();
+    client->addHandler(CDACAsioNetController::Events::CONNECTED, [&connected](std::string){
+        connected = true;
+    });
+    client->startAsioNet(asionet_simple::CAsioSocketSimple::ASMode::AS_CLIENT, "127.0.0.1", _port);
+
+    std::thread sender([&](){
+        vector<int16_t> ch1(block_samples), ch2(block_samples);
+        uint32_t counter = 0;
+        while (!connected && sending) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        while (sending) {
+            fillPack(ch1, ch2, counter);
+            if (!client->sendBuffer((uint8_t*)ch1.data(), dac_buf_size, (uint8_t*)ch2.data(), dac_buf_size))
+                break;
+            counter += block_samples;
+        }
+    });
+
+    CDACJitterBuffer jitter(dac_buf_size, 16, 4);
+    vector<int16_t> out1(block_samples), out2(block_samples);
+    const auto period = std::chrono::duration<double>(_rate > 0 ? block_samples / (_rate * 1e6) : 0);
+    uint32_t expected = 0;
+    bool synced = false;
+    bool started = false;
+    clock_type::time_point begin, next;
+
+    while (true) {
+        while (!jitter.isFull()) {
+            auto pack = server->getBuffer();
+            if (pack.empty) break;
+            if (!jitter.push(pack)) {
+                delete[] pack.ch1;
+                delete[] pack.ch2;
+            }
+        }
+
+        if (!started) {
+            if (!jitter.isReady()) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                continue;
+            }
+            started = true;
+            begin = next = clock_type::now();
+        }
+
+        auto now = clock_type::now();
+        if (now - begin >= std::chrono::duration<double>(_seconds)) break;
+        if (now < next) {
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+            continue;
+        }
+        // Catch up without bursts when the process was not scheduled in time
+        next += std::chrono::duration_cast<clock_type::duration>(period);
+
+        if (_rate == 0 && !jitter.isReady()) {
+            continue;
+        }
+        if (jitter.pop((uint8_t*)out1.data(), (uint8_t*)out2.data())) {
+            if (!synced) {
+                expected = (uint16_t)out1[0];
+                synced = true;
+            }
+            res.errors += checkBlock(out1.data(), out2.data(), expected);
+            expected = (uint16_t)(expected + block_samples);
+        } else {
+            // Part of the block may be real data, resynchronise on the next one
+            synced = false;
+        }
+        res.blocks++;
+    }
+    res.seconds = std::chrono::duration<double>(clock_type::now() - begin).count();
+    res.stats = jitter.getStats();
+
+    sending = false;
+    client->stopAsioNet();
+    server->stopAsioNet();
+    sender.join();
+    delete client;
+    delete server;
+    return res;
+}
+
+static auto print(const char *_name, double _rate, const result_t &_res) -> void {
+    double played = (_res.blocks - _res.stats.underruns) * block_samples / _res.seconds;
+    cout << _name << ": ";
+    if (_rate > 0)
+        cout << "requested " << _rate << " MS/s, ";
+    cout << "played " << played / 1e6 << " MS/s per channel ("
+         << played * 2 * sizeof(int16_t) / 1e6 << " MB/s), "
+         << "blocks " << _res.blocks << ", underruns " << _res.stats.underruns
+         << ", late " << _res.stats.late << ", lost " << _res.stats.lost
+         << ", bad samples " << _res.errors << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+    double rate = argc > 1 ? atof(argv[1]) : 0;
+    double seconds = argc > 2 ? atof(argv[2]) : 5;
+    int port = argc > 3 ? atoi(argv[3]) : 23121;
+    bool ok = true;
+
+    cout << fixed << setprecision(2);
+
+    if (rate == 0) {
+        auto res = run(0, seconds, to_string(port));
+        print("unthrottled", 0, res);
+        ok = res.errors == 0 && res.stats.late == 0 && res.stats.lost == 0;
+        rate = (res.blocks - res.stats.underruns) * block_samples / res.seconds / 1e6 * 0.8;
+        port++;
+    }
+
+    auto res = run(rate, seconds, to_string(port));
+    print("sustained", rate, res);
+    ok = ok && res.errors == 0 && res.stats.underruns == 0 && res.stats.late == 0 && res.stats.lost == 0;
+
+    cout << (ok ? "OK" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "file_async_writer.h"
+#include "File.h"
+
+using namespace std;
+
+// Round trip of the append-only TDMS stream: buffers are written through
+// FileQueueManager like the streaming server does, with changes of the buffer
+// size, channel count and data type in between, and read back with TDMS::File.
+// The file is read with its index, without it, and with a cut index so the tail
+// has to be scanned.
+//
+// Usage: tdms_stream_test [work directory]
+
+struct chunk_t {
+    int            channel;
+    TDMS::TDMSType type;
+    vector<uint8_t> data;
+};
+
+struct layout_t {
+    unsigned short resolution;
+    size_t         samples;
+    bool           ch1;
+    bool           ch2;
+    int            count;
+};
+
+// Joins the consecutive chunks of the same channel and type
+static auto merge(const vector<chunk_t> &_chunks, int _channel) -> vector<chunk_t> {
+    vector<chunk_t> out;
+    for (auto &c : _chunks) {
+        if (c.channel != _channel) continue;
+        if (out.empty() || out.back().type != c.type)
+            out.push_back({c.channel, c.type, {}});
+        out.back().data.insert(out.back().data.end(), c.data.begin(), c.data.end());
+    }
+    return out;
+}
+
+static auto readBack(const string &_file, int &_segments, int &_metaSegments) -> vector<chunk_t> {
+    vector<chunk_t> chunks;
+    // The reader traces every segment to stdout
+    stringstream trace;
+    auto coutBuf = cout.rdbuf(trace.rdbuf());
+    TDMS::File file;
+    auto segments = file.ReadFileWithoutClose(_file);
+    _segments = segments.size();
+    _metaSegments = 0;
+    for (auto &seg : segments) {
+        if (seg->TableOfContents.HasMetaData) _metaSegments++;
+        for (auto &meta : file.GetMetadata(seg)) {
+            if (meta->Path.size() < 2 || meta->RawData.Count == 0) continue;
+            int channel = meta->Path[1] == "'ch1'" ? 1 : (meta->Path[1] == "'ch2'" ? 2 : 0);
+            for (auto &raw : meta->RawData.DataType.GetRawVector())
+                chunks.push_back({channel, raw->dataType, vector<uint8_t>(raw->data, raw->data + raw->size)});
+        }
+    }
+    file.Close();
+    cout.rdbuf(coutBuf);
+    return chunks;
+}
+
+static auto check(const string &_name, const vector<chunk_t> &_expected, const vector<chunk_t> &_actual) -> bool {
+    bool ok = true;
+    for (int ch = 1; ch <= 2; ch++) {
+        auto e = merge(_expected, ch);
+        auto a = merge(_actual, ch);
+        bool same = e.size() == a.size();
+        for (size_t i = 0; same && i < e.size(); i++)
+            same = e[i].type == a[i].type && e[i].data == a[i].data;
+        if (!same) {
+            cout << _name << ": ch" << ch << " data mismatch\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static auto fileSize(const string &_file) -> long {
+    FILE *f = fopen(_file.c_str(), "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+int main(int argc, char* argv[])
+{
+    string dir = argc > 1 ? argv[1] : "/tmp";
+    string file = dir + "/tdms_stream_test.tdms";
+    string index = file + TDMS_INDEX_SUFFIX;
+
+    const layout_t layouts[] = {
+        {16, 8192, true,  true,  40},
+        {16, 4000, true,  true,  1},   // short buffer with lost samples
+        {16, 8192, true,  true,  20},
+        {16, 8192, true,  false, 10},
+        {16, 8192, false, true,  10},
+        {8,  8192, true,  true,  10},
+        {32, 8192, true,  true,  10},
+    };
+
+    vector<chunk_t> expected;
+    FileQueueManager fm;
+    fm.OpenFile(file, false);
+    fm.StartWrite(Stream_FileType::TDMS_TYPE);
+    uint32_t counter = 0;
+    int buffers = 0;
+    for (auto &l : layouts) {
+        auto type = l.resolution == 8 ? TDMS::TDMSType::Integer8 : (l.resolution == 16 ? TDMS::TDMSType::Integer16 : TDMS::TDMSType::SingleFloat);
+        size_t bytes = l.samples * (l.resolution / 8);
+        for (int i = 0; i < l.count; i++) {
+            vector<uint8_t> ch[2] = {vector<uint8_t>(bytes), vector<uint8_t>(bytes)};
+            for (int c = 0; c < 2; c++) {
+                for (size_t s = 0; s < l.samples; s++, counter++) {
+                    if (l.resolution == 8)  ((int8_t*)ch[c].data())[s] = (int8_t)counter;
+                    if (l.resolution == 16) ((int16_t*)ch[c].data())[s] = (int16_t)counter;
+                    if (l.resolution == 32) ((float*)ch[c].data())[s] = (float)counter * 0.5f;
+                }
+            }
+            if (l.ch1) expected.push_back({1, type, ch[0]});
+            if (l.ch2) expected.push_back({2, type, ch[1]});
+            auto stream = fm.BuildTDMSStream(l.ch1 ? ch[0].data() : nullptr, l.ch1 ? bytes : 0,
+                                             l.ch2 ? ch[1].data() : nullptr, l.ch2 ? bytes : 0, l.resolution);
+            if (!fm.AddBufferToWrite(stream)) {
+                cout << "Buffer is not queued\n";
+                return 1;
+            }
+            buffers++;
+        }
+    }
+    fm.StopWrite(true);
+    fm.CloseFile();
+
+    long dataSize = fileSize(file);
+    long indexSize = fileSize(index);
+    long rawSize = 0;
+    for (auto &c : expected) rawSize += c.data.size();
+    cout << "Buffers: " << buffers << ", file: " << dataSize << " bytes, raw data: " << rawSize
+         << " bytes, index: " << indexSize << " bytes\n";
+
+    bool ok = true;
+    int segments = 0, metaSegments = 0;
+
+    auto actual = readBack(file, segments, metaSegments);
+    cout << "With index: " << segments << " segments, " << metaSegments << " with metadata\n";
+    ok = check("With index", expected, actual) && ok;
+    ok = ok && segments == buffers;
+
+    // Keep the first half of the index, the rest of the file is scanned
+    {
+        FILE *f = fopen(index.c_str(), "rb");
+        vector<char> data(indexSize);
+        if (f) { data.resize(fread(data.data(), 1, data.size(), f)); fclose(f); }
+        f = fopen(index.c_str(), "wb");
+        if (f) { fwrite(data.data(), 1, data.size() / 2, f); fclose(f); }
+    }
+    actual = readBack(file, segments, metaSegments);
+    cout << "Cut index: " << segments << " segments\n";
+    ok = check("Cut index", expected, actual) && ok;
+    ok = ok && segments == buffers;
+
+    remove(index.c_str());
+    actual = readBack(file, segments, metaSegments);
+    cout << "Without index: " << segments << " segments\n";
+    ok = check("Without index", expected, actual) && ok;
+    ok = ok && segments == buffers;
+
+    remove(file.c_str());
+    cout << (ok ? "PASSED\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
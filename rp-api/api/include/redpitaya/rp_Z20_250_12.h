@@ -294,6 +294,31 @@ typedef enum {
 } rp_acq_trig_state_t;
 
 
+/**
+ * Zero-copy view of a window of the ADC ring buffer.
+ * The window [pos, pos + size) is split into up to two contiguous spans that point
+ * straight into FPGA memory. Samples are raw 32 bit words, only the lower ADC_BITS
+ * are valid. Calibrated volts are obtained as:
+ *   v = clamp(sign_extend(cnts), min_cnt, max_cnt) * scale + bias
+ * and calibrated counts as clamp(sign_extend(cnts), min_cnt, max_cnt) - dc_offs.
+ */
+typedef struct {
+    const volatile uint32_t* span1;  //!< First span, starts at pos
+    uint32_t size1;                  //!< Samples in span1
+    const volatile uint32_t* span2;  //!< Wrapped span, starts at the buffer beginning (NULL if not wrapped)
+    uint32_t size2;                  //!< Samples in span2
+    uint32_t pos;                    //!< Normalized start position of the window
+    uint32_t write_pointer;          //!< Write pointer when the view was taken
+    uint32_t generation;             //!< Acquisition generation (incremented on every acquisition start)
+    uint32_t bits;                   //!< Number of valid ADC bits in a sample word
+    float    scale;                  //!< Fused gain and calibration scale [V/count]
+    float    bias;                   //!< Fused calibrated DC offset [V]
+    int32_t  dc_offs;                //!< Calibrated DC offset [counts]
+    int32_t  min_cnt;                //!< Lower clamp bound on sign-extended counts
+    int32_t  max_cnt;                //!< Upper clamp bound on sign-extended counts
+} rp_acq_data_view_t;
+
+
 /**
  * Calibration parameters, stored in the EEPROM device
  */
@@ -680,6 +705,55 @@ int rp_AIpinGetValue(int unsigned pin, float* value);
  */
 int rp_AIpinGetValueRaw(int unsigned pin, uint32_t* value);
 
+/**
+ * Gets raw values from all four analog input pins in one call.
+ * @param values  array of 4 raw 12 bit XADC values, index is the pin
+ * @return        RP_OK - successful, RP_E* - failure
+ */
+int rp_AIpinGetValuesRaw(uint32_t* values);
+
+/**
+ * Gets values from all four analog input pins in volts in one call.
+ * @param values  array of 4 voltages, index is the pin
+ * @return        RP_OK - successful, RP_E* - failure
+ */
+int rp_AIpinGetValues(float* values);
+
+/**
+ * Starts continuous capture of all four analog input pins at the XADC
+ * sample rate. Scans are collected by the driver into a kernel ring buffer
+ * and read with rp_AIpinReadCapture(). While the capture runs, single pin
+ * reads fail.
+ * @param sample_rate  XADC sampling frequency in Hz, 0 keeps the current one
+ * @param buffer_size  ring size in scans, 0 selects the default
+ * @return             RP_OK - successful, RP_E* - failure
+ */
+int rp_AIpinStartCapture(uint32_t sample_rate, uint32_t buffer_size);
+
+/**
+ * Gets the sampling frequency of the XADC as set by the driver.
+ * @param sample_rate  sampling frequency in Hz
+ * @return             RP_OK - successful, RP_E* - failure
+ */
+int rp_AIpinGetCaptureRate(uint32_t* sample_rate);
+
+/**
+ * Reads a block of captured scans. A scan holds one raw 12 bit value of
+ * each pin, AI0 to AI3, so the buffer must hold 4 * size values.
+ * @param buffer      output buffer of raw values
+ * @param size        in: buffer size in scans, out: number of scans read
+ * @param timeout_ms  time to wait for data when none is ready, -1 waits forever
+ * @return            RP_OK - successful (size is 0 on timeout), RP_NOTS - the
+ *                    capture is not running or was stopped while waiting, RP_E* - failure
+ */
+int rp_AIpinReadCapture(uint16_t* buffer, uint32_t* size, int timeout_ms);
+
+/**
+ * Stops the continuous capture started with rp_AIpinStartCapture().
+ * @return  RP_OK - successful, RP_E* - failure
+ */
+int rp_AIpinStopCapture();
+
 
 /** @name Analog Outputs
  */
@@ -1148,6 +1222,30 @@ int rp_AcqGetDataV2(uint32_t pos, uint32_t* size, float* buffer1, float* buffer2
  */
 int rp_AcqGetDataV2D(uint32_t pos, uint32_t* size, double* buffer1, double* buffer2);
 
+/**
+ * Returns a zero-copy view of the ADC buffer from specified position and desired size.
+ * No data is copied. The view points into the acquisition memory and carries the calibration
+ * constants and a write pointer/generation stamp, so the caller can process the samples in place.
+ * @param channel Channel A or B for which we want to retrieve the ADC buffer view.
+ * @param pos Starting position of the ADC buffer window.
+ * @param size Length of the window. Limited to the ADC buffer size.
+ * @param view The view gets filled with the spans and conversion constants.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_AcqGetDataView(rp_channel_t channel, uint32_t pos, uint32_t size, rp_acq_data_view_t* view);
+
+/**
+ * Checks whether samples of a view have been overwritten since the view was taken.
+ * The check compares the acquisition generation and the progress of the write pointer.
+ * It is exact as long as it is called within one pass of the write pointer over the buffer.
+ * @param view View returned by rp_AcqGetDataView.
+ * @param valid Set to true if no sample of the window has been overwritten.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_AcqIsDataViewValid(const rp_acq_data_view_t* view, bool* valid);
+
 /**
  * Returns the ADC buffer in Volt units from the oldest sample to the newest one.
  * Output buffer must be at least 'size' long.
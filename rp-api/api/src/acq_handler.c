@@ -22,6 +22,7 @@
 #include "oscilloscope.h"
 #include "acq_handler.h"
 #include "calib.h"
+#include "convert.h"
 
 #ifdef Z20_250_12
 #include "rp-i2c-mcp47x6-c.h"
@@ -58,6 +59,9 @@ static rp_acq_ac_dc_mode_t power_mode_ch_b = RP_AC_MODE;
 /* @brief Determines whether TriggerDelay was set in time or sample units */
 static bool triggerDelayInNs = false;
 
+/* Incremented on every acquisition start, used to detect stale data views */
+static uint32_t acq_generation = 0;
+
 rp_acq_trig_src_t last_trig_src = RP_TRIG_SRC_DISABLED;
 
 /* @brief Default filter equalization coefficients */
@@ -661,6 +665,7 @@ int acq_GetChannelThresholdHyst(rp_channel_t channel, float* voltage)
 
 int acq_Start()
 {
+    acq_generation++;
     osc_WriteDataIntoMemory(true);
     return RP_OK;
 }
@@ -709,31 +714,36 @@ uint32_t acq_GetNormalizedDataPos(uint32_t pos)
     return (pos % ADC_BUFFER_SIZE);
 }
 
-int acq_GetDataRaw(rp_channel_t channel, uint32_t pos, uint32_t* size, int16_t* buffer)
+/* Gathers gain, calibrated offset and front end scale of a channel into fused conversion constants */
+static void getCnvParams(rp_channel_t channel, cnv_params_t *params)
 {
-
-    *size = MIN(*size, ADC_BUFFER_SIZE);
-
-    uint32_t cnts;
-
-    const volatile uint32_t* raw_buffer = getRawBuffer(channel);
-
+    float gainV;
     rp_pinState_t gain;
+    acq_GetGainV(channel, &gainV);
     acq_GetGain(channel, &gain);
-    
+
 #ifdef Z20_250_12
     rp_acq_ac_dc_mode_t power_mode;
     acq_GetAC_DC(channel,&power_mode);
     int32_t dc_offs = calib_getOffset(channel, gain,power_mode);
+    uint32_t calibScale = calib_GetFrontEndScale(channel, gain,power_mode);
 #else
     int32_t dc_offs = calib_getOffset(channel, gain);
+    uint32_t calibScale = calib_GetFrontEndScale(channel, gain);
 #endif
 
-    for (uint32_t i = 0; i < (*size); ++i) {
-        cnts = (raw_buffer[(pos + i) % ADC_BUFFER_SIZE]) & ADC_BITS_MASK;
+    cnv_InitParams(params, gainV, calibScale, dc_offs);
+}
 
-        buffer[i] = cmn_CalibCnts(ADC_BITS, cnts, dc_offs);
-    }
+int acq_GetDataRaw(rp_channel_t channel, uint32_t pos, uint32_t* size, int16_t* buffer)
+{
+
+    *size = MIN(*size, ADC_BUFFER_SIZE);
+
+    cnv_params_t params;
+    getCnvParams(channel, &params);
+
+    cnv_RingToCalibCnts(&params, getRawBuffer(channel), pos, *size, buffer);
 
     return RP_OK;
 }
@@ -743,13 +753,9 @@ int acq_GetDataRawV2(uint32_t pos, uint32_t* size, uint16_t* buffer, uint16_t* b
 {
 
     *size = MIN(*size, ADC_BUFFER_SIZE);
-    const volatile uint32_t* raw_buffer = getRawBuffer(RP_CH_1);
-    const volatile uint32_t* raw_buffer2 = getRawBuffer(RP_CH_2);
-    
-    for (uint32_t i = 0; i < (*size); ++i) {
-        buffer[i] =  (raw_buffer[(pos + i) % ADC_BUFFER_SIZE]) & ADC_BITS_MASK;
-        buffer2[i] = (raw_buffer2[(pos + i) % ADC_BUFFER_SIZE]) & ADC_BITS_MASK;
-    }
+
+    cnv_RingToRaw(getRawBuffer(RP_CH_1), pos, *size, buffer);
+    cnv_RingToRaw(getRawBuffer(RP_CH_2), pos, *size, buffer2);
 
     return RP_OK;
 }
@@ -800,28 +806,10 @@ int acq_GetDataV(rp_channel_t channel,  uint32_t pos, uint32_t* size, float* buf
 {
     *size = MIN(*size, ADC_BUFFER_SIZE);
 
-    float gainV;
-    rp_pinState_t gain;
-    acq_GetGainV(channel, &gainV);
-    acq_GetGain(channel, &gain);
-
-#ifdef Z20_250_12
-    rp_acq_ac_dc_mode_t power_mode;
-    acq_GetAC_DC(channel,&power_mode);
-    int32_t dc_offs = calib_getOffset(channel, gain,power_mode);
-    uint32_t calibScale = calib_GetFrontEndScale(channel, gain,power_mode);
-#else
-    int32_t dc_offs = calib_getOffset(channel, gain);
-    uint32_t calibScale = calib_GetFrontEndScale(channel, gain);
-#endif
-
-    const volatile uint32_t* raw_buffer = getRawBuffer(channel);
+    cnv_params_t params;
+    getCnvParams(channel, &params);
 
-    uint32_t cnts;
-    for (uint32_t i = 0; i < (*size); ++i) {
-        cnts = raw_buffer[(pos + i) % ADC_BUFFER_SIZE];
-        buffer[i] = cmn_CnvCntToV(ADC_BITS, cnts & ADC_BITS_MASK, gainV, calibScale, dc_offs, 0.0);
-    }
+    cnv_RingToV(&params, getRawBuffer(channel), pos, *size, buffer);
 
     return RP_OK;
 }
@@ -830,109 +818,78 @@ int acq_GetDataV2(uint32_t pos, uint32_t* size, float* buffer1, float* buffer2)
 {
     *size = MIN(*size, ADC_BUFFER_SIZE);
 
-    float gainV1, gainV2;
-    rp_pinState_t gain1, gain2;
-    acq_GetGainV(RP_CH_1, &gainV1);
-    acq_GetGain(RP_CH_1, &gain1);
-    acq_GetGainV(RP_CH_2, &gainV2);
-    acq_GetGain(RP_CH_2, &gain2);
+    cnv_params_t params1, params2;
+    getCnvParams(RP_CH_1, &params1);
+    getCnvParams(RP_CH_2, &params2);
 
-#ifdef Z20_250_12
-    rp_acq_ac_dc_mode_t power_mode1;
-    acq_GetAC_DC(RP_CH_1,&power_mode1);
-    int32_t dc_offs1 = calib_getOffset(RP_CH_1, gain1,power_mode1);
-    uint32_t calibScale1 = calib_GetFrontEndScale(RP_CH_1, gain1,power_mode1);
-#else
-    int32_t dc_offs1 = calib_getOffset(RP_CH_1, gain1);
-    uint32_t calibScale1 = calib_GetFrontEndScale(RP_CH_1, gain1);
-#endif
+    cnv_RingToV(&params1, getRawBuffer(RP_CH_1), pos, *size, buffer1);
+    cnv_RingToV(&params2, getRawBuffer(RP_CH_2), pos, *size, buffer2);
 
-#ifdef Z20_250_12
-    rp_acq_ac_dc_mode_t power_mode2;
-    acq_GetAC_DC(RP_CH_2,&power_mode2);
-    int32_t dc_offs2 = calib_getOffset(RP_CH_2, gain2,power_mode2);
-    uint32_t calibScale2 = calib_GetFrontEndScale(RP_CH_2, gain2,power_mode2);
-#else
-    int32_t dc_offs2 = calib_getOffset(RP_CH_2, gain2);
-    uint32_t calibScale2 = calib_GetFrontEndScale(RP_CH_2, gain2);
-#endif
+    return RP_OK;
+}
 
-    const volatile uint32_t* raw_buffer1 = getRawBuffer(RP_CH_1);
-    const volatile uint32_t* raw_buffer2 = getRawBuffer(RP_CH_2);
+int acq_GetDataV2D(uint32_t pos, uint32_t* size, double* buffer1, double* buffer2)
+{
+    *size = MIN(*size, ADC_BUFFER_SIZE);
 
-    uint32_t cnts1[*size];
-    uint32_t cnts2[*size];
-    uint32_t* ptr1 = cnts1;
-    uint32_t* ptr2 = cnts2;
+    cnv_params_t params1, params2;
+    getCnvParams(RP_CH_1, &params1);
+    getCnvParams(RP_CH_2, &params2);
 
-    for (uint32_t i = 0; i < (*size); ++i) {
-        *ptr1++ = raw_buffer1[pos];
-        *ptr2++ = raw_buffer2[pos];
-        pos = (pos + 1) % ADC_BUFFER_SIZE;
-    }
+    cnv_RingToVD(&params1, getRawBuffer(RP_CH_1), pos, *size, buffer1);
+    cnv_RingToVD(&params2, getRawBuffer(RP_CH_2), pos, *size, buffer2);
 
-    ptr1 = cnts1;
-    ptr2 = cnts2;
-
-    for (uint32_t i = 0; i < (*size); ++i) {
-        *buffer1++ = cmn_CnvCntToV(ADC_BITS, *ptr1++ & ADC_BITS_MASK, gainV1, calibScale1, dc_offs1, 0.0);
-        *buffer2++ = cmn_CnvCntToV(ADC_BITS, *ptr2++ & ADC_BITS_MASK, gainV2, calibScale2, dc_offs2, 0.0);
-    }
     return RP_OK;
 }
 
-int acq_GetDataV2D(uint32_t pos, uint32_t* size, double* buffer1, double* buffer2)
+int acq_GetDataView(rp_channel_t channel, uint32_t pos, uint32_t size, rp_acq_data_view_t* view)
 {
-    *size = MIN(*size, ADC_BUFFER_SIZE);
-
-    float gainV1, gainV2;
-    rp_pinState_t gain1, gain2;
-    acq_GetGainV(RP_CH_1, &gainV1);
-    acq_GetGain(RP_CH_1, &gain1);
-    acq_GetGainV(RP_CH_2, &gainV2);
-    acq_GetGain(RP_CH_2, &gain2);
+    if (view == NULL) {
+        return RP_EOOR;
+    }
 
-#ifdef Z20_250_12
-    rp_acq_ac_dc_mode_t power_mode1;
-    acq_GetAC_DC(RP_CH_1,&power_mode1);
-    int32_t dc_offs1 = calib_getOffset(RP_CH_1, gain1,power_mode1);
-    uint32_t calibScale1 = calib_GetFrontEndScale(RP_CH_1, gain1, power_mode1);
-#else
-    int32_t dc_offs1 = calib_getOffset(RP_CH_1, gain1);
-    uint32_t calibScale1 = calib_GetFrontEndScale(RP_CH_1, gain1);
-#endif
+    size = MIN(size, ADC_BUFFER_SIZE);
+    pos = acq_GetNormalizedDataPos(pos);
 
-#ifdef Z20_250_12
-    rp_acq_ac_dc_mode_t power_mode2;
-    acq_GetAC_DC(RP_CH_2,&power_mode2);
-    int32_t dc_offs2 = calib_getOffset(RP_CH_2, gain2,power_mode2);
-    uint32_t calibScale2 = calib_GetFrontEndScale(RP_CH_2, gain2,power_mode2);
-#else
-    int32_t dc_offs2 = calib_getOffset(RP_CH_2, gain2);
-    uint32_t calibScale2 = calib_GetFrontEndScale(RP_CH_2, gain2);
-#endif
+    cnv_params_t params;
+    getCnvParams(channel, &params);
 
-    const volatile uint32_t* raw_buffer1 = getRawBuffer(RP_CH_1);
-    const volatile uint32_t* raw_buffer2 = getRawBuffer(RP_CH_2);
+    const volatile uint32_t* raw_buffer = getRawBuffer(channel);
 
-    uint32_t cnts1[*size];
-    uint32_t cnts2[*size];
-    uint32_t* ptr1 = cnts1;
-    uint32_t* ptr2 = cnts2;
+    view->pos = pos;
+    view->size1 = MIN(size, ADC_BUFFER_SIZE - pos);
+    view->size2 = size - view->size1;
+    view->span1 = raw_buffer + pos;
+    view->span2 = view->size2 ? raw_buffer : NULL;
+    view->bits = ADC_BITS;
+    view->scale = params.scale;
+    view->bias = params.bias;
+    view->dc_offs = params.dc_offs;
+    view->min_cnt = params.min_cnt;
+    view->max_cnt = params.max_cnt;
+    view->generation = acq_generation;
+    return acq_GetWritePointer(&view->write_pointer);
+}
 
-    for (uint32_t i = 0; i < (*size); ++i) {
-        *ptr1++ = raw_buffer1[pos];
-        *ptr2++ = raw_buffer2[pos];
-        pos = (pos + 1) % ADC_BUFFER_SIZE;
+int acq_IsDataViewValid(const rp_acq_data_view_t* view, bool* valid)
+{
+    if (view == NULL || valid == NULL) {
+        return RP_EOOR;
     }
 
-    ptr1 = cnts1;
-    ptr2 = cnts2;
+    uint32_t wp;
+    ECHECK(acq_GetWritePointer(&wp));
 
-    for (uint32_t i = 0; i < (*size); ++i) {
-        *buffer1++ = (double)cmn_CnvCntToV(ADC_BITS, *ptr1++ & ADC_BITS_MASK, gainV1, calibScale1, dc_offs1, 0.0);
-        *buffer2++ = (double)cmn_CnvCntToV(ADC_BITS, *ptr2++ & ADC_BITS_MASK, gainV2, calibScale2, dc_offs2, 0.0);
+    if (view->generation != acq_generation) {
+        *valid = false;
+        return RP_OK;
     }
+
+    /* Samples written since the stamp are (write_pointer, wp], check if the window starts among them */
+    uint32_t advanced = acq_GetNormalizedDataPos(wp + ADC_BUFFER_SIZE - view->write_pointer);
+    uint32_t distance = acq_GetNormalizedDataPos(view->pos + ADC_BUFFER_SIZE - view->write_pointer - 1);
+    uint32_t size = view->size1 + view->size2;
+    *valid = advanced == 0 || (distance >= advanced && distance + size <= ADC_BUFFER_SIZE);
     return RP_OK;
 }
 
@@ -83,6 +83,8 @@ int acq_GetLatestDataRaw(rp_channel_t channel, uint32_t* size, int16_t* buffer);
 int acq_GetDataV(rp_channel_t channel, uint32_t pos, uint32_t* size, float* buffer);
 int acq_GetDataV2(uint32_t pos, uint32_t* size, float* buffer1, float* buffer2);
 int acq_GetDataV2D(uint32_t pos, uint32_t* size, double* buffer1, double* buffer2);
+int acq_GetDataView(rp_channel_t channel, uint32_t pos, uint32_t size, rp_acq_data_view_t* view);
+int acq_IsDataViewValid(const rp_acq_data_view_t* view, bool* valid);
 int acq_GetOldestDataV(rp_channel_t channel, uint32_t* size, float* buffer);
 int acq_GetLatestDataV(rp_channel_t channel, uint32_t* size, float* buffer);
 
@@ -0,0 +1,234 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library calibrated sample conversion kernels implementation
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdint.h>
+
+#include "common.h"
+#include "convert.h"
+
+#if defined(ARCH_ARM) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CNV_USE_NEON
+#endif
+
+/* Shift used to sign-extend ADC_BITS wide counts held in 32 bit FPGA words */
+#define CNV_SEXT_SHIFT (32 - ADC_BITS)
+
+static inline int32_t cnvSignExtend(uint32_t cnts)
+{
+    return ((int32_t)(cnts << CNV_SEXT_SHIFT)) >> CNV_SEXT_SHIFT;
+}
+
+static inline int32_t cnvClamp(const cnv_params_t *params, int32_t cnts)
+{
+    if (cnts < params->min_cnt) return params->min_cnt;
+    if (cnts > params->max_cnt) return params->max_cnt;
+    return cnts;
+}
+
+void cnv_InitParams(cnv_params_t *params, float adc_max_v, uint32_t calib_scale, int32_t calib_dc_off)
+{
+    /* Same math as cmn_CnvCntToV() with user_dc_off = 0, folded into one multiply-add */
+    double calibV = cmn_CalibFullScaleToVoltage(calib_scale);
+    double scale = (double)adc_max_v / (double)(1 << (ADC_BITS - 1)) * calibV / (FULL_SCALE_NORM / (double)adc_max_v);
+
+    params->scale = (float)scale;
+    params->bias = (float)(-(double)calib_dc_off * scale);
+    params->dc_offs = calib_dc_off;
+    /* cmn_CalibCnts() limits (cnts - dc_off) to [-2^(n-1), 2^(n-1)] */
+    params->min_cnt = -(1 << (ADC_BITS - 1)) + calib_dc_off;
+    params->max_cnt = (1 << (ADC_BITS - 1)) + calib_dc_off;
+}
+
+void cnv_SpanToCalibCnts(const cnv_params_t *params, const volatile uint32_t *src, uint32_t size, int16_t *dst)
+{
+    uint32_t i = 0;
+#ifdef CNV_USE_NEON
+    const int32x4_t vmin = vdupq_n_s32(params->min_cnt);
+    const int32x4_t vmax = vdupq_n_s32(params->max_cnt);
+    const int32x4_t voff = vdupq_n_s32(params->dc_offs);
+    for (; i + 8 <= size; i += 8) {
+        int32x4_t a = vreinterpretq_s32_u32(vld1q_u32((const uint32_t*)src + i));
+        int32x4_t b = vreinterpretq_s32_u32(vld1q_u32((const uint32_t*)src + i + 4));
+        a = vshrq_n_s32(vshlq_n_s32(a, CNV_SEXT_SHIFT), CNV_SEXT_SHIFT);
+        b = vshrq_n_s32(vshlq_n_s32(b, CNV_SEXT_SHIFT), CNV_SEXT_SHIFT);
+        a = vsubq_s32(vminq_s32(vmaxq_s32(a, vmin), vmax), voff);
+        b = vsubq_s32(vminq_s32(vmaxq_s32(b, vmin), vmax), voff);
+        vst1q_s16(dst + i, vcombine_s16(vmovn_s32(a), vmovn_s32(b)));
+    }
+#endif
+    for (; i < size; ++i) {
+        dst[i] = cnvClamp(params, cnvSignExtend(src[i])) - params->dc_offs;
+    }
+}
+
+void cnv_SpanToV(const cnv_params_t *params, const volatile uint32_t *src, uint32_t size, float *dst)
+{
+    uint32_t i = 0;
+#ifdef CNV_USE_NEON
+    const int32x4_t vmin = vdupq_n_s32(params->min_cnt);
+    const int32x4_t vmax = vdupq_n_s32(params->max_cnt);
+    const float32x4_t vbias = vdupq_n_f32(params->bias);
+    const float32_t scale = params->scale;
+    for (; i + 8 <= size; i += 8) {
+        int32x4_t a = vreinterpretq_s32_u32(vld1q_u32((const uint32_t*)src + i));
+        int32x4_t b = vreinterpretq_s32_u32(vld1q_u32((const uint32_t*)src + i + 4));
+        a = vshrq_n_s32(vshlq_n_s32(a, CNV_SEXT_SHIFT), CNV_SEXT_SHIFT);
+        b = vshrq_n_s32(vshlq_n_s32(b, CNV_SEXT_SHIFT), CNV_SEXT_SHIFT);
+        a = vminq_s32(vmaxq_s32(a, vmin), vmax);
+        b = vminq_s32(vmaxq_s32(b, vmin), vmax);
+        vst1q_f32(dst + i, vmlaq_n_f32(vbias, vcvtq_f32_s32(a), scale));
+        vst1q_f32(dst + i + 4, vmlaq_n_f32(vbias, vcvtq_f32_s32(b), scale));
+    }
+#endif
+    for (; i < size; ++i) {
+        dst[i] = (float)cnvClamp(params, cnvSignExtend(src[i])) * params->scale + params->bias;
+    }
+}
+
+void cnv_SpanToVD(const cnv_params_t *params, const volatile uint32_t *src, uint32_t size, double *dst)
+{
+    uint32_t i = 0;
+#ifdef CNV_USE_NEON
+    /* Cortex-A9 NEON has no double lanes: convert in float, widen on store */
+    float tmp[8];
+    const int32x4_t vmin = vdupq_n_s32(params->min_cnt);
+    const int32x4_t vmax = vdupq_n_s32(params->max_cnt);
+    const float32x4_t vbias = vdupq_n_f32(params->bias);
+    const float32_t scale = params->scale;
+    for (; i + 8 <= size; i += 8) {
+        int32x4_t a = vreinterpretq_s32_u32(vld1q_u32((const uint32_t*)src + i));
+        int32x4_t b = vreinterpretq_s32_u32(vld1q_u32((const uint32_t*)src + i + 4));
+        a = vshrq_n_s32(vshlq_n_s32(a, CNV_SEXT_SHIFT), CNV_SEXT_SHIFT);
+        b = vshrq_n_s32(vshlq_n_s32(b, CNV_SEXT_SHIFT), CNV_SEXT_SHIFT);
+        a = vminq_s32(vmaxq_s32(a, vmin), vmax);
+        b = vminq_s32(vmaxq_s32(b, vmin), vmax);
+        vst1q_f32(tmp, vmlaq_n_f32(vbias, vcvtq_f32_s32(a), scale));
+        vst1q_f32(tmp + 4, vmlaq_n_f32(vbias, vcvtq_f32_s32(b), scale));
+        for (int j = 0; j < 8; ++j) {
+            dst[i + j] = tmp[j];
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        dst[i] = (double)((float)cnvClamp(params, cnvSignExtend(src[i])) * params->scale + params->bias);
+    }
+}
+
+void cnv_SpanToRaw(const volatile uint32_t *src, uint32_t size, uint16_t *dst)
+{
+    uint32_t i = 0;
+#ifdef CNV_USE_NEON
+    const uint32x4_t vmask = vdupq_n_u32(ADC_BITS_MASK);
+    for (; i + 8 <= size; i += 8) {
+        uint32x4_t a = vandq_u32(vld1q_u32((const uint32_t*)src + i), vmask);
+        uint32x4_t b = vandq_u32(vld1q_u32((const uint32_t*)src + i + 4), vmask);
+        vst1q_u16(dst + i, vcombine_u16(vmovn_u32(a), vmovn_u32(b)));
+    }
+#endif
+    for (; i < size; ++i) {
+        dst[i] = src[i] & ADC_BITS_MASK;
+    }
+}
+
+/* First span length for a read of size samples starting at pos of the ADC ring */
+static inline uint32_t cnvFirstSpan(uint32_t *pos, uint32_t size)
+{
+    *pos %= ADC_BUFFER_SIZE;
+    return MIN(size, ADC_BUFFER_SIZE - *pos);
+}
+
+void cnv_RingToCalibCnts(const cnv_params_t *params, const volatile uint32_t *ring, uint32_t pos, uint32_t size, int16_t *dst)
+{
+    uint32_t first = cnvFirstSpan(&pos, size);
+    cnv_SpanToCalibCnts(params, ring + pos, first, dst);
+    cnv_SpanToCalibCnts(params, ring, size - first, dst + first);
+}
+
+void cnv_RingToV(const cnv_params_t *params, const volatile uint32_t *ring, uint32_t pos, uint32_t size, float *dst)
+{
+    uint32_t first = cnvFirstSpan(&pos, size);
+    cnv_SpanToV(params, ring + pos, first, dst);
+    cnv_SpanToV(params, ring, size - first, dst + first);
+}
+
+void cnv_RingToVD(const cnv_params_t *params, const volatile uint32_t *ring, uint32_t pos, uint32_t size, double *dst)
+{
+    uint32_t first = cnvFirstSpan(&pos, size);
+    cnv_SpanToVD(params, ring + pos, first, dst);
+    cnv_SpanToVD(params, ring, size - first, dst + first);
+}
+
+void cnv_RingToRaw(const volatile uint32_t *ring, uint32_t pos, uint32_t size, uint16_t *dst)
+{
+    uint32_t first = cnvFirstSpan(&pos, size);
+    cnv_SpanToRaw(ring + pos, first, dst);
+    cnv_SpanToRaw(ring, size - first, dst + first);
+}
+
+static inline int32_t cnvNormToCnt(float value, float full, int32_t max_cnt, uint32_t mask)
+{
+    if (value > 1.f) value = 1.f;
+    else if (value < -1.f) value = -1.f;
+
+    /* Scaling by a power of two and the truncated remainder are exact, so the
+     * rounding decision is the same as round() on the scaled value */
+    float x = value * full;
+    int32_t cnts = (int32_t)x;
+    float rem = x - (float)cnts;
+    if (rem >= 0.5f) cnts++;
+    else if (rem <= -0.5f) cnts--;
+
+    if (cnts > max_cnt) cnts = max_cnt;
+    return cnts & mask;
+}
+
+void cnv_SpanFromNorm(const float *src, uint32_t size, uint32_t field_len, volatile int32_t *dst)
+{
+    const float full = (float)(1 << (field_len - 1));
+    const int32_t max_cnt = (1 << (field_len - 1)) - 1;
+    const uint32_t mask = (1u << field_len) - 1;
+    uint32_t i = 0;
+#ifdef CNV_USE_NEON
+    const float32x4_t vmin = vdupq_n_f32(-1.f);
+    const float32x4_t vmax = vdupq_n_f32(1.f);
+    const float32x4_t vhalf = vdupq_n_f32(0.5f);
+    const float32x4_t vnhalf = vdupq_n_f32(-0.5f);
+    const int32x4_t vmaxcnt = vdupq_n_s32(max_cnt);
+    const int32x4_t vmask = vdupq_n_s32(mask);
+    for (; i + 8 <= size; i += 8) {
+        for (int j = 0; j < 8; j += 4) {
+            float32x4_t x = vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i + j), vmin), vmax), full);
+            int32x4_t cnts = vcvtq_s32_f32(x);
+            float32x4_t rem = vsubq_f32(x, vcvtq_f32_s32(cnts));
+            /* Comparison masks are -1 where true */
+            cnts = vsubq_s32(cnts, vreinterpretq_s32_u32(vcgeq_f32(rem, vhalf)));
+            cnts = vaddq_s32(cnts, vreinterpretq_s32_u32(vcleq_f32(rem, vnhalf)));
+            cnts = vminq_s32(cnts, vmaxcnt);
+            vst1q_s32((int32_t*)dst + i + j, vandq_s32(cnts, vmask));
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        dst[i] = cnvNormToCnt(src[i], full, max_cnt, mask);
+    }
+}
+
+void cnv_RingFromNorm(const float *src, uint32_t size, uint32_t field_len, volatile int32_t *ring, uint32_t ring_size, uint32_t pos)
+{
+    pos %= ring_size;
+    uint32_t first = MIN(size, ring_size - pos);
+    cnv_SpanFromNorm(src, first, field_len, ring + pos);
+    cnv_SpanFromNorm(src + first, size - first, field_len, ring);
+}
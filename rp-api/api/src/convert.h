@@ -0,0 +1,59 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library calibrated sample conversion kernels interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef SRC_CONVERT_H_
+#define SRC_CONVERT_H_
+
+#include <stdint.h>
+#include "rp_cross.h"
+
+/**
+ * Per channel conversion constants.
+ * Calibrated DC offset and ADC limits are folded into clamp bounds on the raw
+ * sign-extended counts, gain and calibration scale into a single scale and bias:
+ * volts = clamp(cnts, min_cnt, max_cnt) * scale + bias
+ */
+typedef struct {
+    float   scale;
+    float   bias;
+    int32_t dc_offs;
+    int32_t min_cnt;
+    int32_t max_cnt;
+} cnv_params_t;
+
+void cnv_InitParams(cnv_params_t *params, float adc_max_v, uint32_t calib_scale, int32_t calib_dc_off);
+
+/* Contiguous span kernels (no ring wrap) */
+void cnv_SpanToCalibCnts(const cnv_params_t *params, const volatile uint32_t *src, uint32_t size, int16_t *dst);
+void cnv_SpanToV(const cnv_params_t *params, const volatile uint32_t *src, uint32_t size, float *dst);
+void cnv_SpanToVD(const cnv_params_t *params, const volatile uint32_t *src, uint32_t size, double *dst);
+void cnv_SpanToRaw(const volatile uint32_t *src, uint32_t size, uint16_t *dst);
+
+/* Ring buffer readers: split [pos, pos + size) into at most two contiguous spans */
+void cnv_RingToCalibCnts(const cnv_params_t *params, const volatile uint32_t *ring, uint32_t pos, uint32_t size, int16_t *dst);
+void cnv_RingToV(const cnv_params_t *params, const volatile uint32_t *ring, uint32_t pos, uint32_t size, float *dst);
+void cnv_RingToVD(const cnv_params_t *params, const volatile uint32_t *ring, uint32_t pos, uint32_t size, double *dst);
+void cnv_RingToRaw(const volatile uint32_t *ring, uint32_t pos, uint32_t size, uint16_t *dst);
+
+/*
+ * DAC direction: normalized samples (full scale = 1) to field_len wide two's
+ * complement counts. Matches cmn_CnvVToCnt(field_len, src * max_v, max_v, false, 0, 0, 0)
+ * for a power of two max_v: samples are limited to [-1, 1] and rounded half away from zero.
+ */
+void cnv_SpanFromNorm(const float *src, uint32_t size, uint32_t field_len, volatile int32_t *dst);
+
+/* Writes size samples to the DAC ring of ring_size words starting at pos, wrapping once */
+void cnv_RingFromNorm(const float *src, uint32_t size, uint32_t field_len, volatile int32_t *ring, uint32_t ring_size, uint32_t pos);
+
+#endif /* SRC_CONVERT_H_ */
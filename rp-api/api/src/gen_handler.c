@@ -13,6 +13,7 @@
 */
 
 #include <float.h>
+#include <string.h>
 #include "math.h"
 #include "common.h"
 #include "generate.h"
@@ -55,6 +56,34 @@ rp_gen_gain_t chA_gain                    , chB_gain                    ;
 float chA_arbitraryData[BUFFER_LENGTH];
 float chB_arbitraryData[BUFFER_LENGTH];
 
+/*
+ * Normalized waveform tables of recent settings. Frequency, amplitude and offset
+ * are FPGA registers and the phase rotates the table as it is written out, so
+ * only the parameters that change the shape itself are part of the key.
+ */
+#define WAVEFORM_CACHE_SIZE 4
+
+typedef struct {
+    rp_waveform_t       waveform;
+    int32_t             shape;          /* square edge or PWM high length in samples */
+    float               frequency;      /* the rest is used by sweeps only */
+    float               sweepStartFreq;
+    float               sweepEndFreq;
+    float               phaseRad;
+    rp_gen_sweep_mode_t sweepMode;
+    rp_gen_sweep_dir_t  sweepDir;
+} waveform_key_t;
+
+typedef struct {
+    bool           valid;
+    uint32_t       used;
+    waveform_key_t key;
+    float          data[BUFFER_LENGTH];
+} waveform_cache_t;
+
+static waveform_cache_t waveform_cache[WAVEFORM_CACHE_SIZE];
+static uint32_t         waveform_cache_tick = 0;
+
 int gen_SetDefaultValues() {
     gen_Disable(RP_CH_1);
     gen_Disable(RP_CH_2);
@@ -658,15 +687,63 @@ int gen_SynchroniseSM() {
     return generate_ResetSM();
 }
 
+static int synthesis_squareEdge(float frequency) {
+    // Various locally used constants - HW specific parameters
+#ifdef Z20_250_12
+        const int trans0 = 1;
+        const int trans1 = 100;
+#else
+        const int trans0 = 30;
+        const int trans1 = 300;
+#endif
+
+    int trans = (int) (frequency / 1e6 * trans1); // 300 samples at 1 MHz
+
+    if (trans <= 10)  trans = trans0;
+    return trans;
+}
+
+static float *lookup_waveform(const waveform_key_t *key, float frequency, float dutyCycle) {
+    waveform_cache_t *slot = &waveform_cache[0];
+    for (int i = 0; i < WAVEFORM_CACHE_SIZE; i++) {
+        waveform_cache_t *entry = &waveform_cache[i];
+        if (entry->valid && memcmp(&entry->key, key, sizeof(waveform_key_t)) == 0) {
+            entry->used = ++waveform_cache_tick;
+            return entry->data;
+        }
+        if (!entry->valid || (slot->valid && entry->used < slot->used)) {
+            slot = entry;
+        }
+    }
+
+    // Miss: synthesize into the least recently used entry
+    uint16_t buf_size = BUFFER_LENGTH;
+    switch (key->waveform) {
+        case RP_WAVEFORM_SINE     : synthesis_sin      (slot->data,buf_size);                 break;
+        case RP_WAVEFORM_TRIANGLE : synthesis_triangle (slot->data,buf_size);                 break;
+        case RP_WAVEFORM_SQUARE   : synthesis_square   (frequency, slot->data,buf_size);      break;
+        case RP_WAVEFORM_RAMP_UP  : synthesis_rampUp   (slot->data,buf_size);                 break;
+        case RP_WAVEFORM_RAMP_DOWN: synthesis_rampDown (slot->data,buf_size);                 break;
+        case RP_WAVEFORM_DC       : synthesis_DC       (slot->data,buf_size);                 break;
+        case RP_WAVEFORM_DC_NEG   : synthesis_DC_NEG   (slot->data,buf_size);                 break;
+        case RP_WAVEFORM_PWM      : synthesis_PWM      (dutyCycle, slot->data,buf_size);      break;
+        case RP_WAVEFORM_SWEEP    : synthesis_sweep(key->frequency,key->sweepStartFreq,key->sweepEndFreq,key->phaseRad,key->sweepMode,key->sweepDir, slot->data, buf_size);break;
+        default:                    return NULL;
+    }
+    slot->key = *key;
+    slot->valid = true;
+    slot->used = ++waveform_cache_tick;
+    return slot->data;
+}
+
 int synthesize_signal(rp_channel_t channel) {
-    float data[BUFFER_LENGTH];
     rp_waveform_t waveform;
     rp_gen_sweep_mode_t sweep_mode;
     rp_gen_sweep_dir_t sweep_dir;
     float dutyCycle, frequency,sweepStartFreq , sweepEndFreq;
-    uint32_t size = BUFFER_LENGTH;
     int32_t phase;
     float  phaseRad = 0;
+    float *arbitraryData;
 
     if (channel == RP_CH_1) {
         waveform = chA_waveform;
@@ -676,9 +753,9 @@ int synthesize_signal(rp_channel_t channel) {
         sweepEndFreq = chA_sweepEndFrequency;
         sweep_mode = chA_sweepMode;
         sweep_dir = chA_sweepDir;
-        size = chA_size;
         phase = (chA_phase * BUFFER_LENGTH / 360.0);
         phaseRad = chA_phase/180.0 *  M_PI;
+        arbitraryData = chA_arbitraryData;
     }
     else if (channel == RP_CH_2) {
         waveform = chB_waveform;
@@ -688,31 +765,49 @@ int synthesize_signal(rp_channel_t channel) {
         sweepEndFreq = chB_sweepEndFrequency;
         sweep_mode = chB_sweepMode;
         sweep_dir = chB_sweepDir;
-        size = chB_size;
         phase = (chB_phase * BUFFER_LENGTH / 360.0);
         phaseRad = chB_phase/180.0 *  M_PI;
+        arbitraryData = chB_arbitraryData;
     }
     else{
         return RP_EPN;
     }
-    uint16_t buf_size = BUFFER_LENGTH;
     if(waveform == RP_WAVEFORM_SWEEP) phase = 0;
-    
+
+    if (waveform == RP_WAVEFORM_ARBITRARY) {
+        uint32_t size = channel == RP_CH_1 ? chA_arb_size : chB_arb_size;
+        return generate_writeData(channel, arbitraryData, phase, size);
+    }
+
+    // Zeroed so the padding does not take part in the key comparison
+    waveform_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.waveform = waveform;
     switch (waveform) {
-        case RP_WAVEFORM_SINE     : synthesis_sin      (data,buf_size);                 break;
-        case RP_WAVEFORM_TRIANGLE : synthesis_triangle (data,buf_size);                 break;
-        case RP_WAVEFORM_SQUARE   : synthesis_square   (frequency, data,buf_size);      break;
-        case RP_WAVEFORM_RAMP_UP  : synthesis_rampUp   (data,buf_size);                 break;
-        case RP_WAVEFORM_RAMP_DOWN: synthesis_rampDown (data,buf_size);                 break;
-        case RP_WAVEFORM_DC       : synthesis_DC       (data,buf_size);                 break;
-        case RP_WAVEFORM_DC_NEG   : synthesis_DC_NEG   (data,buf_size);                 break; 
-        case RP_WAVEFORM_PWM      : synthesis_PWM      (dutyCycle, data,buf_size);      break;
-        case RP_WAVEFORM_ARBITRARY: synthesis_arbitrary(channel, data, &size);          break;
-        case RP_WAVEFORM_SWEEP    : synthesis_sweep(frequency,sweepStartFreq,sweepEndFreq,phaseRad,sweep_mode,sweep_dir, data, buf_size);break;
-        default:                    return RP_EIPV;
-    }
-    if (waveform != RP_WAVEFORM_ARBITRARY) size = buf_size;
-    return generate_writeData(channel, data, phase, size);
+        case RP_WAVEFORM_SQUARE:
+            // Only the edge length depends on the frequency
+            key.shape = synthesis_squareEdge(frequency);
+            break;
+        case RP_WAVEFORM_PWM:
+            key.shape = (int) (BUFFER_LENGTH * dutyCycle);
+            break;
+        case RP_WAVEFORM_SWEEP:
+            key.frequency = frequency;
+            key.sweepStartFreq = sweepStartFreq;
+            key.sweepEndFreq = sweepEndFreq;
+            key.phaseRad = phaseRad;
+            key.sweepMode = sweep_mode;
+            key.sweepDir = sweep_dir;
+            break;
+        default:
+            break;
+    }
+
+    float *data = lookup_waveform(&key, frequency, dutyCycle);
+    if (data == NULL) {
+        return RP_EIPV;
+    }
+    return generate_writeData(channel, data, phase, BUFFER_LENGTH);
 }
 
 int synthesis_sin(float *data_out,uint16_t buffSize) {
@@ -788,18 +883,7 @@ int synthesis_arbitrary(rp_channel_t channel, float *data_out, uint32_t * size)
 }
 
 int synthesis_square(float frequency, float *data_out,uint16_t buffSize) {
-    // Various locally used constants - HW specific parameters
-#ifdef Z20_250_12
-        const int trans0 = 1;
-        const int trans1 = 100;
-#else
-        const int trans0 = 30;
-        const int trans1 = 300;
-#endif
-    
-    int trans = (int) (frequency / 1e6 * trans1); // 300 samples at 1 MHz
-
-    if (trans <= 10)  trans = trans0;
+    int trans = synthesis_squareEdge(frequency);
 
     for(int unsigned i = 0; i < BUFFER_LENGTH; i++) {
         int unsigned x = (i % buffSize);
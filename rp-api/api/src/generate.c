@@ -20,6 +20,7 @@
 #include "common.h"
 #include "generate.h"
 #include "calib.h"
+#include "convert.h"
 
 static volatile generate_control_t *generate = NULL;
 static volatile int32_t *data_chA = NULL;
@@ -422,16 +423,11 @@ int generate_writeData(rp_channel_t channel, float *data, int32_t start, uint32_
             dataOut = data_chA,
             dataOut = data_chB)
 
-    volatile ch_properties_t *properties;
-    getChannelPropertiesAddress(&properties, channel);
     generate_setWrapCounter(channel, length);
 
-    //rp_calib_params_t calib = calib_GetParams();
-    int dc_offs = 0;//channel == RP_CH_1 ? calib.be_ch1_dc_offs: calib.be_ch2_dc_offs;
-    uint32_t amp_max = 0; //channel == RP_CH_1 ? calib.be_ch1_fs: calib.be_ch2_fs;
+    // Amplitude and offset are set in FPGA registers, the buffer holds the
+    // normalized shape rotated by the phase
     if (start < 0) start += BUFFER_LENGTH;
-    for(int i = start; i < start+BUFFER_LENGTH; i++) {
-        dataOut[i % BUFFER_LENGTH] = cmn_CnvVToCnt(DATA_BIT_LENGTH, data[i-start] * AMPLITUDE_MAX , AMPLITUDE_MAX, false, amp_max, dc_offs, 0.0);
-    }
+    cnv_RingFromNorm(data, BUFFER_LENGTH, DATA_BIT_LENGTH, dataOut, BUFFER_LENGTH, start);
     return RP_OK;
 }
@@ -24,6 +24,7 @@
 #include "calib.h"
 #include "generate.h"
 #include "gen_handler.h"
+#include "xadc.h"
 
 static char version[50];
 int g_api_state = 0;
@@ -71,6 +72,7 @@ int rp_Release()
 {
     osc_Release();
     generate_Release();
+    xadc_Release();
     ams_Release();
     hk_Release();
     calib_Release();
@@ -429,18 +431,7 @@ int rp_ApinGetRange(rp_apin_t pin, float* min_val, float* max_val) {
  */
 
 int rp_AIpinGetValueRaw(int unsigned pin, uint32_t* value) {
-    FILE *fp;
-    switch (pin) {
-        case 0:  fp = fopen ("/sys/devices/soc0/amba_pl/83c00000.xadc_wiz/iio:device1/in_voltage11_vaux8_raw", "r");  break;
-        case 1:  fp = fopen ("/sys/devices/soc0/amba_pl/83c00000.xadc_wiz/iio:device1/in_voltage9_vaux0_raw" , "r");  break;
-        case 2:  fp = fopen ("/sys/devices/soc0/amba_pl/83c00000.xadc_wiz/iio:device1/in_voltage10_vaux1_raw", "r");  break;
-        case 3:  fp = fopen ("/sys/devices/soc0/amba_pl/83c00000.xadc_wiz/iio:device1/in_voltage12_vaux9_raw", "r");  break;
-        default:
-            return RP_EPN;
-    }
-    int r = !fscanf (fp, "%d", value);
-    fclose(fp);
-    return r;
+    return xadc_GetValueRaw(pin, value);
 }
 
 int rp_AIpinGetValue(int unsigned pin, float* value) {
@@ -450,6 +441,35 @@ int rp_AIpinGetValue(int unsigned pin, float* value) {
     return result;
 }
 
+int rp_AIpinGetValuesRaw(uint32_t* values) {
+    return xadc_GetValuesRaw(values);
+}
+
+int rp_AIpinGetValues(float* values) {
+    uint32_t values_raw[XADC_PINS] = { 0 };
+    int result = rp_AIpinGetValuesRaw(values_raw);
+    for (int pin = 0; pin < XADC_PINS; pin++) {
+        values[pin] = (((float)values_raw[pin] / ANALOG_IN_MAX_VAL_INTEGER) * (ANALOG_IN_MAX_VAL - ANALOG_IN_MIN_VAL)) + ANALOG_IN_MIN_VAL;
+    }
+    return result;
+}
+
+int rp_AIpinStartCapture(uint32_t sample_rate, uint32_t buffer_size) {
+    return xadc_StartCapture(sample_rate, buffer_size);
+}
+
+int rp_AIpinGetCaptureRate(uint32_t* sample_rate) {
+    return xadc_GetCaptureRate(sample_rate);
+}
+
+int rp_AIpinReadCapture(uint16_t* buffer, uint32_t* size, int timeout_ms) {
+    return xadc_ReadCapture(buffer, size, timeout_ms);
+}
+
+int rp_AIpinStopCapture() {
+    return xadc_StopCapture();
+}
+
 
 /**
  * Analog Outputs
@@ -718,6 +738,16 @@ int rp_AcqGetDataV2D(uint32_t pos, uint32_t* size, double* buffer1, double* buff
     return acq_GetDataV2D(pos, size, buffer1, buffer2);
 }
 
+int rp_AcqGetDataView(rp_channel_t channel, uint32_t pos, uint32_t size, rp_acq_data_view_t* view)
+{
+    return acq_GetDataView(channel, pos, size, view);
+}
+
+int rp_AcqIsDataViewValid(const rp_acq_data_view_t* view, bool* valid)
+{
+    return acq_IsDataViewValid(view, valid);
+}
+
 int rp_AcqGetOldestDataV(rp_channel_t channel, uint32_t* size, float* buffer)
 {
     return acq_GetOldestDataV(channel, size, buffer);
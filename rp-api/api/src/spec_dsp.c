@@ -24,6 +24,10 @@
 #include "kiss_fftr.h"
 #include "rp_cross.h"
 
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
 #ifndef M_PI
     #define M_PI 3.14159265358979323846
 #endif
@@ -54,6 +58,18 @@ kiss_fft_cpx         *rp_kiss_fft_out1 = NULL;
 kiss_fft_cpx         *rp_kiss_fft_out2 = NULL;
 kiss_fftr_cfg         rp_kiss_fft_cfg  = NULL;
 
+/* Single precision path used by rp_spectr_fft_decimate() */
+typedef struct {
+    float r;
+    float i;
+} rp_spectr_cpx_t;
+
+float                *rp_window_f = NULL;
+rp_spectr_cpx_t      *rp_fft_buf1 = NULL;
+rp_spectr_cpx_t      *rp_fft_buf2 = NULL;
+rp_spectr_cpx_t      *rp_fft_tw   = NULL;  // twiddles of all stages, less than N in total
+int                   rp_fft_len  = 0;
+
 
 window_mode_t         g_window_mode = HANNING;
 int                   g_mode = 0;
@@ -167,8 +183,10 @@ int rp_spectr_window_init(window_mode_t mode){
     rp_spectr_window_clean();
     
     rp_window = (double *)malloc(rp_get_spectr_signal_max_length() * sizeof(double));
-    if(rp_window == NULL) {
+    rp_window_f = (float *)malloc(rp_get_spectr_signal_max_length() * sizeof(float));
+    if(rp_window == NULL || rp_window_f == NULL) {
         fprintf(stderr, "rp_spectr_window_init() can not allocate mem");
+        rp_spectr_window_clean();
         return -1;
     }
 
@@ -246,6 +264,9 @@ int rp_spectr_window_init(window_mode_t mode){
             rp_spectr_window_clean();
             return -1;
     }
+    for(i = 0; i < SPECTR_FPGA_SIG_LEN; i++) {
+        rp_window_f[i] = rp_window[i];
+    }
     return 0;
 }
 
@@ -266,6 +287,10 @@ int rp_spectr_window_clean(){
         free(rp_window);
         rp_window = NULL;
     }
+    if(rp_window_f) {
+        free(rp_window_f);
+        rp_window_f = NULL;
+    }
     return 0;
 }
 
@@ -298,6 +323,29 @@ int rp_spectr_fft_init()
 
     rp_kiss_fft_cfg = kiss_fftr_alloc(rp_get_spectr_signal_length(), 0, NULL, NULL);
 
+    rp_fft_len = rp_get_spectr_signal_length();
+    rp_fft_buf1 = (rp_spectr_cpx_t *)malloc(rp_fft_len * sizeof(rp_spectr_cpx_t));
+    rp_fft_buf2 = (rp_spectr_cpx_t *)malloc(rp_fft_len * sizeof(rp_spectr_cpx_t));
+    rp_fft_tw = (rp_spectr_cpx_t *)malloc(rp_fft_len * sizeof(rp_spectr_cpx_t));
+    if(!rp_kiss_fft_out1 || !rp_kiss_fft_out2 || !rp_kiss_fft_cfg ||
+       !rp_fft_buf1 || !rp_fft_buf2 || !rp_fft_tw) {
+        fprintf(stderr, "rp_spectr_fft_init() can not allocate mem");
+        rp_spectr_fft_clean();
+        return -1;
+    }
+
+    /* Radix-4 stage with sub-transform length n uses exp(-2*pi*i*k*p/n)
+     * for k = 1, 2, 3 and p < n/4 */
+    rp_spectr_cpx_t *tw = rp_fft_tw;
+    for(int n = rp_fft_len; n >= 4; n /= 4) {
+        for(int p = 0; p < n / 4; p++) {
+            for(int k = 1; k <= 3; k++, tw++) {
+                tw->r = cos(2 * M_PI * k * p / n);
+                tw->i = -sin(2 * M_PI * k * p / n);
+            }
+        }
+    }
+
     return 0;
 }
 
@@ -316,6 +364,11 @@ int rp_spectr_fft_clean()
         free(rp_kiss_fft_cfg);
         rp_kiss_fft_cfg = NULL;
     }
+    free(rp_fft_buf1);
+    free(rp_fft_buf2);
+    free(rp_fft_tw);
+    rp_fft_buf1 = rp_fft_buf2 = rp_fft_tw = NULL;
+    rp_fft_len = 0;
     return 0;
 }
 
@@ -336,69 +389,260 @@ int rp_spectr_fft(double *cha_in, double *chb_in,
     kiss_fftr(rp_kiss_fft_cfg, (kiss_fft_scalar *)cha_in, rp_kiss_fft_out1);
     kiss_fftr(rp_kiss_fft_cfg, (kiss_fft_scalar *)chb_in, rp_kiss_fft_out2);
     for(i = 0; i < SPECTR_OUT_SIG_LENGTH; i++) {                     // FFT limited to fs/2, specter of amplitudes
-        cha_o[i] = sqrt(pow(rp_kiss_fft_out1[i].r, 2) +
-                        pow(rp_kiss_fft_out1[i].i, 2));
-        chb_o[i] = sqrt(pow(rp_kiss_fft_out2[i].r, 2) +
-                        pow(rp_kiss_fft_out2[i].i, 2));
+        cha_o[i] = sqrt(rp_kiss_fft_out1[i].r * rp_kiss_fft_out1[i].r +
+                        rp_kiss_fft_out1[i].i * rp_kiss_fft_out1[i].i);
+        chb_o[i] = sqrt(rp_kiss_fft_out2[i].r * rp_kiss_fft_out2[i].r +
+                        rp_kiss_fft_out2[i].i * rp_kiss_fft_out2[i].i);
     }
     return 0;
 }
 
+/* Factor from FFT magnitude to the units of the current mode. For dBm the
+ * magnitude is squared first (V -> RMS -> power), the factor then includes
+ * the square of the voltage scaling and the impedance. */
+static double rp_spectr_mode_scale(int *power)
+{
+    const double k = 2 / rp_window_sum;
+    *power = 0;
+    switch(rp_spectr_get_mode()) {
+        case 0: // dBm
+            *power = 1;
+            return (k / 1.414213562) * (k / 1.414213562) / c_imp;
+        case 1: // V
+            return k;
+        case 2: // dBu
+            return k / 1.414213562;
+        default:
+            return 0;
+    }
+}
+
 int rp_spectr_decimate(double *cha_in, double *chb_in, 
                        float **cha_out, float **chb_out,
                        int in_len, int out_len)
 {
     int step;
-    int i, j;
+    int i, j, k;
+    int power;
     float *cha_o = *cha_out;
     float *chb_o = *chb_out;
+    double scale;
 
     if(!cha_in || !chb_in || !*cha_out || !*chb_out)
         return -1;
 
+    scale = rp_spectr_mode_scale(&power);
+
     step = (int)round((float)in_len / (float)out_len);
     if(step < 1)
         step = 1;
     for(i = 0, j = 0; i < out_len; i++, j+=step) {
-        int k=j;
+        double cha_s = 0;
+        double chb_s = 0;
 
         if(j >= in_len) {
             fprintf(stderr, "rp_spectr_decimate() index too high\n");
             return -1;
         }
-        cha_o[i] = 0;
-        chb_o[i] = 0;
-	
-
-        for(k=j; k < j+step; k++) {
-	
-            double cha_p = 0;
-            double chb_p = 0;
-            //dBm
-            if (rp_spectr_get_mode() == 0){
-                /* Conversion to power (Watts) */
-                // V -> RMS -> power
-                cha_p = pow((cha_in[k] / rp_window_sum * 2) / 1.414213562, 2) / c_imp;
-                chb_p = pow((chb_in[k] / rp_window_sum * 2) / 1.414213562, 2) / c_imp;
-            }
-            // V
-            if (rp_spectr_get_mode() == 1){
-                cha_p = cha_in[k] / rp_window_sum  * 2; 
-                chb_p = chb_in[k] / rp_window_sum  * 2; 
+
+        // Summing the power expressed in Watts (or the amplitude) associated to each FFT bin
+        if(power) {
+            for(k = j; k < j + step; k++) {
+                cha_s += cha_in[k] * cha_in[k];
+                chb_s += chb_in[k] * chb_in[k];
             }
-            // dBu
-            if (rp_spectr_get_mode() == 2){
-                cha_p = cha_in[k] / rp_window_sum  * 2 / 1.414213562;
-                chb_p = chb_in[k] / rp_window_sum  * 2 / 1.414213562; 
+        } else {
+            for(k = j; k < j + step; k++) {
+                cha_s += cha_in[k];
+                chb_s += chb_in[k];
             }
+        }
+        cha_o[i] = cha_s * scale / step;
+        chb_o[i] = chb_s * scale / step;
+    }
+    return 0;
+}
 
-            
-       
-            cha_o[i] += (double)cha_p;  // Summing the power expressed in Watts associated to each FFT bin
-            chb_o[i] += (double)chb_p;
+/* One radix-4 Stockham stage: s interleaved sub-transforms of length n are
+ * split in 4. Results are in natural order after the last stage, so no bit
+ * reversal pass is needed. tw holds W^p, W^2p, W^3p for each p < n/4. */
+static void rp_spectr_fft_stage4(const rp_spectr_cpx_t *x, rp_spectr_cpx_t *y,
+                                 const rp_spectr_cpx_t *tw, int n, int s)
+{
+    const int m = n / 4;
+    int p, q;
+
+    for(p = 0; p < m; p++, tw += 3) {
+        const rp_spectr_cpx_t w1 = tw[0], w2 = tw[1], w3 = tw[2];
+        const rp_spectr_cpx_t *a0 = x + s * p;
+        const rp_spectr_cpx_t *a1 = a0 + s * m;
+        const rp_spectr_cpx_t *a2 = a1 + s * m;
+        const rp_spectr_cpx_t *a3 = a2 + s * m;
+        rp_spectr_cpx_t *y0 = y + s * 4 * p;
+        rp_spectr_cpx_t *y1 = y0 + s;
+        rp_spectr_cpx_t *y2 = y1 + s;
+        rp_spectr_cpx_t *y3 = y2 + s;
+
+        q = 0;
+#ifdef __ARM_NEON
+        for(; q + 4 <= s; q += 4) {
+            float32x4x2_t v0 = vld2q_f32(&a0[q].r);
+            float32x4x2_t v1 = vld2q_f32(&a1[q].r);
+            float32x4x2_t v2 = vld2q_f32(&a2[q].r);
+            float32x4x2_t v3 = vld2q_f32(&a3[q].r);
+            float32x4x2_t o;
+            float32x4_t b0r = vaddq_f32(v0.val[0], v2.val[0]);
+            float32x4_t b0i = vaddq_f32(v0.val[1], v2.val[1]);
+            float32x4_t b1r = vsubq_f32(v0.val[0], v2.val[0]);
+            float32x4_t b1i = vsubq_f32(v0.val[1], v2.val[1]);
+            float32x4_t b2r = vaddq_f32(v1.val[0], v3.val[0]);
+            float32x4_t b2i = vaddq_f32(v1.val[1], v3.val[1]);
+            float32x4_t b3r = vsubq_f32(v1.val[1], v3.val[1]);   // -i * (a1 - a3)
+            float32x4_t b3i = vsubq_f32(v3.val[0], v1.val[0]);
+            float32x4_t cr, ci;
+
+            o.val[0] = vaddq_f32(b0r, b2r);
+            o.val[1] = vaddq_f32(b0i, b2i);
+            vst2q_f32(&y0[q].r, o);
+
+            cr = vaddq_f32(b1r, b3r);
+            ci = vaddq_f32(b1i, b3i);
+            o.val[0] = vmlsq_n_f32(vmulq_n_f32(cr, w1.r), ci, w1.i);
+            o.val[1] = vmlaq_n_f32(vmulq_n_f32(cr, w1.i), ci, w1.r);
+            vst2q_f32(&y1[q].r, o);
+
+            cr = vsubq_f32(b0r, b2r);
+            ci = vsubq_f32(b0i, b2i);
+            o.val[0] = vmlsq_n_f32(vmulq_n_f32(cr, w2.r), ci, w2.i);
+            o.val[1] = vmlaq_n_f32(vmulq_n_f32(cr, w2.i), ci, w2.r);
+            vst2q_f32(&y2[q].r, o);
+
+            cr = vsubq_f32(b1r, b3r);
+            ci = vsubq_f32(b1i, b3i);
+            o.val[0] = vmlsq_n_f32(vmulq_n_f32(cr, w3.r), ci, w3.i);
+            o.val[1] = vmlaq_n_f32(vmulq_n_f32(cr, w3.i), ci, w3.r);
+            vst2q_f32(&y3[q].r, o);
+        }
+#endif
+        for(; q < s; q++) {
+            const float b0r = a0[q].r + a2[q].r, b0i = a0[q].i + a2[q].i;
+            const float b1r = a0[q].r - a2[q].r, b1i = a0[q].i - a2[q].i;
+            const float b2r = a1[q].r + a3[q].r, b2i = a1[q].i + a3[q].i;
+            const float b3r = a1[q].i - a3[q].i, b3i = a3[q].r - a1[q].r;
+            float cr, ci;
+
+            y0[q].r = b0r + b2r;
+            y0[q].i = b0i + b2i;
+            cr = b1r + b3r;
+            ci = b1i + b3i;
+            y1[q].r = cr * w1.r - ci * w1.i;
+            y1[q].i = cr * w1.i + ci * w1.r;
+            cr = b0r - b2r;
+            ci = b0i - b2i;
+            y2[q].r = cr * w2.r - ci * w2.i;
+            y2[q].i = cr * w2.i + ci * w2.r;
+            cr = b1r - b3r;
+            ci = b1i - b3i;
+            y3[q].r = cr * w3.r - ci * w3.i;
+            y3[q].i = cr * w3.i + ci * w3.r;
+        }
+    }
+}
+
+/* Last stage for odd powers of two, sub-transforms of length 2 */
+static void rp_spectr_fft_stage2(const rp_spectr_cpx_t *x, rp_spectr_cpx_t *y, int s)
+{
+    int q;
+
+    for(q = 0; q < s; q++) {
+        y[q].r = x[q].r + x[q + s].r;
+        y[q].i = x[q].i + x[q + s].i;
+        y[q + s].r = x[q].r - x[q + s].r;
+        y[q + s].i = x[q].i - x[q + s].i;
+    }
+}
+
+int rp_spectr_fft_decimate(float *cha_in, float *chb_in,
+                           float **cha_out, float **chb_out,
+                           int out_len)
+{
+    const int len = SPECTR_FPGA_SIG_LEN;
+    const int in_len = SPECTR_OUT_SIG_LENGTH;
+    float *cha_o = *cha_out;
+    float *chb_o = *chb_out;
+    rp_spectr_cpx_t *x = rp_fft_buf1;
+    rp_spectr_cpx_t *y = rp_fft_buf2;
+    const rp_spectr_cpx_t *tw = rp_fft_tw;
+    int i, j, k, n, s, step, power;
+    float scale;
+
+    if(!cha_in || !chb_in || !*cha_out || !*chb_out)
+        return -1;
+
+    if(!rp_fft_buf1 || !rp_window_f || rp_fft_len != len) {
+        fprintf(stderr, "rp_spectr_fft_decimate() not initialized\n");
+        return -1;
+    }
+
+    step = (int)round((float)in_len / (float)out_len);
+    if(step < 1)
+        step = 1;
+    if((out_len - 1) * step >= in_len) {
+        fprintf(stderr, "rp_spectr_fft_decimate() index too high\n");
+        return -1;
+    }
+
+    /* Both channels windowed into one complex signal: CH1 real, CH2 imaginary */
+    for(i = 0; i < len; i++) {
+        x[i].r = cha_in[i] * rp_window_f[i];
+        x[i].i = chb_in[i] * rp_window_f[i];
+    }
+
+    for(n = len, s = 1; n > 1; n /= 4, s *= 4) {
+        if(n >= 4) {
+            rp_spectr_fft_stage4(x, y, tw, n, s);
+            tw += 3 * (n / 4);
+        } else {
+            rp_spectr_fft_stage2(x, y, s);
+        }
+        rp_spectr_cpx_t *t = x;
+        x = y;
+        y = t;
+    }
+
+    /* Separate the channels with Z[k] and conj(Z[N-k]), which gives 2*A[k]
+     * and 2*i*B[k]. The squared magnitudes are therefore 4 times too big. */
+    scale = rp_spectr_mode_scale(&power);
+    if(power)
+        scale /= 4;
+    else
+        scale /= 2;
+
+    for(i = 0, j = 0; i < out_len; i++, j += step) {
+        float cha_s = 0;
+        float chb_s = 0;
+        int end = j + step < in_len ? j + step : in_len;
+
+        for(k = j; k < end; k++) {
+            const rp_spectr_cpx_t z = x[k];
+            const rp_spectr_cpx_t zn = x[(len - k) & (len - 1)];
+            const float ar = z.r + zn.r;
+            const float ai = z.i - zn.i;
+            const float br = z.i + zn.i;
+            const float bi = zn.r - z.r;
+            const float pa = ar * ar + ai * ai;
+            const float pb = br * br + bi * bi;
+
+            if(power) {
+                cha_s += pa;
+                chb_s += pb;
+            } else {
+                cha_s += sqrtf(pa);
+                chb_s += sqrtf(pb);
+            }
         }
-        cha_o[i] /= step;
-        chb_o[i] /= step;
+        cha_o[i] = cha_s * scale / (end - j);
+        chb_o[i] = chb_s * scale / (end - j);
     }
     return 0;
 }
@@ -71,6 +71,18 @@ int rp_spectr_decimate(double *cha_in, double *chb_in,
                        float **cha_out, float **chb_out,
                        int in_len, int out_len);
 
+/*
+ * Single precision path fusing rp_spectr_window_filter(), rp_spectr_fft() and
+ * rp_spectr_decimate(). Both channels are windowed into one complex FFT (CH1
+ * real, CH2 imaginary) and separated after the transform, then converted to
+ * the units of the current mode and reduced to out_len bins in the same pass.
+ * Inputs length: SPECTR_FPGA_SIG_LEN, needs rp_spectr_window_init() and
+ * rp_spectr_fft_init() for the current signal length.
+*/
+int rp_spectr_fft_decimate(float *cha_in, float *chb_in,
+                           float **cha_out, float **chb_out,
+                           int out_len);
+
 /* Converts amplitude of the signal to Voltage (k_c2v - counts 2 voltage) and
  * to dBm (k_dBm) & convert to linear scale (20*log10())
  * Input & Outputs of length SPECTR_OUT_SIG_LEN (decimated length)
@@ -0,0 +1,377 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library XADC (slow analog inputs) module implementation
+ *
+ * Single values are read from the IIO sysfs attributes, which are opened
+ * once and re-read with pread(). Continuous capture enables the four inputs
+ * as IIO scan elements, starts the XADC sample rate trigger and reads whole
+ * scans from the IIO character device, the kernel buffer serving as ring.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include "common.h"
+#include "rp_cross.h"
+#include "xadc.h"
+
+// IIO channel names of AI0 - AI3
+static const char* const xadc_channels[XADC_PINS] = {
+    "in_voltage11_vaux8",
+    "in_voltage9_vaux0",
+    "in_voltage10_vaux1",
+    "in_voltage12_vaux9"
+};
+
+static pthread_mutex_t xadc_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int xadc_raw_fd[XADC_PINS] = { -1, -1, -1, -1 };
+
+// Capture state: scan layout as reported by the driver
+static int      xadc_dev_fd = -1;
+static uint32_t xadc_scan_words = 0;
+static uint32_t xadc_scan_pos[XADC_PINS];
+static uint32_t xadc_shift = 0;
+static uint32_t xadc_mask = 0xFFF;
+// Readers wait without the lock, stopping signals this eventfd to wake them
+static int      xadc_wake_fd = -1;
+static uint32_t xadc_capture_id = 0;
+
+static int xadc_WriteAttr(const char* path, const char* value) {
+    int fd = open(path, O_WRONLY);
+    if (fd < 0) {
+        return RP_EFOB;
+    }
+    ssize_t len = strlen(value);
+    int ret = write(fd, value, len) == len ? RP_OK : RP_EFWB;
+    close(fd);
+    return ret;
+}
+
+static int xadc_ReadAttr(const char* path, char* value, size_t size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return RP_EFOB;
+    }
+    ssize_t len = read(fd, value, size - 1);
+    close(fd);
+    if (len <= 0) {
+        return RP_EFRB;
+    }
+    value[len] = '\0';
+    return RP_OK;
+}
+
+static int xadc_WriteScanAttr(const char* channel, const char* attr, const char* value) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/scan_elements/%s_%s", XADC_SYSFS_PATH, channel, attr);
+    return xadc_WriteAttr(path, value);
+}
+
+static int xadc_ReadScanAttr(const char* channel, const char* attr, char* value, size_t size) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/scan_elements/%s_%s", XADC_SYSFS_PATH, channel, attr);
+    return xadc_ReadAttr(path, value, size);
+}
+
+// Opens the raw value attribute of the pin, caller holds xadc_mutex
+static int xadc_OpenRaw(int unsigned pin) {
+    if (xadc_raw_fd[pin] < 0) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s_raw", XADC_SYSFS_PATH, xadc_channels[pin]);
+        xadc_raw_fd[pin] = open(path, O_RDONLY);
+        if (xadc_raw_fd[pin] < 0) {
+            return RP_EFOB;
+        }
+    }
+    return RP_OK;
+}
+
+static int xadc_ReadRaw(int unsigned pin, uint32_t* value) {
+    char buf[16];
+    int ret = xadc_OpenRaw(pin);
+    if (ret != RP_OK) {
+        return ret;
+    }
+    // sysfs attributes are regenerated on every read from offset 0
+    ssize_t len = pread(xadc_raw_fd[pin], buf, sizeof(buf) - 1, 0);
+    if (len <= 0) {
+        return RP_EFRB;
+    }
+    buf[len] = '\0';
+    *value = strtoul(buf, NULL, 10);
+    return RP_OK;
+}
+
+static void xadc_CloseRaw() {
+    for (int pin = 0; pin < XADC_PINS; pin++) {
+        if (xadc_raw_fd[pin] >= 0) {
+            close(xadc_raw_fd[pin]);
+            xadc_raw_fd[pin] = -1;
+        }
+    }
+}
+
+// Finds the sample rate trigger registered by the XADC driver
+static int xadc_FindTrigger(char* name, size_t size) {
+    DIR* dir = opendir(XADC_TRIG_PATH);
+    struct dirent* ent;
+    int ret = RP_EFOB;
+
+    if (dir == NULL) {
+        return RP_EFOB;
+    }
+    while ((ent = readdir(dir)) != NULL && ret != RP_OK) {
+        char path[512];
+        if (strncmp(ent->d_name, "trigger", 7) != 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s/name", XADC_TRIG_PATH, ent->d_name);
+        if (xadc_ReadAttr(path, name, size) != RP_OK) {
+            continue;
+        }
+        name[strcspn(name, "\n")] = '\0';
+        if (strncmp(name, "xadc", 4) == 0 && strstr(name, "samplerate") != NULL) {
+            ret = RP_OK;
+        }
+    }
+    closedir(dir);
+    return ret;
+}
+
+// Enables only the four inputs and reads their order and format in a scan
+static int xadc_SetupScan() {
+    DIR* dir;
+    struct dirent* ent;
+    char path[512];
+    char value[32];
+    uint32_t index[XADC_PINS];
+
+    snprintf(path, sizeof(path), "%s/scan_elements", XADC_SYSFS_PATH);
+    dir = opendir(path);
+    if (dir == NULL) {
+        return RP_EFOB;
+    }
+    while ((ent = readdir(dir)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (len > 3 && strcmp(ent->d_name + len - 3, "_en") == 0) {
+            snprintf(path, sizeof(path), "%s/scan_elements/%s", XADC_SYSFS_PATH, ent->d_name);
+            xadc_WriteAttr(path, "0");
+        }
+    }
+    closedir(dir);
+
+    for (int pin = 0; pin < XADC_PINS; pin++) {
+        ECHECK(xadc_WriteScanAttr(xadc_channels[pin], "en", "1"));
+        ECHECK(xadc_ReadScanAttr(xadc_channels[pin], "index", value, sizeof(value)));
+        index[pin] = strtoul(value, NULL, 10);
+    }
+
+    // Scan elements are stored in the order of their index
+    for (int pin = 0; pin < XADC_PINS; pin++) {
+        xadc_scan_pos[pin] = 0;
+        for (int other = 0; other < XADC_PINS; other++) {
+            if (index[other] < index[pin]) {
+                xadc_scan_pos[pin]++;
+            }
+        }
+    }
+    xadc_scan_words = XADC_PINS;
+
+    // Format is [be|le]:[s|u]bits/storagebits[Xrepeat]>>shift, e.g. le:u12/16>>4
+    char endian, sign;
+    unsigned bits, storage, shift = 0;
+    ECHECK(xadc_ReadScanAttr(xadc_channels[0], "type", value, sizeof(value)));
+    if (sscanf(value, "%ce:%c%u/%u>>%u", &endian, &sign, &bits, &storage, &shift) < 4 ||
+        storage != 16 || bits == 0 || bits > 16) {
+        return RP_EUF;
+    }
+    xadc_shift = shift;
+    xadc_mask = (1u << bits) - 1;
+    return RP_OK;
+}
+
+int xadc_GetValueRaw(int unsigned pin, uint32_t* value) {
+    if (pin >= XADC_PINS) {
+        return RP_EPN;
+    }
+    pthread_mutex_lock(&xadc_mutex);
+    int ret = xadc_ReadRaw(pin, value);
+    pthread_mutex_unlock(&xadc_mutex);
+    return ret;
+}
+
+int xadc_GetValuesRaw(uint32_t* values) {
+    int ret = RP_OK;
+    pthread_mutex_lock(&xadc_mutex);
+    for (int pin = 0; pin < XADC_PINS && ret == RP_OK; pin++) {
+        ret = xadc_ReadRaw(pin, &values[pin]);
+    }
+    pthread_mutex_unlock(&xadc_mutex);
+    return ret;
+}
+
+static int xadc_StopCaptureLocked() {
+    if (xadc_dev_fd < 0) {
+        return RP_OK;
+    }
+    close(xadc_dev_fd);
+    xadc_dev_fd = -1;
+    xadc_capture_id++;
+    if (xadc_wake_fd >= 0) {
+        uint64_t wake = 1;
+        if (write(xadc_wake_fd, &wake, sizeof(wake)) != sizeof(wake)) {
+            // Already signaled
+        }
+    }
+    xadc_WriteAttr(XADC_SYSFS_PATH "/buffer/enable", "0");
+    xadc_WriteAttr(XADC_SYSFS_PATH "/trigger/current_trigger", "\n");
+    return RP_OK;
+}
+
+int xadc_StartCapture(uint32_t sample_rate, uint32_t buffer_size) {
+    char trigger[64];
+    char value[32];
+    int ret;
+
+    pthread_mutex_lock(&xadc_mutex);
+    xadc_StopCaptureLocked();
+
+    if (xadc_wake_fd < 0) {
+        xadc_wake_fd = eventfd(0, EFD_NONBLOCK);
+    } else {
+        uint64_t wake;
+        if (read(xadc_wake_fd, &wake, sizeof(wake)) != sizeof(wake)) {
+            // Not signaled
+        }
+    }
+
+    ret = xadc_wake_fd < 0 ? RP_EFOB : xadc_FindTrigger(trigger, sizeof(trigger));
+    if (ret == RP_OK) {
+        ret = xadc_SetupScan();
+    }
+    if (ret == RP_OK && sample_rate) {
+        snprintf(value, sizeof(value), "%u", sample_rate);
+        ret = xadc_WriteAttr(XADC_SYSFS_PATH "/sampling_frequency", value);
+    }
+    if (ret == RP_OK) {
+        ret = xadc_WriteAttr(XADC_SYSFS_PATH "/trigger/current_trigger", trigger);
+    }
+    if (ret == RP_OK) {
+        snprintf(value, sizeof(value), "%u", buffer_size ? buffer_size : XADC_DEFAULT_BUFFER);
+        ret = xadc_WriteAttr(XADC_SYSFS_PATH "/buffer/length", value);
+    }
+    if (ret == RP_OK) {
+        ret = xadc_WriteAttr(XADC_SYSFS_PATH "/buffer/enable", "1");
+    }
+    if (ret == RP_OK) {
+        xadc_dev_fd = open(XADC_CHAR_DEV, O_RDONLY | O_NONBLOCK);
+        if (xadc_dev_fd < 0) {
+            ret = RP_EFOB;
+        } else {
+            xadc_capture_id++;
+        }
+    }
+    if (ret != RP_OK) {
+        xadc_WriteAttr(XADC_SYSFS_PATH "/buffer/enable", "0");
+        xadc_WriteAttr(XADC_SYSFS_PATH "/trigger/current_trigger", "\n");
+    }
+    pthread_mutex_unlock(&xadc_mutex);
+    return ret;
+}
+
+int xadc_ReadCapture(uint16_t* buffer, uint32_t* size, int timeout_ms) {
+    int ret = RP_OK;
+    uint32_t scans = 0;
+
+    pthread_mutex_lock(&xadc_mutex);
+    if (xadc_dev_fd < 0) {
+        pthread_mutex_unlock(&xadc_mutex);
+        *size = 0;
+        return RP_NOTS;
+    }
+    uint32_t capture_id = xadc_capture_id;
+    struct pollfd pfd[2] = {
+        { .fd = xadc_dev_fd, .events = POLLIN },
+        { .fd = xadc_wake_fd, .events = POLLIN }
+    };
+    pthread_mutex_unlock(&xadc_mutex);
+
+    // Waiting does not hold the lock, so single reads and stopping are not blocked
+    int ready = poll(pfd, 2, timeout_ms);
+
+    pthread_mutex_lock(&xadc_mutex);
+    if (xadc_capture_id != capture_id) {
+        // Stopped or restarted while waiting
+        pthread_mutex_unlock(&xadc_mutex);
+        *size = 0;
+        return RP_NOTS;
+    }
+
+    if (ready > 0 && (pfd[0].revents & POLLIN)) {
+        // Scans have the same layout as the output, only the order differs
+        ssize_t len = read(xadc_dev_fd, buffer, (size_t)*size * xadc_scan_words * sizeof(uint16_t));
+        if (len < 0 && errno != EAGAIN) {
+            ret = RP_EFRB;
+        } else if (len > 0) {
+            scans = len / (xadc_scan_words * sizeof(uint16_t));
+        }
+    }
+
+    for (uint32_t i = 0; i < scans; i++) {
+        uint16_t* scan = buffer + i * xadc_scan_words;
+        uint16_t tmp[XADC_PINS];
+        memcpy(tmp, scan, sizeof(tmp));
+        for (int pin = 0; pin < XADC_PINS; pin++) {
+            scan[pin] = (tmp[xadc_scan_pos[pin]] >> xadc_shift) & xadc_mask;
+        }
+    }
+    pthread_mutex_unlock(&xadc_mutex);
+
+    *size = scans;
+    return ret;
+}
+
+int xadc_StopCapture() {
+    pthread_mutex_lock(&xadc_mutex);
+    int ret = xadc_StopCaptureLocked();
+    pthread_mutex_unlock(&xadc_mutex);
+    return ret;
+}
+
+int xadc_GetCaptureRate(uint32_t* sample_rate) {
+    char value[32];
+    ECHECK(xadc_ReadAttr(XADC_SYSFS_PATH "/sampling_frequency", value, sizeof(value)));
+    *sample_rate = strtoul(value, NULL, 10);
+    return RP_OK;
+}
+
+int xadc_Release() {
+    pthread_mutex_lock(&xadc_mutex);
+    xadc_StopCaptureLocked();
+    xadc_CloseRaw();
+    if (xadc_wake_fd >= 0) {
+        close(xadc_wake_fd);
+        xadc_wake_fd = -1;
+    }
+    pthread_mutex_unlock(&xadc_mutex);
+    return RP_OK;
+}
@@ -0,0 +1,40 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library XADC (slow analog inputs) module interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef SRC_XADC_H_
+#define SRC_XADC_H_
+
+#include <stdint.h>
+
+#define XADC_PINS 4
+
+// IIO device of the XADC wizard in the FPGA
+#define XADC_SYSFS_PATH "/sys/devices/soc0/amba_pl/83c00000.xadc_wiz/iio:device1"
+#define XADC_CHAR_DEV   "/dev/iio:device1"
+#define XADC_TRIG_PATH  "/sys/bus/iio/devices"
+
+// Kernel ring size in scans when the caller does not set one
+#define XADC_DEFAULT_BUFFER 4096
+
+int xadc_Release();
+
+int xadc_GetValueRaw(int unsigned pin, uint32_t* value);
+int xadc_GetValuesRaw(uint32_t* values);
+
+int xadc_StartCapture(uint32_t sample_rate, uint32_t buffer_size);
+int xadc_ReadCapture(uint16_t* buffer, uint32_t* size, int timeout_ms);
+int xadc_StopCapture();
+int xadc_GetCaptureRate(uint32_t* sample_rate);
+
+#endif /* SRC_XADC_H_ */
@@ -35,11 +35,12 @@ typedef struct {
   char          *dma_dev;
   size_t         dma_size;
   int            dma_fd;
-  //volatile void *dma_mem;
+  void          *dma_mem;     ///< DMA buffer, mapped for the lifetime of the handle
 } rp_handle_uio_t;
 
 typedef struct {
     int16_t *      buf;
+    int16_t *      buf_min;     ///< second buffer of RP_RATIO_MODE_AGGREGATE, may be NULL
     size_t         buf_size;
     uint32_t       pre_samples;
     uint32_t       post_samples;
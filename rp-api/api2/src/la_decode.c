@@ -0,0 +1,382 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library Logic analyzer protocol decoders
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "la_decode.h"
+
+/**
+ * Walks an RLE capture one segment at a time. A segment is the union of consecutive
+ * words in which the masked channels keep their value, so the hardware's 256 sample
+ * run limit and changes on the other channels do not cost anything beyond a compare.
+ */
+typedef struct {
+    const int16_t * words;
+    uint32_t n;
+    uint32_t i;       ///< first word after the current segment
+    uint8_t  mask;
+    uint8_t  value;   ///< masked value of the current segment
+    uint8_t  raw;     ///< all channels at the start of the current segment
+    uint64_t start;   ///< first sample of the current segment
+    uint64_t end;     ///< first sample after the current segment
+} rp_rle_iter_t;
+
+typedef struct {
+    RP_LA_EVENT * buf;
+    uint32_t size;
+    uint32_t cnt;
+} rp_event_out_t;
+
+static bool rp_RleNext(rp_rle_iter_t * it)
+{
+    const int16_t * w=it->words;
+    uint32_t i=it->i;
+    if(i>=it->n){
+        return false;
+    }
+    it->start=it->end;
+    it->raw=RP_LA_RLE_VALUE(w[i]);
+    it->value=it->raw&it->mask;
+    uint64_t end=it->end+RP_LA_RLE_LENGTH(w[i]);
+    for(i++; i<it->n && (RP_LA_RLE_VALUE(w[i])&it->mask)==it->value; i++){
+        end+=RP_LA_RLE_LENGTH(w[i]);
+    }
+    it->end=end;
+    it->i=i;
+    return true;
+}
+
+static bool rp_RleInit(rp_rle_iter_t * it, const int16_t * words, uint32_t n, uint8_t mask)
+{
+    memset(it, 0, sizeof(rp_rle_iter_t));
+    it->words=words;
+    it->n=n;
+    it->mask=mask;
+    return rp_RleNext(it);
+}
+
+/** Moves forward to the segment holding sample t */
+static inline bool rp_RleSeek(rp_rle_iter_t * it, uint64_t t)
+{
+    while(t>=it->end){
+        if(!rp_RleNext(it)){
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline bool rp_EventPut(rp_event_out_t * out, uint64_t start, uint64_t length, uint8_t type, uint8_t flags, uint16_t data)
+{
+    if(out->cnt>=out->size){
+        return false;
+    }
+    RP_LA_EVENT * e=&out->buf[out->cnt++];
+    e->start=start;
+    e->length=length>UINT32_MAX ? UINT32_MAX : (uint32_t)length;
+    e->type=type;
+    e->flags=flags;
+    e->data=data;
+    return true;
+}
+
+static inline uint16_t rp_BitReverse(uint16_t v, uint8_t bits)
+{
+    uint16_t r=0;
+    for(uint8_t k=0; k<bits; k++){
+        r=(r<<1)|((v>>k)&1);
+    }
+    return r;
+}
+
+static inline bool rp_RleChannelValid(RP_DIGITAL_CHANNEL ch)
+{
+    return (unsigned)ch<RP_LA_RLE_CHANNELS;
+}
+
+RP_STATUS rp_DecodeUart(const int16_t * words,
+                        uint32_t noOfWords,
+                        const RP_UART_DECODER * decoder,
+                        RP_LA_EVENT * events,
+                        uint32_t * noOfEvents)
+{
+    if(words==NULL || decoder==NULL || events==NULL || noOfEvents==NULL){
+        return RP_NULL_PARAMETER;
+    }
+    if(!rp_RleChannelValid(decoder->rx)){
+        return RP_INVALID_DIGITAL_CHANNEL;
+    }
+    if(decoder->samplesPerBit<2 || decoder->dataBits<5 || decoder->dataBits>9 ||
+       decoder->stopBits<1 || decoder->stopBits>2 || decoder->parity>RP_UART_PARITY_EVEN){
+        return RP_INVALID_PARAMETER;
+    }
+
+    rp_event_out_t out={events, *noOfEvents, 0};
+    const uint8_t bit=1<<decoder->rx;
+    const uint8_t idle=decoder->inverted ? 0 : bit;
+    const uint8_t data_bits=decoder->dataBits;
+    const uint8_t parity_bits=decoder->parity!=RP_UART_PARITY_NONE;
+    const uint8_t frame_bits=1+data_bits+parity_bits+decoder->stopBits;
+
+    // sample points in the middle of each bit, relative to the start bit edge
+    uint64_t offset[1+9+1+2];
+    for(uint8_t k=0; k<frame_bits; k++){
+        offset[k]=(uint64_t)((k+0.5)*decoder->samplesPerBit);
+    }
+    const uint64_t frame_len=(uint64_t)(frame_bits*decoder->samplesPerBit+0.5);
+
+    rp_rle_iter_t it;
+    RP_STATUS status=RP_API_OK;
+    if(!rp_RleInit(&it, words, noOfWords, bit)){
+        *noOfEvents=0;
+        return RP_API_OK;
+    }
+    // a capture that starts in the middle of a frame has no usable start bit
+    while(it.value!=idle){
+        if(!rp_RleNext(&it)){
+            goto done;
+        }
+    }
+
+    for(;;){
+        // start bit edge
+        while(it.value==idle){
+            if(!rp_RleNext(&it)){
+                goto done;
+            }
+        }
+        const uint64_t t0=it.start;
+
+        if(!rp_RleSeek(&it, t0+offset[0])){
+            goto done;
+        }
+        if(it.value==idle){
+            continue; // glitch shorter than half a bit
+        }
+
+        uint16_t data=0;
+        uint8_t ones=0;
+        uint8_t k=1;
+        for(; k<=data_bits; k++){
+            if(!rp_RleSeek(&it, t0+offset[k])){
+                goto done;
+            }
+            uint16_t b=it.value==idle;
+            data|=b<<(k-1);
+            ones+=b;
+        }
+
+        uint8_t flags=0;
+        if(parity_bits){
+            if(!rp_RleSeek(&it, t0+offset[k])){
+                goto done;
+            }
+            ones+=it.value==idle;
+            if((ones&1)!=(decoder->parity==RP_UART_PARITY_ODD)){
+                flags|=RP_LA_EVENT_PARITY_ERROR;
+            }
+            k++;
+        }
+        for(; k<frame_bits; k++){
+            if(!rp_RleSeek(&it, t0+offset[k])){
+                goto done;
+            }
+            if(it.value!=idle){
+                flags|=RP_LA_EVENT_FRAMING_ERROR;
+            }
+        }
+
+        if(decoder->msbFirst){
+            data=rp_BitReverse(data, data_bits);
+        }
+        if(!rp_EventPut(&out, t0, frame_len, RP_LA_EVENT_UART_DATA, flags, data)){
+            status=RP_BUFFER_STALL;
+            goto done;
+        }
+
+        // after a framing error (or break) the next start bit needs the line to return to idle first
+        while(it.value!=idle){
+            if(!rp_RleNext(&it)){
+                goto done;
+            }
+        }
+    }
+
+done:
+    *noOfEvents=out.cnt;
+    return status;
+}
+
+RP_STATUS rp_DecodeSpi(const int16_t * words,
+                       uint32_t noOfWords,
+                       const RP_SPI_DECODER * decoder,
+                       RP_LA_EVENT * events,
+                       uint32_t * noOfEvents)
+{
+    if(words==NULL || decoder==NULL || events==NULL || noOfEvents==NULL){
+        return RP_NULL_PARAMETER;
+    }
+    const bool use_miso=decoder->miso!=RP_MAX_DIGITAL_CHANNELS;
+    const bool use_cs=decoder->cs!=RP_MAX_DIGITAL_CHANNELS;
+    if(!rp_RleChannelValid(decoder->clk) || !rp_RleChannelValid(decoder->mosi) ||
+       (use_miso && !rp_RleChannelValid(decoder->miso)) || (use_cs && !rp_RleChannelValid(decoder->cs))){
+        return RP_INVALID_DIGITAL_CHANNEL;
+    }
+    if(decoder->wordBits<1 || decoder->wordBits>16 || decoder->cpol>1 || decoder->cpha>1){
+        return RP_INVALID_PARAMETER;
+    }
+
+    rp_event_out_t out={events, *noOfEvents, 0};
+    const uint8_t clk=1<<decoder->clk;
+    const uint8_t mosi=1<<decoder->mosi;
+    const uint8_t miso=use_miso ? 1<<decoder->miso : 0;
+    const uint8_t cs=use_cs ? 1<<decoder->cs : 0;
+    const uint8_t cs_active=decoder->csActiveHigh ? cs : 0;
+    // data is sampled on the rising edge in modes 0 and 3
+    const uint8_t sample_level=decoder->cpol==decoder->cpha ? clk : 0;
+
+    // data lines are read from the raw value, only clock and chip select split segments
+    rp_rle_iter_t it;
+    if(!rp_RleInit(&it, words, noOfWords, clk|cs)){
+        *noOfEvents=0;
+        return RP_API_OK;
+    }
+
+    RP_STATUS status=RP_API_OK;
+    uint8_t prev=it.value;
+    uint8_t bits=0;
+    uint16_t mosi_word=0, miso_word=0;
+    uint64_t word_start=0;
+
+    while(rp_RleNext(&it)){
+        const uint8_t v=it.value;
+        const bool active=(v&cs)==cs_active;
+
+        if((prev&cs)!=(v&cs)){
+            // chip select edge: drop a partial word, start a new one
+            if(bits>0 && !active){
+                uint8_t flags=RP_LA_EVENT_INCOMPLETE;
+                if(!rp_EventPut(&out, word_start, it.start-word_start, RP_LA_EVENT_SPI_MOSI, flags, mosi_word) ||
+                   (use_miso && !rp_EventPut(&out, word_start, it.start-word_start, RP_LA_EVENT_SPI_MISO, flags, miso_word))){
+                    status=RP_BUFFER_STALL;
+                    break;
+                }
+            }
+            bits=0;
+        }
+
+        if(active && ((prev^v)&clk) && (v&clk)==sample_level){
+            if(bits==0){
+                word_start=it.start;
+                mosi_word=0;
+                miso_word=0;
+            }
+            mosi_word=(mosi_word<<1)|((it.raw&mosi)!=0);
+            miso_word=(miso_word<<1)|((it.raw&miso)!=0);
+            if(++bits==decoder->wordBits){
+                if(decoder->lsbFirst){
+                    mosi_word=rp_BitReverse(mosi_word, bits);
+                    miso_word=rp_BitReverse(miso_word, bits);
+                }
+                if(!rp_EventPut(&out, word_start, it.start-word_start+1, RP_LA_EVENT_SPI_MOSI, 0, mosi_word) ||
+                   (use_miso && !rp_EventPut(&out, word_start, it.start-word_start+1, RP_LA_EVENT_SPI_MISO, 0, miso_word))){
+                    status=RP_BUFFER_STALL;
+                    break;
+                }
+                bits=0;
+            }
+        }
+        prev=v;
+    }
+
+    *noOfEvents=out.cnt;
+    return status;
+}
+
+RP_STATUS rp_DecodeI2c(const int16_t * words,
+                       uint32_t noOfWords,
+                       const RP_I2C_DECODER * decoder,
+                       RP_LA_EVENT * events,
+                       uint32_t * noOfEvents)
+{
+    if(words==NULL || decoder==NULL || events==NULL || noOfEvents==NULL){
+        return RP_NULL_PARAMETER;
+    }
+    if(!rp_RleChannelValid(decoder->scl) || !rp_RleChannelValid(decoder->sda) || decoder->scl==decoder->sda){
+        return RP_INVALID_DIGITAL_CHANNEL;
+    }
+
+    rp_event_out_t out={events, *noOfEvents, 0};
+    const uint8_t scl=1<<decoder->scl;
+    const uint8_t sda=1<<decoder->sda;
+
+    rp_rle_iter_t it;
+    if(!rp_RleInit(&it, words, noOfWords, scl|sda)){
+        *noOfEvents=0;
+        return RP_API_OK;
+    }
+
+    RP_STATUS status=RP_API_OK;
+    uint8_t prev=it.value;
+    bool in_transfer=false;
+    bool address=false;
+    uint8_t bits=0;
+    uint16_t byte=0;
+    uint64_t byte_start=0;
+
+    while(rp_RleNext(&it)){
+        const uint8_t v=it.value;
+        bool ok=true;
+
+        if((prev&scl) && (v&scl)){
+            // SDA edge while SCL is high: start or stop condition
+            if(prev&sda){
+                ok=rp_EventPut(&out, it.start, 1, in_transfer ? RP_LA_EVENT_I2C_REPEATED_START : RP_LA_EVENT_I2C_START, 0, 0);
+                in_transfer=true;
+                address=true;
+            }else{
+                ok=rp_EventPut(&out, it.start, 1, RP_LA_EVENT_I2C_STOP, 0, 0);
+                in_transfer=false;
+            }
+            bits=0;
+        }else if(in_transfer && !(prev&scl) && (v&scl)){
+            // SCL rising edge: 8 data bits then the acknowledge bit
+            const uint16_t b=(v&sda)!=0;
+            if(bits==0){
+                byte_start=it.start;
+                byte=0;
+            }
+            if(bits<8){
+                byte=(byte<<1)|b;
+                bits++;
+            }else{
+                ok=rp_EventPut(&out, byte_start, it.start-byte_start+1,
+                               address ? RP_LA_EVENT_I2C_ADDRESS : RP_LA_EVENT_I2C_DATA,
+                               b ? RP_LA_EVENT_NACK : 0, byte);
+                address=false;
+                bits=0;
+            }
+        }
+        if(!ok){
+            status=RP_BUFFER_STALL;
+            break;
+        }
+        prev=v;
+    }
+
+    *noOfEvents=out.cnt;
+    return status;
+}
@@ -0,0 +1,116 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library Logic analyzer protocol decoders interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+// The decoders work on RLE captures as returned by rp_GetValues() in RP_RATIO_MODE_NONE.
+// They move from one transition of the decoded lines to the next, so the run time depends
+// on the number of edges and not on the capture length.
+
+#ifndef __LA_DECODE_H
+#define __LA_DECODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rp_api.h"
+
+/** RLE word: run length - 1 in the high byte, digital channels 0..7 in the low byte */
+#define RP_LA_RLE_VALUE(w)  ((uint8_t)(w))
+#define RP_LA_RLE_LENGTH(w) ((uint32_t)(uint8_t)((uint16_t)(w)>>8)+1)
+
+/** Number of channels present in RLE captures */
+#define RP_LA_RLE_CHANNELS 8
+
+typedef enum rpLaEventType {
+    RP_LA_EVENT_UART_DATA,          ///< data is the received character
+    RP_LA_EVENT_SPI_MOSI,           ///< data is the word on MOSI
+    RP_LA_EVENT_SPI_MISO,           ///< data is the word on MISO, same start and length as the MOSI event before it
+    RP_LA_EVENT_I2C_START,
+    RP_LA_EVENT_I2C_REPEATED_START,
+    RP_LA_EVENT_I2C_STOP,
+    RP_LA_EVENT_I2C_ADDRESS,        ///< data is the first byte after a start: 7 bit address and R/W bit
+    RP_LA_EVENT_I2C_DATA            ///< data is the byte, flags tell if it was acknowledged
+} RP_LA_EVENT_TYPE;
+
+/** event flags */
+#define RP_LA_EVENT_PARITY_ERROR  (1<<0) ///< UART parity bit does not match
+#define RP_LA_EVENT_FRAMING_ERROR (1<<1) ///< UART stop bit is not at idle level
+#define RP_LA_EVENT_NACK          (1<<2) ///< I2C byte was not acknowledged
+#define RP_LA_EVENT_INCOMPLETE    (1<<3) ///< SPI word cut short by chip select
+
+/** Decoded frame, 16 bytes */
+typedef struct rpLaEvent {
+    uint64_t start;   ///< index of the first sample of the frame, counted from the first RLE word
+    uint32_t length;  ///< frame length in samples
+    uint8_t  type;    ///< RP_LA_EVENT_TYPE
+    uint8_t  flags;   ///< RP_LA_EVENT_* flags
+    uint16_t data;
+} RP_LA_EVENT;
+
+typedef enum rpUartParity {
+    RP_UART_PARITY_NONE,
+    RP_UART_PARITY_ODD,
+    RP_UART_PARITY_EVEN
+} RP_UART_PARITY;
+
+typedef struct rpUartDecoder {
+    RP_DIGITAL_CHANNEL rx;
+    double         samplesPerBit;   ///< sampling rate / baud rate, at least 2
+    uint8_t        dataBits;        ///< 5 .. 9
+    RP_UART_PARITY parity;
+    uint8_t        stopBits;        ///< 1 or 2
+    bool           inverted;        ///< line idles low
+    bool           msbFirst;
+} RP_UART_DECODER;
+
+typedef struct rpSpiDecoder {
+    RP_DIGITAL_CHANNEL clk;
+    RP_DIGITAL_CHANNEL mosi;
+    RP_DIGITAL_CHANNEL miso;        ///< RP_MAX_DIGITAL_CHANNELS if not used
+    RP_DIGITAL_CHANNEL cs;          ///< RP_MAX_DIGITAL_CHANNELS if not used
+    uint8_t            cpol;        ///< clock idle level
+    uint8_t            cpha;        ///< 0 - data is sampled on the leading clock edge, 1 - on the trailing edge
+    bool               csActiveHigh;
+    uint8_t            wordBits;    ///< 1 .. 16
+    bool               lsbFirst;
+} RP_SPI_DECODER;
+
+typedef struct rpI2cDecoder {
+    RP_DIGITAL_CHANNEL scl;
+    RP_DIGITAL_CHANNEL sda;
+} RP_I2C_DECODER;
+
+/**
+ * Each decoder takes noOfWords RLE words and writes up to *noOfEvents events.
+ * On return *noOfEvents holds the number of events written. RP_BUFFER_STALL is
+ * returned when the event buffer filled up before the end of the capture.
+ */
+RP_STATUS rp_DecodeUart(const int16_t * words,
+                        uint32_t noOfWords,
+                        const RP_UART_DECODER * decoder,
+                        RP_LA_EVENT * events,
+                        uint32_t * noOfEvents);
+
+RP_STATUS rp_DecodeSpi(const int16_t * words,
+                       uint32_t noOfWords,
+                       const RP_SPI_DECODER * decoder,
+                       RP_LA_EVENT * events,
+                       uint32_t * noOfEvents);
+
+RP_STATUS rp_DecodeI2c(const int16_t * words,
+                       uint32_t noOfWords,
+                       const RP_I2C_DECODER * decoder,
+                       RP_LA_EVENT * events,
+                       uint32_t * noOfEvents);
+
+#endif // __LA_DECODE_H
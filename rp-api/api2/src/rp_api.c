@@ -8,10 +8,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <pthread.h>
 
 #include "common.h"
 
 #include "la_acq.h"
+#include "rp_dma.h"
 
 /** SIGNAL ACQUISTION  */
 
@@ -28,6 +30,55 @@ rp_acq_data_t acq_data;
 
 bool g_acq_running=false;
 
+/** Streaming state. DMA runs cyclically over RP_SGMNT_CNT segments of the mapped buffer. */
+typedef struct {
+    int16_t *        map;             ///< DMA buffer the segments are delivered from
+    uint32_t         sgmnt_samples;   ///< samples per DMA segment
+    uint64_t         produced;        ///< segments completed by DMA
+    uint64_t         consumed;        ///< next segment to be delivered
+    uint64_t         delivered;
+    uint64_t         overruns;
+    uint64_t         samples;         ///< samples delivered
+    uint64_t         max_samples;     ///< auto stop limit, 0 - unlimited
+    bool             lost;            ///< samples were lost since the last delivery
+    bool             active;          ///< threads are started
+    bool             running;         ///< DMA is producing segments
+    bool             failed;
+    bool             delivering;      ///< a callback is in progress
+    bool             auto_stopped;
+    rpStreamingReady ready;           ///< callback of the consumer thread
+    void *           ready_param;
+    bool             has_consumer;
+    pthread_t        reader;
+    pthread_t        consumer;
+    pthread_mutex_t  mutex;
+    pthread_cond_t   cond;
+} rp_streaming_t;
+
+static rp_streaming_t stream = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER
+};
+
+static void rp_StreamingStop(void);
+
+/** One pass down-sampler of rp_GetValues() */
+typedef struct {
+    RP_RATIO_MODE   mode;
+    uint32_t        ratio;
+    uint32_t        skip;       ///< input samples to drop before startIndex
+    int16_t *       out;
+    int16_t *       out_min;    ///< bitwise AND of the window in RP_RATIO_MODE_AGGREGATE
+    uint32_t        out_len;
+    uint32_t        out_cnt;
+    uint32_t        fill;       ///< samples in the current window
+    uint32_t        dec_skip;   ///< samples left of a decimated window already written
+    uint16_t        first;
+    uint16_t        or_acc;
+    uint16_t        and_acc;
+    uint32_t        ones[16];   ///< samples with the bit set, RP_RATIO_MODE_AVERAGE
+} rp_downsample_t;
+
 /**
  * Open device
  */
@@ -44,6 +95,9 @@ RP_STATUS rp_OpenUnit(void) {
  */
 RP_STATUS rp_CloseUnit(void) {
     int r=RP_API_OK;
+    if(stream.active){
+        rp_StreamingStop();
+    }
     if(rp_LaAcqClose(&la_acq_handle)!=RP_API_OK){
         r=-1;
     }
@@ -229,9 +283,32 @@ RP_STATUS rp_SetDataBuffer(      int16_t * buffer,
                                  int32_t bufferLth,
                                 // uint32_t segmentIndex,
                                 RP_RATIO_MODE mode) {
-            acq_data.buf = buffer;
-            acq_data.buf_size = bufferLth;
-            return RP_API_OK;
+    return rp_SetDataBuffers(buffer, NULL, bufferLth, mode);
+}
+
+/**
+ * Set data buffers
+ *
+ * Same as rp_SetDataBuffer, with a second buffer that receives the bitwise AND
+ * of each window when rp_GetValues is called with RP_RATIO_MODE_AGGREGATE.
+ * The first buffer then receives the bitwise OR.
+ *
+ * @param bufferMax  The location of the buffer (OR of the window when aggregating)
+ * @param bufferMin  The location of the AND buffer, can be NULL
+ * @param bufferLth  The size of each buffer array (notice that one sample is 16 bits)
+ *
+ */
+RP_STATUS rp_SetDataBuffers(     int16_t * bufferMax,
+                                 int16_t * bufferMin,
+                                 int32_t bufferLth,
+                                 RP_RATIO_MODE mode) {
+    if(bufferLth<0){
+        return RP_INVALID_PARAMETER;
+    }
+    acq_data.buf = bufferMax;
+    acq_data.buf_min = bufferMin;
+    acq_data.buf_size = bufferLth;
+    return RP_API_OK;
 }
 
 
@@ -275,14 +352,10 @@ RP_STATUS rp_RunBlock(uint32_t noOfPreTriggerSamples,
         return RP_INVALID_TIMEBASE;
     }
 
-    printf("\r\n timeIntervalNanoseconds: %f", timeIntervalNanoseconds);
-
     if(!(inrangeUint32 (noOfPreTriggerSamples+noOfPostTriggerSamples, 10, maxSamples))){
         return RP_INVALID_PARAMETER;
     }
 
-    printf("\r\n max: %d", maxSamples);
-
     *timeIndisposedMs=(noOfPreTriggerSamples+noOfPostTriggerSamples)*timeIntervalNanoseconds/10e6;
 
     // configure FPGA to start block mode
@@ -299,7 +372,6 @@ RP_STATUS rp_RunBlock(uint32_t noOfPreTriggerSamples,
         return RP_INVALID_PARAMETER;
     }
 
-    printf("\r\nrp_LaAcqRunAcq");
     // start acq.
     if(rp_LaAcqRunAcq(&la_acq_handle)!=RP_OK){
         rp_LaAcqStopAcq(&la_acq_handle);
@@ -309,7 +381,6 @@ RP_STATUS rp_RunBlock(uint32_t noOfPreTriggerSamples,
     //rp_LaAcqFpgaRegDump(&la_acq_handle);
 
     // block till acq. is complete
-    printf("\r\nBlocking read");
     g_acq_running=true;
     rp_LaAcqBlockingRead(&la_acq_handle);
     g_acq_running=false;
@@ -318,7 +389,6 @@ RP_STATUS rp_RunBlock(uint32_t noOfPreTriggerSamples,
     bool isStoped;
     rp_LaAcqAcqIsStopped(&la_acq_handle, &isStoped);
     if(!isStoped){
-        printf("\r\n not stopped!!");
         rp_LaAcqStopAcq(&la_acq_handle);
         return RP_BLOCK_MODE_FAILED;
     }
@@ -344,8 +414,6 @@ RP_STATUS rp_RunBlock(uint32_t noOfPreTriggerSamples,
             return RP_BLOCK_MODE_FAILED;
         }
 
-        printf("\r\n trig_sample %d, pst_length %d, buf_ovfl %d", trig_sample, pst_length, buf_ovfl);
-
 		// acquired number of post samples must match to req
 		if(pst_length!=noOfPostTriggerSamples){
 			rp_LaAcqStopAcq(&la_acq_handle);
@@ -369,11 +437,141 @@ RP_STATUS rp_RunBlock(uint32_t noOfPreTriggerSamples,
 }
 
 
+/**
+ * Waits for DMA segment completions. Each read() of the DMA device in cyclic mode
+ * returns after one segment has been filled. Cancellation is only enabled in read().
+ */
+static void * rp_StreamingReader(void * arg)
+{
+    int state;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+    for(;;){
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &state);
+        int r=rp_LaAcqBlockingRead(&la_acq_handle);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+
+        pthread_mutex_lock(&stream.mutex);
+        if(r!=RP_OK){
+            stream.failed=true;
+            stream.running=false;
+        }
+        else{
+            stream.produced++;
+        }
+        bool running=stream.running;
+        pthread_cond_broadcast(&stream.cond);
+        pthread_mutex_unlock(&stream.mutex);
+        if(!running){
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Hands completed segments to rpReady in place, one call per contiguous run of segments.
+ * Segments the DMA is about to overwrite are skipped and counted as overruns.
+ * Called and returns with stream.mutex locked; returns false when nothing was pending.
+ */
+static bool rp_StreamingDeliver(rpStreamingReady rpReady, void * pParameter)
+{
+    uint64_t pending=stream.produced-stream.consumed;
+    if(pending==0 || stream.auto_stopped){
+        return false;
+    }
+    // the segment being filled is produced%RP_SGMNT_CNT, keep it out of the delivered range
+    if(pending>=RP_SGMNT_CNT){
+        uint64_t skip=pending-(RP_SGMNT_CNT-1);
+        stream.overruns+=skip;
+        stream.consumed+=skip;
+        stream.lost=true;
+        pending=RP_SGMNT_CNT-1;
+    }
+
+    uint64_t first=stream.consumed;
+    uint32_t first_idx=first%RP_SGMNT_CNT;
+    uint32_t count=pending;
+    if(first_idx+count>RP_SGMNT_CNT){
+        count=RP_SGMNT_CNT-first_idx;
+    }
+
+    uint64_t samples=(uint64_t)count*stream.sgmnt_samples;
+    int16_t autoStop=0;
+    if(stream.max_samples && stream.samples+samples>=stream.max_samples){
+        samples=stream.max_samples-stream.samples;
+        autoStop=1;
+    }
+    int16_t overflow=stream.lost;
+    stream.lost=false;
+    stream.delivering=true;
+
+    pthread_mutex_unlock(&stream.mutex);
+    (*rpReady)(samples, first_idx*stream.sgmnt_samples, overflow, 0, 1, autoStop, pParameter);
+    pthread_mutex_lock(&stream.mutex);
+
+    // segments rewritten while the callback was reading them
+    if(stream.produced>=first+RP_SGMNT_CNT){
+        uint64_t torn=stream.produced-(first+RP_SGMNT_CNT)+1;
+        stream.overruns+=torn<count ? torn : count;
+        stream.lost=true;
+    }
+    stream.consumed=first+count;
+    stream.delivered+=count;
+    stream.samples+=samples;
+    stream.delivering=false;
+    if(autoStop){
+        stream.auto_stopped=true;
+        rp_LaAcqStopAcq(&la_acq_handle);
+    }
+    pthread_cond_broadcast(&stream.cond);
+    return true;
+}
+
+static void * rp_StreamingConsumer(void * arg)
+{
+    pthread_mutex_lock(&stream.mutex);
+    while(stream.running && !stream.auto_stopped){
+        if(!rp_StreamingDeliver(stream.ready, stream.ready_param)){
+            pthread_cond_wait(&stream.cond, &stream.mutex);
+        }
+    }
+    pthread_mutex_unlock(&stream.mutex);
+    return NULL;
+}
+
+static void rp_StreamingStop(void)
+{
+    rp_LaAcqStopAcq(&la_acq_handle);
+
+    pthread_mutex_lock(&stream.mutex);
+    stream.running=false;
+    pthread_cond_broadcast(&stream.cond);
+    pthread_mutex_unlock(&stream.mutex);
+
+    // stopping the DMA does not wake a reader blocked in read()
+    pthread_cancel(stream.reader);
+    pthread_join(stream.reader, NULL);
+    if(stream.has_consumer){
+        pthread_join(stream.consumer, NULL);
+    }
+
+    pthread_mutex_lock(&stream.mutex);
+    while(stream.delivering){
+        pthread_cond_wait(&stream.cond, &stream.mutex);
+    }
+    stream.map=NULL;
+    stream.active=false;
+    pthread_mutex_unlock(&stream.mutex);
+}
+
 /**
  *
  * Start collecting data in streaming mode.
- * When data has been collected from the device it is down-sampled if necessary and then
- * delivered to the user. Call rpGetStreamingLatestValues() to retrieve the data.
+ * DMA fills the RP_SGMNT_CNT segments of the buffer cyclically. Completed segments are
+ * delivered without copying, either by the consumer thread to the callback registered with
+ * rp_SetStreamingCallback() or by calls to rpGetStreamingLatestValues(). Segments that are
+ * overwritten before they are delivered are counted, see rp_GetStreamingStats().
+ * Call rp_Stop() to end streaming.
  *
  * When a trigger is set, the total number of samples stored in the driver is the sum of maxPreTriggerSamples and maxPostTriggerSamples.
  *
@@ -392,7 +590,7 @@ RP_STATUS rp_RunBlock(uint32_t noOfPreTriggerSamples,
  *
  * @param downSampleRatio             See rpGetValues()
  *
- * @param downSampleRatioMode         See rpGetValues()
+ * @param downSampleRatioMode         Only RP_RATIO_MODE_NONE, streaming data is not down-sampled.
  *
  * @param overviewBufferSize         The size of the overview buffers. These are temporary buffers used for storing the data
  *                                     before returning it to the application.
@@ -407,17 +605,304 @@ RP_STATUS rp_RunStreaming(uint32_t * sampleInterval,
                         RP_RATIO_MODE downSampleRatioMode,
                         uint32_t overviewBufferSize)
 {
+    static const double unit_ns[] = { 1e-6, 1e-3, 1, 1e3, 1e6, 1e9 };
 
-    // configure FPGA to start block mode
+    if(stream.active){
+        return RP_INVALID_STATE;
+    }
+    if(sampleInterval==NULL){
+        return RP_NULL_PARAMETER;
+    }
+    if(sampleIntervalTimeUnits<RP_FS || sampleIntervalTimeUnits>RP_S){
+        return RP_INVALID_SAMPLE_INTERVAL;
+    }
+    // segments are handed out in place, there is no intermediate buffer to down-sample into
+    if(downSampleRatioMode!=RP_RATIO_MODE_NONE){
+        return RP_RATIO_MODE_NOT_SUPPORTED;
+    }
+
+    // sample rate = 125Msps/(dec+1)
+    double interval_ns=*sampleInterval*unit_ns[sampleIntervalTimeUnits];
+    double dec=round(interval_ns/c_max_dig_sampling_rate_time_interval_ns)-1;
+    if(dec<0 || dec>UINT32_MAX){
+        return RP_INVALID_SAMPLE_INTERVAL;
+    }
+    *sampleInterval=round((dec+1)*c_max_dig_sampling_rate_time_interval_ns/unit_ns[sampleIntervalTimeUnits]);
+
+    int16_t * map = (int16_t *) la_acq_handle.dma_mem;
+    if(map==NULL){
+        return RP_MEMORY_FAIL;
+    }
+
+    rp_la_decimation_regset_t dec_reg;
+    dec_reg.dec=dec;
+    rp_LaAcqSetDecimation(&la_acq_handle, dec_reg);
+
+    // continuous acquisition, triggered as soon as it is started
+    rp_la_cfg_regset_t cfg;
+    cfg.pre=0;
+    cfg.pst=RP_LA_ACQ_CFG_TRIG_MAX;
+    rp_LaAcqSetCntConfig(&la_acq_handle, cfg);
+    rp_LaAcqSetConfig(&la_acq_handle, RP_LA_ACQ_CFG_CONT_MASK|RP_LA_ACQ_CFG_AUTO_MASK);
+
+    pthread_mutex_lock(&stream.mutex);
+    stream.map=map;
+    stream.sgmnt_samples=RP_SGMNT_SIZE/sizeof(int16_t);
+    stream.produced=0;
+    stream.consumed=0;
+    stream.delivered=0;
+    stream.overruns=0;
+    stream.samples=0;
+    stream.max_samples=autoStop ? (uint64_t)maxPreTriggerSamples+maxPostTriggerSamples : 0;
+    stream.lost=false;
+    stream.failed=false;
+    stream.delivering=false;
+    stream.auto_stopped=false;
+    stream.running=true;
+    stream.has_consumer=stream.ready!=NULL;
+    pthread_mutex_unlock(&stream.mutex);
+
+    if(rp_LaAcqRunAcq(&la_acq_handle)!=RP_OK){
+        rp_LaAcqStopAcq(&la_acq_handle);
+        stream.running=false;
+        return RP_STREAMING_FAILED;
+    }
+
+    if(pthread_create(&stream.reader, NULL, rp_StreamingReader, NULL)!=0){
+        rp_LaAcqStopAcq(&la_acq_handle);
+        stream.running=false;
+        return RP_STREAMING_FAILED;
+    }
+    if(stream.has_consumer && pthread_create(&stream.consumer, NULL, rp_StreamingConsumer, NULL)!=0){
+        stream.has_consumer=false;
+    }
+    stream.active=true;
     return RP_API_OK;
 };
 
+/**
+ * Registers the callback of the streaming consumer thread. When set before rp_RunStreaming(),
+ * completed segments are delivered as they arrive and rp_GetStreamingLatestValues() must not be used.
+ * Pass NULL to poll with rp_GetStreamingLatestValues() instead.
+ *
+ * @param rpReady       Callback receiving noOfSamples starting at startIndex of the streaming buffer.
+ * @param pParameter    A void pointer that will be passed to the callback.
+ */
+RP_STATUS rp_SetStreamingCallback(rpStreamingReady rpReady,
+                                  void * pParameter)
+{
+    if(stream.active){
+        return RP_INVALID_STATE;
+    }
+    stream.ready=rpReady;
+    stream.ready_param=pParameter;
+    return RP_API_OK;
+}
+
+/**
+ * Returns the DMA buffer streaming data is delivered in. The startIndex of rpStreamingReady()
+ * is an index into this buffer; data is valid until the callback returns.
+ *
+ * @param buffer      On exit, pointer to the first sample of the buffer.
+ * @param bufferLth   On exit, buffer length in samples.
+ */
+RP_STATUS rp_GetStreamingBuffer(int16_t ** buffer,
+                                uint32_t * bufferLth)
+{
+    if(!stream.active){
+        return RP_INVALID_STATE;
+    }
+    *buffer=stream.map;
+    *bufferLth=stream.sgmnt_samples*RP_SGMNT_CNT;
+    return RP_API_OK;
+}
+
+/**
+ * Returns the segment and overrun counters of the current or last streaming run.
+ */
+RP_STATUS rp_GetStreamingStats(RP_STREAMING_STATS * stats)
+{
+    if(stats==NULL){
+        return RP_NULL_PARAMETER;
+    }
+    pthread_mutex_lock(&stream.mutex);
+    stats->segments=stream.produced;
+    stats->delivered=stream.delivered;
+    stats->overruns=stream.overruns;
+    pthread_mutex_unlock(&stream.mutex);
+    return RP_API_OK;
+}
 
 RP_STATUS rp_GetTrigPosition(uint32_t * tigger_pos){
 	*tigger_pos=acq_data.trig_sample;
 	return RP_API_OK;
 }
 
+/** Copies len samples starting at index first of the DMA buffer, unwrapping at its end */
+static void rp_RingCopy(int16_t * dst, const int16_t * ring, uint32_t ring_len, uint32_t first, uint32_t len)
+{
+    uint32_t n=ring_len-first;
+    n=n<len ? n : len;
+    memcpy(dst, ring+first, n*sizeof(int16_t));
+    memcpy(dst+n, ring, (len-n)*sizeof(int16_t));
+}
+
+/**
+ * Walks RLE words back from the last one until total samples are covered.
+ * Returns the first word, the number of words, the number of words after the trigger
+ * and by how much the first run is longer than needed. Without enough data the whole
+ * buffer is returned.
+ */
+static void rp_RleFindFirst(const int16_t * ring, uint32_t ring_len, uint32_t last, uint64_t total, uint32_t post,
+                            uint32_t * first, uint32_t * words, uint32_t * trig_words, uint32_t * len_adj)
+{
+    uint64_t len=0;
+    uint32_t i=0;
+    bool trig_found=false;
+
+    *trig_words=0;
+    // last..0, then the older words at the end of the buffer
+    for(int pass=0; pass<2; pass++){
+        int32_t hi=pass==0 ? (int32_t)last : (int32_t)ring_len-1;
+        int32_t lo=pass==0 ? 0 : (int32_t)last+1;
+        for(int32_t k=hi; k>=lo; k--){
+            i++;
+            len+=((uint8_t)(ring[k]>>8))+1;
+            if(!trig_found && len+1>=post){
+                *trig_words=i;
+                trig_found=true;
+            }
+            if(len>=total){
+                *first=k;
+                *words=i;
+                *len_adj=len-total;
+                return;
+            }
+        }
+    }
+    *first=(last+1)%ring_len;
+    *words=ring_len;
+    *len_adj=0;
+}
+
+static void rp_DownsampleInit(rp_downsample_t * ds, RP_RATIO_MODE mode, uint32_t ratio, uint32_t skip, uint32_t out_len)
+{
+    memset(ds, 0, sizeof(rp_downsample_t));
+    ds->mode=mode;
+    ds->ratio=mode==RP_RATIO_MODE_NONE ? 1 : ratio;
+    ds->skip=skip;
+    ds->out=acq_data.buf;
+    ds->out_min=mode==RP_RATIO_MODE_AGGREGATE ? acq_data.buf_min : NULL;
+    ds->out_len=out_len;
+}
+
+static inline bool rp_DownsampleFull(const rp_downsample_t * ds)
+{
+    return ds->out_cnt>=ds->out_len;
+}
+
+static void rp_DownsampleEmit(rp_downsample_t * ds)
+{
+    int16_t value=ds->first;
+    if(ds->mode==RP_RATIO_MODE_AGGREGATE){
+        value=ds->or_acc;
+        if(ds->out_min){
+            ds->out_min[ds->out_cnt]=ds->and_acc;
+        }
+    }
+    else if(ds->mode==RP_RATIO_MODE_AVERAGE){
+        // per channel majority over the window
+        value=0;
+        for(int b=0; b<16; b++){
+            if(2*ds->ones[b]>=ds->fill){
+                value|=1<<b;
+            }
+        }
+    }
+    ds->out[ds->out_cnt++]=value;
+    ds->fill=0;
+}
+
+/** Adds len samples of the same value, whole windows inside the run are written directly */
+static void rp_DownsamplePushRun(rp_downsample_t * ds, uint16_t value, uint32_t len)
+{
+    if(ds->skip){
+        uint32_t k=ds->skip<len ? ds->skip : len;
+        ds->skip-=k;
+        len-=k;
+    }
+    while(len && !rp_DownsampleFull(ds)){
+        if(ds->fill==0 && len>=ds->ratio){
+            uint32_t n=len/ds->ratio;
+            uint32_t room=ds->out_len-ds->out_cnt;
+            n=n<room ? n : room;
+            for(uint32_t k=0; k<n; k++){
+                ds->out[ds->out_cnt+k]=value;
+            }
+            if(ds->out_min){
+                for(uint32_t k=0; k<n; k++){
+                    ds->out_min[ds->out_cnt+k]=value;
+                }
+            }
+            ds->out_cnt+=n;
+            len-=n*ds->ratio;
+            continue;
+        }
+
+        uint32_t k=ds->ratio-ds->fill;
+        k=k<len ? k : len;
+        if(ds->fill==0){
+            ds->first=value;
+            ds->or_acc=0;
+            ds->and_acc=0xFFFF;
+            memset(ds->ones, 0, sizeof(ds->ones));
+        }
+        ds->or_acc|=value;
+        ds->and_acc&=value;
+        if(ds->mode==RP_RATIO_MODE_AVERAGE){
+            for(int b=0; b<16; b++){
+                if(value&(1<<b)){
+                    ds->ones[b]+=k;
+                }
+            }
+        }
+        ds->fill+=k;
+        len-=k;
+        if(ds->fill==ds->ratio){
+            rp_DownsampleEmit(ds);
+        }
+    }
+}
+
+/** Adds len consecutive samples */
+static void rp_DownsamplePush(rp_downsample_t * ds, const int16_t * src, uint32_t len)
+{
+    if(ds->mode==RP_RATIO_MODE_DECIMATE && !ds->skip){
+        // first sample of every window, strided
+        uint32_t k=ds->dec_skip<len ? ds->dec_skip : len;
+        ds->dec_skip-=k;
+        for(; k<len && !rp_DownsampleFull(ds); k+=ds->ratio){
+            ds->out[ds->out_cnt++]=src[k];
+        }
+        // the rest of the last window is at the start of the next span
+        if(k>len){
+            ds->dec_skip=k-len;
+        }
+        return;
+    }
+    for(uint32_t k=0; k<len && !rp_DownsampleFull(ds); k++){
+        rp_DownsamplePushRun(ds, src[k], 1);
+    }
+}
+
+/** Emits the last, partly filled window */
+static void rp_DownsampleFinish(rp_downsample_t * ds)
+{
+    if(ds->fill && !rp_DownsampleFull(ds)){
+        rp_DownsampleEmit(ds);
+    }
+}
+
 /**
  * This function returns block-mode data, with or without down-sampling, starting at the
  * specified sample number. It is used to get the stored data from the driver after data
@@ -443,158 +928,105 @@ RP_STATUS rp_GetValues(uint32_t startIndex,
                       //uint32_t segmentIndex,
                       int16_t * overflow){
 
-    // TODO: startIndex & noOfSamples not used yet..
+    const int16_t * map=(const int16_t *)la_acq_handle.dma_mem;
+    uint32_t buf_len=rp_LaAcqBufLenInSamples(&la_acq_handle);
 
-    int16_t * map=NULL;
-    map = (int16_t *) mmap(NULL, la_acq_handle.dma_size, PROT_READ | PROT_WRITE, MAP_SHARED, la_acq_handle.dma_fd, 0);
-    if (map==NULL) {
-        printf("Failed to mmap\n");
-        if (la_acq_handle.dma_fd) {
-            close(la_acq_handle.dma_fd);
-        }
-        return -1;
+    if(map==NULL){
+        return RP_MEMORY_FAIL;
     }
-
-    bool rle;
-    rp_LaAcqIsRLE(&la_acq_handle,&rle);
-    if(rle){ // RLE mode
-        // try to find first sample and trigger sample
-        uint32_t first_sample=0;
-        uint32_t samples=0;
-        acq_data.trig_sample=0;
-
-        uint32_t fist_sample_len_adj;
-
-        uint32_t len=0;
-        uint32_t i=0;
-        uint32_t index = acq_data.last_sample;
-        uint32_t total = acq_data.pre_samples+acq_data.post_samples;
-       // printf("\n\rtotal: %d", total);
-        bool trig_sample_found=false;
-
-			// find first and last sample
-			i=0;
-			len=0;
-			for(;;){
-
-				i++;
-				len+=((uint8_t)(map[index]>>8))+1;
-
-				// trigger position
-				if(!trig_sample_found){
-					if(len>=(acq_data.post_samples-1)){
-						//printf("\n\rtrig. sample found: i=%d len=%d", i, len);
-						acq_data.trig_sample=i;
-						trig_sample_found=true;
-					}
-				}
-
-				// first sample position
-				if(len>=total){
-					first_sample=index;
-					samples=i;
-
-					// adjust first sample length so that it fits to the
-					// length of requested data
-
-					fist_sample_len_adj=len-total;
-
-					//printf("len %d >= total %d\n", len, total);
-					break;
-				}
-
-			    //printf("\n\r sta: samples=%d trig=%d, ", samples, acq_data.trig_sample);
-			    //printf("\r\n %d len: %02x val: %02x ", i,(uint8_t)(map[index]>>8),(uint8_t)map[index]);
-
-				if(index==0){
-					index=rp_LaAcqBufLenInSamples(&la_acq_handle)-1;
-				}
-				else{
-					index--;
-				}
-
-
-			}
-
-		//	printf("fist_sample_len_adj %d\n", fist_sample_len_adj);
-
-			// copy data
-			index=first_sample;
-			for(i=0;i<samples;i++){
-				if(index>=rp_LaAcqBufLenInSamples(&la_acq_handle)){
-					index=0;
-				}
-
-				acq_data.buf[i]=map[index];
-				 // adjust length of first sample
-				if(i==0){
-					acq_data.buf[i]-=(int16_t)(fist_sample_len_adj<<8);
-				}
-
-				index++;
-			}
-
-
-
-			acq_data.trig_sample=samples-acq_data.trig_sample;
-
-			printf("\n\r sta: samples=%d trig=%d", samples, acq_data.trig_sample);
-			for(i=0;i<samples;i++){
-				printf("\r\n %d len: %02x val: %02x ", i,(uint8_t)(acq_data.buf[i]>>8),(uint8_t)acq_data.buf[i]);
-			}
-
-			*noOfSamples=samples;
+    if(acq_data.buf==NULL){
+        return RP_BUFFERS_NOT_SET;
+    }
+    if(downSampleRatioMode<RP_RATIO_MODE_NONE || downSampleRatioMode>RP_RATIO_MODE_DECIMATE){
+        return RP_RATIO_MODE_NOT_SUPPORTED;
+    }
+    if(downSampleRatioMode!=RP_RATIO_MODE_NONE && downSampleRatio==0){
+        return RP_INVALID_SAMPLERATIO;
+    }
+    if(overflow){
+        *overflow=0;
     }
-    else{
-
-        int32_t first_sample =   acq_data.trig_sample - acq_data.pre_samples;
-        int32_t last_sample =   acq_data.trig_sample + acq_data.post_samples;
-        int32_t buf_len =  rp_LaAcqBufLenInSamples(&la_acq_handle);
-
-        printf("\n\r req: pre=%d pos=%d\n\r", acq_data.pre_samples, acq_data.post_samples);
-        printf("\n\r sta: first=%d trig=%d last=%d\n\r", first_sample, acq_data.trig_sample, last_sample);
-
-        int32_t wlen;
-        if(first_sample<0){
-
-            printf("\n\r first_sample > last_sample\n\r");
-
-            wlen=abs(first_sample);
-            first_sample=buf_len+first_sample;
-            printf("\n\r sta: first=%d wlen=%d\n\r", first_sample, wlen);
-            for(int i=0; i<wlen; i++){
-                acq_data.buf[i]=map[first_sample+i];
-            }
-            for(int i=0; i<last_sample; i++){
-                acq_data.buf[wlen+i]=map[i];
-            }
 
-        }
-        else if(last_sample>=buf_len){
+    uint32_t max_out=*noOfSamples<acq_data.buf_size ? *noOfSamples : acq_data.buf_size;
 
-            printf("\n\r last_sample > size\n\r");
+    rp_downsample_t ds;
+    rp_DownsampleInit(&ds, downSampleRatioMode, downSampleRatio, startIndex, max_out);
 
-            wlen=buf_len-first_sample;
-            for(int i=0; i<wlen; i++){
-                acq_data.buf[i]=map[first_sample+i];
+    bool rle;
+    rp_LaAcqIsRLE(&la_acq_handle,&rle);
+    if(rle){ // RLE mode
+        uint32_t first;
+        uint32_t words;
+        uint32_t trig_words;
+        uint32_t len_adj;
+        rp_RleFindFirst(map, buf_len, acq_data.last_sample,
+                        (uint64_t)acq_data.pre_samples+acq_data.post_samples, acq_data.post_samples,
+                        &first, &words, &trig_words, &len_adj);
+
+        if(downSampleRatioMode==RP_RATIO_MODE_NONE){
+            // RLE words are returned as they are, startIndex counts words
+            if(startIndex>=words){
+                return RP_STARTINDEX_INVALID;
             }
-            last_sample-=buf_len;
-            for(int i=0; i<last_sample; i++){
-                acq_data.buf[wlen+i]=map[i];
+            uint32_t n=words-startIndex;
+            n=n<max_out ? n : max_out;
+            rp_RingCopy(acq_data.buf, map, buf_len, (first+startIndex)%buf_len, n);
+            // adjust length of first sample
+            if(startIndex==0 && n>0){
+                acq_data.buf[0]-=(int16_t)(len_adj<<8);
             }
-
+            acq_data.trig_sample=words-trig_words;
+            *noOfSamples=n;
         }
         else{
-            printf("\n\r last_sample > first_sample\n\r");
-            for(int i=0; i<(*noOfSamples); i++){
-                acq_data.buf[i]=map[first_sample+i];
+            // expanded to samples and down-sampled in the same pass, startIndex counts samples
+            uint32_t w=0;
+            uint32_t index=first;
+            while(w<words && !rp_DownsampleFull(&ds)){
+                uint32_t span=buf_len-index;
+                span=span<words-w ? span : words-w;
+                for(uint32_t k=0; k<span; k++){
+                    int16_t word=map[index+k];
+                    uint32_t run=((uint8_t)(word>>8))+1;
+                    if(w+k==0){
+                        run-=len_adj;
+                    }
+                    rp_DownsamplePushRun(&ds, (uint8_t)word, run);
+                }
+                w+=span;
+                index=0;
             }
+            rp_DownsampleFinish(&ds);
+            acq_data.trig_sample=acq_data.pre_samples>startIndex ? (acq_data.pre_samples-startIndex)/downSampleRatio : 0;
+            *noOfSamples=ds.out_cnt;
         }
     }
+    else{
+        uint32_t total=acq_data.pre_samples+acq_data.post_samples;
+        if(startIndex>=total){
+            return RP_STARTINDEX_INVALID;
+        }
+        int64_t first=(int64_t)acq_data.trig_sample-acq_data.pre_samples+startIndex;
+        first%=buf_len;
+        if(first<0){
+            first+=buf_len;
+        }
+        uint32_t avail=total-startIndex;
 
-    if(munmap (map, la_acq_handle.dma_size)==-1){
-        printf("Failed to munmap\n");
-        return -1;
+        if(downSampleRatioMode==RP_RATIO_MODE_NONE){
+            uint32_t n=avail<max_out ? avail : max_out;
+            rp_RingCopy(acq_data.buf, map, buf_len, first, n);
+            *noOfSamples=n;
+        }
+        else{
+            ds.skip=0;
+            uint32_t span=buf_len-first;
+            span=span<avail ? span : avail;
+            rp_DownsamplePush(&ds, map+first, span);
+            rp_DownsamplePush(&ds, map, avail-span);
+            rp_DownsampleFinish(&ds);
+            *noOfSamples=ds.out_cnt;
+        }
     }
 
     return RP_API_OK;
@@ -633,6 +1065,9 @@ RP_STATUS rp_GetValuesAsync(
  * This function instructs the driver to return the next block of values to your
  * rpStreamingReady() callback. You must have previously called
  * rpRunStreaming() beforehand to set up streaming.
+ * All segments completed since the last call are delivered in place: startIndex points into
+ * the buffer returned by rp_GetStreamingBuffer(), overflow is set when segments were lost.
+ * Returns RP_BUSY when no new segment is available.
  *
  * @param rpReady          A pointer to your rpStreamingReady() callback.
  * @param pParameter    A void pointer that will be passed to the rpStreamingReady() callback.
@@ -642,31 +1077,29 @@ RP_STATUS rp_GetValuesAsync(
 RP_STATUS rp_GetStreamingLatestValues(rpStreamingReady rpReady,
                                      void * pParameter)
 {
-    // block read
-    int32_t noOfSamples;
-    uint32_t startIndex;
-    int16_t overflow;
-    uint32_t triggerAt;
-    int16_t triggered;
-    int16_t autoStop;
-
-    noOfSamples=0;
-    startIndex=0;
-    overflow=0;
-    triggerAt=0;
-    triggered=0;
-    autoStop=0;
-
-    // acquisition is completed -> callback
-    (*rpReady)(noOfSamples,
-               startIndex,
-               overflow,
-               triggerAt,
-               triggered,
-               autoStop,
-               pParameter);
+    if(!stream.active){
+        return RP_INVALID_STATE;
+    }
+    if(stream.has_consumer){
+        return RP_INVALID_CALL;
+    }
 
-    return RP_API_OK;
+    RP_STATUS status=RP_BUSY;
+    pthread_mutex_lock(&stream.mutex);
+    if(stream.delivering){
+        status=RP_USER_CALLBACK;
+    }
+    else{
+        // at most two runs: up to the end of the buffer and from its start
+        while(rp_StreamingDeliver(rpReady, pParameter)){
+            status=RP_API_OK;
+        }
+        if(status==RP_BUSY && stream.failed){
+            status=RP_STREAMING_FAILED;
+        }
+    }
+    pthread_mutex_unlock(&stream.mutex);
+    return status;
 }
 
 /**
@@ -675,6 +1108,10 @@ RP_STATUS rp_GetStreamingLatestValues(rpStreamingReady rpReady,
  * Always call this function after the end of a capture to ensure that the scope is ready for the next capture.
  */
 RP_STATUS rp_Stop(void){
+	if(stream.active){
+		rp_StreamingStop();
+		return RP_API_OK;
+	}
 	return rp_SoftwareTrigger();
 	//return rp_LaAcqStopAcq(&la_acq_handle);
 }
@@ -176,6 +176,12 @@ typedef enum rpTimeUnits {
 } RP_TIME_UNITS;
 
 
+typedef struct rpStreamingStats {
+    uint64_t segments;  ///< DMA segments completed since rp_RunStreaming()
+    uint64_t delivered; ///< segments handed to the rpStreamingReady() callback
+    uint64_t overruns;  ///< segments overwritten by DMA before or while they were delivered
+} RP_STREAMING_STATS;
+
 typedef void (*rpBlockReady)(RP_STATUS rp_status,
                              void * pParameter);
 
@@ -212,6 +218,11 @@ RP_STATUS rp_SetDataBuffer(int16_t * buffer,
                           // uint32_t segmentIndex,
                           RP_RATIO_MODE mode);
 
+RP_STATUS rp_SetDataBuffers(int16_t * bufferMax,
+                           int16_t * bufferMin,
+                           int32_t bufferLth,
+                           RP_RATIO_MODE mode);
+
 RP_STATUS rp_RunBlock(uint32_t noOfPreTriggerSamples,
                        uint32_t noOfPostTriggerSamples,
                        uint32_t timebase,
@@ -231,6 +242,14 @@ RP_STATUS rp_RunStreaming(uint32_t * sampleInterval,
                         RP_RATIO_MODE downSampleRatioMode,
                         uint32_t overviewBufferSize);
 
+RP_STATUS rp_SetStreamingCallback(rpStreamingReady rpReady,
+                                  void * pParameter);
+
+RP_STATUS rp_GetStreamingBuffer(int16_t ** buffer,
+                                uint32_t * bufferLth);
+
+RP_STATUS rp_GetStreamingStats(RP_STREAMING_STATS * stats);
+
 RP_STATUS rp_GetTrigPosition(uint32_t * tigger_pos);
 
 RP_STATUS rp_GetValues(uint32_t startIndex,
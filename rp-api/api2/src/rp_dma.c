@@ -17,9 +17,6 @@
 #include "rp_dma.h"
 
 
-#define RP_SGMNT_CNT 8 // 240/RP_SGMNT_CNT must be int
-#define RP_SGMNT_SIZE (256*1024)
-
 int rp_DmaOpen(const char *dev, rp_handle_uio_t *handle) {
     // make a copy of the device path
     handle->dma_dev = (char*) malloc((strlen(dev)+1) * sizeof(char));
@@ -34,6 +31,13 @@ int rp_DmaOpen(const char *dev, rp_handle_uio_t *handle) {
     handle->dma_size=RP_SGMNT_CNT*RP_SGMNT_SIZE;
     rp_SetSgmntC(handle,RP_SGMNT_CNT);
     rp_SetSgmntS(handle,RP_SGMNT_SIZE);
+    // map once, readers use handle->dma_mem instead of mapping per access
+    handle->dma_mem = mmap(NULL, handle->dma_size, PROT_READ | PROT_WRITE, MAP_SHARED, handle->dma_fd, 0);
+    if (handle->dma_mem == MAP_FAILED) {
+        handle->dma_mem = NULL;
+        printf("Failed to mmap\n");
+        return -1;
+    }
     return RP_OK;
 }
 
@@ -71,6 +75,10 @@ int rp_DmaRead(rp_handle_uio_t *handle) {
 }
 
 int rp_DmaClose(rp_handle_uio_t *handle) {
+    if(handle->dma_mem){
+        munmap(handle->dma_mem, handle->dma_size);
+        handle->dma_mem=NULL;
+    }
     if(handle->dma_fd){
         if(close(handle->dma_fd)==-1){
             return -1;
@@ -18,6 +18,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define RP_SGMNT_CNT 8 // 240/RP_SGMNT_CNT must be int
+#define RP_SGMNT_SIZE (256*1024)
+
 typedef enum {
     RP_DMA_SINGLE,
     RP_DMA_CYCLIC,
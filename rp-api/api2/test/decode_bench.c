@@ -0,0 +1,302 @@
+/**
+ * $Id: $
+ *
+ * @brief Benchmark for the logic analyzer protocol decoders. Builds synthetic
+ *        UART, SPI and I2C captures, decodes them in RLE form and in a form with
+ *        one word per sample, checks the results against the generated data and
+ *        prints the decoding times.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "rp_api.h"
+#include "la_decode.h"
+
+#define SAMPLE_RATE 125e6
+#define REPEAT      10
+
+/** Capture under construction */
+typedef struct {
+    int16_t  *w;
+    uint32_t  n;
+    uint32_t  cap;
+    uint8_t   level;
+    uint64_t  samples;
+    uint64_t  max_samples;
+    uint16_t *expected;     ///< generated data values in decoding order
+    uint32_t  n_expected;
+} capture_t;
+
+static double nowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void capInit(capture_t *c, uint64_t samples, uint8_t level)
+{
+    memset(c, 0, sizeof(*c));
+    c->cap = samples / 16 + 1024;
+    c->w = malloc(c->cap * sizeof(int16_t));
+    c->expected = malloc((samples / 64 + 16) * sizeof(uint16_t));
+    c->level = level;
+    c->max_samples = samples;
+}
+
+static void capFree(capture_t *c)
+{
+    free(c->w);
+    free(c->expected);
+}
+
+static bool capFull(const capture_t *c)
+{
+    return c->samples >= c->max_samples;
+}
+
+/* Keeps the current level for len samples */
+static void hold(capture_t *c, uint64_t len)
+{
+    c->samples += len;
+    while (len > 0) {
+        if (c->n > 0 && RP_LA_RLE_VALUE(c->w[c->n - 1]) == c->level && RP_LA_RLE_LENGTH(c->w[c->n - 1]) < 256) {
+            uint32_t room = 256 - RP_LA_RLE_LENGTH(c->w[c->n - 1]);
+            uint32_t k = len < room ? len : room;
+            c->w[c->n - 1] = (int16_t)((uint16_t)c->w[c->n - 1] + (k << 8));
+            len -= k;
+            continue;
+        }
+        if (c->n == c->cap) {
+            c->cap *= 2;
+            c->w = realloc(c->w, c->cap * sizeof(int16_t));
+        }
+        uint32_t k = len < 256 ? len : 256;
+        c->w[c->n++] = (int16_t)(((k - 1) << 8) | c->level);
+        len -= k;
+    }
+}
+
+static void set(capture_t *c, uint8_t mask, bool on)
+{
+    c->level = on ? (c->level | mask) : (c->level & ~mask);
+}
+
+static void expect(capture_t *c, uint16_t value)
+{
+    c->expected[c->n_expected++] = value;
+}
+
+/* Same capture with one word per sample, which is what decoding costs without RLE */
+static int16_t *expand(const capture_t *c, uint32_t *n)
+{
+    int16_t *out = malloc(c->samples * sizeof(int16_t));
+    uint64_t k = 0;
+    for (uint32_t i = 0; i < c->n; i++) {
+        for (uint32_t j = 0; j < RP_LA_RLE_LENGTH(c->w[i]); j++) {
+            out[k++] = RP_LA_RLE_VALUE(c->w[i]);
+        }
+    }
+    *n = k;
+    return out;
+}
+
+/* UART 115200 8N1 on channel 0 */
+static void genUart(capture_t *c, const RP_UART_DECODER *d)
+{
+    const uint8_t rx = 1 << d->rx;
+    double t = 0;
+    hold(c, 1000);
+    while (!capFull(c)) {
+        uint16_t ch = rand() & 0xFF;
+        expect(c, ch);
+        uint64_t start = c->samples;
+        for (int k = 0; k < 10; k++) {
+            bool b = k == 0 ? 0 : k == 9 ? 1 : (ch >> (k - 1)) & 1;
+            set(c, rx, b);
+            t += d->samplesPerBit;
+            hold(c, (uint64_t)t + start - c->samples);
+        }
+        // idle gap of up to three characters
+        uint64_t gap = (uint64_t)(d->samplesPerBit * (rand() % 30));
+        hold(c, gap);
+        t = 0;
+    }
+}
+
+/* SPI mode 0, 1 MHz clock, 4 byte transfers with active low chip select */
+static void genSpi(capture_t *c, const RP_SPI_DECODER *d)
+{
+    const uint8_t clk = 1 << d->clk, mosi = 1 << d->mosi, miso = 1 << d->miso, cs = 1 << d->cs;
+    const uint32_t half = 62;
+    set(c, cs, 1);
+    hold(c, 1000);
+    while (!capFull(c)) {
+        set(c, cs, 0);
+        hold(c, half);
+        for (int b = 0; b < 4; b++) {
+            uint16_t out = rand() & 0xFF, in = rand() & 0xFF;
+            expect(c, out);
+            expect(c, in);
+            for (int k = 7; k >= 0; k--) {
+                set(c, mosi, (out >> k) & 1);
+                set(c, miso, (in >> k) & 1);
+                hold(c, half);
+                set(c, clk, 1);
+                hold(c, half);
+                set(c, clk, 0);
+            }
+            hold(c, half * 4);
+        }
+        set(c, cs, 1);
+        hold(c, half * (20 + rand() % 200));
+    }
+}
+
+static void i2cBit(capture_t *c, uint8_t scl, uint8_t sda, bool b, uint32_t quarter)
+{
+    set(c, sda, b);
+    hold(c, quarter);
+    set(c, scl, 1);
+    hold(c, 2 * quarter);
+    set(c, scl, 0);
+    hold(c, quarter);
+}
+
+/* I2C 100 kHz: address, three data bytes, the last one not acknowledged */
+static void genI2c(capture_t *c, const RP_I2C_DECODER *d)
+{
+    const uint8_t scl = 1 << d->scl, sda = 1 << d->sda;
+    const uint32_t quarter = 312;
+    set(c, scl | sda, 1);
+    hold(c, 1000);
+    while (!capFull(c)) {
+        set(c, sda, 0);
+        hold(c, quarter);
+        set(c, scl, 0);
+        hold(c, quarter);
+        for (int b = 0; b < 4; b++) {
+            uint16_t byte = rand() & 0xFF;
+            expect(c, byte);
+            for (int k = 7; k >= 0; k--) {
+                i2cBit(c, scl, sda, (byte >> k) & 1, quarter);
+            }
+            i2cBit(c, scl, sda, b == 3, quarter);
+        }
+        set(c, sda, 0);
+        hold(c, quarter);
+        set(c, scl, 1);
+        hold(c, quarter);
+        set(c, sda, 1);
+        hold(c, quarter * (8 + rand() % 40));
+    }
+}
+
+typedef RP_STATUS (*decode_func)(const int16_t *, uint32_t, const void *, RP_LA_EVENT *, uint32_t *);
+
+static double timeDecode(decode_func f, const int16_t *w, uint32_t n, const void *d,
+                         RP_LA_EVENT *ev, uint32_t size, uint32_t *cnt, int repeat)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeat; r++) {
+        *cnt = size;
+        double t0 = nowMs();
+        if (f(w, n, d, ev, cnt) != RP_API_OK) {
+            fprintf(stderr, "Decoder failed\n");
+            exit(1);
+        }
+        double t = nowMs() - t0;
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+/* Compares data events against the generated values, skipping start and stop conditions */
+static bool check(const capture_t *c, const RP_LA_EVENT *ev, uint32_t cnt)
+{
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < cnt; i++) {
+        if (ev[i].type == RP_LA_EVENT_I2C_START || ev[i].type == RP_LA_EVENT_I2C_STOP) {
+            continue;
+        }
+        if (k >= c->n_expected || ev[i].data != c->expected[k] ||
+            (ev[i].flags & ~RP_LA_EVENT_NACK) != 0) {
+            fprintf(stderr, "Mismatch at event %u\n", i);
+            return false;
+        }
+        k++;
+    }
+    // the last frame may be cut by the end of the capture
+    return k + 8 >= c->n_expected;
+}
+
+static bool run(const char *name, capture_t *c, decode_func f, const void *d)
+{
+    uint32_t size = c->n_expected * 2 + 16;
+    RP_LA_EVENT *ev = malloc(size * sizeof(RP_LA_EVENT));
+    RP_LA_EVENT *ev_ref = malloc(size * sizeof(RP_LA_EVENT));
+    uint32_t cnt, cnt_ref, n_ref;
+
+    double t_rle = timeDecode(f, c->w, c->n, d, ev, size, &cnt, REPEAT);
+
+    double t0 = nowMs();
+    int16_t *ref = expand(c, &n_ref);
+    double t_exp = nowMs() - t0;
+    double t_ref = timeDecode(f, ref, n_ref, d, ev_ref, size, &cnt_ref, 1);
+
+    bool ok = check(c, ev, cnt) && cnt == cnt_ref && memcmp(ev, ev_ref, cnt * sizeof(RP_LA_EVENT)) == 0;
+    printf("%-5s %9.1f Msamples %8u RLE words %7u events  RLE %8.2f ms (%7.1f Msamples/s)  "
+           "per sample %8.2f ms + expand %8.2f ms  speedup %6.1fx  %s\n",
+           name, c->samples / 1e6, c->n, cnt, t_rle, c->samples / t_rle / 1e3,
+           t_ref, t_exp, (t_ref + t_exp) / t_rle, ok ? "OK" : "FAILED");
+
+    free(ref);
+    free(ev);
+    free(ev_ref);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t samples = argc > 1 ? strtoull(argv[1], NULL, 0) : 64 * 1024 * 1024;
+    bool ok = true;
+    capture_t c;
+    srand(1);
+
+    RP_UART_DECODER uart = { .rx = RP_DIGITAL_CHANNEL_0, .samplesPerBit = SAMPLE_RATE / 115200,
+                             .dataBits = 8, .parity = RP_UART_PARITY_NONE, .stopBits = 1 };
+    capInit(&c, samples, 0xFF);
+    genUart(&c, &uart);
+    ok &= run("UART", &c, (decode_func)rp_DecodeUart, &uart);
+    capFree(&c);
+
+    RP_SPI_DECODER spi = { .clk = RP_DIGITAL_CHANNEL_1, .mosi = RP_DIGITAL_CHANNEL_2, .miso = RP_DIGITAL_CHANNEL_3,
+                           .cs = RP_DIGITAL_CHANNEL_4, .wordBits = 8 };
+    capInit(&c, samples, 0);
+    genSpi(&c, &spi);
+    ok &= run("SPI", &c, (decode_func)rp_DecodeSpi, &spi);
+    capFree(&c);
+
+    RP_I2C_DECODER i2c = { .scl = RP_DIGITAL_CHANNEL_5, .sda = RP_DIGITAL_CHANNEL_6 };
+    capInit(&c, samples, 0);
+    genI2c(&c, &i2c);
+    ok &= run("I2C", &c, (decode_func)rp_DecodeI2c, &i2c);
+    capFree(&c);
+
+    return ok ? 0 : 1;
+}
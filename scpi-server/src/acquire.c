@@ -22,8 +22,13 @@
 #include "scpi/parser.h"
 #include "scpi/units.h"
 
+#define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
 
 rp_scpi_acq_unit_t unit     = RP_SCPI_VOLTS;        // default value
+rp_scpi_endian_t   endian   = RP_SCPI_BIG_ENDIAN;   // default value
+
+/* Sample buffer shared by the ACQ:SOUR#:DATA queries, sized for a full ADC buffer */
+static void *data_buffer = NULL;
 
 /* These structures are a direct API mirror 
 and should not be altered! */
@@ -33,6 +38,12 @@ const scpi_choice_def_t scpi_RpUnits[] = {
     SCPI_CHOICE_LIST_END
 };
 
+const scpi_choice_def_t scpi_RpEndian[] = {
+    {"BIG", RP_SCPI_BIG_ENDIAN},
+    {"LITTLE", RP_SCPI_LITTLE_ENDIAN},
+    SCPI_CHOICE_LIST_END
+};
+
 const scpi_choice_def_t scpi_RpGain[] = {
     {"LV", 0},
     {"HV", 1},
@@ -85,6 +96,37 @@ const scpi_choice_def_t scpi_RpTrigStat[] = {
     SCPI_CHOICE_LIST_END
 };
 
+/* Returns the shared sample buffer and its capacity in samples, or NULL if it cannot be allocated */
+static void *getDataBuffer(uint32_t *capacity) {
+    uint32_t size_buff;
+    rp_AcqGetBufSize(&size_buff);
+    if (data_buffer == NULL) {
+        data_buffer = malloc(size_buff * sizeof(float));
+        if (data_buffer == NULL) {
+            RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA Failed to allocate data buffer.\n");
+            return NULL;
+        }
+    }
+    *capacity = size_buff;
+    return data_buffer;
+}
+
+static void resultDataFloat(scpi_t *context, const float *buffer, uint32_t size) {
+    if (context->binary_output) {
+        RP_ResultBinBlock(context, buffer, sizeof(float), size, endian);
+    } else {
+        SCPI_ResultBufferFloat(context, buffer, size);
+    }
+}
+
+static void resultDataInt16(scpi_t *context, const int16_t *buffer, uint32_t size) {
+    if (context->binary_output) {
+        RP_ResultBinBlock(context, buffer, sizeof(int16_t), size, endian);
+    } else {
+        SCPI_ResultBufferInt16(context, buffer, size);
+    }
+}
+
 scpi_result_t RP_AcqSetDataFormat(scpi_t *context) {
     const char * param;
     size_t param_len;
@@ -111,6 +153,41 @@ scpi_result_t RP_AcqSetDataFormat(scpi_t *context) {
     return SCPI_RES_OK;
 }
 
+scpi_result_t RP_AcqDataFormatQ(scpi_t *context) {
+    SCPI_ResultMnemonic(context, context->binary_output ? "BIN" : "ASCII");
+
+    RP_LOG(LOG_INFO, "*ACQ:DATA:FORMAT? Successfully returned data format.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqDataEndian(scpi_t *context) {
+    int32_t choice;
+
+    if(!SCPI_ParamChoice(context, scpi_RpEndian, &choice, true)){
+        RP_LOG(LOG_ERR, "*ACQ:DATA:ENDIAN Missing first parameter.\n");
+        return SCPI_RES_ERR;
+    }
+
+    endian = choice;
+
+    RP_LOG(LOG_INFO, "*ACQ:DATA:ENDIAN Successfully set binary byte order.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqDataEndianQ(scpi_t *context) {
+    const char *name;
+
+    if(!SCPI_ChoiceToName(scpi_RpEndian, endian, &name)){
+        RP_LOG(LOG_ERR, "*ACQ:DATA:ENDIAN? Failed to get byte order.\n");
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultMnemonic(context, name);
+
+    RP_LOG(LOG_INFO, "*ACQ:DATA:ENDIAN? Successfully returned byte order.\n");
+    return SCPI_RES_OK;
+}
+
 
 scpi_result_t RP_AcqStart(scpi_t *context) {
     int result = rp_AcqStart();
@@ -165,6 +242,7 @@ scpi_result_t RP_AcqReset(scpi_t *context) {
     }
 
     unit = RP_SCPI_VOLTS;
+    endian = RP_SCPI_BIG_ENDIAN;
     context->binary_output = false;
 
     RP_LOG(LOG_INFO, "*ACQ:RST Successful reset  Red Pitaya acquire.\n");
@@ -664,9 +742,14 @@ scpi_result_t RP_AcqDataPosQ(scpi_t *context) {
         return SCPI_RES_ERR;
     }
 
-    uint32_t size = end - start;
+    uint32_t size;
+    void *data = getDataBuffer(&size);
+    if(data == NULL){
+        return SCPI_RES_ERR;
+    }
+
     if(unit == RP_SCPI_VOLTS){
-        float buffer[size];
+        float *buffer = data;
         result = rp_AcqGetDataPosV(channel, start, end, buffer, &size);
         
         if(result != RP_OK){
@@ -674,10 +757,10 @@ scpi_result_t RP_AcqDataPosQ(scpi_t *context) {
             return SCPI_RES_ERR;
         }
         
-        SCPI_ResultBufferFloat(context, buffer, size);
+        resultDataFloat(context, buffer, size);
 
     }else{
-        int16_t buffer[size];
+        int16_t *buffer = data;
         result = rp_AcqGetDataPosRaw(channel, start, end, buffer, &size);
         
         if(result != RP_OK){
@@ -685,7 +768,7 @@ scpi_result_t RP_AcqDataPosQ(scpi_t *context) {
             return SCPI_RES_ERR;
         }
 
-        SCPI_ResultBufferInt16(context, buffer, size);
+        resultDataInt16(context, buffer, size);
     }
 
     RP_LOG(LOG_INFO, "*ACQ:SOUR#:DATA:STA:END? Successfully returned data to client.\n");
@@ -716,9 +799,14 @@ scpi_result_t RP_AcqDataQ(scpi_t *context) {
     }
 
     uint32_t size_buff;
-    rp_AcqGetBufSize(&size_buff);
+    void *data = getDataBuffer(&size_buff);
+    if(data == NULL){
+        return SCPI_RES_ERR;
+    }
+    size = MIN(size, size_buff);
+
     if(unit == RP_SCPI_VOLTS){
-        float buffer[size_buff - start];
+        float *buffer = data;
         result = rp_AcqGetDataV(channel, start, &size, buffer);
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR<n>:DATA:STA:N? Failed to get "
@@ -726,10 +814,10 @@ scpi_result_t RP_AcqDataQ(scpi_t *context) {
             return SCPI_RES_ERR;
         }
 
-        SCPI_ResultBufferFloat(context, buffer, size);
+        resultDataFloat(context, buffer, size);
 
     }else{
-        int16_t buffer[size_buff - start];
+        int16_t *buffer = data;
         result = rp_AcqGetDataRaw(channel, start, &size, buffer);
 
         if(result != RP_OK){
@@ -737,7 +825,7 @@ scpi_result_t RP_AcqDataQ(scpi_t *context) {
             return SCPI_RES_ERR;
         }
 
-        SCPI_ResultBufferInt16(context, buffer, size);
+        resultDataInt16(context, buffer, size);
     }
 
     RP_LOG(LOG_INFO, "*ACQ:SOUR<n>:DATA:STA:N? Successfully returned data.\n");
@@ -755,9 +843,13 @@ scpi_result_t RP_AcqDataOldestAllQ(scpi_t *context) {
         return SCPI_RES_ERR;
     }
     
-    rp_AcqGetBufSize(&size);
+    void *data = getDataBuffer(&size);
+    if(data == NULL){
+        return SCPI_RES_ERR;
+    }
+
     if(unit == RP_SCPI_VOLTS){
-        float buffer[size];
+        float *buffer = data;
         result = rp_AcqGetOldestDataV(channel, &size, buffer);
 
         if(result != RP_OK){
@@ -765,17 +857,17 @@ scpi_result_t RP_AcqDataOldestAllQ(scpi_t *context) {
             return SCPI_RES_ERR;
         }
 
-        SCPI_ResultBufferFloat(context, buffer, size);
+        resultDataFloat(context, buffer, size);
 
     }else{
-        int16_t buffer[size];
+        int16_t *buffer = data;
         result = rp_AcqGetOldestDataRaw(channel, &size, buffer);
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA? Failed to get raw data: %s\n", rp_GetError(result));
             return SCPI_RES_ERR;
         }
 
-        SCPI_ResultBufferInt16(context, buffer, size);
+        resultDataInt16(context, buffer, size);
     }
 
     RP_LOG(LOG_INFO, "*ACQ:SOUR#:DATA? Successfully returned data.\n");
@@ -798,8 +890,15 @@ scpi_result_t RP_AcqOldestDataQ(scpi_t *context) {
         return SCPI_RES_ERR;
     }
 
+    uint32_t size_buff;
+    void *data = getDataBuffer(&size_buff);
+    if(data == NULL){
+        return SCPI_RES_ERR;
+    }
+    size = MIN(size, size_buff);
+
     if(unit == RP_SCPI_VOLTS){
-        float buffer[size];
+        float *buffer = data;
         result = rp_AcqGetOldestDataV(channel, &size, buffer);
 
         if(result != RP_OK){
@@ -809,17 +908,17 @@ scpi_result_t RP_AcqOldestDataQ(scpi_t *context) {
             return SCPI_RES_ERR;
         }
 
-        SCPI_ResultBufferFloat(context, buffer, size);
+        resultDataFloat(context, buffer, size);
 
     }else{
-        int16_t buffer[size];
+        int16_t *buffer = data;
         result = rp_AcqGetOldestDataRaw(channel, &size, buffer);
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR#:DATA:OLD:N? Failed to get raw data: %s\n", rp_GetError(result));
             return SCPI_RES_ERR;
         }
 
-        SCPI_ResultBufferInt16(context, buffer, size);
+        resultDataInt16(context, buffer, size);
     }
 
     RP_LOG(LOG_INFO, "*ACQ:SOUR#:DATA:OLD:N? Successfully returned data to client.");
@@ -842,8 +941,15 @@ scpi_result_t RP_AcqLatestDataQ(scpi_t *context) {
         return SCPI_RES_ERR;
     }
 
+    uint32_t size_buff;
+    void *data = getDataBuffer(&size_buff);
+    if(data == NULL){
+        return SCPI_RES_ERR;
+    }
+    size = MIN(size, size_buff);
+
     if(unit == RP_SCPI_VOLTS){
-        float buffer[size];
+        float *buffer = data;
         result = rp_AcqGetLatestDataV(channel, &size, buffer);
 
         if(result != RP_OK){
@@ -852,17 +958,18 @@ scpi_result_t RP_AcqLatestDataQ(scpi_t *context) {
             return SCPI_RES_ERR;
         }
 
-        SCPI_ResultBufferFloat(context, buffer, size);
+        resultDataFloat(context, buffer, size);
     }else{
-        int16_t buffer[size];
+        int16_t *buffer = data;
         result = rp_AcqGetLatestDataRaw(channel, &size, buffer);
 
         if(result != RP_OK){
             RP_LOG(LOG_ERR, "*ACQ:SOUR<n>:DATA:LAT:N? Failed to "
                 "get raw data: %s\n", rp_GetError(result));
+            return SCPI_RES_ERR;
         }
 
-        SCPI_ResultBufferInt16(context, buffer, size);
+        resultDataInt16(context, buffer, size);
     }
 
     RP_LOG(LOG_INFO, "*ACQ:SOUR<n>:DATA:LAT:N? Successfully returned data to client.\n");
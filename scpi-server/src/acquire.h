@@ -18,14 +18,22 @@
 
 #include "scpi/types.h"
 #include "rp.h"
+#include "common.h"
 
 typedef enum {
     RP_SCPI_VOLTS,
     RP_SCPI_RAW,
 } rp_scpi_acq_unit_t;
 
+/* ACQ:DATA:UNITS and ACQ:DATA:ENDIAN of the client being served, swapped per connection by the server */
+extern rp_scpi_acq_unit_t unit;
+extern rp_scpi_endian_t   endian;
+
 int RP_AcqSetDefaultValues();
 scpi_result_t RP_AcqSetDataFormat(scpi_t *context);
+scpi_result_t RP_AcqDataFormatQ(scpi_t *context);
+scpi_result_t RP_AcqDataEndian(scpi_t *context);
+scpi_result_t RP_AcqDataEndianQ(scpi_t *context);
 scpi_result_t RP_AcqStart(scpi_t * context);
 scpi_result_t RP_AcqStop(scpi_t *context);
 scpi_result_t RP_AcqReset(scpi_t * context);
@@ -13,13 +13,22 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "common.h"
 #include "apin.h"
+#include "acquire.h"
 #include "scpi/parser.h"
 //#include "../../api/src/common.h"
 
+/* Scans returned by one ANALOG:CAPT:DATA? query */
+#define CAPTURE_DEFAULT_SCANS 1024
+#define CAPTURE_MAX_SCANS     16384
+
+/* Scan buffer of the ANALOG:CAPT:DATA? query, 4 raw values per scan */
+static uint16_t *capture_buffer = NULL;
+
 /* Apin choice def */
 const scpi_choice_def_t scpi_RpApin[] = {
     {"AOUT0", 0},  //!< Analog output 0
@@ -115,3 +124,113 @@ scpi_result_t RP_AnalogPinValue(scpi_t * context) {
     RP_LOG(LOG_INFO, "*ANALOG:PIN Successfully set port value.\n");
     return SCPI_RES_OK;
 }
+
+/**
+ * Starts continuous capture of the analog inputs at the XADC sample rate
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_AnalogCaptureStart(scpi_t * context) {
+
+    uint32_t rate = 0;
+    uint32_t scans = 0;
+
+    /* Both parameters are optional, 0 keeps the current rate and selects the default ring size */
+    if (!SCPI_ParamUInt32(context, &rate, false)) {
+        rate = 0;
+    }
+    if (!SCPI_ParamUInt32(context, &scans, false)) {
+        scans = 0;
+    }
+
+    int result = rp_AIpinStartCapture(rate, scans);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*ANALOG:CAPT:START Failed to start capture: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*ANALOG:CAPT:START Successfully started capture.\n");
+    return SCPI_RES_OK;
+}
+
+/**
+ * Stops continuous capture of the analog inputs
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_AnalogCaptureStop(scpi_t * context) {
+
+    int result = rp_AIpinStopCapture();
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*ANALOG:CAPT:STOP Failed to stop capture: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*ANALOG:CAPT:STOP Successfully stopped capture.\n");
+    return SCPI_RES_OK;
+}
+
+/**
+ * Returns the XADC sampling frequency in Hz to SCPI context
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_AnalogCaptureRateQ(scpi_t * context) {
+
+    uint32_t rate;
+    int result = rp_AIpinGetCaptureRate(&rate);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*ANALOG:CAPT:RATE? Failed to get sampling frequency: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultUInt32Base(context, rate, 10);
+
+    RP_LOG(LOG_INFO, "*ANALOG:CAPT:RATE? Successfully returned sampling frequency.\n");
+    return SCPI_RES_OK;
+}
+
+/**
+ * Returns the scans captured since the last query, up to the given count.
+ * Each scan holds the raw values of AIN0 to AIN3. The query does not wait,
+ * so the server keeps serving other clients; no data gives an empty result.
+ * The data follows ACQ:DATA:FORMAT and ACQ:DATA:ENDIAN.
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_AnalogCaptureDataQ(scpi_t * context) {
+
+    uint32_t scans;
+
+    if (!SCPI_ParamUInt32(context, &scans, false)) {
+        scans = CAPTURE_DEFAULT_SCANS;
+    }
+    if (scans == 0 || scans > CAPTURE_MAX_SCANS) {
+        RP_LOG(LOG_ERR, "*ANALOG:CAPT:DATA? Scan count must be between 1 and %d.\n", CAPTURE_MAX_SCANS);
+        return SCPI_RES_ERR;
+    }
+
+    if (capture_buffer == NULL) {
+        capture_buffer = malloc(CAPTURE_MAX_SCANS * 4 * sizeof(uint16_t));
+        if (capture_buffer == NULL) {
+            RP_LOG(LOG_ERR, "*ANALOG:CAPT:DATA? Failed to allocate data buffer.\n");
+            return SCPI_RES_ERR;
+        }
+    }
+
+    int result = rp_AIpinReadCapture(capture_buffer, &scans, 0);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*ANALOG:CAPT:DATA? Failed to read capture: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    /* Raw values are 12 bit, so they fit the signed result */
+    if (context->binary_output) {
+        RP_ResultBinBlock(context, capture_buffer, sizeof(uint16_t), scans * 4, endian);
+    } else {
+        SCPI_ResultBufferInt16(context, (const int16_t *)capture_buffer, scans * 4);
+    }
+
+    RP_LOG(LOG_INFO, "*ANALOG:CAPT:DATA? Successfully returned capture data.\n");
+    return SCPI_RES_OK;
+}
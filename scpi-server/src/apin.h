@@ -19,5 +19,9 @@
 scpi_result_t RP_AnalogPinReset(scpi_t * context);
 scpi_result_t RP_AnalogPinValueQ(scpi_t * context);
 scpi_result_t RP_AnalogPinValue(scpi_t * context);
+scpi_result_t RP_AnalogCaptureStart(scpi_t * context);
+scpi_result_t RP_AnalogCaptureStop(scpi_t * context);
+scpi_result_t RP_AnalogCaptureRateQ(scpi_t * context);
+scpi_result_t RP_AnalogCaptureDataQ(scpi_t * context);
 
 #endif /* APIN_H_ */
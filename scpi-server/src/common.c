@@ -14,8 +14,12 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 #include "common.h"
 
+/* Staging size for byte swapped binary block payload */
+#define BIN_BLOCK_CHUNK 4096
+
 const scpi_choice_def_t scpi_RpLogMode[] = {
     {"OFF", RP_SCPI_LOG_OFF},
     {"CONSOLE", RP_SCPI_LOG_CONSOLE},
@@ -70,3 +74,56 @@ void RP_LOG(int mode, const char * format,...){
         vfprintf(stdout, format, args);
     va_end (args);
 }
+
+static bool isHostLittleEndian(){
+    const uint16_t probe = 1;
+    return *(const uint8_t *)&probe == 1;
+}
+
+static size_t writeBlockData(scpi_t *context, const uint8_t *data, size_t elem_size, size_t count, bool swap){
+    uint8_t chunk[BIN_BLOCK_CHUNK];
+    size_t per_chunk = BIN_BLOCK_CHUNK / elem_size;
+    size_t result = 0;
+
+    if (!swap) {
+        return context->interface->write(context, (const char *)data, elem_size * count);
+    }
+
+    while (count > 0) {
+        size_t n = count < per_chunk ? count : per_chunk;
+        size_t bytes = n * elem_size;
+        for (size_t i = 0; i < n; i++) {
+            for (size_t b = 0; b < elem_size; b++) {
+                chunk[i * elem_size + b] = data[i * elem_size + elem_size - 1 - b];
+            }
+        }
+        result += context->interface->write(context, (const char *)chunk, bytes);
+        data += bytes;
+        count -= n;
+    }
+    return result;
+}
+
+size_t RP_ResultBinBlock(scpi_t *context, const void *data, size_t elem_size, size_t count, rp_scpi_endian_t endian){
+    char header[32];
+    char len_str[12];
+    size_t result = 0;
+
+    if (elem_size == 0 || elem_size > BIN_BLOCK_CHUNK) {
+        return 0;
+    }
+
+    if (context->output_count > 0) {
+        result += context->interface->write(context, ",", 1);
+    }
+
+    int len_digits = snprintf(len_str, sizeof(len_str), "%zu", elem_size * count);
+    int header_len = snprintf(header, sizeof(header), "#%d%s", len_digits, len_str);
+    result += context->interface->write(context, header, header_len);
+
+    bool swap = (endian == RP_SCPI_LITTLE_ENDIAN) != isHostLittleEndian();
+    result += writeBlockData(context, (const uint8_t *)data, elem_size, count, swap);
+
+    context->output_count++;
+    return result;
+}
@@ -28,6 +28,11 @@ typedef enum {
     RP_SCPI_LOG_SYSLOG
 } rp_scpi_log;
 
+typedef enum {
+    RP_SCPI_BIG_ENDIAN,
+    RP_SCPI_LITTLE_ENDIAN
+} rp_scpi_endian_t;
+
 
 #define SCPI_CMD_NUM 	1
 
@@ -41,5 +46,8 @@ scpi_result_t RP_SetLogMode(scpi_t *context);
 
 void RP_LOG(int mode,const char * format, ...);
 
+/* Writes count samples of elem_size bytes as an IEEE 488.2 definite length block #<n><len><data> */
+size_t RP_ResultBinBlock(scpi_t *context, const void *data, size_t elem_size, size_t count, rp_scpi_endian_t endian);
+
 
 #endif /* COMMON_H_ */
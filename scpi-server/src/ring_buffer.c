@@ -0,0 +1,155 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya Scpi server byte ring buffer implementation
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ring_buffer.h"
+
+#define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
+
+static size_t roundUpPow2(size_t size) {
+    size_t pow2 = 1;
+    while (pow2 < size) {
+        pow2 <<= 1;
+    }
+    return pow2;
+}
+
+int rb_Init(ring_buffer_t *rb, size_t size, size_t max_size) {
+    rb->size = roundUpPow2(size);
+    rb->max_size = max_size;
+    rb->head = 0;
+    rb->used = 0;
+    rb->data = malloc(rb->size);
+    return rb->data != NULL ? 0 : -1;
+}
+
+void rb_Release(ring_buffer_t *rb) {
+    free(rb->data);
+    rb->data = NULL;
+    rb->size = 0;
+    rb->head = 0;
+    rb->used = 0;
+}
+
+bool rb_Reserve(ring_buffer_t *rb, size_t len) {
+    if (rb_Free(rb) >= len) {
+        return true;
+    }
+
+    size_t new_size = roundUpPow2(rb->used + len);
+    if (new_size > rb->max_size) {
+        return false;
+    }
+
+    char *data = malloc(new_size);
+    if (data == NULL) {
+        return false;
+    }
+
+    // Linearize the stored bytes at the start of the new block
+    rb_Peek(rb, 0, data, rb->used);
+    free(rb->data);
+    rb->data = data;
+    rb->size = new_size;
+    rb->head = 0;
+    return true;
+}
+
+size_t rb_Write(ring_buffer_t *rb, const void *data, size_t len) {
+    if (!rb_Reserve(rb, len)) {
+        return 0;
+    }
+
+    size_t tail = (rb->head + rb->used) & (rb->size - 1);
+    size_t first = MIN(len, rb->size - tail);
+    memcpy(rb->data + tail, data, first);
+    memcpy(rb->data, (const char *)data + first, len - first);
+    rb->used += len;
+    return len;
+}
+
+void rb_Peek(const ring_buffer_t *rb, size_t offset, void *dst, size_t len) {
+    size_t start = (rb->head + offset) & (rb->size - 1);
+    size_t first = MIN(len, rb->size - start);
+    memcpy(dst, rb->data + start, first);
+    memcpy((char *)dst + first, rb->data, len - first);
+}
+
+void rb_Consume(ring_buffer_t *rb, size_t len) {
+    len = MIN(len, rb->used);
+    rb->head = (rb->head + len) & (rb->size - 1);
+    rb->used -= len;
+    if (rb->used == 0) {
+        rb->head = 0;
+    }
+}
+
+long rb_Find(const ring_buffer_t *rb, size_t from, char ch) {
+    if (from >= rb->used) {
+        return -1;
+    }
+
+    size_t start = (rb->head + from) & (rb->size - 1);
+    size_t first = MIN(rb->used - from, rb->size - start);
+    const char *hit = memchr(rb->data + start, ch, first);
+    if (hit != NULL) {
+        return from + (hit - (rb->data + start));
+    }
+
+    hit = memchr(rb->data, ch, rb->used - from - first);
+    if (hit != NULL) {
+        return from + first + (hit - rb->data);
+    }
+    return -1;
+}
+
+int rb_WritableIov(ring_buffer_t *rb, struct iovec iov[2]) {
+    size_t free_len = rb_Free(rb);
+    if (free_len == 0) {
+        return 0;
+    }
+
+    size_t tail = (rb->head + rb->used) & (rb->size - 1);
+    size_t first = MIN(free_len, rb->size - tail);
+    iov[0].iov_base = rb->data + tail;
+    iov[0].iov_len = first;
+    if (first == free_len) {
+        return 1;
+    }
+    iov[1].iov_base = rb->data;
+    iov[1].iov_len = free_len - first;
+    return 2;
+}
+
+void rb_Commit(ring_buffer_t *rb, size_t len) {
+    rb->used += MIN(len, rb_Free(rb));
+}
+
+int rb_ReadableIov(const ring_buffer_t *rb, struct iovec iov[2]) {
+    if (rb->used == 0) {
+        return 0;
+    }
+
+    size_t first = MIN(rb->used, rb->size - rb->head);
+    iov[0].iov_base = rb->data + rb->head;
+    iov[0].iov_len = first;
+    if (first == rb->used) {
+        return 1;
+    }
+    iov[1].iov_base = rb->data;
+    iov[1].iov_len = rb->used - first;
+    return 2;
+}
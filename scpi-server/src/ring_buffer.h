@@ -0,0 +1,55 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya Scpi server byte ring buffer interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+/**
+ * Byte FIFO used for client socket input and output.
+ * Capacity is a power of two and doubles on demand up to max_size.
+ */
+typedef struct {
+    char   *data;
+    size_t  size;       //!< Allocated capacity in bytes (power of two)
+    size_t  max_size;   //!< Upper limit for capacity growth
+    size_t  head;       //!< Read offset
+    size_t  used;       //!< Bytes stored
+} ring_buffer_t;
+
+int  rb_Init(ring_buffer_t *rb, size_t size, size_t max_size);
+void rb_Release(ring_buffer_t *rb);
+
+static inline size_t rb_Used(const ring_buffer_t *rb) { return rb->used; }
+static inline size_t rb_Free(const ring_buffer_t *rb) { return rb->size - rb->used; }
+
+/* Grows the buffer so that at least len more bytes fit. Returns false when max_size would be exceeded. */
+bool   rb_Reserve(ring_buffer_t *rb, size_t len);
+/* Appends len bytes, growing as needed. Returns the number of bytes stored. */
+size_t rb_Write(ring_buffer_t *rb, const void *data, size_t len);
+/* Copies len bytes from offset of the stored data into dst without consuming */
+void   rb_Peek(const ring_buffer_t *rb, size_t offset, void *dst, size_t len);
+void   rb_Consume(ring_buffer_t *rb, size_t len);
+/* Returns offset of the first occurrence of ch after offset from, or -1 */
+long   rb_Find(const ring_buffer_t *rb, size_t from, char ch);
+
+/* Scatter/gather views for readv()/writev(). Return the number of iovecs filled (0..2). */
+int    rb_WritableIov(ring_buffer_t *rb, struct iovec iov[2]);
+void   rb_Commit(ring_buffer_t *rb, size_t len);
+int    rb_ReadableIov(const ring_buffer_t *rb, struct iovec iov[2]);
+
+#endif /* RING_BUFFER_H_ */
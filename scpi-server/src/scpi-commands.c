@@ -20,6 +20,7 @@
 
 #include "api_cmd.h"
 #include "common.h"
+#include "ring_buffer.h"
 #include "dpin.h"
 #include "apin.h"
 #include "uart.h"
@@ -41,24 +42,18 @@ bool RST_executed = FALSE;
  */
 size_t SCPI_Write(scpi_t * context, const char * data, size_t len) {
 
-    size_t total = 0;
+    /* Responses are queued on the client output buffer and sent by the event loop */
     if (context->user_context != NULL) {
-        int fd = *(int *)(context->user_context);
-        while (len > 0) {
-            size_t written =  write(fd, data, len);
-            if (written < 0) {
-                syslog(LOG_ERR,
-                    "Failed to write into the socket. Should send %zu bytes. Could send only %zu bytes",
-                    len, written);
-                return total;
-            }
-            
-            len -= written;
-            data += written;
-            total += written;
+        ring_buffer_t *output = (ring_buffer_t *)(context->user_context);
+        if (rb_Write(output, data, len) != len) {
+            syslog(LOG_ERR,
+                "Failed to queue response. Should queue %zu bytes, output buffer holds %zu bytes",
+                len, rb_Used(output));
+            return 0;
         }
+        return len;
     }
-    return total;
+    return 0;
 }
 
 scpi_result_t SCPI_Flush(scpi_t * context) {
@@ -145,6 +140,10 @@ static const scpi_command_t scpi_commands[] = {
     {.pattern = "ANALOG:RST", .callback                 = RP_AnalogPinReset,},
     {.pattern = "ANALOG:PIN", .callback                 = RP_AnalogPinValue,},
     {.pattern = "ANALOG:PIN?", .callback                = RP_AnalogPinValueQ,},
+    {.pattern = "ANALOG:CAPT:START", .callback          = RP_AnalogCaptureStart,},
+    {.pattern = "ANALOG:CAPT:STOP", .callback           = RP_AnalogCaptureStop,},
+    {.pattern = "ANALOG:CAPT:RATE?", .callback          = RP_AnalogCaptureRateQ,},
+    {.pattern = "ANALOG:CAPT:DATA?", .callback          = RP_AnalogCaptureDataQ,},
 
     /* Acquire */
     {.pattern = "ACQ:START", .callback                  = RP_AcqStart,},
@@ -172,6 +171,9 @@ static const scpi_command_t scpi_commands[] = {
     {.pattern = "ACQ:DATA:UNITS", .callback             = RP_AcqScpiDataUnits,},
     {.pattern = "ACQ:DATA:UNITS?", .callback            = RP_AcqScpiDataUnitsQ,},
     {.pattern = "ACQ:DATA:FORMAT", .callback            = RP_AcqSetDataFormat,},
+    {.pattern = "ACQ:DATA:FORMAT?", .callback           = RP_AcqDataFormatQ,},
+    {.pattern = "ACQ:DATA:ENDIAN", .callback            = RP_AcqDataEndian,},
+    {.pattern = "ACQ:DATA:ENDIAN?", .callback           = RP_AcqDataEndianQ,},
     {.pattern = "ACQ:SOUR#:DATA:STA:END?", .callback    = RP_AcqDataPosQ,},
     {.pattern = "ACQ:SOUR#:DATA:STA:N?", .callback      = RP_AcqDataQ,},
     {.pattern = "ACQ:SOUR#:DATA:OLD:N?", .callback      = RP_AcqOldestDataQ,},
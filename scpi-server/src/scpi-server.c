@@ -18,7 +18,11 @@
 #include <string.h>
 
 #include <netinet/in.h>
-#include <sys/prctl.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <arpa/inet.h>
 #include <signal.h>
@@ -27,6 +31,8 @@
 
 #include "scpi-commands.h"
 #include "common.h"
+#include "ring_buffer.h"
+#include "acquire.h"
 
 #include "scpi/parser.h"
 #include "rp.h"
@@ -37,20 +43,50 @@
 
 #define LISTEN_BACKLOG 50
 #define LISTEN_PORT 5000
-#define MAX_BUFF_SIZE 1024
+#define MAX_EVENTS 64
+#define MAX_CLIENTS 32
+#define SOCKET_SNDBUF (1024 * 512)
+
+#define INPUT_BUFFER_SIZE (1024 * 4)
+#define INPUT_BUFFER_LIMIT (1024 * 1024)
+#define OUTPUT_BUFFER_SIZE (1024 * 64)
+#define OUTPUT_BUFFER_LIMIT (1024 * 1024 * 16)
+
+/* Commands executed per client before the loop services other clients */
+#define COMMANDS_PER_TURN 16
+/* Client input is not executed while this much output is still queued */
+#define OUTPUT_HIGH_WATER (1024 * 1024 * 2)
+/* Errors kept per client between commands, the length of the parser error queue */
+#define CLIENT_ERROR_QUEUE 16
+
+typedef struct rp_scpi_client_s {
+    int           fd;
+    char          ip[INET_ADDRSTRLEN];
+    ring_buffer_t input;
+    ring_buffer_t output;
+    bool          binary_output;    //!< Per connection ACQ:DATA:FORMAT
+    rp_scpi_acq_unit_t units;       //!< Per connection ACQ:DATA:UNITS
+    rp_scpi_endian_t   endian;      //!< Per connection ACQ:DATA:ENDIAN
+    scpi_reg_val_t registers[SCPI_REG_COUNT]; //!< Per connection status registers
+    int16_t       errors[CLIENT_ERROR_QUEUE]; //!< Per connection error queue, oldest first
+    int           error_count;
+    uint32_t      events;           //!< Currently armed epoll events
+    bool          closing;          //!< Peer closed its side, drop after output is flushed
+    struct rp_scpi_client_s *next;
+} rp_scpi_client_t;
 
 static bool app_exit = false;
 static char delimiter[] = "\r\n";
+static rp_scpi_client_t *clients = NULL;
+static int client_count = 0;
 
+/* Scratch buffer holding one command for SCPI_Input */
+static char *command_buff = NULL;
+static size_t command_len = 0;
 
-static void handleCloseChildEvents()
-{
-    struct sigaction sigchld_action = {
-            .sa_handler = SIG_DFL,
-            .sa_flags = SA_NOCLDWAIT
-    };
-    sigaction(SIGCHLD, &sigchld_action, NULL);
-}
+/* Used while the errors of a client are pushed back, so they are not reported twice */
+static scpi_interface_t restore_interface;
+static scpi_reg_val_t restore_registers[SCPI_REG_COUNT];
 
 
 static void termSignalHandler(int signum)
@@ -67,36 +103,28 @@ static void installTermSignalHandler()
     action.sa_handler = termSignalHandler;
     sigaction(SIGTERM, &action, NULL);
     sigaction(SIGINT, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
 }
 
 /**
- * Helper method which returns next command position from the buffer.
- * @param buffer     Input buffer
- * @param bufferLen  Input buffer length
- * @return Position of next command within buffer, or -1 if not found.
+ * Helper method which returns the length of the next command in the client input.
+ * @param input  Client input buffer
+ * @return Length of next command including delimiter, or -1 if not complete yet.
  */
-static size_t getNextCommand(const char* buffer, size_t bufferLen)
+static long getNextCommand(const ring_buffer_t *input)
 {
     size_t delimiterLen = sizeof(delimiter) - 1; // dont count last null char.
-    size_t i = 0;
-    for (i = 0; i < bufferLen; i++) {
-
-        // Find match for end of delimiter
-        if (buffer[i] == delimiter[delimiterLen - 1]) {
-
-            // Now go back checking if all delimiter character matches
-            size_t dist = 0;
-            while (i - dist >= 0 && delimiterLen - dist > 0) {
-                if (buffer[i - dist] != delimiter[delimiterLen - dist - 1]) {
-                    break;
-                }
-                if (delimiterLen - dist - 1 == 0) {
-                    return i + 1; // Position of next command
-                }
-
-                dist++;
+    long pos = rb_Find(input, 0, delimiter[delimiterLen - 1]);
+
+    while (pos >= 0) {
+        if ((size_t)pos + 1 >= delimiterLen) {
+            char tail[sizeof(delimiter)];
+            rb_Peek(input, pos + 1 - delimiterLen, tail, delimiterLen);
+            if (memcmp(tail, delimiter, delimiterLen) == 0) {
+                return pos + 1; // Position of next command
             }
         }
+        pos = rb_Find(input, pos + 1, delimiter[delimiterLen - 1]);
     }
 
     // No match found
@@ -114,95 +142,285 @@ void LogMessage(char *m, size_t len) {
     RP_LOG(LOG_INFO, "Processing command: %s\n", buff);
 }
 
-/**
- * This is main method of every child process. Here communication with client is handled.
- * @param connfd The communication port
- * @return
- */
-static int handleConnection(int connfd) {
-    int read_size;
-
-    size_t message_len = MAX_BUFF_SIZE;
-    char *message_buff = malloc(message_len);
-    char buffer[MAX_BUFF_SIZE];
-    size_t msg_end = 0;
-
-    installTermSignalHandler();
+static int setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
 
-    prctl( 1, SIGTERM );
+static void updateEvents(int epfd, rp_scpi_client_t *client)
+{
+    // Stop reading while the client has a backlog, so a slow reader cannot grow buffers without bound
+    bool want_read = !client->closing
+                     && rb_Used(&client->output) < OUTPUT_HIGH_WATER
+                     && rb_Used(&client->input) < INPUT_BUFFER_LIMIT;
+    bool want_write = rb_Used(&client->output) > 0;
+    uint32_t events = (want_read ? EPOLLIN | EPOLLRDHUP : 0) | (want_write ? EPOLLOUT : 0);
+    if (events == client->events) {
+        return;
+    }
 
-    RP_LOG(LOG_INFO, "Waiting for first client request.");
-    int buf = 1024 * 16;
-    if (setsockopt(connfd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(int)) == -1) {
-        RP_LOG(LOG_ERR, "Error setting socket opts: %s\n", strerror(errno));
+    struct epoll_event ev = {
+        .events = events,
+        .data.ptr = client
+    };
+    if (epoll_ctl(epfd, EPOLL_CTL_MOD, client->fd, &ev) == -1) {
+        RP_LOG(LOG_ERR, "Failed to update client events (%s)", strerror(errno));
+        return;
     }
+    client->events = events;
+}
 
-    buf = 1024 * 16;
-    if (setsockopt(connfd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(int)) == -1) {
-        RP_LOG(LOG_ERR, "Error setting socket opts: %s\n", strerror(errno));
+static void closeClient(int epfd, rp_scpi_client_t *client)
+{
+    rp_scpi_client_t **link = &clients;
+    while (*link != NULL && *link != client) {
+        link = &(*link)->next;
     }
-    //Receive a message from client
-    while( (read_size = recv(connfd , buffer , MAX_BUFF_SIZE , 0)) > 0 )
-    {
-        if (app_exit) {
-            break;
+    if (*link != NULL) {
+        *link = client->next;
+    }
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    RP_LOG(LOG_INFO, "Closing connection with client ip %s.", client->ip);
+
+    rb_Release(&client->input);
+    rb_Release(&client->output);
+    free(client);
+    client_count--;
+}
+
+static void acceptClients(int epfd, int listenfd)
+{
+    while (1) {
+        struct sockaddr_in cliaddr;
+        socklen_t clilen = sizeof(cliaddr);
+
+        int connfd = accept(listenfd, (struct sockaddr *)&cliaddr, &clilen);
+        if (connfd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                RP_LOG(LOG_ERR, "Failed to accept connection (%s)", strerror(errno));
+            }
+            return;
         }
 
-        // First make sure that message buffer is large enough
-        while (msg_end + read_size >= message_len) {
-            message_len *= 2;
-            message_buff = realloc(message_buff, message_len);
+        if (client_count >= MAX_CLIENTS) {
+            RP_LOG(LOG_ERR, "Too many clients, rejecting connection from %s", inet_ntoa(cliaddr.sin_addr));
+            close(connfd);
+            continue;
         }
 
-        // Copy read buffer into message buffer
-        memcpy(message_buff + msg_end, buffer, read_size);
-        msg_end += read_size;
+        rp_scpi_client_t *client = calloc(1, sizeof(rp_scpi_client_t));
+        if (client == NULL
+            || rb_Init(&client->input, INPUT_BUFFER_SIZE, INPUT_BUFFER_LIMIT) != 0
+            || rb_Init(&client->output, OUTPUT_BUFFER_SIZE, OUTPUT_BUFFER_LIMIT) != 0
+            || setNonBlocking(connfd) == -1) {
+            RP_LOG(LOG_ERR, "Failed to set up client connection");
+            if (client != NULL) {
+                rb_Release(&client->input);
+                rb_Release(&client->output);
+                free(client);
+            }
+            close(connfd);
+            continue;
+        }
 
-        // Now try to parse each command out
-        char *m = message_buff;
-        size_t pos = -1;
-        while ((pos = getNextCommand(m, msg_end)) != -1) {
+        int opt = 1;
+        if (setsockopt(connfd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(int)) == -1) {
+            RP_LOG(LOG_ERR, "Error setting socket opts: %s\n", strerror(errno));
+        }
+        opt = SOCKET_SNDBUF;
+        if (setsockopt(connfd, SOL_SOCKET, SO_SNDBUF, &opt, sizeof(int)) == -1) {
+            RP_LOG(LOG_ERR, "Error setting socket opts: %s\n", strerror(errno));
+        }
 
-            // Log out message
-            LogMessage(m, pos);
+        client->fd = connfd;
+        client->units = RP_SCPI_VOLTS;
+        client->endian = RP_SCPI_BIG_ENDIAN;
+        client->events = EPOLLIN | EPOLLRDHUP;
+        inet_ntop(AF_INET, &cliaddr.sin_addr, client->ip, sizeof(client->ip));
+
+        struct epoll_event ev = {
+            .events = client->events,
+            .data.ptr = client
+        };
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, connfd, &ev) == -1) {
+            RP_LOG(LOG_ERR, "Failed to register client (%s)", strerror(errno));
+            rb_Release(&client->input);
+            rb_Release(&client->output);
+            free(client);
+            close(connfd);
+            continue;
+        }
+
+        client->next = clients;
+        clients = client;
+        client_count++;
 
-            //Parse the message and return response
-            SCPI_Input(&scpi_context, m, pos);
-            m += pos;
-            msg_end -= pos;
+        RP_LOG(LOG_INFO, "Connection with client ip %s established.", client->ip);
+    }
+}
+
+/**
+ * Reads everything available on the socket into the client input buffer.
+ * @return false if the connection failed and must be closed.
+ */
+static bool readClient(rp_scpi_client_t *client)
+{
+    while (1) {
+        struct iovec iov[2];
+
+        if (rb_Free(&client->input) == 0 && !rb_Reserve(&client->input, INPUT_BUFFER_SIZE)) {
+            // Input limit reached: wait for queued commands to run, or drop a client sending an endless command
+            if (getNextCommand(&client->input) == -1) {
+                RP_LOG(LOG_ERR, "Command from client ip %s exceeds input buffer limit", client->ip);
+                return false;
+            }
+            return true;
         }
 
-        // Move the rest of the message to the beginning of the buffer
-        if (message_buff != m && msg_end > 0) {
-            memmove(message_buff, m, msg_end);
+        int cnt = rb_WritableIov(&client->input, iov);
+        ssize_t read_size = readv(client->fd, iov, cnt);
+        if (read_size > 0) {
+            rb_Commit(&client->input, read_size);
+            continue;
+        }
+        if (read_size == 0) {
+            RP_LOG(LOG_INFO, "Client is disconnected");
+            client->closing = true;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
         }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return true;
+        }
+        RP_LOG(LOG_ERR, "Receive message failed (%s)", strerror(errno));
+        return false;
+    }
+}
 
-        RP_LOG(LOG_INFO, "Waiting for next client request.\n");
+/**
+ * Sends as much queued output as the socket accepts.
+ * @return false if the connection failed and must be closed.
+ */
+static bool writeClient(rp_scpi_client_t *client)
+{
+    while (rb_Used(&client->output) > 0) {
+        struct iovec iov[2];
+        int cnt = rb_ReadableIov(&client->output, iov);
+        ssize_t written = writev(client->fd, iov, cnt);
+        if (written > 0) {
+            rb_Consume(&client->output, written);
+            continue;
+        }
+        if (written == -1 && errno == EINTR) {
+            continue;
+        }
+        if (written == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        RP_LOG(LOG_ERR, "Failed to write into the socket (%s)", strerror(errno));
+        return false;
     }
+    return true;
+}
 
-    free(message_buff);
+/**
+ * Loads the per connection state of the client into the shared SCPI context.
+ * The context holds no errors here, the errors of the client are pushed back in order.
+ */
+static void restoreClientState(rp_scpi_client_t *client)
+{
+    unit = client->units;
+    endian = client->endian;
+    scpi_context.binary_output = client->binary_output;
+
+    if (client->error_count > 0) {
+        scpi_interface_t *interface = scpi_context.interface;
+        scpi_context.interface = &restore_interface;
+        scpi_context.registers = restore_registers;
+        for (int i = 0; i < client->error_count; i++) {
+            SCPI_ErrorPush(&scpi_context, client->errors[i]);
+        }
+        scpi_context.interface = interface;
+    }
 
-    RP_LOG(LOG_INFO, "Closing client connection...");
+    scpi_context.registers = client->registers;
+    scpi_context.user_context = &client->output;
+}
 
-    if(read_size == 0)
-    {
-        RP_LOG(LOG_INFO, "Client is disconnected");
-        return 0;
+/**
+ * Stores the per connection state of the client and leaves the error queue of the context empty.
+ */
+static void saveClientState(rp_scpi_client_t *client)
+{
+    int16_t err;
+
+    client->units = unit;
+    client->endian = endian;
+    client->binary_output = scpi_context.binary_output;
+
+    client->error_count = 0;
+    while ((err = SCPI_ErrorPop(&scpi_context)) != SCPI_ERROR_NO_ERROR) {
+        if (client->error_count < CLIENT_ERROR_QUEUE) {
+            client->errors[client->error_count++] = err;
+        }
     }
-    else if(read_size == -1)
-    {
-        RP_LOG(LOG_ERR, "Receive message failed (%s)", strerror(errno));
-        perror("Receive message failed");
-        return 1;
+
+    scpi_context.user_context = NULL;
+}
+
+/**
+ * Executes up to COMMANDS_PER_TURN complete commands from the client input.
+ * All commands of all clients run on this thread, which is the only owner of the API.
+ * @return true if complete commands are still waiting.
+ */
+static bool executeClient(rp_scpi_client_t *client)
+{
+    int executed = 0;
+    long pos;
+
+    while (executed < COMMANDS_PER_TURN
+           && rb_Used(&client->output) < OUTPUT_HIGH_WATER
+           && (pos = getNextCommand(&client->input)) != -1) {
+
+        if ((size_t)pos > command_len) {
+            char *buff = realloc(command_buff, pos);
+            if (buff == NULL) {
+                RP_LOG(LOG_ERR, "Failed to allocate command buffer");
+                return false;
+            }
+            command_buff = buff;
+            command_len = pos;
+        }
+        rb_Peek(&client->input, 0, command_buff, pos);
+        rb_Consume(&client->input, pos);
+
+        // Log out message
+        LogMessage(command_buff, pos);
+
+        //Parse the message and queue the response on this client
+        restoreClientState(client);
+        SCPI_Input(&scpi_context, command_buff, pos);
+        saveClientState(client);
+
+        executed++;
     }
-    return 0;
+
+    return rb_Used(&client->output) < OUTPUT_HIGH_WATER && getNextCommand(&client->input) != -1;
 }
 
 
 /**
- * Main daemon entrance point. Opens a socket and listens for any incoming connection.
- * When client connects, if forks the conversation into a new socket and the daemon (parent process)
- * waits for another connection. It can handle multiple connections simultaneously.
+ * Main daemon entrance point. Opens a socket and serves all connections from a single
+ * epoll event loop. Commands are executed in the order they arrive on each connection,
+ * clients take turns so a streaming client does not starve others.
  * @param argc  not used
  * @param argv  not used
  * @return
@@ -218,13 +436,9 @@ int main(int argc, char *argv[])
 
     installTermSignalHandler();
 
-    int listenfd = 0, connfd = 0;
+    int listenfd = 0, epfd = 0;
     struct sockaddr_in serv_addr;
 
-    // Handle close child events
-    handleCloseChildEvents();
-
-
     int result = rp_Init();
     if (result != RP_OK) {
         RP_LOG(LOG_ERR, "Failed to initialize RP APP library: %s", rp_GetError(result));
@@ -239,11 +453,15 @@ int main(int argc, char *argv[])
 
 
 
-    // user_context will be pointer to socket
+    // user_context will be pointer to the output buffer of the client being served
     scpi_context.user_context = NULL;
     scpi_context.binary_output = false;
     SCPI_Init(&scpi_context);
     RP_ResetAll(&scpi_context); // need for set default values of scpi
+    SCPI_ErrorClear(&scpi_context);
+
+    restore_interface = *scpi_context.interface;
+    restore_interface.error = NULL;
 
     // Create a socket
     listenfd = socket(AF_INET, SOCK_STREAM, 0);
@@ -254,18 +472,14 @@ int main(int argc, char *argv[])
         return (EXIT_FAILURE);
     }
 
-    memset(&serv_addr, '0', sizeof(serv_addr));
+    memset(&serv_addr, 0, sizeof(serv_addr));
 
     serv_addr.sin_family = AF_INET;
     serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
     serv_addr.sin_port = htons(LISTEN_PORT);
-    int buf = 1024 * 16;
-    if (setsockopt(listenfd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(int)) == -1) {
-        RP_LOG(LOG_ERR, "Error setting socket opts: %s\n", strerror(errno));
-    }
 
-    buf = 1024 * 16;
-    if (setsockopt(listenfd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(int)) == -1) {
+    int opt = 1;
+    if (setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(int)) == -1) {
         RP_LOG(LOG_ERR, "Error setting socket opts: %s\n", strerror(errno));
     }
 
@@ -276,61 +490,86 @@ int main(int argc, char *argv[])
         return (EXIT_FAILURE);
     }
 
-    if (listen(listenfd, LISTEN_BACKLOG) == -1)
+    if (listen(listenfd, LISTEN_BACKLOG) == -1 || setNonBlocking(listenfd) == -1)
     {
         RP_LOG(LOG_ERR, "Failed to listen on the socket (%s)", strerror(errno));
         perror("Failed to listen on the socket");
         return (EXIT_FAILURE);
     }
 
-    RP_LOG(LOG_INFO, "Server is listening on port %d\n", LISTEN_PORT);
-
-    // Socket is opened and listening on port. Now we can accept connections
-    while(1)
+    epfd = epoll_create1(0);
+    struct epoll_event listen_ev = {
+        .events = EPOLLIN,
+        .data.ptr = NULL
+    };
+    if (epfd == -1 || epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &listen_ev) == -1)
     {
-        struct sockaddr_in cliaddr;
-        socklen_t clilen;
-        clilen = sizeof(cliaddr);
+        RP_LOG(LOG_ERR, "Failed to create event loop (%s)", strerror(errno));
+        perror("Failed to create event loop");
+        return (EXIT_FAILURE);
+    }
 
-        connfd = accept(listenfd, (struct sockaddr *)&cliaddr, &clilen);
+    RP_LOG(LOG_INFO, "Server is listening on port %d\n", LISTEN_PORT);
 
-        if (app_exit == true) {
-            break;
-        }
+    struct epoll_event events[MAX_EVENTS];
+    bool pending = false;
 
-        if (connfd == -1) {
-            RP_LOG(LOG_ERR, "Failed to accept connection (%s)", strerror(errno));
-            perror("Failed to accept connection\n");
-            return (EXIT_FAILURE);
+    // Socket is opened and listening on port. Now we serve all connections from this loop
+    while (!app_exit)
+    {
+        // Do not sleep while some client still has queued commands
+        int count = epoll_wait(epfd, events, MAX_EVENTS, pending ? 0 : -1);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            RP_LOG(LOG_ERR, "Event loop failed (%s)", strerror(errno));
+            break;
         }
 
-        // Fork a child process, which will talk to the client
-        if (!fork()) {
-
-            RP_LOG(LOG_INFO, "Connection with client ip %s established.", inet_ntoa(cliaddr.sin_addr));
+        for (int i = 0; i < count; i++) {
+            rp_scpi_client_t *client = events[i].data.ptr;
 
-            // this is the child process
-            close(listenfd); // child doesn't need the listener
-
-            scpi_context.user_context = &connfd;
+            if (client == NULL) {
+                acceptClients(epfd, listenfd);
+                continue;
+            }
 
-            result = handleConnection(connfd);
+            bool ok = true;
+            if (events[i].events & EPOLLOUT) {
+                ok = writeClient(client);
+            }
+            if (ok && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+                ok = readClient(client);
+            }
+            if (!ok || (events[i].events & EPOLLERR)) {
+                closeClient(epfd, client);
+            }
+        }
 
-            close(connfd);
+        // Run queued commands, one turn per client
+        pending = false;
+        rp_scpi_client_t *client = clients;
+        while (client != NULL) {
+            rp_scpi_client_t *next = client->next;
 
-            RP_LOG(LOG_INFO, "Closing connection with client ip %s.", inet_ntoa(cliaddr.sin_addr));
+            pending |= executeClient(client);
 
-            if (result == 0) {
-                return(EXIT_SUCCESS);
-            }
-            else {
-                return(EXIT_FAILURE);
+            bool ok = writeClient(client);
+            if (!ok || (client->closing && rb_Used(&client->output) == 0 && getNextCommand(&client->input) == -1)) {
+                closeClient(epfd, client);
+            } else {
+                updateEvents(epfd, client);
             }
+            client = next;
         }
-
-        close(connfd);
     }
 
+    while (clients != NULL) {
+        closeClient(epfd, clients);
+    }
+    free(command_buff);
+    close(epfd);
     close(listenfd);
 
     result = rp_Release();